@@ -195,6 +195,7 @@ namespace CellParams {
                            * this is the max allowed timestep over all particle species.*/
       MAXFDT,             /*!< maximum timestep allowed in ordinary space by fieldsolver for this cell**/
       LBWEIGHTCOUNTER,    /*!< Counter for storing compute time weights needed by the load balancing**/
+      LBCOMPUTETIME,      /*!< Measured compute time (s of rank wall-clock time) of the step preceding a load balance, used by multi-constraint load balancing**/
       ISCELLSAVINGF,      /*!< Value telling whether a cell is saving its distribution function when partial f data is written out. */
       FSGRID_RANK, /*!< Rank of this cell in the FsGrid cartesian communicator */
       FSGRID_BOUNDARYTYPE, /*!< Boundary type of this cell, as stored in the fsGrid */
@@ -225,6 +226,7 @@ namespace CellParams {
       BULKV_FORCING_Y, /*! Externally forced drift velocity (ex. from the ionosphere) */
       BULKV_FORCING_Z, /*! Externally forced drift velocity (ex. from the ionosphere) */
       NU0, /*!< nu0 value for subgrid diffusion */
+      PAD_SKIP, /*!< 1 if the moments rule out pitch-angle diffusion in this cell, set with the interpolated moments */
       N_SPATIAL_CELL_PARAMS
    };
 }
@@ -757,6 +757,18 @@ void initializeDataReducers(DataReducer * outputReducer, DataReducer * diagnosti
             continue;
          }
       }
+      if(P::systemWriteAllDROs || lowercase == "populations_vg_velocity_extent") {
+         // Per-population velocity space bounding box of existing blocks
+         for(unsigned int i =0; i < getObjectWrapper().particleSpecies.size(); i++) {
+            species::Species& species=getObjectWrapper().particleSpecies[i];
+            const std::string& pop = species.name;
+            outputReducer->addOperator(new DRO::VelocityExtent(i));
+            outputReducer->addMetadata(outputReducer->size()-1,"m/s","$\\mathrm{m}\\,\\mathrm{s}^{-1}$","$V_\\mathrm{"+pop+",extent}$","1.0");
+         }
+         if(!P::systemWriteAllDROs) {
+            continue;
+         }
+      }
       if(P::systemWriteAllDROs || lowercase == "fsaved" || lowercase == "vg_fsaved" || lowercase == "vg_f_saved") {
          // Boolean marker whether a velocity space is saved in a given spatial cell
          outputReducer->addOperator(new DRO::DataReductionOperatorCellParams("vg_f_saved",CellParams::ISCELLSAVINGF,1));
@@ -3645,6 +3657,15 @@ void initializeDataReducers(DataReducer * outputReducer, DataReducer * diagnosti
             continue;
          }
       }
+      if(P::diagnosticWriteAllDROs || lowercase == "populations_vg_velocity_extent") {
+         // Per-population largest velocity covered by the velocity mesh
+         for(unsigned int i =0; i < getObjectWrapper().particleSpecies.size(); i++) {
+            diagnosticReducer->addOperator(new DRO::VelocityExtent(i));
+         }
+         if(!P::diagnosticWriteAllDROs) {
+            continue;
+         }
+      }
       if(P::diagnosticWriteAllDROs || lowercase == "vg_rhom" || lowercase == "rhom") {
          // Overall mass density
          diagnosticReducer->addOperator(new DRO::DataReductionOperatorCellParams("vg_rhom",CellParams::RHOM,1));
@@ -3836,6 +3857,26 @@ bool DataReducer::reduceDiagnostic(const SpatialCell* cell,const unsigned int& o
    return true;
 }
 
+/** Check whether the diagnostic value of the given DataReductionOperator can be
+ * computed for several cells concurrently with reduceDiagnosticConcurrent.
+ * @param operatorID ID number of the selected DataReductionOperator.
+ * @return If true, reduceDiagnosticConcurrent may be called from several threads.*/
+bool DataReducer::isDiagnosticThreadSafe(const unsigned int& operatorID) const {
+   if (operatorID >= operators.size()) return false;
+   return operators[operatorID]->isDiagnosticThreadSafe();
+}
+
+/** Thread-safe version of reduceDiagnostic for operators for which
+ * isDiagnosticThreadSafe returns true.
+ * @param cell The SpatialCell to reduce data out of.
+ * @param operatorID ID number of the selected DataReductionOperator.
+ * @param result Buffer in which the reduced data is written.
+ * @return If true, DataReductionOperator reduced data successfully.*/
+bool DataReducer::reduceDiagnosticConcurrent(const SpatialCell* cell,const unsigned int& operatorID,Real * result) const {
+   if (operatorID >= operators.size()) return false;
+   return operators[operatorID]->reduceDiagnosticConcurrent(cell,result);
+}
+
 /** Get the number of DataReductionOperators stored in DataReducer.
  * @return Number of DataReductionOperators stored in DataReducer.
  */
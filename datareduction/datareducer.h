@@ -53,6 +53,8 @@ class DataReducer {
    bool hasParameters(const unsigned int& operatorID) const;
    bool reduceData(const SpatialCell* cell,const unsigned int& operatorID,char* buffer);
    bool reduceDiagnostic(const SpatialCell* cell,const unsigned int& operatorID,Real * result);
+   bool isDiagnosticThreadSafe(const unsigned int& operatorID) const;
+   bool reduceDiagnosticConcurrent(const SpatialCell* cell,const unsigned int& operatorID,Real * result) const;
    unsigned int size() const;
    bool writeParameters(const unsigned int& operatorID, vlsv::Writer& vlsvWriter);
    bool writeFsGridData(
@@ -71,6 +71,17 @@ namespace DRO {
       return false;
    }
 
+   /** Thread-safe variant of reduceDiagnostic, only called if isDiagnosticThreadSafe() returns true.
+    * @param cell the SpatialCell to reduce data out of
+    * @param result Buffer in which the reduced data is written.
+    * @return If true, DataReductionOperator reduced data successfully.
+    */
+   bool DataReductionOperator::reduceDiagnosticConcurrent(const SpatialCell* cell,Real* result) const {
+      cerr << "ERROR: DataReductionOperator::reduceDiagnosticConcurrent called for a non-thread-safe operator! (variable " <<
+              getName() << ")" << endl;
+      return false;
+   }
+
    DataReductionOperatorCellParams::DataReductionOperatorCellParams(const std::string& name,const unsigned int parameterIndex,const unsigned int _vectorSize) :
       DataReductionOperator(), _parameterIndex {parameterIndex}, vectorSize {_vectorSize}, variableName {name} {}
    DataReductionOperatorCellParams::~DataReductionOperatorCellParams() { }
@@ -97,6 +108,14 @@ namespace DRO {
       *buffer=data[0];
       return true;
    }
+   bool DataReductionOperatorCellParams::reduceDiagnosticConcurrent(const SpatialCell* cell,Real* buffer) const {
+      if(!std::isfinite(cell->parameters[_parameterIndex])) {
+         string message = "The DataReductionOperator " + this->getName() + " returned a nan or an inf in its 0-component.";
+         bailout(true, message, __FILE__, __LINE__);
+      }
+      *buffer = cell->parameters[_parameterIndex];
+      return true;
+   }
    bool DataReductionOperatorCellParams::setSpatialCell(const SpatialCell* cell) {
       for (uint i=0; i<vectorSize; i++) {
          if(!std::isfinite(cell->parameters[_parameterIndex+i])) {
@@ -549,11 +568,76 @@ namespace DRO {
       return true;
    }
 
+   bool Blocks::reduceDiagnosticConcurrent(const SpatialCell* cell,Real* buffer) const {
+      *buffer = 1.0 * cell->get_number_of_velocity_blocks(popID);
+      return true;
+   }
+
    bool Blocks::setSpatialCell(const SpatialCell* cell) {
       nBlocks = cell->get_number_of_velocity_blocks(popID);
       return true;
    }
 
+   // Velocity space bounding box of the existing blocks, vx_min vy_min vz_min vx_max vy_max vz_max
+   VelocityExtent::VelocityExtent(cuint _popID): DataReductionOperator(),popID(_popID) {
+      popName=getObjectWrapper().particleSpecies[popID].name;
+   }
+   VelocityExtent::~VelocityExtent() { }
+
+   bool VelocityExtent::getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const {
+      dataType = "float";
+      dataSize = sizeof(Real);
+      vectorSize = 6;
+      return true;
+   }
+
+   std::string VelocityExtent::getName() const {return popName + "/vg_velocity_extent";}
+
+   bool VelocityExtent::reduceData(const SpatialCell* cell,char* buffer) {
+      const char* ptr = reinterpret_cast<const char*>(extent);
+      for (uint i = 0; i < 6*sizeof(Real); ++i) buffer[i] = ptr[i];
+      return true;
+   }
+
+   // Velocity space bounding box of the existing blocks of a cell
+   static void computeVelocityExtent(const SpatialCell* cell,cuint popID,Real* extent) {
+      for (uint i = 0; i < 6; ++i) extent[i] = 0.0;
+      vmesh::VelocityMesh* vmesh = cell->get_population(popID).vmesh;
+      vmesh::LocalID minIndices[3], maxIndices[3];
+      if (vmesh->getBlockIndexExtents(minIndices, maxIndices)) {
+         const Real* meshMinLimits = vmesh->getMeshMinLimits();
+         const Real* blockSize = vmesh->getBlockSize();
+         for (uint d = 0; d < 3; ++d) {
+            extent[d] = meshMinLimits[d] + minIndices[d]*blockSize[d];
+            extent[3+d] = meshMinLimits[d] + (maxIndices[d]+1)*blockSize[d];
+         }
+      }
+   }
+
+   // Largest speed along any axis covered by the velocity mesh of this cell
+   bool VelocityExtent::reduceDiagnostic(const SpatialCell* cell,Real* buffer) {
+      *buffer = 0.0;
+      for (uint i = 0; i < 6; ++i) {
+         *buffer = max(*buffer, fabs(extent[i]));
+      }
+      return true;
+   }
+
+   bool VelocityExtent::reduceDiagnosticConcurrent(const SpatialCell* cell,Real* buffer) const {
+      Real cellExtent[6];
+      computeVelocityExtent(cell,popID,cellExtent);
+      *buffer = 0.0;
+      for (uint i = 0; i < 6; ++i) {
+         *buffer = max(*buffer, fabs(cellExtent[i]));
+      }
+      return true;
+   }
+
+   bool VelocityExtent::setSpatialCell(const SpatialCell* cell) {
+      computeVelocityExtent(cell,popID,extent);
+      return true;
+   }
+
    // Scalar pressure from the stored values which were calculated to be used by the solvers
    VariablePressureSolver::VariablePressureSolver(): DataReductionOperator() { }
    VariablePressureSolver::~VariablePressureSolver() { }
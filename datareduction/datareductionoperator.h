@@ -75,6 +75,10 @@ namespace DRO {
       virtual bool reduceData(const SpatialCell* cell,char* buffer);
       virtual bool reduceDiagnostic(const SpatialCell* cell,Real * result);
       virtual bool setSpatialCell(const SpatialCell* cell) = 0;
+      /** If true, reduceDiagnosticConcurrent is implemented and may be called for
+       * different cells from several threads at once.*/
+      virtual bool isDiagnosticThreadSafe() const {return false;}
+      virtual bool reduceDiagnosticConcurrent(const SpatialCell* cell,Real* result) const;
 
    protected:
       std::string unit;
@@ -212,6 +216,8 @@ namespace DRO {
       virtual bool reduceData(const SpatialCell* cell,char* buffer);
       virtual bool reduceDiagnostic(const SpatialCell* cell,Real * result);
       virtual bool setSpatialCell(const SpatialCell* cell);
+      virtual bool isDiagnosticThreadSafe() const {return true;}
+      virtual bool reduceDiagnosticConcurrent(const SpatialCell* cell,Real* result) const;
 
    protected:
       uint _parameterIndex;
@@ -224,12 +230,14 @@ namespace DRO {
    public:
       DataReductionOperatorDerivatives(const std::string& name,const unsigned int parameterIndex,const unsigned int vectorSize);
       virtual bool setSpatialCell(const SpatialCell* cell);
+      virtual bool isDiagnosticThreadSafe() const {return false;}
    };
 
    class DataReductionOperatorBVOLDerivatives: public DataReductionOperatorCellParams {
    public:
       DataReductionOperatorBVOLDerivatives(const std::string& name,const unsigned int parameterIndex,const unsigned int vectorSize);
       virtual bool setSpatialCell(const SpatialCell* cell);
+      virtual bool isDiagnosticThreadSafe() const {return false;}
    };
 
    class MPIrank: public DataReductionOperator {
@@ -285,6 +293,8 @@ namespace DRO {
       virtual bool reduceData(const SpatialCell* cell,char* buffer);
       virtual bool reduceDiagnostic(const SpatialCell* cell,Real* buffer);
       virtual bool setSpatialCell(const SpatialCell* cell);
+      virtual bool isDiagnosticThreadSafe() const {return true;}
+      virtual bool reduceDiagnosticConcurrent(const SpatialCell* cell,Real* result) const;
 
    protected:
       uint nBlocks;
@@ -292,6 +302,25 @@ namespace DRO {
       std::string popName;
    };
 
+   class VelocityExtent: public DataReductionOperator {
+   public:
+      VelocityExtent(cuint popID);
+      virtual ~VelocityExtent();
+
+      virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
+      virtual std::string getName() const;
+      virtual bool reduceData(const SpatialCell* cell,char* buffer);
+      virtual bool reduceDiagnostic(const SpatialCell* cell,Real* buffer);
+      virtual bool setSpatialCell(const SpatialCell* cell);
+      virtual bool isDiagnosticThreadSafe() const {return true;}
+      virtual bool reduceDiagnosticConcurrent(const SpatialCell* cell,Real* result) const;
+
+   protected:
+      Real extent[6];
+      uint popID;
+      std::string popName;
+   };
+
    class VariableBVol: public DataReductionOperator {
    public:
       VariableBVol();
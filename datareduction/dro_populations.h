@@ -72,6 +72,23 @@ namespace DRO {
          return true;
       }
 
+      virtual bool isDiagnosticThreadSafe() const {return true;}
+
+      virtual bool reduceDiagnosticConcurrent(const spatial_cell::SpatialCell* cell, Real* target) const {
+         if(_vectorSize > 1) {
+            std::cerr << "Warning: trying to use variable " << getName() << " as a diagnostic reducer, but it's vectorSize is " << _vectorSize << " > 1" << std::endl;
+            return false;
+         }
+         const char* population_struct = reinterpret_cast<const char*>(&cell->get_population(_popID));
+         const Real* ptr = reinterpret_cast<const Real*>(population_struct + _byteOffset);
+         if(!std::isfinite(*ptr)) {
+            std::string message = "The DataReductionOperator " + this->getName() + " returned a nan or an inf.";
+            bailout(true, message, __FILE__, __LINE__);
+         }
+         *target = *ptr;
+         return true;
+      }
+
       virtual bool setSpatialCell(const spatial_cell::SpatialCell* cell) {
 
          // First, get a byte-sized pointer to this populations' struct within this cell.
@@ -509,6 +509,13 @@ namespace FieldTracing {
       TracingFieldFunction<TReal> tracingFullField = [&perBGrid, &dPerBGrid, &technicalGrid](std::array<TReal,3>& r, const bool alongB, std::array<TReal,3>& b)->bool{
          return traceFullFieldFunction(perBGrid, dPerBGrid, technicalGrid, r, alongB, b);
       };
+      TracingBatchFieldFunction<TReal> tracingFullFieldBatch = [&perBGrid, &dPerBGrid, &technicalGrid](
+         const BatchArray<TReal>& x, const BatchArray<TReal>& y, const BatchArray<TReal>& z,
+         const BatchArray<uint8_t>& alongB, const BatchArray<uint8_t>& mask,
+         BatchArray<TReal>& bx, BatchArray<TReal>& by, BatchArray<TReal>& bz, BatchArray<uint8_t>& ok
+      ) {
+         traceFullFieldBatch(perBGrid, dPerBGrid, technicalGrid, x, y, z, alongB, mask, bx, by, bz, ok);
+      };
       
       int itCount=0;
       bool warnMaxStepsExceeded = false;
@@ -518,6 +525,98 @@ namespace FieldTracing {
          
          #pragma omp parallel
          {
+            if(fieldTracingParameters.useBatchedTracing) {
+               // Same as below, with the nodes of each chunk advanced in lockstep as one SIMD batch.
+               TracingBatch<TReal> batch;
+               #pragma omp for schedule(dynamic)
+               for(uint n0=0; n0<nodes.size(); n0+=TRACING_BATCH_SIZE) {
+                  batch.clear();
+                  for(uint n=n0; n<min(n0+TRACING_BATCH_SIZE, (uint)nodes.size()); n++) {
+                     if(nodeNeedsContinuedTracing[n]) {
+                        // If the node is in the North, trace along -B, in the South, trace along B
+                        batch.push(n, nodeTracingCoordinates[n], nodeTracingStepSize[n], (nodes[n].x[2] < 0));
+                     }
+                  }
+                  
+                  while(batch.anyActive()) {
+                     for(int l=0; l<batch.size; l++) {
+                        if(!batch.active[l]) {
+                           continue;
+                        }
+                        cuint n = batch.id[l];
+                        nodeStepCounter[n]++;
+                        
+                        // Check if the current coordinates (pre-step) are in our own domain.
+                        std::array<FsGridTools::FsIndex_t, 3> fsgridCell = getLocalFsGridCellIndexForCoord(technicalGrid,{(TReal)batch.x[l], (TReal)batch.y[l], (TReal)batch.z[l]});
+                        // If it is not in our domain, somebody else takes care of it.
+                        if(fsgridCell[0] == -1) {
+                           nodeNeedsContinuedTracing[n] = 0;
+                           nodeTracingCoordinates[n] = {0,0,0};
+                           nodeTracingStepSize[n]=0;
+                           batch.active[l] = 0;
+                           continue;
+                        }
+                        
+                        if(nodeStepCounter[n] > maxTracingSteps) {
+                           nodeNeedsContinuedTracing[n] = 0;
+                           nodeTracingCoordinates[n] = {0,0,0};
+                           #pragma omp critical
+                           {
+                              warnMaxStepsExceeded = true;
+                           }
+                           batch.active[l] = 0;
+                        }
+                     }
+                     
+                     // Make one step along the fieldlines
+                     stepFieldLinesBatch(batch,(TReal)fieldTracingParameters.min_tracer_dx_full_box,(TReal)technicalGrid.DX/2,fieldTracingParameters.tracingMethod,tracingFullFieldBatch);
+                     
+                     for(int l=0; l<batch.size; l++) {
+                        if(!batch.active[l]) {
+                           continue;
+                        }
+                        cuint n = batch.id[l];
+                        const std::array<TReal, 3> x = {batch.x[l], batch.y[l], batch.z[l]};
+                        nodeTracingStepSize[n] = batch.stepSize[l];
+                        nodeTracingStepCount[n]++;
+                        
+                        // Look up the fsgrid cell belonging to these coordinates
+                        std::array<FsGridTools::FsIndex_t, 3> fsgridCell = getLocalFsGridCellIndexForCoord(technicalGrid,{(TReal)x[0], (TReal)x[1], (TReal)x[2]});
+                        
+                        // If we map into the ionosphere, this node is on a closed field line.
+                        if(x[0]*x[0] + x[1]*x[1] + x[2]*x[2] < SBC::Ionosphere::innerRadius*SBC::Ionosphere::innerRadius) {
+                           nodeNeedsContinuedTracing[n] = 0;
+                           nodeTracingCoordinates[n] = {0,0,0};
+                           nodeMapping[n] = TracingLineEndType::CLOSED;
+                           batch.active[l] = 0;
+                           continue;
+                        }
+                        
+                        // If we map out of the box, this node is on an open field line.
+                        if(   x[0] > fieldTracingParameters.x_max
+                           || x[0] < fieldTracingParameters.x_min
+                           || x[1] > fieldTracingParameters.y_max
+                           || x[1] < fieldTracingParameters.y_min
+                           || x[2] > fieldTracingParameters.z_max
+                           || x[2] < fieldTracingParameters.z_min
+                        ) {
+                           nodeNeedsContinuedTracing[n] = 0;
+                           nodeTracingCoordinates[n] = {0,0,0};
+                           nodeMapping[n] = TracingLineEndType::OPEN;
+                           batch.active[l] = 0;
+                           continue;
+                        }
+                        
+                        // Now, after stepping, if it is no longer in our domain, another MPI rank will pick up later.
+                        if(fsgridCell[0] == -1) {
+                           nodeNeedsContinuedTracing[n] = 1;
+                           nodeTracingCoordinates[n] = x;
+                           batch.active[l] = 0;
+                        }
+                     }
+                  } // while batch active
+               }
+            } else
             // Trace node coordinates outwards until a non-sysboundary cell is encountered or the local fsgrid domain has been left.
             #pragma omp for schedule(dynamic)
             for(uint n=0; n<nodes.size(); n++) {
@@ -758,6 +857,143 @@ namespace FieldTracing {
       } // while true
    }
    
+   /*!< Batched counterpart of stepCellAcrossTaskDomain: the field lines listed in lineIds (all traced in the same direction)
+    * are advanced in lockstep through stepFieldLinesBatch, lines are masked out of the batch as they terminate or leave this
+    * task's domain. The termination logic is identical to stepCellAcrossTaskDomain.
+    * Beware this is inside a threaded region.
+    * \sa stepCellAcrossTaskDomain
+    */
+   void stepCellsAcrossTaskDomainBatch(
+      const int* lineIds,
+      cint nLines,
+      FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> & technicalGrid,
+      TracingFieldFunction<TReal> & tracingFullField,
+      TracingBatchFieldFunction<TReal> & tracingFullFieldBatch,
+      const std::vector<std::array<TReal,3>> & cellInitialCoordinates,
+      const std::vector<TReal> & cellCurvatureRadius,
+      std::vector<std::array<TReal, 3>> & cellTracingCoordinates,
+      std::vector<TReal> & cellTracingStepSize,
+      std::vector<TReal> & cellRunningDistance,
+      std::vector<TReal> & cellMaxExtension,
+      std::vector<signed char> & cellConnection,
+      bool & warnMaxDistanceExceeded,
+      const TReal maxTracingDistance,
+      cuint DIRECTION
+   ) {
+      TracingBatch<TReal> batch;
+      batch.clear();
+      for(int i=0; i<nLines; i++) {
+         batch.push(lineIds[i], cellTracingCoordinates[lineIds[i]], cellTracingStepSize[lineIds[i]], (DIRECTION == Direction::FORWARD));
+      }
+      
+      while(batch.anyActive()) {
+         for(int l=0; l<batch.size; l++) {
+            if(!batch.active[l]) {
+               continue;
+            }
+            cint n = batch.id[l];
+            // Check if the current coordinates (pre-step) are in our own domain.
+            std::array<FsGridTools::FsIndex_t, 3> fsgridCell = getLocalFsGridCellIndexForCoord(technicalGrid,{(Real)batch.x[l], (Real)batch.y[l], (Real)batch.z[l]});
+            // If it is not in our domain, somebody else takes care of it.
+            if(fsgridCell[0] == -1) {
+               cellTracingCoordinates[n] = {0,0,0};
+               cellTracingStepSize[n]=0;
+               batch.active[l] = 0;
+            }
+         }
+         
+         // Make one step along the fieldlines
+         stepFieldLinesBatch(batch,(TReal)100e3,(TReal)technicalGrid.DX/2,fieldTracingParameters.tracingMethod,tracingFullFieldBatch);
+         
+         for(int l=0; l<batch.size; l++) {
+            if(!batch.active[l]) {
+               continue;
+            }
+            cint n = batch.id[l];
+            std::array<TReal, 3> x = {batch.x[l], batch.y[l], batch.z[l]};
+            std::array<TReal, 3> v = {batch.bx[l], batch.by[l], batch.bz[l]};
+            cellTracingStepSize[n] = batch.stepSize[l];
+            cellRunningDistance[n] += cellTracingStepSize[n];
+            
+            // Look up the fsgrid cell belonging to these coordinates
+            std::array<FsGridTools::FsIndex_t, 3> fsgridCell = getLocalFsGridCellIndexForCoord(technicalGrid,{(Real)x[0], (Real)x[1], (Real)x[2]});
+            
+            // If we map into the ionosphere, discard this field line.
+            if(x[0]*x[0] + x[1]*x[1] + x[2]*x[2] < fieldTracingParameters.innerBoundaryRadius*fieldTracingParameters.innerBoundaryRadius) {
+               cellTracingCoordinates[n] = x;
+               cellConnection[n] += TracingLineEndType::CLOSED;
+               
+               // Take a step back and find the innerRadius crossing point, this is rare enough to be done per line.
+               stepFieldLine(x,v, cellTracingStepSize[n],(TReal)fieldTracingParameters.min_tracer_dx_full_box,(TReal)technicalGrid.DX/2,fieldTracingParameters.tracingMethod,tracingFullField,!(DIRECTION == Direction::FORWARD));
+               Real r_in = sqrt(cellTracingCoordinates[n][0]*cellTracingCoordinates[n][0] + cellTracingCoordinates[n][1]*cellTracingCoordinates[n][1] + cellTracingCoordinates[n][2]*cellTracingCoordinates[n][2]);
+               Real r_out = sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
+               Real alpha = (fieldTracingParameters.innerBoundaryRadius-r_in)/(r_out - r_in);
+               alpha = std::fmax(std::fmin(alpha,1.0),0.0);
+               if (fabs(r_out-r_in) < 0.01*fieldTracingParameters.min_tracer_dx_full_box) {
+                  alpha = 0.5;
+               }
+               TReal xi = x[0]-cellTracingCoordinates[n][0];
+               TReal yi = x[1]-cellTracingCoordinates[n][1];
+               TReal zi = x[2]-cellTracingCoordinates[n][2];
+               cellTracingCoordinates[n][0] += xi*alpha;
+               cellTracingCoordinates[n][1] += yi*alpha;
+               cellTracingCoordinates[n][2] += zi*alpha;
+               cellRunningDistance[n] -= cellTracingStepSize[n]*alpha;
+               batch.active[l] = 0;
+               continue;
+            }
+            
+            // If we map out of the box, discard this field line.
+            if(
+                  x[0] > fieldTracingParameters.x_max
+               || x[0] < fieldTracingParameters.x_min
+               || x[1] > fieldTracingParameters.y_max
+               || x[1] < fieldTracingParameters.y_min
+               || x[2] > fieldTracingParameters.z_max
+               || x[2] < fieldTracingParameters.z_min
+            ) {
+               cellTracingCoordinates[n] = x;
+               cellConnection[n] += TracingLineEndType::OPEN;
+               batch.active[l] = 0;
+               continue;
+            }
+            
+            // If we exceed the max tracing distance we're probably looping
+            if(cellRunningDistance[n] > maxTracingDistance) {
+               cellTracingCoordinates[n] = x;
+               cellConnection[n] += TracingLineEndType::DANGLING;
+               #pragma omp critical
+               {
+                  warnMaxDistanceExceeded = true;
+               }
+               batch.active[l] = 0;
+               continue;
+            }
+            
+            // See the longer comment for the function traceFullBoxConnectionAndFluxRopes for details.
+            if(cellConnection[n] < TracingLineEndType::N_TYPES) {
+               const TReal extension = sqrt(
+                    (x[0]-(cellInitialCoordinates[n])[0])*(x[0]-(cellInitialCoordinates[n])[0])
+                  + (x[1]-(cellInitialCoordinates[n])[1])*(x[1]-(cellInitialCoordinates[n])[1])
+                  + (x[2]-(cellInitialCoordinates[n])[2])*(x[2]-(cellInitialCoordinates[n])[2])
+               );
+               cellMaxExtension[n] = max(cellMaxExtension[n], extension);
+               if(extension > fieldTracingParameters.fluxrope_max_curvature_radii_extent*cellCurvatureRadius[n]) {
+                  cellConnection[n] += TracingLineEndType::N_TYPES;
+               } else if(cellRunningDistance[n] > fieldTracingParameters.fluxrope_max_curvature_radii_to_trace*cellCurvatureRadius[n]) {
+                  cellConnection[n] += 2*TracingLineEndType::N_TYPES;
+               }
+            }
+            
+            // Now, after stepping, if it is no longer in our domain, another MPI rank will pick up later.
+            if(fsgridCell[0] == -1) {
+               cellTracingCoordinates[n] = x;
+               batch.active[l] = 0;
+            }
+         }
+      } // while batch active
+   }
+
    /*!< \brief Trace magnetic field lines forward and backward from each DCCRG cell to record the connectivity and detect flux ropes.
     *
     * Full box connection and flux rope tracing
@@ -941,6 +1177,13 @@ namespace FieldTracing {
       TracingFieldFunction<TReal> tracingFullField = [&perBGrid, &dPerBGrid, &technicalGrid](std::array<TReal,3>& r, const bool alongB, std::array<TReal,3>& b)->bool {
          return traceFullFieldFunction(perBGrid, dPerBGrid, technicalGrid, r, alongB, b);
       };
+      TracingBatchFieldFunction<TReal> tracingFullFieldBatch = [&perBGrid, &dPerBGrid, &technicalGrid](
+         const BatchArray<TReal>& x, const BatchArray<TReal>& y, const BatchArray<TReal>& z,
+         const BatchArray<uint8_t>& alongB, const BatchArray<uint8_t>& mask,
+         BatchArray<TReal>& bx, BatchArray<TReal>& by, BatchArray<TReal>& bz, BatchArray<uint8_t>& ok
+      ) {
+         traceFullFieldBatch(perBGrid, dPerBGrid, technicalGrid, x, y, z, alongB, mask, bx, by, bz, ok);
+      };
       int itCount = 0;
       bool warnMaxDistanceExceeded = false;
       int cellsToDoFullBox, cellsToDoFluxRopes;
@@ -967,6 +1210,56 @@ namespace FieldTracing {
             {
                itCount++;
             }
+            if(fieldTracingParameters.useBatchedTracing) {
+               // Same as below, with the unfinished lines of each chunk of cells advanced in lockstep as SIMD batches.
+               #pragma omp for schedule(dynamic)
+               for(int n0=0; n0<globalDccrgSize; n0+=TRACING_BATCH_SIZE) {
+                  std::array<int, TRACING_BATCH_SIZE> fwLines, bwLines;
+                  int nFW = 0, nBW = 0;
+                  for(int n=n0; n<min(n0+TRACING_BATCH_SIZE, globalDccrgSize); n++) {
+                     if(cellFWConnection[n] % TracingLineEndType::N_TYPES == TracingLineEndType::UNPROCESSED) {
+                        fwLines[nFW++] = n;
+                     }
+                     if(cellBWConnection[n] % TracingLineEndType::N_TYPES == TracingLineEndType::UNPROCESSED) {
+                        bwLines[nBW++] = n;
+                     }
+                  }
+                  stepCellsAcrossTaskDomainBatch(
+                     fwLines.data(),
+                     nFW,
+                     technicalGrid,
+                     tracingFullField,
+                     tracingFullFieldBatch,
+                     cellInitialCoordinates,
+                     cellCurvatureRadius,
+                     cellFWTracingCoordinates,
+                     cellFWTracingStepSize,
+                     cellFWRunningDistance,
+                     cellMaxExtension,
+                     cellFWConnection,
+                     warnMaxDistanceExceeded,
+                     maxTracingDistance,
+                     Direction::FORWARD
+                  );
+                  stepCellsAcrossTaskDomainBatch(
+                     bwLines.data(),
+                     nBW,
+                     technicalGrid,
+                     tracingFullField,
+                     tracingFullFieldBatch,
+                     cellInitialCoordinates,
+                     cellCurvatureRadius,
+                     cellBWTracingCoordinates,
+                     cellBWTracingStepSize,
+                     cellBWRunningDistance,
+                     cellMaxExtension,
+                     cellBWConnection,
+                     warnMaxDistanceExceeded,
+                     maxTracingDistance,
+                     Direction::BACKWARD
+                  );
+               } // for
+            } else
             // Trace node coordinates forward and backwards until a non-sysboundary cell is encountered or the local fsgrid domain has been left.
             #pragma omp for schedule(dynamic)
             for(int n=0; n<globalDccrgSize; n++) {
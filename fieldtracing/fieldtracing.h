@@ -91,6 +91,7 @@ namespace FieldTracing {
       bool doTraceOpenClosed=false;
       bool doTraceFullBox=false;
       bool useCache=false;
+      bool useBatchedTracing=false; /*!< Advance field lines in SIMD batches in the full box and open/closed tracing */
       TracingMethod tracingMethod;
       Real max_allowed_error; /*!< Maximum alowed error for the adaptive field line tracing methods */
       uint32_t max_field_tracer_attempts; /*!< Max allowed attempts for the iterative field tracers */
@@ -628,6 +629,457 @@ namespace FieldTracing {
       }
    }//stepFieldLine
    
+   /*! Number of field lines advanced in lockstep by the batched tracers. */
+   constexpr int TRACING_BATCH_SIZE = 16;
+
+   /*! Fixed-width lane array used for the structure-of-arrays batched tracing state. */
+   template<typename T> using BatchArray = std::array<T, TRACING_BATCH_SIZE>;
+
+   /*! Structure-of-arrays state of a batch of field lines traced in lockstep.
+    * Lanes with active == 0 are masked out and left untouched by the batched steppers.
+    */
+   template<typename REAL> struct TracingBatch {
+      BatchArray<REAL> x, y, z;          /*!< Field line positions */
+      BatchArray<REAL> bx, by, bz;       /*!< Unit field direction at the start of the last accepted step */
+      BatchArray<REAL> stepSize;         /*!< Per-line adaptive step size */
+      BatchArray<uint8_t> alongB;        /*!< Trace along (1) or against (0) the field direction */
+      BatchArray<uint8_t> active;        /*!< Lane mask, finished lines are switched off */
+      BatchArray<int> id;                /*!< Index of the traced line in the caller's arrays */
+      int size = 0;                      /*!< Number of occupied lanes */
+
+      /*! Append a line to the batch, returns false if the batch is full. */
+      bool push(const int lineId, const std::array<REAL, 3>& r, const REAL h, const bool along) {
+         if(size == TRACING_BATCH_SIZE) {
+            return false;
+         }
+         x[size] = r[0];
+         y[size] = r[1];
+         z[size] = r[2];
+         bx[size] = 0;
+         by[size] = 0;
+         bz[size] = 0;
+         stepSize[size] = h;
+         alongB[size] = along;
+         active[size] = 1;
+         id[size] = lineId;
+         size++;
+         return true;
+      }
+
+      void clear() {
+         size = 0;
+         active.fill(0);
+      }
+
+      bool anyActive() const {
+         for(int l=0; l<size; l++) {
+            if(active[l]) {
+               return true;
+            }
+         }
+         return false;
+      }
+   };
+
+   /*! Handler function for batched field line tracing.
+    * Evaluates the unit field direction at (x,y,z) for all lanes set in mask, and clears ok for lanes where the evaluation failed
+    * (the equivalent of a TracingFieldFunction returning false). Lanes not set in mask are not touched.
+    */
+   template<typename REAL> using TracingBatchFieldFunction = std::function<void(
+      const BatchArray<REAL>& x,
+      const BatchArray<REAL>& y,
+      const BatchArray<REAL>& z,
+      const BatchArray<uint8_t>& alongB,
+      const BatchArray<uint8_t>& mask,
+      BatchArray<REAL>& bx,
+      BatchArray<REAL>& by,
+      BatchArray<REAL>& bz,
+      BatchArray<uint8_t>& ok
+   )>;
+
+   /*! Batched counterpart of traceFullFieldFunction.
+    * The dipole and uniform background parts are evaluated per lane, the Balsara reconstruction coefficients are fetched only once
+    * per fsgrid cell shared by several lanes and the perturbed field polynomial, normalisation and direction flip are evaluated
+    * across lanes in a SIMD loop.
+    */
+   template<typename REAL> void traceFullFieldBatch(
+      FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> & perBGrid,
+      FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, FS_STENCIL_WIDTH> & dPerBGrid,
+      FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> & technicalGrid,
+      const BatchArray<REAL>& x,
+      const BatchArray<REAL>& y,
+      const BatchArray<REAL>& z,
+      const BatchArray<uint8_t>& alongB,
+      const BatchArray<uint8_t>& mask,
+      BatchArray<REAL>& bx,
+      BatchArray<REAL>& by,
+      BatchArray<REAL>& bz,
+      BatchArray<uint8_t>& ok
+   ) {
+      const std::array<FsGridTools::FsIndex_t, 3> localStart = technicalGrid.getLocalStart();
+      const std::array<FsGridTools::FsIndex_t, 3> localSize = technicalGrid.getLocalSize();
+      
+      // Linearised local cell index including one ghost layer, -1 for lanes without a perturbed field contribution
+      BatchArray<int64_t> cellKey;
+      std::array<BatchArray<FsGridTools::FsIndex_t>, 3> cell;
+      // Balsara local coordinates in [-1/2, 1/2]
+      BatchArray<Real> xl, yl, zl;
+      // Reconstruction coefficients gathered per lane in SoA form
+      std::array<BatchArray<Real>, Rec::N_REC_COEFFICIENTS> rc;
+      BatchArray<uint8_t> hasPerB;
+      
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         ok[l] = mask[l];
+         cellKey[l] = -1;
+         hasPerB[l] = 0;
+         xl[l] = 0;
+         yl[l] = 0;
+         zl[l] = 0;
+         if(!mask[l]) {
+            continue;
+         }
+         if(   x[l] > P::xmax - 2*P::dx_ini
+            || x[l] < P::xmin + 2*P::dx_ini
+            || y[l] > P::ymax - 2*P::dy_ini
+            || y[l] < P::ymin + 2*P::dy_ini
+            || z[l] > P::zmax - 2*P::dz_ini
+            || z[l] < P::zmin + 2*P::dz_ini
+         ) {
+            cerr << (string)("(fieldtracing) Error: fsgrid coupling trying to step outside of the global domain?\n");
+            ok[l] = 0;
+            continue;
+         }
+         
+         // Get field direction
+         bx[l] = SBC::ionosphereGrid.dipoleField(x[l],y[l],z[l],X,0,X) + SBC::ionosphereGrid.BGB[0];
+         by[l] = SBC::ionosphereGrid.dipoleField(x[l],y[l],z[l],Y,0,Y) + SBC::ionosphereGrid.BGB[1];
+         bz[l] = SBC::ionosphereGrid.dipoleField(x[l],y[l],z[l],Z,0,Z) + SBC::ionosphereGrid.BGB[2];
+         
+         const std::array<Real, 3> r = {(TReal)x[l], (TReal)y[l], (TReal)z[l]};
+         std::array<FsGridTools::FsSize_t, 3> fsgridCellu = getGlobalFsGridCellIndexForCoord(technicalGrid, r);
+         // Make the global index a local one, bypass the fsgrid function that yields (-1,-1,-1) also for ghost cells.
+         for(int c=0; c<3; c++) {
+            cell[c][l] = (FsGridTools::FsIndex_t)fsgridCellu[c] - localStart[c];
+         }
+         
+         if(cell[0][l] > localSize[0] || cell[1][l] > localSize[1] || cell[2][l] > localSize[2]
+            || cell[0][l] < -1 || cell[1][l] < -1 || cell[2][l] < -1) {
+            cerr << (string)("(fieldtracing) Error: fsgrid coupling trying to access local ID " + to_string(cell[0][l]) + " " + to_string(cell[1][l]) + " " + to_string(cell[2][l])
+            + " for local domain size " + to_string(localSize[0]) + " " + to_string(localSize[1]) + " " + to_string(localSize[2])
+            + " at position " + to_string(x[l]) + " " + to_string(y[l]) + " " + to_string(z[l]) + " radius " + to_string(sqrt(x[l]*x[l]+y[l]*y[l]+z[l]*z[l]))
+            + "\n");
+            abort();
+         }
+         if(technicalGrid.get(cell[0][l],cell[1][l],cell[2][l])->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) {
+            continue;
+         }
+         
+         std::array<Real, 3> xLocal = getFractionalFsGridCellForCoord(technicalGrid, r);
+         xl[l] = xLocal[0] - 0.5;
+         yl[l] = xLocal[1] - 0.5;
+         zl[l] = xLocal[2] - 0.5;
+         if (fabs(xl[l]) > 0.5 || fabs(yl[l]) > 0.5 || fabs(zl[l]) > 0.5) {
+            cerr << __FILE__ << ":" << __LINE__ << ": Coordinate (" << xl[l] << "," << yl[l] << "," << zl[l] << ")  outside of this cell!" << endl;
+            abort();
+         }
+         cellKey[l] = (int64_t)(cell[0][l]+1) + (int64_t)(cell[1][l]+1) * (localSize[0]+2) + (int64_t)(cell[2][l]+1) * (localSize[0]+2) * (localSize[1]+2);
+         hasPerB[l] = 1;
+      }
+      
+      // Fetch the reconstruction coefficients once per distinct cell and hand them to all lanes sharing that cell.
+      BatchArray<uint8_t> haveCoefficients = {};
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         if(cellKey[l] < 0 || haveCoefficients[l]) {
+            continue;
+         }
+         std::array<Real, Rec::N_REC_COEFFICIENTS> cellRc;
+         const std::array<int, 3> cellIds = {(int)cell[0][l], (int)cell[1][l], (int)cell[2][l]};
+         if(fieldTracingParameters.useCache) {
+            #pragma omp critical
+            {
+               auto it = fieldTracingParameters.reconstructionCoefficientsCache.find(cellIds);
+               if (it == fieldTracingParameters.reconstructionCoefficientsCache.end()) {
+                  reconstructionCoefficients(perBGrid, dPerBGrid, cellRc, cellIds[0], cellIds[1], cellIds[2], 3);
+                  fieldTracingParameters.reconstructionCoefficientsCache.insert({cellIds, cellRc});
+               } else {
+                  cellRc = it->second;
+               }
+            }
+         } else {
+            reconstructionCoefficients(perBGrid, dPerBGrid, cellRc, cellIds[0], cellIds[1], cellIds[2], 3);
+         }
+         for(int m=l; m<TRACING_BATCH_SIZE; m++) {
+            if(cellKey[m] == cellKey[l]) {
+               for(int c=0; c<Rec::N_REC_COEFFICIENTS; c++) {
+                  rc[c][m] = cellRc[c];
+               }
+               haveCoefficients[m] = 1;
+            }
+         }
+      }
+      
+      // Eqs. (7)-(9) Balsara 2009, normalisation and direction across lanes
+      #pragma omp simd
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         const Real a = hasPerB[l] ? rc[Rec::a_0][l] + rc[Rec::a_x][l]*xl[l] + rc[Rec::a_y][l]*yl[l] + rc[Rec::a_z][l]*zl[l]
+                      + rc[Rec::a_xx][l] * (xl[l]*xl[l] - TWELWTH) + rc[Rec::a_xy][l]*xl[l]*yl[l] + rc[Rec::a_xz][l]*xl[l]*zl[l] : 0.0;
+         const Real b = hasPerB[l] ? rc[Rec::b_0][l] + rc[Rec::b_x][l]*xl[l] + rc[Rec::b_y][l]*yl[l] + rc[Rec::b_z][l]*zl[l]
+                      + rc[Rec::b_yy][l] * (yl[l]*yl[l] - TWELWTH) + rc[Rec::b_xy][l]*xl[l]*yl[l] + rc[Rec::b_yz][l]*yl[l]*zl[l] : 0.0;
+         const Real c = hasPerB[l] ? rc[Rec::c_0][l] + rc[Rec::c_x][l]*xl[l] + rc[Rec::c_y][l]*yl[l] + rc[Rec::c_z][l]*zl[l]
+                      + rc[Rec::c_zz][l] * (zl[l]*zl[l] - TWELWTH) + rc[Rec::c_xz][l]*xl[l]*zl[l] + rc[Rec::c_yz][l]*yl[l]*zl[l] : 0.0;
+         bx[l] += a;
+         by[l] += b;
+         bz[l] += c;
+      }
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         if(!ok[l]) {
+            continue;
+         }
+         // Normalize
+         REAL norm = 1. / sqrt(bx[l]*bx[l] + by[l]*by[l] + bz[l]*bz[l]);
+         bx[l] *= norm;
+         by[l] *= norm;
+         bz[l] *= norm;
+         if(!(std::isfinite(bx[l]) && std::isfinite(by[l]) && std::isfinite(bz[l]))) {
+            cerr << "(fieldtracing) Error: magnetic field is nan or inf in traceFullFieldBatch at location "
+            << x[l] << ", " << y[l] << ", " << z[l] << ", with B = " << bx[l] << ", " << by[l] << ", " << bz[l] << endl;
+            bx[l] = 0;
+            by[l] = 0;
+            bz[l] = 0;
+         }
+         if(!alongB[l]) {
+            bx[l] *= -1;
+            by[l] *= -1;
+            bz[l] *= -1;
+         }
+      }
+   }
+
+   /*! Batched Euler step, all masked lanes are advanced unconditionally. */
+   template<typename REAL> void eulerStepBatch(
+      TracingBatch<REAL>& batch,
+      const BatchArray<uint8_t>& mask,
+      TracingBatchFieldFunction<REAL>& BFieldFunction
+   ) {
+      BatchArray<uint8_t> ok;
+      BFieldFunction(batch.x, batch.y, batch.z, batch.alongB, mask, batch.bx, batch.by, batch.bz, ok);
+      #pragma omp simd
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         if(mask[l]) {
+            batch.x[l] += batch.stepSize[l] * batch.bx[l];
+            batch.y[l] += batch.stepSize[l] * batch.by[l];
+            batch.z[l] += batch.stepSize[l] * batch.bz[l];
+         }
+      }
+   }
+
+   /*! Batched adaptive Euler step, same arithmetic as adaptiveEulerStep. Lanes that converged are flagged in accepted. */
+   template<typename REAL> void adaptiveEulerStepBatch(
+      TracingBatch<REAL>& batch,
+      const BatchArray<uint8_t>& mask,
+      BatchArray<uint8_t>& accepted,
+      const REAL minStepSize,
+      const REAL maxStepSize,
+      TracingBatchFieldFunction<REAL>& BFieldFunction
+   ) {
+      BatchArray<uint8_t> ok;
+      BatchArray<REAL> bx, by, bz, x2, y2, z2, b2x, b2y, b2z;
+      BFieldFunction(batch.x, batch.y, batch.z, batch.alongB, mask, bx, by, bz, ok);
+      #pragma omp simd
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         x2[l] = batch.x[l] + 0.5*batch.stepSize[l]*bx[l];
+         y2[l] = batch.y[l] + 0.5*batch.stepSize[l]*by[l];
+         z2[l] = batch.z[l] + 0.5*batch.stepSize[l]*bz[l];
+      }
+      BFieldFunction(x2, y2, z2, batch.alongB, mask, b2x, b2y, b2z, ok);
+      const REAL maxError = fieldTracingParameters.max_allowed_error;
+      #pragma omp simd
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         accepted[l] = 0;
+         if(!mask[l]) {
+            continue;
+         }
+         const REAL h = batch.stepSize[l];
+         x2[l] += 0.5*h*b2x[l];
+         y2[l] += 0.5*h*b2y[l];
+         z2[l] += 0.5*h*b2z[l];
+         // Local error estimate against the single full Euler step
+         const REAL err = std::max(std::max(fabs(x2[l] - (batch.x[l] + h*bx[l])), fabs(y2[l] - (batch.y[l] + h*by[l]))), fabs(z2[l] - (batch.z[l] + h*bz[l])));
+         REAL newStep = h*sqrt(maxError/err);
+         newStep = newStep > maxStepSize ? maxStepSize : newStep;
+         newStep = newStep < minStepSize ? minStepSize : newStep;
+         if (err <= maxError || newStep == minStepSize) {
+            batch.x[l] = x2[l];
+            batch.y[l] = y2[l];
+            batch.z[l] = z2[l];
+            batch.bx[l] = bx[l];
+            batch.by[l] = by[l];
+            batch.bz[l] = bz[l];
+            accepted[l] = 1;
+         } else {
+            newStep *= 0.9; // This is to avoid asymptotic convergence when the ratio above is very close to 1.
+         }
+         batch.stepSize[l] = newStep;
+      }
+   }
+
+   /*! Batched Dormand-Prince step, same stages and error control as dormandPrinceStep. Lanes that converged are flagged in accepted. */
+   template<typename REAL> void dormandPrinceStepBatch(
+      TracingBatch<REAL>& batch,
+      const BatchArray<uint8_t>& mask,
+      BatchArray<uint8_t>& accepted,
+      const REAL minStepSize,
+      const REAL maxStepSize,
+      TracingBatchFieldFunction<REAL>& BFieldFunction
+   ) {
+      // Stage position offsets along the previous slope, as in dormandPrinceStep
+      constexpr REAL stageFactor[7] = {0., 1./5., 3./10., 4./5., 8./9., 1., 1.};
+      std::array<BatchArray<REAL>, 7> kx, ky, kz;
+      BatchArray<REAL> _x, _y, _z, bx, by, bz, b0x, b0y, b0z;
+      BatchArray<uint8_t> proceed = mask;
+      BatchArray<uint8_t> ok;
+      
+      for(int s=0; s<7; s++) {
+         if(s == 0) {
+            _x = batch.x;
+            _y = batch.y;
+            _z = batch.z;
+         } else {
+            #pragma omp simd
+            for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+               _x[l] = batch.x[l] + stageFactor[s]*kx[s-1][l];
+               _y[l] = batch.y[l] + stageFactor[s]*ky[s-1][l];
+               _z[l] = batch.z[l] + stageFactor[s]*kz[s-1][l];
+            }
+         }
+         BFieldFunction(_x, _y, _z, batch.alongB, proceed, bx, by, bz, ok);
+         #pragma omp simd
+         for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+            proceed[l] = proceed[l] && ok[l];
+            kx[s][l] = batch.stepSize[l]*bx[l];
+            ky[s][l] = batch.stepSize[l]*by[l];
+            kz[s][l] = batch.stepSize[l]*bz[l];
+         }
+         if(s == 0) {
+            b0x = bx;
+            b0y = by;
+            b0z = bz;
+         }
+      }
+      
+      const REAL maxError = fieldTracingParameters.max_allowed_error;
+      #pragma omp simd
+      for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+         accepted[l] = 0;
+         if(!mask[l]) {
+            continue;
+         }
+         REAL err = 0;
+         REAL newStep = batch.stepSize[l];
+         REAL rfx = 0, rfy = 0, rfz = 0;
+         if(proceed[l]) {
+            rfx = batch.x[l] +(35./384.)*kx[0][l] + (500./1113.)*kx[2][l] + (125./192.)*kx[3][l] - (2187./6784.)*kx[4][l] +(11./84.)*kx[5][l];
+            rfy = batch.y[l] +(35./384.)*ky[0][l] + (500./1113.)*ky[2][l] + (125./192.)*ky[3][l] - (2187./6784.)*ky[4][l] +(11./84.)*ky[5][l];
+            rfz = batch.z[l] +(35./384.)*kz[0][l] + (500./1113.)*kz[2][l] + (125./192.)*kz[3][l] - (2187./6784.)*kz[4][l] +(11./84.)*kz[5][l];
+            const REAL ex = fabs((71./57600.)*kx[0][l] -(71./16695.)*kx[2][l] + (71./1920.)*kx[3][l] -(17253./339200.)*kx[4][l]+(22./525.)*kx[5][l] -(1./40.)*kx[6][l]);
+            const REAL ey = fabs((71./57600.)*ky[0][l] -(71./16695.)*ky[2][l] + (71./1920.)*ky[3][l] -(17253./339200.)*ky[4][l]+(22./525.)*ky[5][l] -(1./40.)*ky[6][l]);
+            const REAL ez = fabs((71./57600.)*kz[0][l] -(71./16695.)*kz[2][l] + (71./1920.)*kz[3][l] -(17253./339200.)*kz[4][l]+(22./525.)*kz[5][l] -(1./40.)*kz[6][l]);
+            err = std::max(std::max(ex, ey), ez);
+            newStep *= pow((maxError/(2*err)),1./5.);
+         } else { // proceed is false, we probably stepped too far
+            newStep /= 2;
+         }
+         newStep = newStep > maxStepSize ? maxStepSize : newStep;
+         newStep = newStep < minStepSize ? minStepSize : newStep;
+         batch.stepSize[l] = newStep;
+         if ((err > maxError && newStep > minStepSize) || !proceed[l]) {
+            continue;
+         }
+         // The b vector of the field line is the one evaluated at the starting point of the step (K1)
+         batch.bx[l] = b0x[l];
+         batch.by[l] = b0y[l];
+         batch.bz[l] = b0z[l];
+         batch.x[l] = rfx;
+         batch.y[l] = rfy;
+         batch.z[l] = rfz;
+         accepted[l] = 1;
+      }
+   }
+
+   /*! Take a step along the field line for all active lanes of a batch.
+    * Retries are done only for the lanes that have not converged yet, converged lanes are masked.
+    * The Bulirsch-Stoer method has no batched variant, its lanes are stepped one at a time through the scalar integrator.
+    */
+   template<typename REAL> void stepFieldLinesBatch(
+      TracingBatch<REAL>& batch,
+      const REAL minStepSize,
+      const REAL maxStepSize,
+      TracingMethod method,
+      TracingBatchFieldFunction<REAL>& BFieldFunction
+   ) {
+      BatchArray<uint8_t> pending = batch.active;
+      BatchArray<uint8_t> accepted;
+      uint32_t attempts = 0;
+      bool anyPending;
+      switch(method) {
+         case Euler:
+            eulerStepBatch(batch, pending, BFieldFunction);
+            break;
+         case ADPT_Euler:
+         case DPrince:
+            do {
+               if(method == ADPT_Euler) {
+                  adaptiveEulerStepBatch(batch, pending, accepted, minStepSize, maxStepSize, BFieldFunction);
+               } else {
+                  dormandPrinceStepBatch(batch, pending, accepted, minStepSize, maxStepSize, BFieldFunction);
+               }
+               anyPending = false;
+               for(int l=0; l<TRACING_BATCH_SIZE; l++) {
+                  pending[l] = pending[l] && !accepted[l];
+                  anyPending = anyPending || pending[l];
+               }
+               attempts++;
+            } while (anyPending && attempts <= fieldTracingParameters.max_field_tracer_attempts);
+            if (anyPending) {
+               logFile << "(fieldtracing) Warning: " << (method == ADPT_Euler ? "Adaptive Euler" : "Dormand Prince")
+                  << " batched field line tracer exhausted all available attempts and still did not converge." << std::endl;
+            }
+            break;
+         case BS:
+            for(int l=0; l<batch.size; l++) {
+               if(!batch.active[l]) {
+                  continue;
+               }
+               TracingFieldFunction<REAL> laneFunction = [&BFieldFunction](std::array<REAL,3>& r, const bool alongB, std::array<REAL,3>& b)->bool {
+                  BatchArray<REAL> lx, ly, lz, lbx, lby, lbz;
+                  BatchArray<uint8_t> lmask = {}, lalong = {}, lok = {};
+                  lx.fill(r[0]);
+                  ly.fill(r[1]);
+                  lz.fill(r[2]);
+                  lmask[0] = 1;
+                  lalong[0] = alongB;
+                  BFieldFunction(lx, ly, lz, lalong, lmask, lbx, lby, lbz, lok);
+                  b = {lbx[0], lby[0], lbz[0]};
+                  return lok[0];
+               };
+               std::array<REAL, 3> r = {batch.x[l], batch.y[l], batch.z[l]};
+               std::array<REAL, 3> b = {0, 0, 0};
+               stepFieldLine(r, b, batch.stepSize[l], minStepSize, maxStepSize, method, laneFunction, (bool)batch.alongB[l]);
+               batch.x[l] = r[0];
+               batch.y[l] = r[1];
+               batch.z[l] = r[2];
+               batch.bx[l] = b[0];
+               batch.by[l] = b[1];
+               batch.bz[l] = b[2];
+            }
+            break;
+         default:
+            std::cerr << "(fieldtracing) Error: No field line tracing method defined."<<std::endl;
+            abort();
+            break;
+      }
+   }//stepFieldLinesBatch
+   
    /*! function to empty the Balsara reconstruction coefficient cache at a new time step */
    inline void resetReconstructionCoefficientsCache() {
       fieldTracingParameters.reconstructionCoefficientsCache.clear();
@@ -28,6 +28,8 @@
 #include <vector>
 #include <sstream>
 #include <ctime>
+#include <limits>
+#include <algorithm>
 #ifdef _OPENMP
   #include <omp.h>
 #endif
@@ -218,6 +220,11 @@ void initializeGrids(
       }
       restartReadTimer.stop();
 
+      if (P::forceRefinement || P::refineOnRestart) {
+         // Refinement changes the cells, let the load balancer place them freely
+         unpinRestartCells(mpiGrid);
+      }
+
       if (P::forceRefinement) {
          // Adapt refinement to match new static refinement parameters
          phiprof::Timer timer {"Restart refinement"};
@@ -326,6 +333,9 @@ void initializeGrids(
    // Function includes re-calculation of local cells cache, but
    // setting third parameter to false skips preparation of
    // translation cell lists and building of pencils.
+   // Restarted cells read onto the writer's partition stay in place for this
+   // first balance, release them for the following ones.
+   unpinRestartCells(mpiGrid);
 
    phiprof::Timer fetchNeighbourTimer {"Fetch Neighbour data", {"MPI"}};
    // update complete cell spatial data for full stencil
@@ -481,6 +491,104 @@ void setFaceNeighborRanks( dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    }
 }
 
+/*! Number of load balance constraints used in multi-constraint mode */
+static const int N_LB_CONSTRAINTS = 3;
+static const char* lbConstraintNames[N_LB_CONSTRAINTS] = {"compute", "memory", "coupling"};
+
+/*! Per-cell load balance constraints used in multi-constraint mode:
+ * measured compute time (acceleration, translation and boundary handling) in seconds,
+ * memory footprint in velocity blocks and fsgrid coupling volume in fsgrid cells.
+ */
+static void getCellLoadConstraints(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, const CellID cell, Real constraints[N_LB_CONSTRAINTS]) {
+   SpatialCell* SC = mpiGrid[cell];
+   constraints[0] = SC->parameters[CellParams::LBCOMPUTETIME];
+   constraints[1] = 1 + SC->get_number_of_all_velocity_blocks();
+   constraints[2] = std::pow(2.0, 3 * (P::amrMaxSpatialRefLevel - mpiGrid.get_refinement_level(cell)));
+}
+
+/*! Set cell weights for the multi-constraint load balancing mode.
+ * dccrg passes a single object weight per cell to Zoltan, so the constraints are combined into one
+ * weight: each constraint is normalized by its global mean and divided by its scale factor
+ * (loadBalance.computeScale, memoryScale, couplingScale), and the cell weight is the largest of these.
+ * A cell that is expensive by any measure is thus weighted by it. Only the imbalance of this combined
+ * weight is bounded by Zoltan, the individual constraints are not.
+ * If no compute time has been measured yet (e.g. first balance after a restart), the block-based
+ * LB weight counter is used for the compute constraint instead.
+ */
+static void setMultiConstraintCellWeights(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, const vector<CellID>& cells) {
+   const Real scales[N_LB_CONSTRAINTS] = {P::loadBalanceComputeScale, P::loadBalanceMemoryScale, P::loadBalanceCouplingScale};
+   vector<Real> cellConstraints(N_LB_CONSTRAINTS * cells.size());
+   Real localSums[N_LB_CONSTRAINTS + 1] = {0};
+   Real globalSums[N_LB_CONSTRAINTS + 1];
+   for (size_t i=0; i<cells.size(); ++i) {
+      getCellLoadConstraints(mpiGrid, cells[i], &cellConstraints[N_LB_CONSTRAINTS * i]);
+      for (int k=0; k<N_LB_CONSTRAINTS; ++k) {
+         localSums[k] += cellConstraints[N_LB_CONSTRAINTS * i + k];
+      }
+   }
+   localSums[N_LB_CONSTRAINTS] = cells.size();
+   MPI_Allreduce(localSums, globalSums, N_LB_CONSTRAINTS + 1, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+
+   const bool computeMeasured = globalSums[0] > 0;
+   if (!computeMeasured) {
+      localSums[0] = 0;
+      for (size_t i=0; i<cells.size(); ++i) {
+         cellConstraints[N_LB_CONSTRAINTS * i] = 1 + mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER];
+         localSums[0] += cellConstraints[N_LB_CONSTRAINTS * i];
+      }
+      MPI_Allreduce(&localSums[0], &globalSums[0], 1, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+   }
+
+   Real normalization[N_LB_CONSTRAINTS];
+   for (int k=0; k<N_LB_CONSTRAINTS; ++k) {
+      const Real mean = globalSums[k] / std::max(globalSums[N_LB_CONSTRAINTS], (Real)1);
+      normalization[k] = 1.0 / (std::max(mean, std::numeric_limits<Real>::min()) * scales[k]);
+   }
+
+   for (size_t i=0; i<cells.size(); ++i) {
+      Real weight = 0;
+      for (int k=0; k<N_LB_CONSTRAINTS; ++k) {
+         weight = std::max(weight, cellConstraints[N_LB_CONSTRAINTS * i + k] * normalization[k]);
+      }
+      mpiGrid.set_cell_weight(cells[i], weight);
+   }
+   if (!computeMeasured) {
+      logFile << "(LB): No measured compute times available, using LB weight counter for the compute constraint" << endl << writeVerbose;
+   }
+}
+
+/*! Log the achieved load imbalance (max / mean over processes) of each multi-constraint load
+ * balancing constraint for the current partition.
+ */
+static void reportLoadImbalance(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, const vector<CellID>& cells) {
+   Real localSums[N_LB_CONSTRAINTS] = {0};
+   Real globalSums[N_LB_CONSTRAINTS];
+   Real globalMax[N_LB_CONSTRAINTS];
+   Real constraints[N_LB_CONSTRAINTS];
+   for (size_t i=0; i<cells.size(); ++i) {
+      getCellLoadConstraints(mpiGrid, cells[i], constraints);
+      for (int k=0; k<N_LB_CONSTRAINTS; ++k) {
+         localSums[k] += constraints[k];
+      }
+   }
+   MPI_Allreduce(localSums, globalSums, N_LB_CONSTRAINTS, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+   MPI_Allreduce(localSums, globalMax, N_LB_CONSTRAINTS, MPI_Type<Real>(), MPI_MAX, MPI_COMM_WORLD);
+
+   int nProcs;
+   MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+   logFile << "(LB): Achieved imbalance (max/mean)";
+   for (int k=0; k<N_LB_CONSTRAINTS; ++k) {
+      const Real mean = globalSums[k] / nProcs;
+      logFile << " " << lbConstraintNames[k] << " ";
+      if (mean > 0) {
+         logFile << globalMax[k] / mean;
+      } else {
+         logFile << "n/a";
+      }
+   }
+   logFile << endl << writeVerbose;
+}
+
 void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, SysBoundary& sysBoundaries, FsGrid<fsgrids::technical, FS_STENCIL_WIDTH> & technicalGrid, bool doTranslationLists){
    // Invalidate cached cell lists
    Parameters::meshRepartitioned = true;
@@ -495,12 +603,16 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
 
    //set weights based on each cells LB weight counter
    const vector<CellID>& cells = getLocalCells();
-   for (size_t i=0; i<cells.size(); ++i){
-      // Set cell weight. We could use different counters or number of blocks if different solvers are active.
-      // if (P::propagateVlasovAcceleration)
-      // When using the FS-SPLIT functionality, Jaro Hokkanen reported issues with using the regular
-      // CellParams::LBWEIGHTCOUNTER, so use of blockscounts + 1 might be required.
-      mpiGrid.set_cell_weight(cells[i], (Real)1 + mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER]);
+   if (P::loadBalanceMultiConstraint) {
+      setMultiConstraintCellWeights(mpiGrid, cells);
+   } else {
+      for (size_t i=0; i<cells.size(); ++i){
+         // Set cell weight. We could use different counters or number of blocks if different solvers are active.
+         // if (P::propagateVlasovAcceleration)
+         // When using the FS-SPLIT functionality, Jaro Hokkanen reported issues with using the regular
+         // CellParams::LBWEIGHTCOUNTER, so use of blockscounts + 1 might be required.
+         mpiGrid.set_cell_weight(cells[i], (Real)1 + mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER]);
+      }
    }
 
    phiprof::Timer initLBTimer {"dccrg.initialize_balance_load"};
@@ -661,9 +773,17 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
       mpiGrid[cells[i]]->set_mpi_transfer_enabled(true);
    }
 
+   if (P::mortonOrderCells) {
+      reorderLocalCellData(mpiGrid);
+   }
+
    // recompute coupling of grids after load balance
    computeCoupling(mpiGrid, cells, technicalGrid);
 
+   if (P::loadBalanceMultiConstraint) {
+      reportLoadImbalance(mpiGrid, cells);
+   }
+
    // Communicate all spatial data for FULL neighborhood, which
    // includes all data with the exception of dist function data
    SpatialCell::set_mpi_transfer_type(Transfer::ALL_SPATIAL_DATA);
@@ -1479,9 +1599,60 @@ bool adaptRefinement(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGri
    return true;
 }
 
+/*! Spread the lowest 21 bits of the argument so that there are two zero bits between each of them */
+static uint64_t spreadMortonBits(uint64_t x) {
+   x &= 0x1fffff;
+   x = (x | x << 32) & 0x1f00000000ffff;
+   x = (x | x << 16) & 0x1f0000ff0000ff;
+   x = (x | x << 8) & 0x100f00f00f00f00f;
+   x = (x | x << 4) & 0x10c30c30c30c30c3;
+   x = (x | x << 2) & 0x1249249249249249;
+   return x;
+}
+
+/*! Sort cells along a Morton (Z-order) curve. Indices are those of the finest refinement
+ * level, so cells of different refinement levels are ordered consistently.
+ */
+static void sortCellsMorton(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, std::vector<CellID>& cells) {
+   std::vector<std::pair<uint64_t,CellID>> keys(cells.size());
+   #pragma omp parallel for
+   for (size_t i=0; i<cells.size(); ++i) {
+      const auto indices = mpiGrid.mapping.get_indices(cells[i]);
+      keys[i].first = spreadMortonBits(indices[0]) | spreadMortonBits(indices[1]) << 1 | spreadMortonBits(indices[2]) << 2;
+      keys[i].second = cells[i];
+   }
+   std::sort(keys.begin(), keys.end());
+   for (size_t i=0; i<cells.size(); ++i) {
+      cells[i] = keys[i].second;
+   }
+}
+
 void recalculateLocalCellsCache(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
    // Clear-and-minimize idiom for minimizing capacity
    // TODO: consider shrink_to_fit() or alternatively benchmark just copy assigning
    std::vector<CellID>().swap(Parameters::localCells);
    Parameters::localCells = mpiGrid.get_cells();
+   if (P::mortonOrderCells) {
+      sortCellsMorton(mpiGrid, Parameters::localCells);
+   }
+}
+
+/*! Reallocate the velocity block storage of local cells in local cell order, so that
+ * consecutive cells (Morton ordered if enabled) are allocated close to each other and
+ * first touched by the thread that processes them in statically scheduled loops.
+ * \param mpiGrid Spatial grid
+ */
+void reorderLocalCellData(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+#ifndef USE_GPU
+   phiprof::Timer timer {"Reorder local cell data"};
+   const vector<CellID>& cells = getLocalCells();
+   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+      #pragma omp parallel for schedule(static)
+      for (size_t i=0; i<cells.size(); ++i) {
+         vmesh::VelocityBlockContainer* blockContainer = mpiGrid[cells[i]]->get_velocity_blocks(popID);
+         blockContainer->setNewCapacityShrink(blockContainer->capacity());
+      }
+   }
+   memory_purge(); // Release the previous allocations
+#endif
 }
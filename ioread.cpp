@@ -307,6 +307,37 @@ bool readNBlocks(vlsv::ParallelReader& file,const std::string& meshName,
    return success;
 }
 
+/* Read the number of cells written by each process of the run that wrote the file.
+ * In restart files the cells of each writing process form one contiguous slice of the
+ * cell list, in rank order, so this describes the partition of the writing run.
+ * @param file Some vlsv reader with a file open
+ * @param meshName Name of the spatial mesh
+ * @param domainSizes Number of local cells of each writing process -- this function saves data here
+ * @return Returns true if the operation was successful
+ @ @see exec_readGrid
+*/
+bool readDomainSizes(vlsv::ParallelReader& file,const std::string& meshName,std::vector<uint64_t>& domainSizes) {
+   list<pair<string,string> > attribsIn;
+   map<string,string> attribsOut;
+   attribsIn.push_back(make_pair("mesh",meshName));
+
+   if (file.getArrayAttributes("MESH_DOMAIN_SIZES",attribsIn,attribsOut) == false) return false;
+   auto it = attribsOut.find("arraysize");
+   if (it == attribsOut.end()) return false;
+   const uint64_t N_domains = atoi(it->second.c_str());
+
+   int64_t* domainInfo = NULL;
+   if (file.read("MESH_DOMAIN_SIZES",attribsIn,0,N_domains,domainInfo) == false) return false;
+
+   // Entries are (local+ghost, ghost), restarts are written without ghosts
+   domainSizes.resize(N_domains);
+   for (uint64_t i_domain = 0; i_domain < N_domains; ++i_domain) {
+      domainSizes[i_domain] = domainInfo[2*i_domain] - domainInfo[2*i_domain+1];
+   }
+   delete [] domainInfo; domainInfo = NULL;
+   return true;
+}
+
 /*! A function for reading parameters, e.g., 'timestep'.
  \param file VLSV parallel reader with a file open.
  \param name Name of the parameter.
@@ -1114,6 +1145,19 @@ bool readIonosphereNodeVariable(
  \return Returns true if the operation was successful
  \sa readGrid
  */
+static bool restartCellsPinned = false; /*!< Cells are still pinned to the partition they were read onto */
+
+void unpinRestartCells(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+   if (!restartCellsPinned) {
+      return;
+   }
+   const vector<CellID>& gridCells = getLocalCells();
+   for (size_t i=0; i<gridCells.size(); ++i) {
+      mpiGrid.unpin(gridCells[i]);
+   }
+   restartCellsPinned = false;
+}
+
 bool exec_readGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
       FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> & perBGrid,
       FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, FS_STENCIL_WIDTH> & EGrid,
@@ -1238,18 +1282,57 @@ bool exec_readGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    uint64_t localCells=0;
    uint64_t numberOfBlocksCount=0;
 
-   // Pin local cells to remote processes, we try to balance number of blocks so that
-   // each process has the same amount of blocks, more or less.
-   for (size_t i=0; i<fileCells.size(); ++i) {
-      numberOfBlocksCount += nBlocks[i];
-      int newCellProcess = numberOfBlocksCount/numberOfBlocksPerProcess;
-      if (newCellProcess == myRank) {
-         if (localCells == 0)
-            localCellStartOffset=i; //here local cells start
-         ++localCells;
+   // If the file was written by as many processes as we have, or an integer multiple thereof,
+   // each of our processes can take over the contiguous file slice(s) of the corresponding
+   // writer(s). Data then lands directly on the partition of the writing run and the initial
+   // load balance after the restart does not need to migrate the blocks a second time.
+   vector<uint64_t> writerDomainSizes;
+   bool useWriterPartition = false;
+   if (P::restartReadWriterPartition && readDomainSizes(file,meshName,writerDomainSizes)) {
+      uint64_t writerCells = 0;
+      for (uint64_t size : writerDomainSizes) {
+         writerCells += size;
+      }
+      useWriterPartition = writerDomainSizes.size() % processes == 0 && writerCells == fileCells.size();
+   }
+   if (myRank == MASTER_RANK) {
+      if (useWriterPartition) {
+         logFile << "(RESTART) Reading cells onto the partition of the " << writerDomainSizes.size() << " writing processes" << endl << writeVerbose;
+      } else if (P::restartReadWriterPartition) {
+         logFile << "(RESTART) Writing process count " << writerDomainSizes.size() << " is not compatible with " << processes << " processes, distributing cells by block count" << endl << writeVerbose;
+      }
+   }
+
+   if (useWriterPartition) {
+      const uint64_t writersPerProcess = writerDomainSizes.size() / processes;
+      size_t i = 0;
+      for (size_t domain=0; domain<writerDomainSizes.size(); ++domain) {
+         const int newCellProcess = domain / writersPerProcess;
+         for (uint64_t c=0; c<writerDomainSizes[domain]; ++c, ++i) {
+            if (newCellProcess == myRank) {
+               if (localCells == 0)
+                  localCellStartOffset=i; //here local cells start
+               ++localCells;
+            }
+            if (mpiGrid.is_local(fileCells[i])) {
+               mpiGrid.pin(fileCells[i],newCellProcess);
+            }
+         }
       }
-      if (mpiGrid.is_local(fileCells[i])) {
-         mpiGrid.pin(fileCells[i],newCellProcess);
+   } else {
+      // Pin local cells to remote processes, we try to balance number of blocks so that
+      // each process has the same amount of blocks, more or less.
+      for (size_t i=0; i<fileCells.size(); ++i) {
+         numberOfBlocksCount += nBlocks[i];
+         int newCellProcess = numberOfBlocksCount/numberOfBlocksPerProcess;
+         if (newCellProcess == myRank) {
+            if (localCells == 0)
+               localCellStartOffset=i; //here local cells start
+            ++localCells;
+         }
+         if (mpiGrid.is_local(fileCells[i])) {
+            mpiGrid.pin(fileCells[i],newCellProcess);
+         }
       }
    }
 
@@ -1264,9 +1347,15 @@ bool exec_readGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    //get new list of local gridcells
    const vector<CellID>& gridCells = getLocalCells();
 
-   // Unpin cells, otherwise we will never change this initial bad balance
-   for (size_t i=0; i<gridCells.size(); ++i) {
-      mpiGrid.unpin(gridCells[i]);
+   // Unpin cells, otherwise we will never change this initial bad balance. When reading onto
+   // the writer's partition the pins are kept through the first load balance after the restart
+   // (see unpinRestartCells), so that it does not move the freshly read blocks elsewhere.
+   if (useWriterPartition) {
+      restartCellsPinned = true;
+   } else {
+      for (size_t i=0; i<gridCells.size(); ++i) {
+         mpiGrid.unpin(gridCells[i]);
+      }
    }
 
    // Check for errors, has migration succeeded
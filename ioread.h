@@ -46,6 +46,16 @@ bool readGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
 
 /*!
 
+\brief Release the pins that keep restarted cells on the partition they were read onto.
+When the restart is read onto the partition of the writing run, the cells stay pinned so that
+the first load balance afterwards does not migrate the freshly read data. This must be called
+after that load balance (or before any refinement), otherwise the balance never changes.
+\param mpiGrid Vlasiator's grid
+*/
+void unpinRestartCells(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+
+/*!
+
 \brief Refine the grid to be identical to the file's
 \param mpiGrid Vlasiator's grid
 \param name Name of the restart file e.g. "restart.00052.vlsv"
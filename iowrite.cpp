@@ -47,6 +47,7 @@
 #include "velocity_mesh_parameters.h"
 #include "sysboundary/ionosphere.h"
 #include "fieldtracing/fieldtracing.h"
+#include "vdf_compression.h"
 
 using namespace std;
 using namespace vlsv;
@@ -58,7 +59,8 @@ typedef Parameters P;
 
 bool writeVelocityDistributionData(const uint popID,Writer& vlsvWriter,
                                    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                   const std::vector<CellID>& cells,MPI_Comm comm);
+                                   const std::vector<CellID>& cells,MPI_Comm comm,
+                                   const Real compressionTolerance);
 
 /*! Updates local ids across MPI to let other processes know in which order this process saves the local cell ids
  \param mpiGrid Vlasiator's MPI grid
@@ -121,26 +123,139 @@ bool globalSuccess(bool success, const string& errorMessage, MPI_Comm comm){
  @param mpiGrid Vlasiator's grid.
  @param cells Vector of local cells within this process (no ghost cells).
  @param comm The MPI communicator.
+ @param compressionTolerance If positive, distributions are written with lossy compression (see vdf_compression.h).
  @return Returns true if operation was successful.*/
 bool writeVelocityDistributionData(Writer& vlsvWriter,
                                    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                   const vector<CellID>& cells,MPI_Comm comm) {
+                                   const vector<CellID>& cells,MPI_Comm comm,
+                                   const Real compressionTolerance) {
    bool success = true;
    for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-      if (writeVelocityDistributionData(popID,vlsvWriter,mpiGrid,cells,comm) == false) success = false;
+      if (writeVelocityDistributionData(popID,vlsvWriter,mpiGrid,cells,comm,compressionTolerance) == false) success = false;
    }
    return success;
 }
 
+/** Encodes the velocity distributions of the given cells with the lossy codec of vdf_compression.h.
+ Blocks dropped by the encoder are removed from the block ID list and the block counts.
+ @param popID ID of the particle species.
+ @param mpiGrid Vlasiator's grid.
+ @param cells Cells whose distributions are encoded.
+ @param tolerance Relative error bound of the encoding.
+ @param velocityBlockIds Block IDs of all cells in cell order, compacted to the kept blocks on return.
+ @param blocksPerCell Block counts of the cells, updated to the kept blocks on return.
+ @param streams Output, encoded stream of each cell.*/
+static void compressVelocityDistributions(const uint popID,
+                                          dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                          const vector<CellID>& cells,const Real tolerance,
+                                          vector<vmesh::GlobalID>& velocityBlockIds,
+                                          vector<vmesh::LocalID>& blocksPerCell,
+                                          vector<vector<unsigned char> >& streams) {
+   phiprof::Timer compressTimer {"compress VDFs"};
+   const size_t meshID = getObjectWrapper().particleSpecies[popID].velocityMesh;
+   const vmesh::MeshParameters& meshParams = vmesh::getMeshWrapper()->velocityMeshes->at(meshID);
+   vdfcompression::MeshGeometry geometry;
+   geometry.blockLength = WID;
+   for (int i=0; i<3; ++i) {
+      geometry.gridLength[i] = meshParams.gridLength[i];
+      geometry.meshMinLimits[i] = meshParams.meshMinLimits[i];
+      geometry.cellSize[i] = meshParams.cellSize[i];
+   }
+
+   vector<uint64_t> cellOffsets(cells.size()+1,0);
+   for (size_t i=0; i<cells.size(); ++i) cellOffsets[i+1] = cellOffsets[i] + blocksPerCell[i];
+
+   streams.assign(cells.size(),vector<unsigned char>());
+   vector<vector<bool> > keep(cells.size());
+   #pragma omp parallel for schedule(dynamic)
+   for (size_t i=0; i<cells.size(); ++i) {
+      SpatialCell* SC = mpiGrid[cells[i]];
+      const uint64_t nBlocks = blocksPerCell[i];
+      vector<uint64_t> blockGIDs(velocityBlockIds.begin()+cellOffsets[i],velocityBlockIds.begin()+cellOffsets[i+1]);
+      #ifdef USE_GPU
+      vector<Realf> hostData(nBlocks*WID3);
+      if (nBlocks > 0) {
+         CHK_ERR( gpuMemcpy(hostData.data(), SC->get_data(popID), nBlocks*WID3*sizeof(Realf), gpuMemcpyDeviceToHost));
+      }
+      const Realf* data = hostData.data();
+      #else
+      const Realf* data = SC->get_data(popID);
+      #endif
+      vdfcompression::encodeCell(data,blockGIDs.data(),nBlocks,geometry,tolerance,
+                                 SC->getVelocityBlockMinValue(popID),streams[i],keep[i]);
+   }
+
+   uint64_t keptBlocks = 0;
+   for (size_t i=0; i<cells.size(); ++i) {
+      vmesh::LocalID kept = 0;
+      for (uint64_t b=0; b<blocksPerCell[i]; ++b) {
+         if (keep[i][b] == false) continue;
+         velocityBlockIds[keptBlocks++] = velocityBlockIds[cellOffsets[i]+b];
+         ++kept;
+      }
+      blocksPerCell[i] = kept;
+   }
+   velocityBlockIds.resize(keptBlocks);
+}
+
+/** Writes encoded velocity distributions. The streams of all cells are concatenated into
+ BLOCKVARIABLECOMPRESSED, and the global byte offset and size of each stream, in the order
+ of CELLSWITHBLOCKS, into BLOCKVARIABLECOMPRESSEDOFFSETS.
+ @param vlsvWriter Some vlsv writer with a file open.
+ @param popName Name of the particle species.
+ @param spatMeshName Name of the spatial mesh.
+ @param streams Encoded stream of each cell.
+ @param tolerance Relative error bound used in the encoding.
+ @param comm The MPI communicator.
+ @return Returns true if operation was successful.*/
+static bool writeCompressedBlockVariable(Writer& vlsvWriter,const string& popName,const string& spatMeshName,
+                                         const vector<vector<unsigned char> >& streams,const Real tolerance,
+                                         MPI_Comm comm) {
+   bool success = true;
+   int myRank;
+   MPI_Comm_rank(comm,&myRank);
+
+   uint64_t localBytes = 0;
+   for (size_t i=0; i<streams.size(); ++i) localBytes += streams[i].size();
+   uint64_t byteOffset = 0;
+   MPI_Exscan(&localBytes,&byteOffset,1,MPI_UINT64_T,MPI_SUM,comm);
+   if (myRank == 0) byteOffset = 0;
+
+   vector<uint64_t> offsets(2*streams.size());
+   vector<char> buffer;
+   buffer.reserve(localBytes);
+   for (size_t i=0; i<streams.size(); ++i) {
+      offsets[2*i+0] = byteOffset + buffer.size();
+      offsets[2*i+1] = streams[i].size();
+      buffer.insert(buffer.end(),streams[i].begin(),streams[i].end());
+   }
+
+   map<string,string> attribs;
+   attribs["mesh"] = spatMeshName;
+   attribs["name"] = popName;
+   if (vlsvWriter.writeArray("BLOCKVARIABLECOMPRESSEDOFFSETS",attribs,streams.size(),2,offsets.data()) == false) success = false;
+
+   stringstream ss;
+   ss << setprecision(17) << tolerance;
+   attribs["encoding"] = vdfcompression::ENCODING_NAME;
+   attribs["tolerance"] = ss.str();
+   attribs["values_per_block"] = to_string(WID3);
+   if (vlsvWriter.writeArray("BLOCKVARIABLECOMPRESSED",attribs,"uint",buffer.size(),1,1,buffer.data()) == false) success = false;
+   if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write BLOCKVARIABLECOMPRESSED to file!" << endl << writeVerbose;
+   return success;
+}
+
 /** Writes the velocity distribution of specified population into the file.
  @param vlsvWriter Some vlsv writer with a file open.
  @param mpiGrid Vlasiator's grid.
  @param cells Vector of local cells within this process (no ghost cells).
  @param comm The MPI communicator.
+ @param compressionTolerance If positive, distributions are written with lossy compression (see vdf_compression.h).
  @return Returns true if operation was successful.*/
 bool writeVelocityDistributionData(const uint popID,Writer& vlsvWriter,
                                    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                   const std::vector<CellID>& cells,MPI_Comm comm) {
+                                   const std::vector<CellID>& cells,MPI_Comm comm,
+                                   const Real compressionTolerance) {
    // Write velocity blocks and related data. 
    // In restart we just write velocity grids for all cells.
    // First write global Ids of those cells which write velocity blocks (here: all cells):
@@ -165,9 +280,6 @@ bool writeVelocityDistributionData(const uint popID,Writer& vlsvWriter,
    // Write the array:
    if (vlsvWriter.writeArray("CELLSWITHBLOCKS",attribs,cells.size(),vectorSize,cells.data()) == false) success = false;
    if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write CELLSWITHBLOCKS to file!" << endl << writeVerbose;
-   // Write blocks per cell, this has to be in the same order as cellswitblocks so that extracting works
-   if(vlsvWriter.writeArray("BLOCKSPERCELL",attribs,blocksPerCell.size(),vectorSize,blocksPerCell.data()) == false) success = false;
-   if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write CELLSWITHBLOCKS to file!" << endl << writeVerbose;
 
    // Write (partial) velocity mesh data
    // The mesh bounding box gives the outer extent of the available velocity space
@@ -252,15 +364,35 @@ bool writeVelocityDistributionData(const uint popID,Writer& vlsvWriter,
       return false;
    }
 
+   // With lossy compression, blocks below the sparsity threshold are dropped, so the
+   // block counts and IDs written below only cover the kept blocks.
+   vector<vector<unsigned char> > compressedCells;
+   if (compressionTolerance > 0) {
+      compressVelocityDistributions(popID,mpiGrid,cells,compressionTolerance,velocityBlockIds,blocksPerCell,compressedCells);
+      totalBlocks = velocityBlockIds.size();
+   }
+
    attribs.clear();
    attribs["mesh"] = spatMeshName;
    attribs["name"] = popName;
+   // Write blocks per cell, this has to be in the same order as cellswitblocks so that extracting works
+   if(vlsvWriter.writeArray("BLOCKSPERCELL",attribs,blocksPerCell.size(),vectorSize,blocksPerCell.data()) == false) success = false;
+   if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write BLOCKSPERCELL to file!" << endl << writeVerbose;
    if (vlsvWriter.writeArray("BLOCKIDS", attribs, totalBlocks, vectorSize, velocityBlockIds.data()) == false) success = false;
    if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write BLOCKIDS to file!" << endl << writeVerbose;
    {
       vector<vmesh::GlobalID>().swap(velocityBlockIds);
    }
 
+   if (compressionTolerance > 0) {
+      if (writeCompressedBlockVariable(vlsvWriter,popName,spatMeshName,compressedCells,compressionTolerance,comm) == false) success = false;
+      if (globalSuccess(success,"(MAIN) writeGrid: ERROR: Failed to write compressed velocity distributions",MPI_COMM_WORLD) == false) {
+         vlsvWriter.close();
+         return false;
+      }
+      return success;
+   }
+
    // Write the velocity space data
    // set everything that is needed for writing in data such as the array name, size, datatype, etc..
    attribs.clear();
@@ -1282,7 +1414,7 @@ bool writeVelocitySpace(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
    localNumVelSpaceCells=velSpaceCells.size();
    MPI_Allreduce(&localNumVelSpaceCells,&numVelSpaceCells,1,MPI_UINT64_T,MPI_SUM,MPI_COMM_WORLD);
    //write out velocity space data NOTE: There is mpi communication in writeVelocityDistributionData
-   if (writeVelocityDistributionData(vlsvWriter, mpiGrid, velSpaceCells, MPI_COMM_WORLD ) == false ) {
+   if (writeVelocityDistributionData(vlsvWriter, mpiGrid, velSpaceCells, MPI_COMM_WORLD, P::vdfCompressionTolerance) == false ) {
       cerr << "ERROR, FAILED TO WRITE VELOCITY DISTRIBUTION DATA AT " << __FILE__ << " " << __LINE__ << endl;
       logFile << "(MAIN) writeGrid: ERROR FAILED TO WRITE VELOCITY DISTRIBUTION DATA AT: " << __FILE__ << " " << __LINE__ << endl << writeVerbose;
    }
@@ -1915,6 +2047,73 @@ bool writeRestart(
 }
 
 
+/*! State of the diagnostic reduction posted by writeDiagnostic and completed at its next call */
+struct PendingDiagnostic {
+   bool active {false};
+   MPI_Request request {MPI_REQUEST_NULL};
+   MPI_Datatype type {MPI_DATATYPE_NULL};
+   MPI_Op op {MPI_OP_NULL};
+   uint nOps {0};
+   vector<Real> local;
+   vector<Real> global;
+   uint tstep {0};
+   Real t {0.0};
+   Real dt {0.0};
+};
+static PendingDiagnostic pendingDiagnostic;
+
+/*! MPI reduction operator for the packed diagnostic values [cell count, sums, minima, maxima].
+ * The number of operators is recovered from the size of the contiguous datatype.
+ */
+static void diagnosticReductionOp(void* in, void* inout, int* len, MPI_Datatype* datatype) {
+   int typeSize;
+   MPI_Type_size(*datatype, &typeSize);
+   const int nValues = typeSize / sizeof(Real);
+   const int nOps = (nValues - 1) / 3;
+   const Real* a = reinterpret_cast<const Real*>(in);
+   Real* b = reinterpret_cast<Real*>(inout);
+   for (int e=0; e<*len; ++e) {
+      for (int i=0; i<1+nOps; ++i) b[i] += a[i];
+      for (int i=1+nOps; i<1+2*nOps; ++i) b[i] = min(a[i], b[i]);
+      for (int i=1+2*nOps; i<nValues; ++i) b[i] = max(a[i], b[i]);
+      a += nValues;
+      b += nValues;
+   }
+}
+
+/*! Waits for the pending diagnostic reduction and writes its line into diagnostic.txt */
+static void completeDiagnosticReduction() {
+   if (pendingDiagnostic.active == false) return;
+   MPI_Wait(&pendingDiagnostic.request, MPI_STATUS_IGNORE);
+   pendingDiagnostic.active = false;
+
+   int myRank;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   if (myRank != MASTER_RANK) return;
+
+   const uint nOps = pendingDiagnostic.nOps;
+   const vector<Real>& global = pendingDiagnostic.global;
+   diagnostic << setprecision(12); 
+   diagnostic << pendingDiagnostic.tstep << "\t";
+   diagnostic << pendingDiagnostic.t << "\t";
+   diagnostic << pendingDiagnostic.dt << "\t";
+   for (uint i=0; i<nOps; ++i) {
+      const Real globalSum = global[1+i];
+      const Real globalAvg = (global[0] != 0.0) ? globalSum / global[0] : globalSum;
+      diagnostic << global[1+nOps+i] << "\t" <<
+      global[1+2*nOps+i] << "\t" <<
+      globalSum << "\t" <<
+      globalAvg << "\t";
+   }
+   diagnostic << endl << write;
+}
+
+static void freeDiagnosticReduction() {
+   if (pendingDiagnostic.type != MPI_DATATYPE_NULL) MPI_Type_free(&pendingDiagnostic.type);
+   if (pendingDiagnostic.op != MPI_OP_NULL) MPI_Op_free(&pendingDiagnostic.op);
+   pendingDiagnostic.nOps = 0;
+}
+
 /*!
 
 \brief Write out simulation diagnostics into diagnostic.txt
@@ -1937,11 +2136,6 @@ bool writeDiagnostic(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    // Exit if the user does not want any diagnostics output
    if (nOps == 0) return true;
 
-   vector<Real> localMin(nOps), localMax(nOps), localSum(nOps+1), localAvg(nOps),
-               globalMin(nOps),globalMax(nOps),globalSum(nOps+1),globalAvg(nOps);
-   localSum[0] = 1.0 * nCells;
-   Real buffer;
-   bool success = true;
    static bool printDiagnosticHeader = true;
    
    if (printDiagnosticHeader == true && myRank == MASTER_RANK) {
@@ -1956,51 +2150,96 @@ bool writeDiagnostic(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       }
       printDiagnosticHeader = false;
    }
-   
+
+   // The previous diagnostic reduction has been overlapping with the steps since then,
+   // complete it and write its line before starting a new one.
+   completeDiagnosticReduction();
+
+   vector<uint> concurrentOps, serialOps;
    for (uint i=0; i<nOps; ++i) {
-      
       if (dataReducer.getDataVectorInfo(i,dataType,dataSize,vectorSize) == false) {
          cerr << "ERROR when requesting info from diagnostic DRO " << dataReducer.getName(i) << endl;
       }
+      if (dataReducer.isDiagnosticThreadSafe(i) == true) concurrentOps.push_back(i);
+      else serialOps.push_back(i);
+   }
+
+   // Local values packed as [cell count, sums, minima, maxima] for the combined reduction
+   vector<Real>& local = pendingDiagnostic.local;
+   local.assign(3*nOps+1, 0.0);
+   local[0] = 1.0 * nCells;
+   Real* localSum = local.data() + 1;
+   Real* localMin = local.data() + 1 + nOps;
+   Real* localMax = local.data() + 1 + 2*nOps;
+   for (uint i=0; i<nOps; ++i) {
       localMin[i] = std::numeric_limits<Real>::max();
       localMax[i] = std::numeric_limits<Real>::min();
-      localSum[i+1] = 0.0;
-      buffer = 0.0;
-      
-      // Request DataReductionOperator to calculate the reduced data for all local cells:
+   }
+   vector<bool> success(nOps, true);
+
+   // Single pass over the cells evaluating all thread-safe operators per cell
+   #pragma omp parallel
+   {
+      vector<Real> threadSum(nOps, 0.0), threadMin(nOps, std::numeric_limits<Real>::max()), threadMax(nOps, std::numeric_limits<Real>::min());
+      vector<bool> threadSuccess(nOps, true);
+      #pragma omp for schedule(dynamic,64)
       for (uint64_t cell=0; cell<nCells; ++cell) {
-         success = true;
-         if (dataReducer.reduceDiagnostic(mpiGrid[cells[cell]], i, &buffer) == false) success = false;
+         const SpatialCell* SC = mpiGrid[cells[cell]];
+         for (const uint i : concurrentOps) {
+            Real buffer = 0.0;
+            if (dataReducer.reduceDiagnosticConcurrent(SC, i, &buffer) == false) threadSuccess[i] = false;
+            threadMin[i] = min(buffer, threadMin[i]);
+            threadMax[i] = max(buffer, threadMax[i]);
+            threadSum[i] += buffer;
+         }
+      }
+      #pragma omp critical
+      {
+         for (const uint i : concurrentOps) {
+            localMin[i] = min(threadMin[i], localMin[i]);
+            localMax[i] = max(threadMax[i], localMax[i]);
+            localSum[i] += threadSum[i];
+            if (threadSuccess[i] == false) success[i] = false;
+         }
+      }
+   }
+
+   // Operators keeping per-cell state in setSpatialCell are evaluated serially
+   for (const uint i : serialOps) {
+      Real buffer = 0.0;
+      for (uint64_t cell=0; cell<nCells; ++cell) {
+         if (dataReducer.reduceDiagnostic(mpiGrid[cells[cell]], i, &buffer) == false) success[i] = false;
          localMin[i] = min(buffer, localMin[i]);
          localMax[i] = max(buffer, localMax[i]);
-         localSum[i+1] += buffer;
+         localSum[i] += buffer;
       }
-      localAvg[i] = localSum[i+1];
-      
-      if (success == false) logFile << "(MAIN) writeDiagnostic: ERROR datareductionoperator '" << dataReducer.getName(i) <<
-                               "' returned false!" << endl << writeVerbose;
    }
-   
-   MPI_Reduce(&localMin[0], &globalMin[0], nOps, MPI_Type<Real>(), MPI_MIN, 0, MPI_COMM_WORLD);
-   MPI_Reduce(&localMax[0], &globalMax[0], nOps, MPI_Type<Real>(), MPI_MAX, 0, MPI_COMM_WORLD);
-   MPI_Reduce(&localSum[0], &globalSum[0], nOps + 1, MPI_Type<Real>(), MPI_SUM, 0, MPI_COMM_WORLD);
-   
-   diagnostic << setprecision(12); 
-   diagnostic << Parameters::tstep << "\t";
-   diagnostic << Parameters::t << "\t";
-   diagnostic << Parameters::dt << "\t";
-   
+
    for (uint i=0; i<nOps; ++i) {
-      if (globalSum[0] != 0.0) globalAvg[i] = globalSum[i+1] / globalSum[0];
-      else globalAvg[i] = globalSum[i+1];
-      if (myRank == MASTER_RANK) {
-         diagnostic << globalMin[i] << "\t" <<
-         globalMax[i] << "\t" <<
-         globalSum[i+1] << "\t" <<
-         globalAvg[i] << "\t";
-      }
-   }
-   if (myRank == MASTER_RANK) diagnostic << endl << write;
+      if (success[i] == false) logFile << "(MAIN) writeDiagnostic: ERROR datareductionoperator '" << dataReducer.getName(i) <<
+                                  "' returned false!" << endl << writeVerbose;
+   }
+
+   // One combined non-blocking reduction, completed at the next call or in flushDiagnostic
+   if (pendingDiagnostic.nOps != nOps) {
+      freeDiagnosticReduction();
+      MPI_Type_contiguous(3*nOps+1, MPI_Type<Real>(), &pendingDiagnostic.type);
+      MPI_Type_commit(&pendingDiagnostic.type);
+      MPI_Op_create(&diagnosticReductionOp, 1, &pendingDiagnostic.op);
+      pendingDiagnostic.nOps = nOps;
+   }
+   pendingDiagnostic.global.resize(3*nOps+1);
+   pendingDiagnostic.tstep = Parameters::tstep;
+   pendingDiagnostic.t = Parameters::t;
+   pendingDiagnostic.dt = Parameters::dt;
+   MPI_Ireduce(local.data(), pendingDiagnostic.global.data(), 1, pendingDiagnostic.type, pendingDiagnostic.op, MASTER_RANK, MPI_COMM_WORLD, &pendingDiagnostic.request);
+   pendingDiagnostic.active = true;
+   return true;
+}
+
+bool flushDiagnostic() {
+   completeDiagnosticReduction();
+   freeDiagnosticReduction();
    return true;
 }
 
@@ -114,11 +114,21 @@ bool writeRestart(
 */
 bool writeDiagnostic(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,DataReducer& dataReducer);
 
+/*!
+
+\brief Complete the diagnostic reduction still in flight and write its line into diagnostic.txt
+
+writeDiagnostic posts its MPI reduction without waiting for it, so that it overlaps the following
+time steps. This must be called before the diagnostic file is closed.
+*/
+bool flushDiagnostic();
+
 bool writeVelocitySpace(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                         vlsv::Writer& vlsvWriter,int index,const std::vector<uint64_t>& cells);
 
 bool writeVelocityDistributionData(vlsv::Writer& vlsvWriter,dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                   const std::vector<uint64_t>& cells,MPI_Comm comm);
+                                   const std::vector<uint64_t>& cells,MPI_Comm comm,
+                                   const Real compressionTolerance=0.0);
 
 bool writeIonosphereGridMetadata(vlsv::Writer& vlsvWriter);
 #endif
@@ -34,6 +34,7 @@
 #include "object_wrapper.h"
 
 #include "memory_report.h"
+#include "memoryallocation.h"
 
 #ifdef PAPI_MEM
 #include "papi.h"
@@ -270,6 +271,36 @@ void report_memory_consumption(
          P::tstep, P::t, sum_mem[2]/GiB, sum_mem[5]/GiB);
    logFile << reportstring;
 
+   if (block_pool::isEnabled()) {
+      /*report occupancy of the velocity block pool, per size class summed over ranks*/
+      std::vector<block_pool::ClassStatistics> poolStatistics;
+      block_pool::getStatistics(poolStatistics);
+      const size_t nClasses = poolStatistics.size();
+      std::vector<double> poolCounts(2*nClasses+2), sumPoolCounts(2*nClasses+2), maxPoolCounts(2*nClasses+2);
+      for (size_t k=0; k<nClasses; ++k) {
+         poolCounts[2*k]   = poolStatistics[k].inUse;
+         poolCounts[2*k+1] = poolStatistics[k].cached;
+         poolCounts[2*nClasses]   += (double)poolStatistics[k].inUse * poolStatistics[k].bufferBytes;
+         poolCounts[2*nClasses+1] += (double)poolStatistics[k].cached * poolStatistics[k].bufferBytes;
+      }
+      MPI_Reduce(poolCounts.data(), sumPoolCounts.data(), 2*nClasses+2, MPI_DOUBLE, MPI_SUM, MASTER_RANK, MPI_COMM_WORLD);
+      MPI_Reduce(poolCounts.data(), maxPoolCounts.data(), 2*nClasses+2, MPI_DOUBLE, MPI_MAX, MASTER_RANK, MPI_COMM_WORLD);
+
+      snprintf(reportstring,512, "(MEM) tstep %i t %.3g %-21s (GiB/rank; avg, max, sum): %-8.3g %-8.3g %-8.3g\n",
+            P::tstep, P::t, "Block pool in use", sumPoolCounts[2*nClasses]/nProcs/GiB, maxPoolCounts[2*nClasses]/GiB, sumPoolCounts[2*nClasses]/GiB);
+      logFile << reportstring;
+      snprintf(reportstring,512, "(MEM) tstep %i t %.3g %-21s (GiB/rank; avg, max, sum): %-8.3g %-8.3g %-8.3g\n",
+            P::tstep, P::t, "Block pool cached", sumPoolCounts[2*nClasses+1]/nProcs/GiB, maxPoolCounts[2*nClasses+1]/GiB, sumPoolCounts[2*nClasses+1]/GiB);
+      logFile << reportstring;
+      logFile << "(MEM) tstep " << P::tstep << " block pool classes (buffer KiB: in use / cached)";
+      for (size_t k=0; k<nClasses; ++k) {
+         if (sumPoolCounts[2*k] + sumPoolCounts[2*k+1] > 0) {
+            logFile << " " << poolStatistics[k].bufferBytes/1024.0 << ": " << sumPoolCounts[2*k] << "/" << sumPoolCounts[2*k+1];
+         }
+      }
+      logFile << std::endl;
+   }
+
    logFile << writeVerbose;
 
    MPI_Comm_free(&interComm);
@@ -25,6 +25,9 @@
 #include <math.h>
 #include <unordered_map> // for hasher
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include "logger.h"
 #include "memoryallocation.h"
 #include "common.h"
@@ -90,8 +93,163 @@ void operator delete[](void *ptr, std::size_t size) noexcept {
 #endif // JEMALLOC_VERSION_MAJOR < 5
 #endif // use jemalloc
 
+namespace block_pool {
+   // Buffers are 64-byte aligned and preceded by a header holding the pointer returned by
+   // malloc and a tag: the size class index, or the byte count with UNPOOLED set.
+   static const std::size_t ALIGNMENT = 64;
+   static const std::size_t HEADER_BYTES = 2*sizeof(uint64_t);
+   static const uint64_t UNPOOLED = uint64_t(1) << 63;
+   static const std::size_t MIN_CLASS_BYTES = 256;
+   static const int CLASSES_PER_OCTAVE = 4;
+   static const int N_OCTAVES = 22; // up to 1 GiB, larger requests bypass the pool
+
+   struct SizeClass {
+      std::mutex mutex;
+      std::vector<void*> freeList;
+      std::atomic<uint64_t> inUse {0};
+      std::size_t bufferBytes {0};
+   };
+
+   struct Pool {
+      Pool() : classes(CLASSES_PER_OCTAVE*N_OCTAVES) {
+         for (size_t k=0; k<classes.size(); ++k) {
+            const double bytes = MIN_CLASS_BYTES * pow(2.0, (double)k / CLASSES_PER_OCTAVE);
+            classes[k].bufferBytes = ((std::size_t)ceil(bytes) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            classBytes.push_back(classes[k].bufferBytes);
+         }
+      }
+      std::vector<SizeClass> classes;
+      std::vector<std::size_t> classBytes;
+      std::atomic<bool> enabled {false};
+      std::atomic<uint64_t> unpooledBytes {0};
+   };
+
+   static Pool& pool() {
+      static Pool instance;
+      return instance;
+   }
+
+   static void* rawAllocate(const std::size_t bytes, const uint64_t tag) {
+#ifdef USE_JEMALLOC
+      void* p = je_malloc(bytes + ALIGNMENT - 1 + HEADER_BYTES);
+#else
+      void* p = malloc(bytes + ALIGNMENT - 1 + HEADER_BYTES);
+#endif
+      if (p == NULL) {
+         return NULL;
+      }
+      uint64_t* ptr = (uint64_t*) (((uintptr_t)p + HEADER_BYTES + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+      ptr[-2] = (uint64_t)(uintptr_t)p;
+      ptr[-1] = tag;
+      return ptr;
+   }
+
+   static void rawFree(void* ptr) {
+      void* p = (void*)(uintptr_t)((uint64_t*)ptr)[-2];
+#ifdef USE_JEMALLOC
+      je_free(p);
+#else
+      free(p);
+#endif
+   }
+
+   void* allocate(const std::size_t bytes) {
+      Pool& bp = pool();
+      void* ptr = NULL;
+      auto it = std::lower_bound(bp.classBytes.begin(), bp.classBytes.end(), bytes);
+      if (bp.enabled && it != bp.classBytes.end()) {
+         const size_t k = it - bp.classBytes.begin();
+         SizeClass& c = bp.classes[k];
+         {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            if (!c.freeList.empty()) {
+               ptr = c.freeList.back();
+               c.freeList.pop_back();
+            }
+         }
+         if (ptr == NULL) {
+            ptr = rawAllocate(c.bufferBytes, k);
+            if (ptr == NULL) {
+               return NULL;
+            }
+         }
+         c.inUse++;
+      } else {
+         ptr = rawAllocate(bytes, UNPOOLED | bytes);
+         if (ptr == NULL) {
+            return NULL;
+         }
+         bp.unpooledBytes += bytes;
+      }
+#ifdef INITIALIZE_ALIGNED_MALLOC_WITH_NAN
+      memset(ptr, ~0u, bytes);
+#endif
+      return ptr;
+   }
+
+   void deallocate(void* ptr) {
+      if (ptr == NULL) {
+         return;
+      }
+      Pool& bp = pool();
+      const uint64_t tag = ((uint64_t*)ptr)[-1];
+      if (tag & UNPOOLED) {
+         bp.unpooledBytes -= (tag & ~UNPOOLED);
+         rawFree(ptr);
+         return;
+      }
+      SizeClass& c = bp.classes[tag];
+      c.inUse--;
+      if (bp.enabled) {
+         std::lock_guard<std::mutex> lock(c.mutex);
+         c.freeList.push_back(ptr);
+      } else {
+         rawFree(ptr);
+      }
+   }
+
+   bool isEnabled() {
+      return pool().enabled;
+   }
+
+   void setEnabled(const bool enabled) {
+      pool().enabled = enabled;
+      if (!enabled) {
+         release();
+      }
+   }
+
+   void release() {
+      for (SizeClass& c : pool().classes) {
+         std::lock_guard<std::mutex> lock(c.mutex);
+         for (void* ptr : c.freeList) {
+            rawFree(ptr);
+         }
+         c.freeList.clear();
+         c.freeList.shrink_to_fit();
+      }
+   }
+
+   void getStatistics(std::vector<ClassStatistics>& statistics) {
+      statistics.resize(pool().classes.size());
+      for (size_t k=0; k<statistics.size(); ++k) {
+         SizeClass& c = pool().classes[k];
+         std::lock_guard<std::mutex> lock(c.mutex);
+         statistics[k].bufferBytes = c.bufferBytes;
+         statistics[k].inUse = c.inUse;
+         statistics[k].cached = c.freeList.size();
+      }
+   }
+
+   void getUnpooledStatistics(uint64_t& inUseBytes) {
+      inUseBytes = pool().unpooledBytes;
+   }
+}
+
 /*! Purge allocations from all arenas to actually release memory back to system */
 void memory_purge() {
+   // Cached pool buffers are only useful while blocks are churning, hand them back first
+   block_pool::release();
 #ifdef USE_JEMALLOC
    je_mallctl("arena." STRINGIFY(MALLCTL_ARENAS_ALL) ".purge", NULL, NULL, NULL, 0);
 #endif
@@ -28,6 +28,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <string.h>
+#include <vector>
 
 #ifdef USE_JEMALLOC
 #include "jemalloc/jemalloc.h"
@@ -240,4 +241,86 @@ private:
 };
 
 
+/**
+ * Rank-wide pool of aligned buffers for velocity block data and block parameters.
+ *
+ * Requests are rounded up to a size class (four classes per power of two) and
+ * released buffers are kept on a per-class free list instead of being returned to
+ * the system, so that the constant resizing of per-cell block containers during
+ * block adjustment, load balancing and remote cell deallocation reuses a small
+ * set of buffer sizes rather than fragmenting the heap. Getting and returning a
+ * buffer is O(1). The pool is disabled by default, in which case buffers are
+ * allocated with their exact size and freed immediately. Buffers carry a tag so
+ * that enabling or disabling the pool at any time is safe.
+ *
+ * VelocityBlockContainer only uses the pool in CPU builds with -DUSE_BLOCK_POOL,
+ * otherwise its storage comes from aligned_allocator.
+ */
+namespace block_pool {
+   /*! Occupancy of one size class.*/
+   struct ClassStatistics {
+      std::size_t bufferBytes; /*!< Size of the buffers in this class.*/
+      uint64_t inUse;          /*!< Buffers handed out and not yet returned.*/
+      uint64_t cached;         /*!< Buffers held on the free list.*/
+   };
+
+   void* allocate(const std::size_t bytes);
+   void deallocate(void* p);
+   bool isEnabled();
+   void setEnabled(const bool enabled);
+   /*! Return all cached buffers to the system.*/
+   void release();
+   /*! Statistics of all size classes, in order of increasing buffer size.*/
+   void getStatistics(std::vector<ClassStatistics>& statistics);
+   /*! Bytes in use in buffers allocated outside the size classes (pool disabled or very large requests).*/
+   void getUnpooledStatistics(uint64_t& inUseBytes);
+}
+
+/**
+ * Stateless allocator drawing from block_pool. Buffers are aligned to 64 bytes;
+ * larger Alignment values (e.g. WID3 with WID=8) are capped there, which still
+ * covers the widest vector loads.
+ */
+template <typename T, std::size_t Alignment>
+class pool_allocator
+{
+public:
+   typedef T value_type;
+   typedef std::size_t size_type;
+   typedef ptrdiff_t difference_type;
+
+   template <typename U>
+   struct rebind
+   {
+      typedef pool_allocator<U, Alignment> other;
+   };
+
+   pool_allocator() { }
+   pool_allocator(const pool_allocator&) { }
+   template <typename U> pool_allocator(const pool_allocator<U, Alignment>&) { }
+
+   bool operator==(const pool_allocator& other) const { return true; }
+   bool operator!=(const pool_allocator& other) const { return false; }
+
+   T * allocate(const std::size_t n) const
+      {
+         if (n == 0) {
+            return NULL;
+         }
+         if (n > (static_cast<std::size_t>(0) - static_cast<std::size_t>(1)) / sizeof(T)) {
+            throw std::length_error("pool_allocator<T>::allocate() - Integer overflow.");
+         }
+         void * const pv = block_pool::allocate(n * sizeof(T));
+         if (pv == NULL) {
+            throw std::bad_alloc();
+         }
+         return static_cast<T *>(pv);
+      }
+
+   void deallocate(T * const p, const std::size_t ) const
+      {
+         block_pool::deallocate(p);
+      }
+};
+
 #endif
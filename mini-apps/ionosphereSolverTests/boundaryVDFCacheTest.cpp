@@ -0,0 +1,163 @@
+/*
+ * Test of the ionosphere boundary VDF cache (ionosphere.boundaryVDFCacheTolerance).
+ *
+ * Maxwellian boundary VDFs are filled with Ionosphere::fillMaxwellianVDF into three cells with
+ * the same moments but different loss counters, time step limits and subcycle counts: one with
+ * the cache disabled, one that misses the cache and one that hits it. The test fails unless
+ *  - the block adjustment loss added to RHOLOSSADJUST is the same, and nonzero, in all three,
+ *  - the hit keeps the loss counter, time step limits, subcycle count and sparsity threshold
+ *    of its own cell,
+ *  - the hit, filled with a density within the cache tolerance of the miss, has the same blocks
+ *    and block data as the miss.
+ *
+ * Usage: boundaryVDFCacheTest
+ */
+#include <iostream>
+#include "../../sysboundary/ionosphere.h"
+#include "../../object_wrapper.h"
+#include "../../velocity_mesh_parameters.h"
+#include "../../logger.h"
+
+using namespace std;
+using namespace SBC;
+
+Logger logFile,diagnostic;
+int globalflags::bailingOut=0;
+bool globalflags::writeRestart=false;
+bool globalflags::writeRecover=false;
+bool globalflags::balanceLoad=false;
+bool globalflags::doRefine=false;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+
+// Dummy implementations of some functions to make things compile
+std::vector<CellID> localCellDummy;
+const std::vector<CellID>& getLocalCells() { return localCellDummy; }
+void deallocateRemoteCellBlocks(dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&) {};
+void updateRemoteVelocityBlockLists(dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&, unsigned int, unsigned int) {};
+void recalculateLocalCellsCache(const dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&) {};
+SysBoundary::SysBoundary() {}
+SysBoundary::~SysBoundary() {}
+
+const uint popID = 0;
+
+/*! Set up one proton population on a uniform velocity mesh, as ObjectWrapper would from the config file.*/
+static void initializePopulation() {
+   vmesh::allocateMeshWrapper();
+
+   getObjectWrapper().particleSpecies.push_back(species::Species());
+   species::Species& proton = getObjectWrapper().particleSpecies.back();
+   proton.name = "proton";
+   proton.charge = physicalconstants::CHARGE;
+   proton.mass = physicalconstants::MASS_PROTON;
+   proton.sparseMinValue = 1e-15;
+   proton.velocityMesh = 0;
+   proton.sparseBlockAddWidthV = 1;
+   proton.sparse_conserve_mass = false;
+   proton.sparseDynamicAlgorithm = 0;
+   proton.thermalRadius = 0;
+
+   vmesh::MeshParameters mesh;
+   mesh.name = proton.name;
+   for (uint d=0; d<3; ++d) {
+      mesh.meshLimits[2*d] = -2e6;
+      mesh.meshLimits[2*d+1] = 2e6;
+      mesh.gridLength[d] = 50;
+      mesh.blockLength[d] = WID;
+   }
+   vmesh::getMeshWrapper()->velocityMeshesCreation->push_back(mesh);
+   vmesh::getMeshWrapper()->initVelocityMeshes(1);
+}
+
+/*! Give the cell a history that the boundary condition must not overwrite.*/
+static void setHistory(SpatialCell& cell, const Real seed) {
+   spatial_cell::Population& population = cell.get_population(popID);
+   population.RHOLOSSADJUST = 1e3 * seed;
+   population.max_dt[0] = 0.1 * seed;
+   population.max_dt[1] = 0.01 * seed;
+   population.ACCSUBCYCLES = (uint)(3 * seed);
+}
+
+int main(int argc, char** argv) {
+   MPI_Init(&argc,&argv);
+   const int masterProcessID = 0;
+   logFile.open(MPI_COMM_WORLD, masterProcessID, "logfile.txt");
+
+   initializePopulation();
+   const Real density = 1e6;
+   const Real temperature = 1e5;
+   const std::array<Real, 3> vDrift = {1e5, -5e4, 2e4};
+
+   SpatialCell uncached, miss, hit;
+   setHistory(uncached, 1);
+   setHistory(miss, 2);
+   setHistory(hit, 3);
+   const spatial_cell::Population hitBefore = hit.get_population(popID);
+
+   Ionosphere::boundaryVDFCacheTolerance = 0;
+   Ionosphere::fillMaxwellianVDF(uncached, popID, density, temperature, vDrift);
+   Ionosphere::boundaryVDFCacheTolerance = 1e-3;
+   Ionosphere::boundaryVDFCacheSize = 8;
+   Ionosphere::fillMaxwellianVDF(miss, popID, density, temperature, vDrift);
+   // Within the cache tolerance but not bit-identical, so block data equal to the miss shows that it was copied
+   Ionosphere::fillMaxwellianVDF(hit, popID, density * (1 + 1e-5), temperature, vDrift);
+
+   bool success = true;
+   const Real lossUncached = uncached.get_population(popID).RHOLOSSADJUST - 1e3;
+   const Real lossMiss = miss.get_population(popID).RHOLOSSADJUST - 2e3;
+   const Real lossHit = hit.get_population(popID).RHOLOSSADJUST - 3e3;
+   cout << "Block adjustment loss: uncached " << lossUncached << ", cache miss " << lossMiss << ", cache hit " << lossHit << endl;
+   // The losses are differences of counters of different size, allow for their rounding
+   const Real lossTolerance = 1e-12 * 3e3;
+   if (!(lossUncached > lossTolerance)) {
+      cerr << "No content was removed by the block adjustment, the loss is not tested" << endl;
+      success = false;
+   }
+   if (!(fabs(lossMiss - lossUncached) <= lossTolerance) || !(fabs(lossHit - lossUncached) <= lossTolerance)) {
+      cerr << "Cache miss or hit changed the loss counter differently from the uncached VDF" << endl;
+      success = false;
+   }
+
+   const spatial_cell::Population& hitAfter = hit.get_population(popID);
+   if (hitAfter.max_dt[0] != hitBefore.max_dt[0] || hitAfter.max_dt[1] != hitBefore.max_dt[1]
+       || hitAfter.ACCSUBCYCLES != hitBefore.ACCSUBCYCLES || hitAfter.velocityBlockMinValue != hitBefore.velocityBlockMinValue) {
+      cerr << "Cache hit overwrote the time step limits, subcycle count or sparsity threshold of the cell" << endl;
+      success = false;
+   }
+
+   const vmesh::LocalID nBlocks = miss.get_number_of_velocity_blocks(popID);
+   if (hit.get_number_of_velocity_blocks(popID) != nBlocks || uncached.get_number_of_velocity_blocks(popID) != nBlocks) {
+      cerr << "Block counts differ: uncached " << uncached.get_number_of_velocity_blocks(popID) << ", cache miss " << nBlocks
+           << ", cache hit " << hit.get_number_of_velocity_blocks(popID) << endl;
+      success = false;
+   } else {
+      for (vmesh::LocalID blockLID = 0; blockLID < nBlocks; ++blockLID) {
+         const vmesh::GlobalID blockGID = miss.get_velocity_block_global_id(blockLID, popID);
+         const vmesh::LocalID hitLID = hit.get_velocity_block_local_id(blockGID, popID);
+         if (hitLID == vmesh::VelocityMesh::invalidLocalID()) {
+            cerr << "Block " << blockGID << " is missing from the cache hit" << endl;
+            success = false;
+            break;
+         }
+         const Realf* missData = miss.get_data(blockLID, popID);
+         const Realf* hitData = hit.get_data(hitLID, popID);
+         bool same = true;
+         for (uint i = 0; i < WID3; ++i) {
+            same = same && (missData[i] == hitData[i]);
+         }
+         if (!same) {
+            cerr << "Block " << blockGID << " data differs between the cache miss and hit" << endl;
+            success = false;
+            break;
+         }
+      }
+   }
+   cout << nBlocks << " blocks" << endl;
+
+   cout << (success ? "PASSED" : "FAILED") << endl;
+   MPI_Finalize();
+   return success ? 0 : 1;
+}
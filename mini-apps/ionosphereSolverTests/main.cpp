@@ -112,6 +112,7 @@ int main(int argc, char** argv) {
    std::vector<std::pair<double, double>> refineExtents;
    Ionosphere::solverMaxIterations = 1000;
    bool doPrecondition = true;
+   bool doMultigrid = false;
    bool writeSolverMtarix = false;
    bool quiet = false;
    int multipoleL = 0;
@@ -152,6 +153,10 @@ int main(int argc, char** argv) {
          doPrecondition = false;
          continue;
       }
+      if(!strcmp(argv[i], "-mg")) {
+         doMultigrid = true;
+         continue;
+      }
       if(!strcmp(argv[i], "-infile")) {
          inputFile = argv[++i];
          continue;
@@ -174,7 +179,7 @@ int main(int argc, char** argv) {
       }
       cerr << "Unknown command line option \"" << argv[i] << "\"" << endl;
       cerr << endl;
-      cerr << "main [-N num] [-r <lat0> <lat1>] [-sigma (identity|random|35|53|file)] [-fac (constant|dipole|quadrupole|octopole|hexadecapole||file)] [-facfile <filename>] [-gaugeFix equator|equator40|equator45|equator60|pole|integral|none] [-np]" << endl;
+      cerr << "main [-N num] [-r <lat0> <lat1>] [-sigma (identity|random|35|53|file)] [-fac (constant|dipole|quadrupole|octopole|hexadecapole||file)] [-facfile <filename>] [-gaugeFix equator|equator40|equator45|equator60|pole|integral|none] [-np] [-mg]" << endl;
       cerr << "Paramters:" << endl;
       cerr << " -N:            Number of ionosphere mesh nodes (default: 64)" << endl;
       cerr << " -r:            Refine grid between the given latitudes (can be specified multiple times)" << endl;
@@ -206,6 +211,7 @@ int main(int argc, char** argv) {
       cerr << "                equator45 - Fix potential on all nodes +- 45 degrees of the equator" << endl;
       cerr << "                equator60 - Fix potential on all nodes +- 60 degrees of the equator" << endl;
       cerr << " -np:           DON'T use the matrix preconditioner (default: do)" << endl;
+      cerr << " -mg:           Use the multigrid preconditioner instead of the diagonal one (default: don't)" << endl;
       cerr << " -maxIter:      Maximum number of solver iterations" << endl;
       cerr << " -o <filename>: Output filename (default: \"output.vlsv\")" << endl;
       cerr << " -matrix:       Write solver dependency matrix to solverMatrix.txt (default: don't.)" << endl;
@@ -469,13 +475,17 @@ int main(int argc, char** argv) {
    // Try to solve the system.
    ionosphereGrid.isCouplingInwards=true;
    Ionosphere::solverPreconditioning = doPrecondition;
+   Ionosphere::solverMultigrid = doMultigrid;
    Ionosphere::solverMaxFailureCount = 3;
    ionosphereGrid.rank = 0;
    int iterations, nRestarts;
    Real residual = std::numeric_limits<Real>::max(), minPotentialN, minPotentialS, maxPotentialN, maxPotentialS;
+   double solveStart = MPI_Wtime();
    ionosphereGrid.solve(iterations, nRestarts, residual, minPotentialN, maxPotentialN, minPotentialS, maxPotentialS);
+   double solveTime = MPI_Wtime() - solveStart;
    if(!quiet) {
       cout << "Ionosphere solver: iterations " << iterations << " restarts " << nRestarts
+         << " time " << solveTime << " s"
          << " residual " << std::scientific << residual << std::defaultfloat
          << " potential min N = " << minPotentialN << " S = " << minPotentialS
          << " max N = " << maxPotentialN << " S = " << maxPotentialS
@@ -0,0 +1,355 @@
+/*
+ * Consistency test of the batched field line tracers (fieldtracing.use_batched_tracing)
+ * against the scalar integrators.
+ *
+ * The same seed points are traced through an analytic dipole field for a fixed number of
+ * steps with stepFieldLine() one line at a time and with stepFieldLinesBatch() in batches
+ * of TRACING_BATCH_SIZE (the last batch partially filled), for the Euler, adaptive Euler,
+ * Bulirsch-Stoer and Dormand-Prince methods. Half of the lines are traced along and half
+ * against the field. The test fails if any endpoint of the two tracers differs by more than
+ * the step tolerance fieldtracing.tracer_max_allowed_error.
+ *
+ * The fsgrid field functions are compared the same way: traceFullFieldBatch() against
+ * traceFullFieldFunction() on a periodic fsgrid box holding a perturbed field, with and
+ * without the reconstruction coefficient cache. Several lanes of each batch share an fsgrid
+ * cell, some cells are flagged as boundary cells without a perturbed field, and every third
+ * lane is masked out. The test fails if a field direction differs by more than 1e-5, if a
+ * masked lane is written, or if a traced endpoint differs by more than the step tolerance.
+ *
+ * Usage: tracingBatchTest [number of seeds] [number of steps]
+ */
+#include <iostream>
+#include "../../sysboundary/ionosphere.h"
+#include "../../object_wrapper.h"
+#include "../../fieldtracing/fieldtracing.h"
+#include "../../logger.h"
+
+using namespace std;
+using namespace SBC;
+
+Logger logFile,diagnostic;
+int globalflags::bailingOut=0;
+bool globalflags::writeRestart=false;
+bool globalflags::writeRecover=false;
+bool globalflags::balanceLoad=false;
+bool globalflags::doRefine=false;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+
+// Dummy implementations of some functions to make things compile
+std::vector<CellID> localCellDummy;
+const std::vector<CellID>& getLocalCells() { return localCellDummy; }
+void deallocateRemoteCellBlocks(dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&) {};
+void updateRemoteVelocityBlockLists(dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&, unsigned int, unsigned int) {};
+void recalculateLocalCellsCache(const dccrg::Dccrg<spatial_cell::SpatialCell, dccrg::Cartesian_Geometry, std::tuple<>, std::tuple<> >&) {};
+SysBoundary::SysBoundary() {}
+SysBoundary::~SysBoundary() {}
+
+// Unit direction of a dipole field pointing along -z at the equator
+static bool dipoleDirection(std::array<Real,3>& r, const bool alongB, std::array<Real,3>& b) {
+   const Real r2 = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+   // B ~ 3 (m.r) r / r^5 - m / r^3 with m = (0,0,-1), the common 1/r^5 is dropped by the normalisation
+   const Real mr = -r[2];
+   b[0] = 3*mr*r[0];
+   b[1] = 3*mr*r[1];
+   b[2] = 3*mr*r[2] + r2;
+   const Real norm = (alongB ? 1. : -1.) / sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+   for (int c=0; c<3; c++) {
+      b[c] *= norm;
+   }
+   return true;
+}
+
+/*! Field line directions and endpoints of traceFullFieldBatch() against traceFullFieldFunction() on a perturbed fsgrid field.*/
+static bool testFsGridField(const int nSeeds) {
+   const FsGridTools::FsSize_t N = 16;
+   const Real dx = 1e6;
+   const std::array<FsGridTools::FsSize_t, 3> dims {N, N, N};
+   const std::array<bool,3> periodicity {true, true, true};
+   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> perBGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, FS_STENCIL_WIDTH> dPerBGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> technicalGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   perBGrid.DX = dPerBGrid.DX = technicalGrid.DX = dx;
+   perBGrid.DY = dPerBGrid.DY = technicalGrid.DY = dx;
+   perBGrid.DZ = dPerBGrid.DZ = technicalGrid.DZ = dx;
+   perBGrid.physicalGlobalStart = dPerBGrid.physicalGlobalStart = technicalGrid.physicalGlobalStart = {0, 0, 0};
+   P::xmin = P::ymin = P::zmin = 0;
+   P::xmax = P::ymax = P::zmax = N*dx;
+   P::dx_ini = P::dy_ini = P::dz_ini = dx;
+
+   // Uniform background and a sinusoidal perturbation with its cell-normalised derivatives, a sphere
+   // of two cells radius in the middle of the box is flagged as boundary cells without perturbation.
+   SBC::ionosphereGrid.setDipoleField([](double, double, double, coordinate, unsigned int, coordinate)->double {return 0;});
+   SBC::ionosphereGrid.setConstantBackgroundField({2e-9, -1e-9, -5e-9});
+   const Real A = 3e-9;
+   const Real k = 2*M_PI/N;
+   const std::array<FsGridTools::FsIndex_t, 3> localSize = technicalGrid.getLocalSize();
+   const std::array<FsGridTools::FsIndex_t, 3> localStart = technicalGrid.getLocalStart();
+   for (FsGridTools::FsIndex_t kk=0; kk<localSize[2]; kk++) {
+      for (FsGridTools::FsIndex_t jj=0; jj<localSize[1]; jj++) {
+         for (FsGridTools::FsIndex_t ii=0; ii<localSize[0]; ii++) {
+            const Real x = k*(ii + localStart[0]);
+            const Real y = k*(jj + localStart[1]);
+            const Real z = k*(kk + localStart[2]);
+            std::array<Real, fsgrids::bfield::N_BFIELD>* perB = perBGrid.get(ii,jj,kk);
+            std::array<Real, fsgrids::dperb::N_DPERB>* dPerB = dPerBGrid.get(ii,jj,kk);
+            perB->at(fsgrids::bfield::PERBX) = A*sin(y)*sin(z);
+            perB->at(fsgrids::bfield::PERBY) = A*sin(x)*sin(z);
+            perB->at(fsgrids::bfield::PERBZ) = A*sin(x)*sin(y);
+            dPerB->at(fsgrids::dperb::dPERBxdy) = A*k*cos(y)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBxdz) = A*k*sin(y)*cos(z);
+            dPerB->at(fsgrids::dperb::dPERBydx) = A*k*cos(x)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBydz) = A*k*sin(x)*cos(z);
+            dPerB->at(fsgrids::dperb::dPERBzdx) = A*k*cos(x)*sin(y);
+            dPerB->at(fsgrids::dperb::dPERBzdy) = A*k*sin(x)*cos(y);
+            dPerB->at(fsgrids::dperb::dPERBxdyy) = -A*k*k*sin(y)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBxdzz) = -A*k*k*sin(y)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBxdyz) = A*k*k*cos(y)*cos(z);
+            dPerB->at(fsgrids::dperb::dPERBydxx) = -A*k*k*sin(x)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBydzz) = -A*k*k*sin(x)*sin(z);
+            dPerB->at(fsgrids::dperb::dPERBydxz) = A*k*k*cos(x)*cos(z);
+            dPerB->at(fsgrids::dperb::dPERBzdxx) = -A*k*k*sin(x)*sin(y);
+            dPerB->at(fsgrids::dperb::dPERBzdyy) = -A*k*k*sin(x)*sin(y);
+            dPerB->at(fsgrids::dperb::dPERBzdxy) = A*k*k*cos(x)*cos(y);
+            const Real ri = ii + localStart[0] + 0.5 - N/2.;
+            const Real rj = jj + localStart[1] + 0.5 - N/2.;
+            const Real rk = kk + localStart[2] + 0.5 - N/2.;
+            technicalGrid.get(ii,jj,kk)->sysBoundaryFlag = (ri*ri + rj*rj + rk*rk < 4) ? sysboundarytype::DO_NOT_COMPUTE : sysboundarytype::NOT_SYSBOUNDARY;
+         }
+      }
+   }
+   perBGrid.updateGhostCells();
+   dPerBGrid.updateGhostCells();
+   technicalGrid.updateGhostCells();
+
+   FieldTracing::TracingFieldFunction<TReal> scalarFunction = [&perBGrid, &dPerBGrid, &technicalGrid](std::array<TReal,3>& r, const bool alongB, std::array<TReal,3>& b)->bool {
+      return FieldTracing::traceFullFieldFunction(perBGrid, dPerBGrid, technicalGrid, r, alongB, b);
+   };
+   FieldTracing::TracingBatchFieldFunction<TReal> batchFunction = [&perBGrid, &dPerBGrid, &technicalGrid](
+      const FieldTracing::BatchArray<TReal>& x, const FieldTracing::BatchArray<TReal>& y, const FieldTracing::BatchArray<TReal>& z,
+      const FieldTracing::BatchArray<uint8_t>& alongB, const FieldTracing::BatchArray<uint8_t>& mask,
+      FieldTracing::BatchArray<TReal>& bx, FieldTracing::BatchArray<TReal>& by, FieldTracing::BatchArray<TReal>& bz, FieldTracing::BatchArray<uint8_t>& ok
+   ) {
+      FieldTracing::traceFullFieldBatch(perBGrid, dPerBGrid, technicalGrid, x, y, z, alongB, mask, bx, by, bz, ok);
+   };
+
+   // Seeds within the middle of the box, in groups of three sharing an fsgrid cell. With at most
+   // nSteps*maxStepSize traced, the lines stay well inside the domain checked by the field functions.
+   const int nSteps = 20;
+   const TReal minStepSize = dx/100;
+   const TReal maxStepSize = dx/8;
+   std::vector<std::array<TReal,3>> seeds(nSeeds);
+   std::vector<bool> alongB(nSeeds);
+   for (int s=0; s<nSeeds; s++) {
+      const int group = s/3;
+      for (int c=0; c<3; c++) {
+         seeds[s][c] = (5 + (group*(c+3) + c) % 6 + 0.25 + 0.2*(s%3)) * dx;
+      }
+      alongB[s] = (group % 2 == 0);
+   }
+
+   bool success = true;
+   for (int useCache=0; useCache<2; useCache++) {
+      FieldTracing::fieldTracingParameters.useCache = useCache;
+      FieldTracing::fieldTracingParameters.reconstructionCoefficientsCache.clear();
+
+      // Field directions, every third lane is masked out and must not be written
+      Real maxDifference = 0;
+      for (int first=0; first<nSeeds; first+=FieldTracing::TRACING_BATCH_SIZE) {
+         FieldTracing::BatchArray<TReal> x, y, z, bx, by, bz;
+         FieldTracing::BatchArray<uint8_t> batchAlongB, mask, ok;
+         for (int l=0; l<FieldTracing::TRACING_BATCH_SIZE; l++) {
+            const int s = min(first + l, nSeeds - 1);
+            x[l] = seeds[s][0];
+            y[l] = seeds[s][1];
+            z[l] = seeds[s][2];
+            batchAlongB[l] = alongB[s];
+            mask[l] = (first + l < nSeeds) && (l % 3 != 2);
+            bx[l] = by[l] = bz[l] = -7;
+         }
+         batchFunction(x, y, z, batchAlongB, mask, bx, by, bz, ok);
+         for (int l=0; l<FieldTracing::TRACING_BATCH_SIZE; l++) {
+            if (!mask[l]) {
+               if (ok[l] || bx[l] != -7 || by[l] != -7 || bz[l] != -7) {
+                  cerr << "fsgrid: masked lane " << l << " of the batch at seed " << first << " was written" << endl;
+                  success = false;
+               }
+               continue;
+            }
+            std::array<TReal,3> r = {x[l], y[l], z[l]};
+            std::array<TReal,3> b;
+            if (!ok[l] || !scalarFunction(r, batchAlongB[l], b)) {
+               cerr << "fsgrid: field function failed at seed " << first + l << endl;
+               success = false;
+               continue;
+            }
+            const Real difference = sqrt((bx[l]-b[0])*(bx[l]-b[0]) + (by[l]-b[1])*(by[l]-b[1]) + (bz[l]-b[2])*(bz[l]-b[2]));
+            if (!(difference <= 1e-5)) {
+               cerr << "fsgrid: field direction at seed " << first + l << " differs by " << difference << endl;
+               success = false;
+            }
+            maxDifference = max(maxDifference, difference);
+         }
+      }
+
+      const FieldTracing::TracingMethod methods[4] = {FieldTracing::Euler, FieldTracing::ADPT_Euler, FieldTracing::BS, FieldTracing::DPrince};
+      const char* methodNames[4] = {"Euler", "ADPT_Euler", "BS", "DPrince"};
+      const Real tolerance = FieldTracing::fieldTracingParameters.max_allowed_error;
+      for (int m=0; m<4; m++) {
+         std::vector<std::array<TReal,3>> scalarEnd(seeds);
+         for (int s=0; s<nSeeds; s++) {
+            std::array<TReal,3> b = {0, 0, 0};
+            TReal stepSize = maxStepSize;
+            for (int n=0; n<nSteps; n++) {
+               FieldTracing::stepFieldLine(scalarEnd[s], b, stepSize, minStepSize, maxStepSize, methods[m], scalarFunction, alongB[s]);
+            }
+         }
+
+         std::vector<std::array<TReal,3>> batchEnd(seeds);
+         for (int first=0; first<nSeeds; first+=FieldTracing::TRACING_BATCH_SIZE) {
+            FieldTracing::TracingBatch<TReal> batch;
+            batch.clear();
+            for (int s=first; s<min(first + FieldTracing::TRACING_BATCH_SIZE, nSeeds); s++) {
+               batch.push(s, seeds[s], maxStepSize, alongB[s]);
+            }
+            for (int n=0; n<nSteps; n++) {
+               FieldTracing::stepFieldLinesBatch(batch, minStepSize, maxStepSize, methods[m], batchFunction);
+            }
+            for (int l=0; l<batch.size; l++) {
+               batchEnd[batch.id[l]] = {batch.x[l], batch.y[l], batch.z[l]};
+            }
+         }
+
+         Real maxDistance = 0;
+         for (int s=0; s<nSeeds; s++) {
+            const Real ddx = batchEnd[s][0] - scalarEnd[s][0];
+            const Real ddy = batchEnd[s][1] - scalarEnd[s][1];
+            const Real ddz = batchEnd[s][2] - scalarEnd[s][2];
+            const Real distance = sqrt(ddx*ddx + ddy*ddy + ddz*ddz);
+            if (!(distance <= tolerance)) {
+               cerr << "fsgrid " << methodNames[m] << ": seed " << s << " ends " << distance << " m apart (tolerance " << tolerance << " m)" << endl;
+               success = false;
+            }
+            maxDistance = max(maxDistance, distance);
+         }
+         cout << "fsgrid " << methodNames[m] << (useCache ? " (cached)" : "") << ": " << nSeeds << " seeds, " << nSteps
+              << " steps, max endpoint distance " << maxDistance << " m" << endl;
+      }
+      cout << "fsgrid" << (useCache ? " (cached)" : "") << ": max field direction difference " << maxDifference << endl;
+   }
+   return success;
+}
+
+int main(int argc, char** argv) {
+   MPI_Init(&argc,&argv);
+   const int masterProcessID = 0;
+   logFile.open(MPI_COMM_WORLD, masterProcessID, "logfile.txt");
+
+   int nSeeds = 2*FieldTracing::TRACING_BATCH_SIZE + 5;
+   int nSteps = 100;
+   if (argc > 1) {
+      nSeeds = atoi(argv[1]);
+   }
+   if (argc > 2) {
+      nSteps = atoi(argv[2]);
+   }
+
+   FieldTracing::fieldTracingParameters.max_allowed_error = 1000;
+   FieldTracing::fieldTracingParameters.max_field_tracer_attempts = 100;
+   const Real minStepSize = FieldTracing::fieldTracingParameters.min_tracer_dx_ionospere_coupling;
+   const Real maxStepSize = FieldTracing::fieldTracingParameters.max_tracer_dx_ionospere_coupling;
+   const Real tolerance = FieldTracing::fieldTracingParameters.max_allowed_error;
+
+   // Seeds at 4-8 Earth radii, spread in latitude and local time. With at most nSteps*maxStepSize
+   // traced, about 1.6 Earth radii by default, the lines stay well away from the dipole singularity.
+   std::vector<std::array<Real,3>> seeds(nSeeds);
+   std::vector<bool> alongB(nSeeds);
+   for (int s=0; s<nSeeds; s++) {
+      const Real radius = (4 + 4*(Real)s/nSeeds) * physicalconstants::R_E;
+      const Real latitude = -1.2 + 2.4*(Real)((7*s) % nSeeds)/nSeeds;
+      const Real longitude = 2*M_PI*(Real)s/nSeeds;
+      seeds[s] = {radius*cos(latitude)*cos(longitude), radius*cos(latitude)*sin(longitude), radius*sin(latitude)};
+      alongB[s] = (s % 2 == 0);
+   }
+
+   FieldTracing::TracingFieldFunction<Real> scalarFunction = dipoleDirection;
+   FieldTracing::TracingBatchFieldFunction<Real> batchFunction = [](
+      const FieldTracing::BatchArray<Real>& x,
+      const FieldTracing::BatchArray<Real>& y,
+      const FieldTracing::BatchArray<Real>& z,
+      const FieldTracing::BatchArray<uint8_t>& alongB,
+      const FieldTracing::BatchArray<uint8_t>& mask,
+      FieldTracing::BatchArray<Real>& bx,
+      FieldTracing::BatchArray<Real>& by,
+      FieldTracing::BatchArray<Real>& bz,
+      FieldTracing::BatchArray<uint8_t>& ok
+   ) {
+      for (int l=0; l<FieldTracing::TRACING_BATCH_SIZE; l++) {
+         ok[l] = mask[l];
+         if (!mask[l]) {
+            continue;
+         }
+         std::array<Real,3> r = {x[l], y[l], z[l]};
+         std::array<Real,3> b = {bx[l], by[l], bz[l]};
+         ok[l] = dipoleDirection(r, alongB[l], b);
+         bx[l] = b[0];
+         by[l] = b[1];
+         bz[l] = b[2];
+      }
+   };
+
+   const FieldTracing::TracingMethod methods[4] = {FieldTracing::Euler, FieldTracing::ADPT_Euler, FieldTracing::BS, FieldTracing::DPrince};
+   const char* methodNames[4] = {"Euler", "ADPT_Euler", "BS", "DPrince"};
+   bool success = true;
+   for (int m=0; m<4; m++) {
+      // Scalar reference
+      std::vector<std::array<Real,3>> scalarEnd(seeds);
+      for (int s=0; s<nSeeds; s++) {
+         std::array<Real,3> b = {0, 0, 0};
+         Real stepSize = maxStepSize;
+         for (int n=0; n<nSteps; n++) {
+            FieldTracing::stepFieldLine(scalarEnd[s], b, stepSize, minStepSize, maxStepSize, methods[m], scalarFunction, alongB[s]);
+         }
+      }
+
+      // Batched
+      std::vector<std::array<Real,3>> batchEnd(seeds);
+      for (int first=0; first<nSeeds; first+=FieldTracing::TRACING_BATCH_SIZE) {
+         FieldTracing::TracingBatch<Real> batch;
+         batch.clear();
+         for (int s=first; s<min(first + FieldTracing::TRACING_BATCH_SIZE, nSeeds); s++) {
+            batch.push(s, seeds[s], maxStepSize, alongB[s]);
+         }
+         for (int n=0; n<nSteps; n++) {
+            FieldTracing::stepFieldLinesBatch(batch, minStepSize, maxStepSize, methods[m], batchFunction);
+         }
+         for (int l=0; l<batch.size; l++) {
+            batchEnd[batch.id[l]] = {batch.x[l], batch.y[l], batch.z[l]};
+         }
+      }
+
+      Real maxDistance = 0;
+      for (int s=0; s<nSeeds; s++) {
+         const Real dx = batchEnd[s][0] - scalarEnd[s][0];
+         const Real dy = batchEnd[s][1] - scalarEnd[s][1];
+         const Real dz = batchEnd[s][2] - scalarEnd[s][2];
+         const Real distance = sqrt(dx*dx + dy*dy + dz*dz);
+         // NaN endpoints compare false and are caught as well
+         if (!(distance <= tolerance)) {
+            cerr << methodNames[m] << ": seed " << s << " ends " << distance << " m apart (tolerance " << tolerance << " m)" << endl;
+            success = false;
+         }
+         maxDistance = max(maxDistance, distance);
+      }
+      cout << methodNames[m] << ": " << nSeeds << " seeds, " << nSteps << " steps, max endpoint distance " << maxDistance << " m" << endl;
+   }
+
+   success = testFsGridField(nSeeds) && success;
+
+   cout << (success ? "PASSED" : "FAILED") << endl;
+   MPI_Finalize();
+   return success ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Benchmark of the velocity moment kernels in vlasovsolver/arch_moments.h on a
+ * single large velocity distribution: the two-sweep version (first moments, then
+ * second moments around the bulk velocity) against the single-sweep version
+ * (all moments relative to a reference velocity, shifted afterwards).
+ *
+ * Usage: moments_test [blocks per dimension] [repetitions] [reference velocity offset in thermal speeds]
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <omp.h>
+
+typedef double Real;
+typedef float Realf;
+
+#define WID 4
+#define WID3 (WID*WID*WID)
+
+struct Block {
+   Real vCrd[3];
+   Real dv[3];
+};
+
+static void firstMoments(const std::vector<Block>& blocks, const std::vector<Realf>& data, Real (&array)[4]) {
+   Real s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+   #pragma omp parallel for reduction(+:s0,s1,s2,s3)
+   for (size_t b = 0; b < blocks.size(); b++) {
+      const Block& p = blocks[b];
+      const Real DV3 = p.dv[0]*p.dv[1]*p.dv[2];
+      for (int k = 0; k < WID; k++) for (int j = 0; j < WID; j++) for (int i = 0; i < WID; i++) {
+         const Real VX = p.vCrd[0] + (i+0.5)*p.dv[0];
+         const Real VY = p.vCrd[1] + (j+0.5)*p.dv[1];
+         const Real VZ = p.vCrd[2] + (k+0.5)*p.dv[2];
+         const Real f = data[b*WID3 + k*WID*WID + j*WID + i];
+         s0 += f * DV3;
+         s1 += f*VX * DV3;
+         s2 += f*VY * DV3;
+         s3 += f*VZ * DV3;
+      }
+   }
+   array[0] = s0; array[1] = s1; array[2] = s2; array[3] = s3;
+}
+
+static void secondMoments(const std::vector<Block>& blocks, const std::vector<Realf>& data, const Real (&V0)[3], Real (&array)[6]) {
+   Real s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0;
+   #pragma omp parallel for reduction(+:s0,s1,s2,s3,s4,s5)
+   for (size_t b = 0; b < blocks.size(); b++) {
+      const Block& p = blocks[b];
+      const Real DV3 = p.dv[0]*p.dv[1]*p.dv[2];
+      for (int k = 0; k < WID; k++) for (int j = 0; j < WID; j++) for (int i = 0; i < WID; i++) {
+         const Real VX = p.vCrd[0] + (i+0.5)*p.dv[0] - V0[0];
+         const Real VY = p.vCrd[1] + (j+0.5)*p.dv[1] - V0[1];
+         const Real VZ = p.vCrd[2] + (k+0.5)*p.dv[2] - V0[2];
+         const Real f = data[b*WID3 + k*WID*WID + j*WID + i];
+         s0 += f * VX * VX * DV3;
+         s1 += f * VY * VY * DV3;
+         s2 += f * VZ * VZ * DV3;
+         s3 += f * VY * VZ * DV3;
+         s4 += f * VX * VZ * DV3;
+         s5 += f * VX * VY * DV3;
+      }
+   }
+   array[0] = s0; array[1] = s1; array[2] = s2; array[3] = s3; array[4] = s4; array[5] = s5;
+}
+
+static void allMoments(const std::vector<Block>& blocks, const std::vector<Realf>& data, const Real (&ref)[3], Real (&array)[10]) {
+   Real s[10] = {0};
+   #pragma omp parallel for reduction(+:s[:10])
+   for (size_t b = 0; b < blocks.size(); b++) {
+      const Block& p = blocks[b];
+      const Real DV3 = p.dv[0]*p.dv[1]*p.dv[2];
+      for (int k = 0; k < WID; k++) for (int j = 0; j < WID; j++) for (int i = 0; i < WID; i++) {
+         const Real VX = p.vCrd[0] + (i+0.5)*p.dv[0];
+         const Real VY = p.vCrd[1] + (j+0.5)*p.dv[1];
+         const Real VZ = p.vCrd[2] + (k+0.5)*p.dv[2];
+         const Real f = data[b*WID3 + k*WID*WID + j*WID + i];
+         s[0] += f * DV3;
+         s[1] += f*VX * DV3;
+         s[2] += f*VY * DV3;
+         s[3] += f*VZ * DV3;
+         const Real fDV3 = f * DV3;
+         const Real dVX = VX - ref[0];
+         const Real dVY = VY - ref[1];
+         const Real dVZ = VZ - ref[2];
+         s[4] += fDV3 * dVX * dVX;
+         s[5] += fDV3 * dVY * dVY;
+         s[6] += fDV3 * dVZ * dVZ;
+         s[7] += fDV3 * dVY * dVZ;
+         s[8] += fDV3 * dVX * dVZ;
+         s[9] += fDV3 * dVX * dVY;
+      }
+   }
+   for (int i = 0; i < 10; i++) {
+      array[i] = s[i];
+   }
+}
+
+// Same as centralSecondMoments() in arch_moments.h
+static void centralSecondMoments(const Real (&array)[10], const Real (&ref)[3], const Real (&V0)[3], Real (&central)[6]) {
+   const Real n = array[0];
+   const Real m[3] = {array[1] - n*ref[0], array[2] - n*ref[1], array[3] - n*ref[2]};
+   const Real d[3] = {V0[0] - ref[0], V0[1] - ref[1], V0[2] - ref[2]};
+   central[0] = array[4] - 2*d[0]*m[0] + n*d[0]*d[0];
+   central[1] = array[5] - 2*d[1]*m[1] + n*d[1]*d[1];
+   central[2] = array[6] - 2*d[2]*m[2] + n*d[2]*d[2];
+   central[3] = array[7] - d[1]*m[2] - m[1]*d[2] + n*d[1]*d[2];
+   central[4] = array[8] - d[0]*m[2] - m[0]*d[2] + n*d[0]*d[2];
+   central[5] = array[9] - d[0]*m[1] - m[0]*d[1] + n*d[0]*d[1];
+}
+
+int main(int argc, char* argv[]) {
+   const int blocksPerDim = argc > 1 ? atoi(argv[1]) : 50;
+   const int repetitions = argc > 2 ? atoi(argv[2]) : 20;
+   const Real referenceOffset = argc > 3 ? atof(argv[3]) : 0.1;
+
+   // Drifting, anisotropic Maxwellian filling the whole velocity mesh
+   const Real vMax = 4.0e6;
+   const Real dv = 2.0*vMax / (blocksPerDim*WID);
+   const Real bulkV[3] = {6.0e5, -2.0e5, 1.0e5};
+   const Real vth[3] = {5.0e5, 4.0e5, 4.0e5};
+   const size_t nBlocks = (size_t)blocksPerDim*blocksPerDim*blocksPerDim;
+   std::vector<Block> blocks(nBlocks);
+   std::vector<Realf> data(nBlocks*WID3);
+   #pragma omp parallel for
+   for (size_t b = 0; b < nBlocks; b++) {
+      const size_t bi = b % blocksPerDim, bj = (b / blocksPerDim) % blocksPerDim, bk = b / blocksPerDim / blocksPerDim;
+      Block& p = blocks[b];
+      p.vCrd[0] = -vMax + bi*WID*dv;
+      p.vCrd[1] = -vMax + bj*WID*dv;
+      p.vCrd[2] = -vMax + bk*WID*dv;
+      p.dv[0] = p.dv[1] = p.dv[2] = dv;
+      for (int k = 0; k < WID; k++) for (int j = 0; j < WID; j++) for (int i = 0; i < WID; i++) {
+         const Real u = (p.vCrd[0] + (i+0.5)*dv - bulkV[0]) / vth[0];
+         const Real v = (p.vCrd[1] + (j+0.5)*dv - bulkV[1]) / vth[1];
+         const Real w = (p.vCrd[2] + (k+0.5)*dv - bulkV[2]) / vth[2];
+         data[b*WID3 + k*WID*WID + j*WID + i] = 1.0e-12 * exp(-0.5*(u*u + v*v + w*w + 0.6*u*v));
+      }
+   }
+   printf("%zu blocks (%.1f MB of distribution), %d threads\n", nBlocks, data.size()*sizeof(Realf)/1.0e6, omp_get_max_threads());
+
+   // Two sweeps
+   Real first[4] = {0}, second[6] = {0}, V0[3] = {0};
+   double t0 = omp_get_wtime();
+   for (int r = 0; r < repetitions; r++) {
+      firstMoments(blocks, data, first);
+      for (int i = 0; i < 3; i++) {
+         V0[i] = first[i+1] / first[0];
+      }
+      secondMoments(blocks, data, V0, second);
+   }
+   const double twoSweeps = (omp_get_wtime() - t0) / repetitions;
+
+   // Single sweep, reference velocity slightly off the bulk velocity as when taken from the previous step
+   Real all[10] = {0}, central[6] = {0};
+   const Real ref[3] = {bulkV[0] + referenceOffset*vth[0], bulkV[1] - referenceOffset*vth[1], bulkV[2]};
+   t0 = omp_get_wtime();
+   for (int r = 0; r < repetitions; r++) {
+      allMoments(blocks, data, ref, all);
+      Real V1[3];
+      for (int i = 0; i < 3; i++) {
+         V1[i] = all[i+1] / all[0];
+      }
+      centralSecondMoments(all, ref, V1, central);
+   }
+   const double singleSweep = (omp_get_wtime() - t0) / repetitions;
+
+   Real maxDiff = 0;
+   for (int i = 0; i < 4; i++) {
+      maxDiff = std::max(maxDiff, std::fabs(all[i] - first[i]) / std::fabs(first[i]));
+   }
+   const Real pScale = std::fabs(second[0]) + std::fabs(second[1]) + std::fabs(second[2]);
+   for (int i = 0; i < 6; i++) {
+      maxDiff = std::max(maxDiff, std::fabs(central[i] - second[i]) / pScale);
+   }
+   printf("two sweeps   %10.3f ms\n", 1.0e3*twoSweeps);
+   printf("single sweep %10.3f ms (speedup %.2f)\n", 1.0e3*singleSweep, twoSweeps/singleSweep);
+   printf("max relative difference %g\n", maxDiff);
+   return maxDiff < 1.0e-10 ? 0 : 1;
+}
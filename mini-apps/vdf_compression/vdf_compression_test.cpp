@@ -0,0 +1,226 @@
+/*
+ * Round-trip test of the velocity distribution codec in vdf_compression.h.
+ *
+ * Encodes synthetic distributions and checks that
+ *  - each value of a kept block is reconstructed within tolerance times the block maximum,
+ *    and only blocks below the sparsity threshold are dropped,
+ *  - density, bulk flux and the trace of the second moment match within the tolerance,
+ *  - tolerance 0, and distributions that fail the moment check, are stored raw and
+ *    decoded bit-exactly,
+ *  - truncated and corrupt streams are rejected without reading out of bounds.
+ *
+ * Usage: vdf_compression_test
+ * Returns a non-zero exit code if any check fails.
+ */
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../../vdf_compression.h"
+
+#define WID 4
+#define WID3 (WID*WID*WID)
+
+static int failures = 0;
+
+static void check(const bool condition, const char* what) {
+   if (condition == false) {
+      printf("FAIL: %s\n", what);
+      ++failures;
+   }
+}
+
+/** Drifting Maxwellian on a cube of blocks, with values spanning many decades.*/
+static void makeMaxwellian(const vdfcompression::MeshGeometry& mesh, std::vector<uint64_t>& blockGIDs, std::vector<float>& data) {
+   const double V0[3] = {2.0e5, -1.0e5, 0.5e5};
+   const double vth = 3.0e5;
+   blockGIDs.clear();
+   data.clear();
+   for (uint64_t bz=0; bz<mesh.gridLength[2]; ++bz) for (uint64_t by=0; by<mesh.gridLength[1]; ++by) for (uint64_t bx=0; bx<mesh.gridLength[0]; ++bx) {
+      blockGIDs.push_back(bx + by*mesh.gridLength[0] + bz*mesh.gridLength[0]*mesh.gridLength[1]);
+      for (int k=0; k<WID; ++k) for (int j=0; j<WID; ++j) for (int i=0; i<WID; ++i) {
+         const double v[3] = {mesh.meshMinLimits[0] + (bx*WID + i + 0.5)*mesh.cellSize[0],
+                              mesh.meshMinLimits[1] + (by*WID + j + 0.5)*mesh.cellSize[1],
+                              mesh.meshMinLimits[2] + (bz*WID + k + 0.5)*mesh.cellSize[2]};
+         double r2 = 0;
+         for (int c=0; c<3; ++c) r2 += (v[c]-V0[c])*(v[c]-V0[c]);
+         data.push_back(1.0e-12 * std::exp(-r2/(vth*vth)));
+      }
+   }
+}
+
+static void moments(const float* data, const std::vector<uint64_t>& blockGIDs, const vdfcompression::MeshGeometry& mesh,
+                    double (&values)[5], double (&scales)[5]) {
+   for (int m=0; m<5; ++m) values[m] = scales[m] = 0;
+   for (size_t b=0; b<blockGIDs.size(); ++b) {
+      vdfcompression::accumulateMoments(data + b*WID3, blockGIDs[b], mesh, values, scales);
+   }
+}
+
+static void testRoundTrip(const vdfcompression::MeshGeometry& mesh, const double tolerance, const double sparsityThreshold) {
+   std::vector<uint64_t> blockGIDs;
+   std::vector<float> data;
+   makeMaxwellian(mesh, blockGIDs, data);
+   const uint64_t nBlocks = blockGIDs.size();
+
+   std::vector<unsigned char> stream;
+   std::vector<bool> keep;
+   const vdfcompression::Mode mode = vdfcompression::encodeCell(data.data(), blockGIDs.data(), nBlocks, mesh, tolerance,
+                                                               sparsityThreshold, stream, keep);
+   check(mode == vdfcompression::MODE_QUANTIZED, "smooth distribution is quantized");
+
+   uint64_t nKept = 0;
+   for (uint64_t b=0; b<nBlocks; ++b) if (keep[b] == true) ++nKept;
+   std::vector<float> decoded;
+   check(vdfcompression::decodeCell(stream.data(), stream.size(), nKept, WID3, decoded) == true, "round trip decodes");
+
+   // Scatter the kept blocks back, dropped blocks are zero
+   std::vector<float> full(nBlocks*WID3, 0);
+   double maxError = 0;
+   bool valuesOk = true, droppedOk = true;
+   for (uint64_t b=0, kept=0; b<nBlocks; ++b) {
+      float blockMax = 0;
+      for (int i=0; i<WID3; ++i) blockMax = std::max(blockMax, data[b*WID3 + i]);
+      if (keep[b] == false) {
+         if (!(blockMax < sparsityThreshold)) droppedOk = false;
+         continue;
+      }
+      for (int i=0; i<WID3; ++i) {
+         const float value = decoded[kept*WID3 + i];
+         full[b*WID3 + i] = value;
+         const double error = std::fabs((double)value - data[b*WID3 + i]);
+         // The step and the reconstruction are single precision, allow for their rounding
+         if (error > tolerance*blockMax*(1 + 1e-6) + 2*FLT_EPSILON*blockMax) valuesOk = false;
+         if (blockMax > 0) maxError = std::max(maxError, error/blockMax);
+      }
+      ++kept;
+   }
+   check(valuesOk, "value error is at most tolerance times the block maximum");
+   check(droppedOk, "only blocks below the sparsity threshold are dropped");
+
+   double original[5], decodedMoments[5], scales[5], dummy[5];
+   moments(data.data(), blockGIDs, mesh, original, scales);
+   moments(full.data(), blockGIDs, mesh, decodedMoments, dummy);
+   bool momentsOk = true;
+   for (int m=0; m<5; ++m) {
+      if (!(std::fabs(decodedMoments[m] - original[m]) <= tolerance*scales[m])) momentsOk = false;
+   }
+   check(momentsOk, "moments match within the tolerance");
+
+   printf("tolerance %.0e: %lu of %lu blocks kept, %lu bytes (%.2f bits/value), max error %.3e of block maximum\n",
+          tolerance, (unsigned long)nKept, (unsigned long)nBlocks, (unsigned long)stream.size(),
+          8.0*stream.size()/(nBlocks*WID3), maxError);
+}
+
+static void testRaw(const vdfcompression::MeshGeometry& mesh) {
+   std::vector<unsigned char> stream;
+   std::vector<bool> keep;
+   std::vector<float> decoded;
+
+   // Tolerance 0 stores the data raw
+   std::vector<uint64_t> blockGIDs;
+   std::vector<float> data;
+   makeMaxwellian(mesh, blockGIDs, data);
+   vdfcompression::Mode mode = vdfcompression::encodeCell(data.data(), blockGIDs.data(), blockGIDs.size(), mesh, 0.0, 0.0, stream, keep);
+   check(mode == vdfcompression::MODE_RAW, "tolerance 0 is stored raw");
+   check(vdfcompression::decodeCell(stream.data(), stream.size(), blockGIDs.size(), WID3, decoded) == true
+         && std::memcmp(decoded.data(), data.data(), data.size()*sizeof(float)) == 0, "raw data decodes bit-exactly");
+
+   // One large value and values just below half of the finest quantization step: every
+   // attempt rounds the small values to zero and misses the density, so the encoder falls back to raw.
+   const double tolerance = 1e-2;
+   std::vector<float> spike(WID3, 0.49 * 2*(tolerance/16));
+   spike[0] = 1;
+   const uint64_t gid = 0;
+   stream.clear();
+   mode = vdfcompression::encodeCell(spike.data(), &gid, 1, mesh, tolerance, 0.0, stream, keep);
+   check(mode == vdfcompression::MODE_RAW, "failed moment check falls back to raw");
+   check(keep[0] == true, "raw fallback keeps all blocks");
+   check(vdfcompression::decodeCell(stream.data(), stream.size(), 1, WID3, decoded) == true
+         && std::memcmp(decoded.data(), spike.data(), WID3*sizeof(float)) == 0, "raw fallback decodes bit-exactly");
+
+   for (size_t size=0; size<stream.size(); ++size) {
+      if (vdfcompression::decodeCell(stream.data(), size, 1, WID3, decoded) == true) {
+         check(false, "truncated raw stream is rejected");
+         break;
+      }
+   }
+}
+
+static void testCorrupt(const vdfcompression::MeshGeometry& mesh) {
+   std::vector<uint64_t> blockGIDs;
+   std::vector<float> data;
+   makeMaxwellian(mesh, blockGIDs, data);
+   std::vector<unsigned char> stream;
+   std::vector<bool> keep;
+   vdfcompression::encodeCell(data.data(), blockGIDs.data(), blockGIDs.size(), mesh, 1e-3, 0.0, stream, keep);
+   const uint64_t nBlocks = blockGIDs.size();
+   std::vector<float> decoded;
+
+   bool truncatedOk = true;
+   for (size_t size=0; size<stream.size(); ++size) {
+      // Copy, so that reading past the end is caught by address sanitizers
+      std::vector<unsigned char> truncated(stream.begin(), stream.begin() + size);
+      if (vdfcompression::decodeCell(truncated.data(), truncated.size(), nBlocks, WID3, decoded) == true) truncatedOk = false;
+   }
+   check(truncatedOk, "truncated quantized streams are rejected");
+   check(vdfcompression::decodeCell(stream.data(), stream.size(), nBlocks + 1, WID3, decoded) == false, "missing blocks are rejected");
+
+   std::vector<unsigned char> corrupt(stream);
+   corrupt[0] = 7;
+   check(vdfcompression::decodeCell(corrupt.data(), corrupt.size(), nBlocks, WID3, decoded) == false, "unknown mode is rejected");
+
+   // The step of the first block follows the mode byte
+   const float badSteps[3] = {-1.0f, INFINITY, NAN};
+   for (int s=0; s<3; ++s) {
+      corrupt = stream;
+      const uint32_t bits = vdfcompression::floatBits(badSteps[s]);
+      for (int i=0; i<4; ++i) corrupt[1+i] = (bits >> (24 - 8*i)) & 0xff;
+      check(vdfcompression::decodeCell(corrupt.data(), corrupt.size(), nBlocks, WID3, decoded) == false, "invalid quantization step is rejected");
+   }
+
+   // Random bit flips may or may not decode, but must not crash or change the output size
+   std::mt19937 rng(12345);
+   bool sizeOk = true;
+   for (int trial=0; trial<1000; ++trial) {
+      corrupt = stream;
+      const size_t position = rng() % (8*corrupt.size());
+      corrupt[position/8] ^= 1u << (position%8);
+      vdfcompression::decodeCell(corrupt.data(), corrupt.size(), nBlocks, WID3, decoded);
+      if (decoded.size() != nBlocks*WID3) sizeOk = false;
+   }
+   check(sizeOk, "corrupt streams decode to the requested size");
+}
+
+int main() {
+   vdfcompression::MeshGeometry mesh;
+   for (int c=0; c<3; ++c) {
+      mesh.gridLength[c] = 10;
+      mesh.meshMinLimits[c] = -2.0e6;
+      mesh.cellSize[c] = 4.0e6 / (mesh.gridLength[c]*WID);
+   }
+   mesh.blockLength = WID;
+
+   const double tolerances[3] = {1e-2, 1e-3, 1e-4};
+   for (int t=0; t<3; ++t) {
+      testRoundTrip(mesh, tolerances[t], 1e-15);
+   }
+   testRaw(mesh);
+
+   // Every prefix of the stream is decoded, keep it short
+   for (int c=0; c<3; ++c) {
+      mesh.gridLength[c] = 3;
+      mesh.cellSize[c] = 4.0e6 / (mesh.gridLength[c]*WID);
+   }
+   testCorrupt(mesh);
+
+   if (failures > 0) {
+      printf("%d checks FAILED\n", failures);
+      return 1;
+   }
+   printf("All checks passed\n");
+   return 0;
+}
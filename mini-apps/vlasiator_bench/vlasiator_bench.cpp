@@ -0,0 +1,779 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*! \file vlasiator_bench.cpp
+ * Single-node benchmark driver for the production solver kernels.
+ *
+ * Built with "make vlasiator_bench", linking the same objects as vlasiator itself (minus
+ * vlasiator.o), so measured changes are changes to the real kernels. Synthetic drifting
+ * Maxwellian VDFs of configurable size and sparsity are generated in standalone spatial cells
+ * and each kernel is run a number of times, restoring its input between repetitions outside
+ * of the timed region. For every kernel the mean, standard deviation and minimum wall time
+ * are reported, together with the throughput in cells/s, blocks/s and an estimate of the
+ * memory traffic in GB/s.
+ *
+ * Kernels:
+ *  acceleration  compute_cell_intersections + cpu_accelerate_cell (three map_1d sweeps)
+ *  translation   copy_trans_block_data_amr + propagatePencil on synthetic pencils
+ *  moments       calculateCellMoments
+ *  adjust        update_velocity_block_content_lists + adjust_velocity_blocks
+ *  fieldsolver   propagateFields on a periodic fsgrid cube
+ *  hashtable     OpenBucketHashtable insert, hit and miss lookups of the block GIDs
+ *  lookup        VelocityMesh::getLocalID one at a time vs. batched getLocalIDs, on the meshes of the
+ *                cells in a shuffled order with 25% misses, touching the data of each found block
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#ifdef _OPENMP
+   #include <omp.h>
+#endif
+
+#include "../../common.h"
+#include "../../definitions.h"
+#include "../../logger.h"
+#include "../../object_wrapper.h"
+#include "../../open_bucket_hashtable.h"
+#include "../../parameters.h"
+#include "../../velocity_mesh_parameters.h"
+#include "../../spatial_cells/spatial_cell_wrapper.hpp"
+#include "../../projects/project.h"
+#include "../../vlasovsolver/vlasovmover.h"
+#include "../../vlasovsolver/cpu_acc_intersections.hpp"
+#include "../../vlasovsolver/cpu_acc_semilag.hpp"
+#include "../../vlasovsolver/cpu_trans_map_amr.hpp"
+#include "../../fieldsolver/fs_common.h"
+#include "phiprof.hpp"
+
+#ifdef USE_GPU
+   #error "vlasiator_bench drives the CPU solver kernels, build it without USE_GPU."
+#endif
+
+using namespace std;
+using namespace spatial_cell;
+
+// Definitions normally provided by vlasiator.cpp
+Logger logFile, diagnostic;
+int globalflags::bailingOut = 0;
+bool globalflags::writeRestart = false;
+bool globalflags::writeRecover = false;
+bool globalflags::balanceLoad = false;
+bool globalflags::doRefine = false;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+const std::vector<CellID>& getLocalCells() {
+   return Parameters::localCells;
+}
+
+static const uint popID = 0;
+
+struct BenchSettings {
+   uint nCells {64};          /*!< Number of synthetic spatial cells.*/
+   uint vBlocks {40};         /*!< Velocity blocks per dimension.*/
+   Real vMax {4.0e6};         /*!< Velocity mesh extends from -vMax to vMax in each dimension.*/
+   Real rho {1.0e6};          /*!< Mean number density of the VDFs.*/
+   Real T {1.0e6};            /*!< Temperature of the VDFs.*/
+   Real drift {5.0e5};        /*!< Bulk speed of the VDFs, the direction varies from cell to cell.*/
+   Real minValue {1.0e-15};   /*!< Sparsity threshold, blocks below it are not generated.*/
+   Real B {1.0e-8};           /*!< Magnetic field magnitude.*/
+   Real rotation {10.0};      /*!< Gyration angle per acceleration step in degrees.*/
+   uint pencilLength {16};    /*!< Cells per translation pencil, without the stencil padding.*/
+   uint fsCells {32};         /*!< Edge length of the field solver cube.*/
+   uint reps {10};            /*!< Timed repetitions per kernel.*/
+   uint warmup {1};           /*!< Untimed repetitions per kernel.*/
+   std::set<std::string> kernels {"acceleration", "translation", "moments", "adjust", "fieldsolver", "hashtable", "lookup"};
+};
+
+/*! Run prepare(rep) untimed and kernel(rep) timed, warmup + reps times.
+ * @return Wall times of the timed repetitions.*/
+template<typename Prepare, typename Kernel>
+static std::vector<double> measure(const BenchSettings& s, Prepare prepare, Kernel kernel) {
+   std::vector<double> times;
+   for (uint rep=0; rep<s.warmup + s.reps; ++rep) {
+      prepare(rep);
+      const double t0 = MPI_Wtime();
+      kernel(rep);
+      const double t1 = MPI_Wtime();
+      if (rep >= s.warmup) {
+         times.push_back(t1 - t0);
+      }
+   }
+   return times;
+}
+
+/*! Print one result line. Throughputs are per mean repetition time, zero counts are printed as "-".*/
+static void report(const std::string& name, const std::vector<double>& times, const double cells, const double blocks, const double bytes) {
+   double mean = 0, var = 0, tmin = times.empty() ? 0 : times[0];
+   for (const double t : times) {
+      mean += t;
+      tmin = std::min(tmin, t);
+   }
+   mean /= std::max<size_t>(times.size(), 1);
+   for (const double t : times) {
+      var += (t - mean) * (t - mean);
+   }
+   const double stddev = times.size() > 1 ? sqrt(var / (times.size() - 1)) : 0.0;
+
+   auto rate = [&](const double count, const double scale) {
+      std::ostringstream os;
+      if (count > 0 && mean > 0) {
+         os << std::scientific << std::setprecision(3) << count / mean / scale;
+      } else {
+         os << "-";
+      }
+      return os.str();
+   };
+   cout << std::left << std::setw(14) << name << std::right
+        << std::setw(6) << times.size()
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << 1e3 * mean
+        << std::setw(12) << 1e3 * stddev
+        << std::setw(8) << (mean > 0 ? 100.0 * stddev / mean : 0.0)
+        << std::setw(12) << 1e3 * tmin
+        << std::setw(12) << rate(cells, 1.0)
+        << std::setw(12) << rate(blocks, 1.0)
+        << std::setw(12) << rate(bytes, 1e9)
+        << std::defaultfloat << endl;
+}
+
+/*! Set up one proton population with a uniform velocity mesh, as ObjectWrapper would from the config file.*/
+static void initializePopulation(const BenchSettings& s) {
+   vmesh::allocateMeshWrapper();
+
+   // The Species copy constructor only copies a subset of the members, so fill in the stored element
+   getObjectWrapper().particleSpecies.push_back(species::Species());
+   species::Species& proton = getObjectWrapper().particleSpecies.back();
+   proton.name = "proton";
+   proton.charge = physicalconstants::CHARGE;
+   proton.mass = physicalconstants::MASS_PROTON;
+   proton.sparseMinValue = s.minValue;
+   proton.velocityMesh = 0;
+   proton.sparseBlockAddWidthV = 1;
+   proton.sparse_conserve_mass = false;
+   proton.sparseDynamicAlgorithm = 0;
+   proton.thermalRadius = 0;
+
+   vmesh::MeshParameters mesh;
+   mesh.name = proton.name;
+   for (uint d=0; d<3; ++d) {
+      mesh.meshLimits[2*d] = -s.vMax;
+      mesh.meshLimits[2*d+1] = s.vMax;
+      mesh.gridLength[d] = s.vBlocks;
+      mesh.blockLength[d] = WID;
+   }
+   vmesh::getMeshWrapper()->velocityMeshesCreation->push_back(mesh);
+   vmesh::getMeshWrapper()->initVelocityMeshes(1);
+}
+
+/*! Fill a cell with a drifting Maxwellian. Blocks whose maximum value is below the sparsity
+ * threshold are not created. Density and drift direction vary with the cell index so that
+ * the cells have different block counts and sparse structure.*/
+static void initializeCell(SpatialCell& cell, const BenchSettings& s, const uint c) {
+   const Real mass = getObjectWrapper().particleSpecies[popID].mass;
+   const Real phase = 2.0 * M_PI * c / s.nCells;
+   const Real V0[3] = {s.drift * cos(phase), s.drift * sin(phase), 0.1 * s.drift};
+   const Real rho = s.rho * (1.0 + 0.5 * sin(3.0 * phase));
+
+   cell.parameters[CellParams::CELLID] = c + 1;
+   cell.sysBoundaryFlag = sysboundarytype::NOT_SYSBOUNDARY;
+
+   vmesh::VelocityMesh* vmesh = cell.get_velocity_mesh(popID);
+   const vmesh::LocalID* gridLength = vmesh->getGridLength();
+   const Real* blockSize = vmesh->getBlockSize();
+   const Real* meshMin = vmesh->getMeshMinLimits();
+   vmesh::LocalID indices[3];
+   for (indices[2]=0; indices[2]<gridLength[2]; ++indices[2]) {
+      for (indices[1]=0; indices[1]<gridLength[1]; ++indices[1]) {
+         for (indices[0]=0; indices[0]<gridLength[0]; ++indices[0]) {
+            // Closest point of the block to the drift velocity
+            Real dv[3];
+            for (uint d=0; d<3; ++d) {
+               const Real lower = meshMin[d] + indices[d] * blockSize[d];
+               dv[d] = std::clamp(V0[d], lower, lower + blockSize[d]) - V0[d];
+            }
+            if (projects::MaxwellianPhaseSpaceDensity(dv[0], dv[1], dv[2], s.T, rho, mass) < s.minValue) {
+               continue;
+            }
+            const vmesh::GlobalID blockGID = vmesh->getGlobalID(indices);
+            cell.add_velocity_block(blockGID, popID);
+            const vmesh::LocalID blockLID = cell.get_velocity_block_local_id(blockGID, popID);
+            Realf* data = cell.get_data(blockLID, popID);
+            const Real* blockParams = cell.get_block_parameters(blockLID, popID);
+            for (uint k=0; k<WID; ++k) {
+               for (uint j=0; j<WID; ++j) {
+                  for (uint i=0; i<WID; ++i) {
+                     data[k*WID2 + j*WID + i] = projects::MaxwellianPhaseSpaceDensity(
+                        blockParams[BlockParams::VXCRD] + (i+0.5)*blockParams[BlockParams::DVX] - V0[0],
+                        blockParams[BlockParams::VYCRD] + (j+0.5)*blockParams[BlockParams::DVY] - V0[1],
+                        blockParams[BlockParams::VZCRD] + (k+0.5)*blockParams[BlockParams::DVZ] - V0[2],
+                        s.T, rho, mass);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   calculateCellMoments(&cell, true, false, true);
+   cell.parameters[CellParams::RHOM_V] = cell.parameters[CellParams::RHOM];
+   cell.parameters[CellParams::VX_V] = cell.parameters[CellParams::VX];
+   cell.parameters[CellParams::VY_V] = cell.parameters[CellParams::VY];
+   cell.parameters[CellParams::VZ_V] = cell.parameters[CellParams::VZ];
+   cell.parameters[CellParams::RHOQ_V] = cell.parameters[CellParams::RHOQ];
+
+   // Field slightly tilted from z so that all three mappings shear the distribution
+   cell.parameters[CellParams::BGBXVOL] = 0.2 * s.B;
+   cell.parameters[CellParams::BGBYVOL] = 0.1 * s.B;
+   cell.parameters[CellParams::BGBZVOL] = sqrt(1.0 - 0.05) * s.B;
+}
+
+static double countBlocks(const std::vector<SpatialCell>& cells) {
+   double blocks = 0;
+   for (const SpatialCell& cell : cells) {
+      blocks += cell.get_number_of_velocity_blocks(popID);
+   }
+   return blocks;
+}
+
+static void restoreCells(std::vector<SpatialCell>& cells, const std::vector<SpatialCell>& source) {
+   #pragma omp parallel for schedule(dynamic,1)
+   for (size_t c=0; c<cells.size(); ++c) {
+      cells[c] = source[c];
+   }
+}
+
+/*! Semi-Lagrangian acceleration of all cells by one step, as cpu_accelerate_cells does.*/
+static void accelerateCells(std::vector<SpatialCell>& cells, const Real dt, const uint mapOrder, const int intersectionsTimerId) {
+   #pragma omp parallel for schedule(dynamic,1)
+   for (size_t c=0; c<cells.size(); ++c) {
+      compute_cell_intersections(&cells[c], popID, mapOrder, dt, intersectionsTimerId);
+      cpu_accelerate_cell(&cells[c], popID, mapOrder);
+   }
+}
+
+static void benchAcceleration(const BenchSettings& s, const std::vector<SpatialCell>& pristine, std::vector<SpatialCell>& cells, const Real dt) {
+   const int intersectionsTimerId {phiprof::initializeTimer("cell-compute-intersections")};
+   double blocks = 0;
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) {
+         restoreCells(cells, pristine);
+         blocks = countBlocks(cells);
+      },
+      [&](const uint rep) {
+         accelerateCells(cells, dt, rep % 3, intersectionsTimerId);
+      });
+   // Each of the three sweeps loads and stores the block data
+   report("acceleration", times, cells.size(), blocks, 3.0 * 2.0 * blocks * WID3 * sizeof(Realf));
+}
+
+static void benchMoments(const BenchSettings& s, const std::vector<SpatialCell>& pristine, std::vector<SpatialCell>& cells) {
+   restoreCells(cells, pristine);
+   const double blocks = countBlocks(cells);
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) { },
+      [&](const uint rep) {
+         #pragma omp parallel for schedule(dynamic,1)
+         for (size_t c=0; c<cells.size(); ++c) {
+            calculateCellMoments(&cells[c], true, false, true);
+         }
+      });
+   report("moments", times, cells.size(), blocks, blocks * WID3 * sizeof(Realf));
+}
+
+/*! Block adjustment after one acceleration step, with the previous and next cell as spatial neighbours.*/
+static void benchAdjust(const BenchSettings& s, const std::vector<SpatialCell>& accelerated, std::vector<SpatialCell>& cells) {
+   double blocks = 0;
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) {
+         restoreCells(cells, accelerated);
+         blocks = countBlocks(cells);
+      },
+      [&](const uint rep) {
+         const size_t n = cells.size();
+         #pragma omp parallel for schedule(dynamic,1)
+         for (size_t c=0; c<n; ++c) {
+            cells[c].update_velocity_block_content_lists(popID);
+         }
+         #pragma omp parallel for schedule(dynamic,1)
+         for (size_t c=0; c<n; ++c) {
+            const std::vector<SpatialCell*> neighbors {&cells[(c + n - 1) % n], &cells[(c + 1) % n]};
+            cells[c].adjust_velocity_blocks(neighbors, popID, true);
+         }
+      });
+   report("adjust", times, cells.size(), blocks, blocks * WID3 * sizeof(Realf));
+}
+
+/*! Translation along x through disjoint pencils of consecutive cells. The stencil padding at
+ * the pencil ends repeats the end cells with a zero target ratio, like non-local neighbours.
+ * Like trans_map_1d_amr the work is threaded over velocity blocks.*/
+static void benchTranslation(const BenchSettings& s, const std::vector<SpatialCell>& pristine, std::vector<SpatialCell>& cells) {
+   const uint dimension = 0;
+   const uint innerLength = std::min(s.pencilLength, s.nCells);
+   const uint nPencils = s.nCells / innerLength;
+   const uint L = innerLength + 2 * VLASOV_STENCIL_WIDTH;
+
+   std::vector<SpatialCell*> pencilCells(nPencils * L);
+   std::vector<Realf> dz(nPencils * L, 1.0);
+   std::vector<Realf> targetRatios(nPencils * L);
+   for (uint p=0; p<nPencils; ++p) {
+      for (uint b=0; b<L; ++b) {
+         const int inner = std::clamp<int>((int)b - VLASOV_STENCIL_WIDTH, 0, innerLength - 1);
+         pencilCells[p*L + b] = &cells[p*innerLength + inner];
+         targetRatios[p*L + b] = (b >= VLASOV_STENCIL_WIDTH && b < L - VLASOV_STENCIL_WIDTH) ? 1.0 : 0.0;
+      }
+   }
+
+   unsigned int vcell_transpose[WID3];
+   for (uint k=0; k<WID; ++k) {
+      for (uint j=0; j<WID; ++j) {
+         for (uint i=0; i<WID; ++i) {
+            vcell_transpose[i + j*WID + k*WID2] = i*WID2 + j*WID + k;
+         }
+      }
+   }
+
+   // Courant number 0.5 at the edge of the velocity mesh
+   const Realf dt = 0.5 / s.vMax;
+
+   std::vector<vmesh::GlobalID> unionOfBlocks;
+   double blocks = 0;
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) {
+         restoreCells(cells, pristine);
+         std::set<vmesh::GlobalID> unionSet;
+         blocks = 0;
+         for (uint c=0; c<nPencils*innerLength; ++c) {
+            for (vmesh::LocalID blockLID=0; blockLID<cells[c].get_number_of_velocity_blocks(popID); ++blockLID) {
+               unionSet.insert(cells[c].get_velocity_block_global_id(blockLID, popID));
+            }
+            blocks += cells[c].get_number_of_velocity_blocks(popID);
+         }
+         unionOfBlocks.assign(unionSet.begin(), unionSet.end());
+      },
+      [&](const uint rep) {
+         const vmesh::VelocityMesh* vmesh = cells[0].get_velocity_mesh(popID);
+         const Realf threshold = cells[0].getVelocityBlockMinValue(popID);
+         #pragma omp parallel
+         {
+            std::vector<Vec> values(L * WID3 / VECL);
+            std::vector<Realf*> blockData(L);
+            #pragma omp for schedule(dynamic,1)
+            for (size_t blocki=0; blocki<unionOfBlocks.size(); ++blocki) {
+               const vmesh::GlobalID blockGID = unionOfBlocks[blocki];
+               for (uint p=0; p<nPencils; ++p) {
+                  bool nonEmpty = false;
+                  for (uint b=0; b<L; ++b) {
+                     SpatialCell* cell = pencilCells[p*L + b];
+                     const vmesh::LocalID blockLID = cell->get_velocity_block_local_id(blockGID, popID);
+                     blockData[b] = (blockLID != SpatialCell::invalid_local_id()) ? cell->get_data(blockLID, popID) : nullptr;
+                     nonEmpty = nonEmpty || blockData[b] != nullptr;
+                  }
+                  if (!nonEmpty) {
+                     continue;
+                  }
+                  copy_trans_block_data_amr(blockData.data(), L, values.data(), vcell_transpose, popID);
+                  for (uint b=VLASOV_STENCIL_WIDTH; b<L-VLASOV_STENCIL_WIDTH; ++b) {
+                     if (blockData[b]) {
+                        memset(blockData[b], 0, WID3*sizeof(Realf));
+                     }
+                  }
+                  propagatePencil(dz.data() + p*L, values.data(), dimension, blockGID, dt, vmesh, L, threshold,
+                                  blockData.data(), targetRatios.data() + p*L, vcell_transpose);
+               }
+            }
+         }
+      });
+   report("translation", times, nPencils * innerLength, blocks, 2.0 * blocks * WID3 * sizeof(Realf));
+}
+
+static void benchHashtable(const BenchSettings& s, const std::vector<SpatialCell>& pristine) {
+   // Shifting a key by the mesh size gives a GID that is never present
+   const vmesh::GlobalID missOffset = (vmesh::GlobalID)s.vBlocks * s.vBlocks * s.vBlocks;
+   std::vector<std::vector<vmesh::GlobalID>> keys(pristine.size());
+   double blocks = 0;
+   for (size_t c=0; c<pristine.size(); ++c) {
+      for (vmesh::LocalID blockLID=0; blockLID<pristine[c].get_number_of_velocity_blocks(popID); ++blockLID) {
+         keys[c].push_back(pristine[c].get_velocity_block_global_id(blockLID, popID));
+      }
+      blocks += keys[c].size();
+   }
+   size_t found = 0;
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) { found = 0; },
+      [&](const uint rep) {
+         #pragma omp parallel for schedule(dynamic,1) reduction(+:found)
+         for (size_t c=0; c<keys.size(); ++c) {
+            OpenBucketHashtable<vmesh::GlobalID,vmesh::LocalID> table;
+            for (size_t i=0; i<keys[c].size(); ++i) {
+               table[keys[c][i]] = i;
+            }
+            for (size_t i=0; i<keys[c].size(); ++i) {
+               found += table.count(keys[c][i]);
+               found += table.count(keys[c][i] + missOffset);
+            }
+         }
+      });
+   if (found != blocks) {
+      cerr << "(BENCH) WARNING: hashtable found " << found << " of " << blocks << " keys" << endl;
+   }
+   // One insert and two lookups per key
+   report("hashtable", times, 0, 3.0 * blocks, 3.0 * blocks * sizeof(std::pair<vmesh::GlobalID,vmesh::LocalID>));
+}
+
+/*! Scalar vs. batched GID to LID resolution in the velocity meshes of the cells.*/
+static void benchLookup(const BenchSettings& s, const std::vector<SpatialCell>& pristine, std::vector<SpatialCell>& cells) {
+   restoreCells(cells, pristine);
+   const vmesh::GlobalID missOffset = (vmesh::GlobalID)s.vBlocks * s.vBlocks * s.vBlocks;
+   std::vector<std::vector<vmesh::GlobalID>> keys(cells.size());
+   double lookups = 0;
+   for (size_t c=0; c<cells.size(); ++c) {
+      const vmesh::LocalID nBlocks = cells[c].get_number_of_velocity_blocks(popID);
+      for (vmesh::LocalID blockLID=0; blockLID<nBlocks; ++blockLID) {
+         const vmesh::GlobalID blockGID = cells[c].get_velocity_block_global_id(blockLID, popID);
+         keys[c].push_back(blockLID % 4 == 3 ? blockGID + missOffset : blockGID);
+      }
+      std::shuffle(keys[c].begin(), keys[c].end(), std::mt19937(c));
+      lookups += keys[c].size();
+   }
+
+   std::vector<Realf> sums(cells.size());
+   auto touch = [&](SpatialCell& cell, const vmesh::LocalID blockLID) -> Realf {
+      return blockLID == SpatialCell::invalid_local_id() ? 0.0 : cell.get_data(blockLID, popID)[0];
+   };
+   const std::vector<double> scalarTimes = measure(s,
+      [&](const uint rep) { },
+      [&](const uint rep) {
+         #pragma omp parallel for schedule(dynamic,1)
+         for (size_t c=0; c<cells.size(); ++c) {
+            const vmesh::VelocityMesh* vmesh = cells[c].get_velocity_mesh(popID);
+            Realf sum = 0;
+            for (size_t i=0; i<keys[c].size(); ++i) {
+               sum += touch(cells[c], vmesh->getLocalID(keys[c][i]));
+            }
+            sums[c] = sum;
+         }
+      });
+   const std::vector<Realf> scalarSums(sums);
+   const std::vector<double> batchTimes = measure(s,
+      [&](const uint rep) { },
+      [&](const uint rep) {
+         #pragma omp parallel
+         {
+            std::vector<vmesh::LocalID> localIDs;
+            #pragma omp for schedule(dynamic,1)
+            for (size_t c=0; c<cells.size(); ++c) {
+               const vmesh::VelocityMesh* vmesh = cells[c].get_velocity_mesh(popID);
+               localIDs.resize(keys[c].size());
+               vmesh->getLocalIDs(keys[c].data(), localIDs.data(), keys[c].size());
+               Realf sum = 0;
+               for (size_t i=0; i<keys[c].size(); ++i) {
+                  sum += touch(cells[c], localIDs[i]);
+               }
+               sums[c] = sum;
+            }
+         }
+      });
+   if (sums != scalarSums) {
+      cerr << "(BENCH) WARNING: batched and scalar lookups differ" << endl;
+   }
+   report("getLocalID", scalarTimes, cells.size(), lookups, 0);
+   report("getLocalIDs", batchTimes, cells.size(), lookups, 0);
+}
+
+static void benchFieldSolver(const BenchSettings& s) {
+   const std::array<FsGridTools::FsSize_t, 3> dims {s.fsCells, s.fsCells, s.fsCells};
+   const std::array<bool,3> periodicity {true, true, true};
+   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> perBGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> perBDt2Grid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, FS_STENCIL_WIDTH> EGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, FS_STENCIL_WIDTH> EDt2Grid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::ehall::N_EHALL>, FS_STENCIL_WIDTH> EHallGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, FS_STENCIL_WIDTH> EGradPeGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, FS_STENCIL_WIDTH> EGradPeDt2Grid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, FS_STENCIL_WIDTH> momentsGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, FS_STENCIL_WIDTH> momentsDt2Grid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, FS_STENCIL_WIDTH> dPerBGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, FS_STENCIL_WIDTH> dMomentsGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, FS_STENCIL_WIDTH> dMomentsDt2Grid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, FS_STENCIL_WIDTH> BgBGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< std::array<Real, fsgrids::volfields::N_VOL>, FS_STENCIL_WIDTH> volGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+   FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> technicalGrid(dims, MPI_COMM_WORLD, periodicity, P::manualFsGridDecomposition);
+
+   const Real dx = 1.0e6;
+   perBGrid.DX = perBDt2Grid.DX = EGrid.DX = EDt2Grid.DX = EHallGrid.DX = EGradPeGrid.DX = EGradPeDt2Grid.DX = momentsGrid.DX
+      = momentsDt2Grid.DX = dPerBGrid.DX = dMomentsGrid.DX = dMomentsDt2Grid.DX = BgBGrid.DX = volGrid.DX = technicalGrid.DX = dx;
+   perBGrid.DY = perBDt2Grid.DY = EGrid.DY = EDt2Grid.DY = EHallGrid.DY = EGradPeGrid.DY = EGradPeDt2Grid.DY = momentsGrid.DY
+      = momentsDt2Grid.DY = dPerBGrid.DY = dMomentsGrid.DY = dMomentsDt2Grid.DY = BgBGrid.DY = volGrid.DY = technicalGrid.DY = dx;
+   perBGrid.DZ = perBDt2Grid.DZ = EGrid.DZ = EDt2Grid.DZ = EHallGrid.DZ = EGradPeGrid.DZ = EGradPeDt2Grid.DZ = momentsGrid.DZ
+      = momentsDt2Grid.DZ = dPerBGrid.DZ = dMomentsGrid.DZ = dMomentsDt2Grid.DZ = BgBGrid.DZ = volGrid.DZ = technicalGrid.DZ = dx;
+   perBGrid.physicalGlobalStart = perBDt2Grid.physicalGlobalStart = EGrid.physicalGlobalStart = EDt2Grid.physicalGlobalStart
+      = EHallGrid.physicalGlobalStart = EGradPeGrid.physicalGlobalStart = EGradPeDt2Grid.physicalGlobalStart = momentsGrid.physicalGlobalStart
+      = momentsDt2Grid.physicalGlobalStart = dPerBGrid.physicalGlobalStart = dMomentsGrid.physicalGlobalStart = dMomentsDt2Grid.physicalGlobalStart
+      = BgBGrid.physicalGlobalStart = volGrid.physicalGlobalStart = technicalGrid.physicalGlobalStart = {P::xmin, P::ymin, P::zmin};
+
+   // Uniform plasma and background field with a small transverse magnetic field wave along x
+   const Real mass = physicalconstants::MASS_PROTON;
+   const std::array<FsGridTools::FsIndex_t, 3> localSize = technicalGrid.getLocalSize();
+   const std::array<FsGridTools::FsIndex_t, 3> localStart = technicalGrid.getLocalStart();
+   for (FsGridTools::FsIndex_t k=0; k<localSize[2]; ++k) {
+      for (FsGridTools::FsIndex_t j=0; j<localSize[1]; ++j) {
+         for (FsGridTools::FsIndex_t i=0; i<localSize[0]; ++i) {
+            fsgrids::technical* technical = technicalGrid.get(i,j,k);
+            technical->sysBoundaryFlag = sysboundarytype::NOT_SYSBOUNDARY;
+            technical->sysBoundaryLayer = 0;
+            technical->maxFsDt = std::numeric_limits<Real>::max();
+            technical->SOLVE = compute::BX | compute::BY | compute::BZ | compute::EX | compute::EY | compute::EZ;
+            technical->refLevel = 0;
+
+            const Real phase = 2.0 * M_PI * (localStart[0] + i) / s.fsCells;
+            std::array<Real, fsgrids::bfield::N_BFIELD>* perB = perBGrid.get(i,j,k);
+            (*perB)[fsgrids::bfield::PERBX] = 0.0;
+            (*perB)[fsgrids::bfield::PERBY] = 0.1 * s.B * sin(phase);
+            (*perB)[fsgrids::bfield::PERBZ] = 0.1 * s.B * cos(phase);
+            *perBDt2Grid.get(i,j,k) = *perB;
+
+            std::array<Real, fsgrids::bgbfield::N_BGB>* bgb = BgBGrid.get(i,j,k);
+            bgb->fill(0.0);
+            (*bgb)[fsgrids::bgbfield::BGBX] = (*bgb)[fsgrids::bgbfield::BGBXVOL] = s.B;
+
+            std::array<Real, fsgrids::moments::N_MOMENTS>* moments = momentsGrid.get(i,j,k);
+            moments->fill(0.0);
+            (*moments)[fsgrids::moments::RHOM] = s.rho * mass;
+            (*moments)[fsgrids::moments::RHOQ] = s.rho * physicalconstants::CHARGE;
+            (*moments)[fsgrids::moments::VX] = s.drift;
+            (*moments)[fsgrids::moments::P_11] = (*moments)[fsgrids::moments::P_22] = (*moments)[fsgrids::moments::P_33]
+               = s.rho * physicalconstants::K_B * s.T;
+            *momentsDt2Grid.get(i,j,k) = *moments;
+         }
+      }
+   }
+   perBGrid.updateGhostCells();
+   perBDt2Grid.updateGhostCells();
+   BgBGrid.updateGhostCells();
+   momentsGrid.updateGhostCells();
+   momentsDt2Grid.updateGhostCells();
+   technicalGrid.updateGhostCells();
+
+   // Well within the CFL limit of the fast mode
+   const Real vA = s.B / sqrt(physicalconstants::MU_0 * s.rho * mass);
+   const Real dt = 0.1 * dx / (vA + s.drift);
+
+   const std::vector<double> times = measure(s,
+      [&](const uint rep) { },
+      [&](const uint rep) {
+         propagateFields(perBGrid, perBDt2Grid, EGrid, EDt2Grid, EHallGrid, EGradPeGrid, EGradPeDt2Grid,
+                         momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, dMomentsDt2Grid, BgBGrid, volGrid,
+                         technicalGrid, getObjectWrapper().sysBoundaryContainer, dt, 1);
+      });
+
+   // Every grid is read or written at least once per step
+   const double bytesPerCell = sizeof(Real) * (2*fsgrids::bfield::N_BFIELD + 2*fsgrids::efield::N_EFIELD + fsgrids::ehall::N_EHALL
+                                               + 2*fsgrids::egradpe::N_EGRADPE + 2*fsgrids::moments::N_MOMENTS + fsgrids::dperb::N_DPERB
+                                               + 2*fsgrids::dmoments::N_DMOMENTS + fsgrids::bgbfield::N_BGB + fsgrids::volfields::N_VOL)
+      + sizeof(fsgrids::technical);
+   const double fsCells = (double)localSize[0] * localSize[1] * localSize[2];
+   report("fieldsolver", times, fsCells, 0, fsCells * bytesPerCell);
+}
+
+static void printUsage(const char* name) {
+   const BenchSettings d;
+   cout << "Usage: " << name << " [options]" << endl
+        << "  -cells N        number of spatial cells with a VDF (" << d.nCells << ")" << endl
+        << "  -vblocks N      velocity blocks per dimension (" << d.vBlocks << ")" << endl
+        << "  -vmax V         velocity mesh half width in m/s (" << d.vMax << ")" << endl
+        << "  -rho N          number density in m^-3 (" << d.rho << ")" << endl
+        << "  -T T            temperature in K (" << d.T << ")" << endl
+        << "  -drift V        bulk speed in m/s (" << d.drift << ")" << endl
+        << "  -minvalue F     sparsity threshold (" << d.minValue << ")" << endl
+        << "  -B B            magnetic field in T (" << d.B << ")" << endl
+        << "  -rotation DEG   gyration per acceleration step in degrees (" << d.rotation << ")" << endl
+        << "  -pencil N       translation pencil length (" << d.pencilLength << ")" << endl
+        << "  -fscells N      field solver cube edge length (" << d.fsCells << ")" << endl
+        << "  -hall           include the Hall term in the field solver" << endl
+        << "  -reps N         timed repetitions (" << d.reps << ")" << endl
+        << "  -warmup N       untimed repetitions (" << d.warmup << ")" << endl
+        << "  -kernels LIST   comma-separated subset of acceleration,translation,moments,adjust,fieldsolver,hashtable,lookup" << endl;
+}
+
+int main(int argc, char** argv) {
+   int required=MPI_THREAD_FUNNELED;
+   int provided;
+   int myRank, nProcs;
+   MPI_Init_thread(&argc,&argv,required,&provided);
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   MPI_Comm_size(MPI_COMM_WORLD,&nProcs);
+   if (required > provided) {
+      if (myRank == MASTER_RANK) {
+         cerr << "(MAIN): MPI_Init_thread failed! Got " << provided << ", need " << required << endl;
+      }
+      exit(1);
+   }
+   if (nProcs != 1) {
+      if (myRank == MASTER_RANK) {
+         cerr << "vlasiator_bench is a single-node benchmark, run it on one MPI rank with OpenMP threads." << endl;
+      }
+      MPI_Finalize();
+      return 1;
+   }
+
+   BenchSettings s;
+   for (int i=1; i<argc; i++) {
+      if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+         printUsage(argv[0]);
+         MPI_Finalize();
+         return 0;
+      }
+      if (i+1 < argc) {
+         if (!strcmp(argv[i], "-cells")) { s.nCells = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-vblocks")) { s.vBlocks = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-vmax")) { s.vMax = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-rho")) { s.rho = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-T")) { s.T = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-drift")) { s.drift = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-minvalue")) { s.minValue = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-B")) { s.B = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-rotation")) { s.rotation = atof(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-pencil")) { s.pencilLength = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-fscells")) { s.fsCells = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-reps")) { s.reps = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-warmup")) { s.warmup = atoi(argv[++i]); continue; }
+         if (!strcmp(argv[i], "-kernels")) {
+            s.kernels.clear();
+            std::istringstream list(argv[++i]);
+            std::string kernel;
+            while (std::getline(list, kernel, ',')) {
+               s.kernels.insert(kernel);
+            }
+            continue;
+         }
+      }
+      if (!strcmp(argv[i], "-hall")) {
+         P::ohmHallTerm = 2;
+         continue;
+      }
+      cerr << "Unknown command line option \"" << argv[i] << "\"" << endl;
+      printUsage(argv[0]);
+      MPI_Finalize();
+      return 1;
+   }
+   if (s.nCells == 0 || s.vBlocks == 0 || s.pencilLength == 0 || s.fsCells == 0 || s.reps == 0) {
+      cerr << "Cell, block, pencil, fsgrid and repetition counts must be positive." << endl;
+      MPI_Finalize();
+      return 1;
+   }
+
+   phiprof::initialize();
+   logFile.open(MPI_COMM_WORLD, MASTER_RANK, "vlasiator_bench.log");
+
+   // Parameters the kernels read, normally set from the config file
+   P::xmin = P::ymin = P::zmin = 0.0;
+   P::xcells_ini = P::ycells_ini = P::zcells_ini = s.fsCells;
+   P::dx_ini = P::dy_ini = P::dz_ini = 1.0e6;
+   P::t = 0.0;
+   P::resistivity = 0.0;
+   P::fieldSolverMaxCFL = 0.5;
+   P::fieldSolverMinCFL = 0.4;
+   P::maxFieldSolverSubcycles = 1;
+   P::bailout_velocity_space_wall_margin = 0;
+
+   initializePopulation(s);
+
+   int nThreads = 1;
+   #ifdef _OPENMP
+   nThreads = omp_get_max_threads();
+   #endif
+
+   std::vector<SpatialCell> pristine(s.nCells);
+   #pragma omp parallel for schedule(dynamic,1)
+   for (uint c=0; c<s.nCells; ++c) {
+      initializeCell(pristine[c], s, c);
+   }
+   std::vector<SpatialCell> cells(pristine);
+
+   const double blocks = countBlocks(pristine);
+   const Real gyroPeriod = 2.0 * M_PI * physicalconstants::MASS_PROTON / (physicalconstants::CHARGE * s.B);
+   const Real accelerationDt = gyroPeriod * s.rotation / 360.0;
+
+   cout << "vlasiator_bench: WID=" << WID << " VECL=" << VECL << " Realf=" << sizeof(Realf) << " bytes, "
+        << nThreads << " threads" << endl
+        << "  " << s.nCells << " cells, " << blocks << " blocks (" << blocks / s.nCells << " per cell, "
+        << 100.0 * blocks / s.nCells / ((double)s.vBlocks * s.vBlocks * s.vBlocks) << "% of the "
+        << s.vBlocks << "^3 mesh), " << blocks * WID3 * sizeof(Realf) / 1e9 << " GB of VDF data" << endl
+        << "  fsgrid " << s.fsCells << "^3, " << s.reps << " repetitions after " << s.warmup << " warmup" << endl << endl;
+   cout << std::left << std::setw(14) << "kernel" << std::right
+        << std::setw(6) << "reps"
+        << std::setw(12) << "mean[ms]"
+        << std::setw(12) << "stddev[ms]"
+        << std::setw(8) << "rsd[%]"
+        << std::setw(12) << "min[ms]"
+        << std::setw(12) << "cells/s"
+        << std::setw(12) << "blocks/s"
+        << std::setw(12) << "GB/s" << endl;
+
+   if (s.kernels.count("acceleration")) {
+      benchAcceleration(s, pristine, cells, accelerationDt);
+   }
+   if (s.kernels.count("translation")) {
+      benchTranslation(s, pristine, cells);
+   }
+   if (s.kernels.count("moments")) {
+      benchMoments(s, pristine, cells);
+   }
+   if (s.kernels.count("adjust")) {
+      // Adjustment works on the distributions left by an acceleration step
+      std::vector<SpatialCell> accelerated(pristine);
+      const int intersectionsTimerId {phiprof::initializeTimer("cell-compute-intersections")};
+      accelerateCells(accelerated, accelerationDt, 0, intersectionsTimerId);
+      benchAdjust(s, accelerated, cells);
+   }
+   if (s.kernels.count("hashtable")) {
+      benchHashtable(s, pristine);
+   }
+   if (s.kernels.count("lookup")) {
+      benchLookup(s, pristine, cells);
+   }
+   if (s.kernels.count("fieldsolver")) {
+      benchFieldSolver(s);
+   }
+
+   if (globalflags::bailingOut) {
+      cerr << "(BENCH) WARNING: a kernel requested bailout, see vlasiator_bench.log" << endl;
+   }
+
+   cells.clear();
+   pristine.clear();
+   logFile.close();
+   MPI_Finalize();
+   return 0;
+}
@@ -63,6 +63,21 @@ private:
        }
     }
 
+   // Resolve key starting from bucket hashIndex, with the same probing as find().
+   LID probe(const GID& key, const uint32_t hashIndex, const LID notFound) const {
+      const uint32_t bitMask = (1u << sizePower) - 1;
+      for (int i = 0; i < maxBucketOverflow; i++) {
+         const std::pair<GID, LID>& candidate = buckets[(hashIndex + i) & bitMask];
+         if (candidate.first == key) {
+            return candidate.second;
+         }
+         if (candidate.first == EMPTYBUCKET) {
+            return notFound;
+         }
+      }
+      return notFound;
+   }
+
 public:
    OpenBucketHashtable() : sizePower(4), fill(0), buckets(1 << sizePower, std::pair<GID, LID>(EMPTYBUCKET, LID())) {};
 
@@ -327,6 +342,30 @@ public:
       return end();
    }
 
+   // Batched lookup: values[i] is set to the value stored for keys[i], or to notFound if the key is absent.
+   // Single lookups are a chain of dependent cache misses (hash -> bucket -> value). Here the keys are
+   // hashed and their buckets prefetched in groups, so the misses of a group are in flight at the same
+   // time before the group is resolved. Results are identical to calling find() for each key.
+   void findBatch(const GID* keys, LID* values, const size_t n, const LID notFound) const {
+      constexpr size_t groupSize = 16;
+      const uint32_t bitMask = (1u << sizePower) - 1;
+      const std::pair<GID, LID>* table = buckets.data();
+      uint32_t hashIndices[groupSize];
+
+      for (size_t groupStart = 0; groupStart < n; groupStart += groupSize) {
+         const size_t groupEnd = std::min(n, groupStart + groupSize);
+         for (size_t i = groupStart; i < groupEnd; i++) {
+            hashIndices[i - groupStart] = hash(keys[i]) & bitMask;
+            #ifdef __GNUC__
+            __builtin_prefetch(table + hashIndices[i - groupStart]);
+            #endif
+         }
+         for (size_t i = groupStart; i < groupEnd; i++) {
+            values[i] = probe(keys[i], hashIndices[i - groupStart], notFound);
+         }
+      }
+   }
+
    // More STL compatibility implementations
    std::pair<iterator, bool> insert(std::pair<GID, LID> newEntry) {
       bool found = find(newEntry.first) != end();
@@ -70,6 +70,7 @@ Real P::vlasovSolverMaxCFL = NAN;
 Real P::vlasovSolverMinCFL = NAN;
 bool P::vlasovSolverGhostTranslate = false;
 uint P::vlasovSolverGhostTranslateExtent = 0;
+bool P::vlasovIncrementalPencils = false;
 Real P::fieldSolverMaxCFL = NAN;
 Real P::fieldSolverMinCFL = NAN;
 uint P::fieldSolverSubcycles = 1;
@@ -137,11 +138,20 @@ Real P::electronPTindex = 1.0;
 
 string P::restartFileName = string("");
 bool P::isRestart = false;
+bool P::restartReadWriterPartition = true;
 int P::writeAsFloat = false;
 int P::writeRestartAsFloat = false;
+Real P::vdfCompressionTolerance = 0.0;
+uint P::telemetryInterval = 0;
+string P::telemetryFileName = string("");
 string P::loadBalanceAlgorithm = string("");
 std::map<std::string, std::string> P::loadBalanceOptions;
 uint P::rebalanceInterval = numeric_limits<uint>::max();
+bool P::mortonOrderCells = false;
+bool P::loadBalanceMultiConstraint = false;
+Real P::loadBalanceComputeScale = 1.05;
+Real P::loadBalanceMemoryScale = 1.05;
+Real P::loadBalanceCouplingScale = 1.2;
 
 vector<string> P::outputVariableList;
 vector<string> P::diagnosticVariableList;
@@ -149,6 +159,8 @@ vector<string> P::diagnosticVariableList;
 string P::projectName = string("");
 
 bool P::vlasovAccelerateMaxwellianBoundaries = false;
+bool P::vlasovFusedAccelerationMoments = false;
+bool P::velocityBlockPool = false;
 Real P::maxSlAccelerationRotation = 10.0;
 Real P::hallMinimumRhom = physicalconstants::MASS_PROTON;
 Real P::hallMinimumRhoq = physicalconstants::CHARGE;
@@ -187,6 +199,7 @@ Real P::alphaDBWeight = 1.0;
 uint P::refineCadence = 5;
 Real P::refineAfter = 0.0;
 Real P::refineRadius = LARGE_REAL;
+Real P::refineMemoryBudget = 0.0;
 int P::refineBoxNumber = 0;
 std::vector<Real> P::refinementMinX;
 std::vector<Real> P::refinementMinY;
@@ -285,6 +298,16 @@ bool P::addParameters() {
    RP::add("io.write_restart_stripe_factor", "Stripe factor for restart and initial grid writing. Default 0 to inherit.", 0);
    RP::add("io.write_system_stripe_factor", "Stripe factor for bulk file writing. Default 0 to inherit.", 0);
    RP::add("io.write_as_float", "If true, write in floats instead of doubles", false);
+   RP::add("io.vdf_compression_tolerance",
+           "Relative error bound of the lossy compression of velocity distributions in bulk files. Values and the "
+           "density and velocity moments of each written distribution are preserved to this tolerance. Restart files "
+           "are always lossless. Default 0 disables compression.",
+           0.0);
+   RP::add("io.telemetry_interval",
+           "Write a machine-readable performance record (step time per section, cells, blocks and memory high water "
+           "mark as min/avg/max over ranks) every arg time steps. Default 0 disables telemetry.",
+           0);
+   RP::add("io.telemetry_file", "JSON Lines file the telemetry records are appended to.", string("telemetry.jsonl"));
    RP::add("io.restart_write_path",
            "Path to the location where restart files should be written. Defaults to the local directory, also if the "
            "specified destination is not writeable.",
@@ -316,6 +339,7 @@ bool P::addParameters() {
 
    RP::add("restart.write_as_float", "If true, write restart fields in floats instead of doubles", false);
    RP::add("restart.filename", "Restart from this vlsv file. No restart if empty file.", string(""));
+   RP::add("restart.read_writer_partition", "If true and the restart was written with the same number of MPI ranks (or an integer multiple thereof), read each rank's cells directly onto the partition of the writing run instead of re-balancing after reading.", true);
 
    RP::add(
        "restart.overrideReadFsGridDecompositionX",
@@ -403,13 +427,29 @@ bool P::addParameters() {
    RP::add("vlasovsolver.accelerateMaxwellianBoundaries",
            "Propagate maxwellian boundary cell contents in velocity space. Default false.",
            false);
+   RP::add("vlasovsolver.fusedAccelerationMoments",
+           "Accumulate the velocity moments after acceleration while mapping the last dimension, instead of "
+           "re-reading the distribution afterwards (CPU only). Default false.",
+           false);
+   RP::add("vlasovsolver.blockPool",
+           "Allocate velocity block data and parameters from a rank-wide pool of size-classed buffers that are "
+           "reused across cells instead of returned to the system (CPU only). Reduces heap fragmentation from "
+           "block container resizing; cached buffers are released whenever memory is purged. Requires a CPU build "
+           "with -DUSE_BLOCK_POOL.",
+           false);
    RP::add("vlasovsolver.GhostTranslate","Boolean for activating all-local ghost translation",false);
    RP::add("vlasovsolver.GhostTranslateExtent","Stencil size in all-local ghost translation (default: VLASOV_STENCIL_WIDTH+1",0);
+   RP::add("vlasovsolver.incrementalPencils","After refinement or load balance, rebuild only translation pencils touching refined, unrefined, migrated or otherwise changed cells",false);
 
    // Load balancing parameters
    RP::add("loadBalance.algorithm", "Load balancing algorithm to be used", string("RCB"));
    RP::add("loadBalance.tolerance", "Load imbalance tolerance", string("1.05"));
    RP::add("loadBalance.rebalanceInterval", "Load rebalance interval (steps)", 10);
+   RP::add("loadBalance.mortonOrder", "Order local cells along a Morton curve and reallocate their velocity block data in that order after each load balance", false);
+   RP::add("loadBalance.multiConstraint", "Balance on measured per-cell compute time, memory footprint and fsgrid coupling volume instead of the block-based weight counter", false);
+   RP::add("loadBalance.computeScale", "Scale factor of the compute constraint in multi-constraint load balancing. The single weight passed to Zoltan is the largest of the constraints, each divided by its global mean and by its scale factor, so a larger factor gives the constraint less influence. This does not bound the imbalance of the constraint, only loadBalance.tolerance is enforced. Must be positive.", 1.05);
+   RP::add("loadBalance.memoryScale", "Scale factor of the memory (velocity block) constraint in multi-constraint load balancing, see loadBalance.computeScale. Must be positive.", 1.05);
+   RP::add("loadBalance.couplingScale", "Scale factor of the fsgrid coupling constraint in multi-constraint load balancing, see loadBalance.computeScale. Must be positive.", 1.2);
 
    RP::addComposing("loadBalance.optionKey", "Zoltan option key. Has to be matched by loadBalance.optionValue.");
    RP::addComposing("loadBalance.optionValue", "Zoltan option value. Has to be matched by loadBalance.optionKey.");
@@ -432,7 +472,7 @@ bool P::addParameters() {
                         "populations_vg_maxdt_translation " +
                         "fg_maxdt_fieldsolver " + "vg_rank fg_rank fg_amr_level vg_loadbalance_weight " +
                         "vg_boundarytype fg_boundarytype vg_boundarylayer fg_boundarylayer " +
-                        "populations_vg_blocks vg_f_saved " + "populations_vg_acceleration_subcycles " +
+                        "populations_vg_blocks populations_vg_velocity_extent vg_f_saved " + "populations_vg_acceleration_subcycles " +
                         "vg_e_vol fg_e_vol " +
                         "fg_e_hall vg_e_gradpe fg_b_vol vg_b_vol vg_b_background_vol vg_b_perturbed_vol " +
                         "vg_pressure fg_pressure populations_vg_ptensor " + "vg_b_vol_derivatives fg_derivs " +
@@ -468,7 +508,7 @@ bool P::addParameters() {
                     string() +
                         "List of data reduction operators (DROs) to add to the diagnostic runtime output. Each "
                         "variable to be added has to be on a new line diagnostic = XXX. Names are case insensitive. " +
-                        "Available (20250130): " + "populations_vg_blocks " +
+                        "Available (20250130): " + "populations_vg_blocks populations_vg_velocity_extent " +
                         "vg_rhom populations_vg_rho_loss_adjust " + "vg_loadbalance_weight " +
                         "vg_maxdt_acceleration vg_maxdt_translation " + "fg_maxdt_fieldsolver " +
                         "populations_vg_maxdt_acceleration populations_vg_maxdt_translation ");
@@ -516,6 +556,7 @@ bool P::addParameters() {
    RP::add("AMR.refine_cadence","Refine every nth load balance", 5);
    RP::add("AMR.refine_after","Start refinement after this many simulation seconds", 0.0);
    RP::add("AMR.refine_radius","Maximum distance from origin to allow refinement within. Only induced refinement allowed outside this radius.", LARGE_REAL);
+   RP::add("AMR.refine_memory_budget","Global budget (GiB) of predicted velocity block memory for adaptive refinement. Refinement candidates are accepted by benefit per byte until the budget is reached. 0 disables the budget.", 0.0);
    RP::add("AMR.number_of_refine_boxes", "How many boxes outside which to suppress refinement, that number of box edges have to then be defined as well. If more than 1 box is defined, refinement is suppressed outside the union of the volumes of all boxes.", 0);
    RP::addComposing("AMR.refinement_min_x", "Refinement minimum X coordinate, no refinement at x < this value (m) except induced refinement.");
    RP::addComposing("AMR.refinement_min_y", "Refinement minimum Y coordinate, no refinement at y < this value (m) except induced refinement.");
@@ -559,6 +600,7 @@ bool P::addParameters() {
    RP::add("fieldtracing.fullbox_max_incomplete_cells", "Maximum fraction of cells left incomplete when stopping tracing loop for full box tracing. Defaults to zero to process all, will be slow at scale! Both fluxrope_max_incomplete_cells and fullbox_max_incomplete_cells will be achieved.", 0);
    RP::add("fieldtracing.fluxrope_max_incomplete_cells", "Maximum fraction of cells left incomplete when stopping loop for flux rope tracing. Defaults to zero to process all, will be slow at scale! Both fluxrope_max_incomplete_cells and fullbox_max_incomplete_cells will be achieved.", 0);
    RP::add("fieldtracing.use_reconstruction_cache", "Use the cache to store reconstruction coefficients. (0: don't, 1: use)", 0);
+   RP::add("fieldtracing.use_batched_tracing", "Advance field lines in SIMD batches sharing reconstruction coefficients in the open/closed and full box tracing. (0: don't, 1: use)", 0);
    RP::add("fieldtracing.fluxrope_max_curvature_radii_to_trace", "Maximum number of seedpoint curvature radii to trace forward and backward from each DCCRG cell to find flux ropes", 10);
    RP::add("fieldtracing.fluxrope_max_curvature_radii_extent", "Maximum extent in seedpoint curvature radii from the seed a field line is allowed to extend to be counted as a flux rope", 2);
    RP::add("fieldtracing.min_allowed_x", "Trace for x coordinates larger than this limit (in m).", -LARGE_REAL);
@@ -599,6 +641,9 @@ void Parameters::getParameters() {
    RP::get("io.restart_write_path", P::restartWritePath);
    RP::get("io.recover_write_path", P::recoverWritePath);
    RP::get("io.write_as_float", P::writeAsFloat);
+   RP::get("io.vdf_compression_tolerance", P::vdfCompressionTolerance);
+   RP::get("io.telemetry_interval", P::telemetryInterval);
+   RP::get("io.telemetry_file", P::telemetryFileName);
 
    // Checks for validity of io and restart parameters
    int myRank;
@@ -621,6 +666,12 @@ void Parameters::getParameters() {
    if (P::recoverMaxFiles == 0) {
       P::recoverMaxFiles = 1; // If we leave it at zero a manual DORC will divide by zero when computing the index.
    }
+   if (P::vdfCompressionTolerance < 0 || P::vdfCompressionTolerance >= 0.5) {
+      if (myRank == MASTER_RANK) {
+         cerr << "ERROR io.vdf_compression_tolerance must be in [0,0.5), got " << P::vdfCompressionTolerance << endl;
+      }
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
    size_t maxSize = 0;
    maxSize = max(maxSize, P::systemWriteTimeInterval.size());
    maxSize = max(maxSize, P::systemWriteName.size());
@@ -782,6 +833,7 @@ void Parameters::getParameters() {
    P::hallMinimumRhoq = hallRho * physicalconstants::CHARGE;
    RP::get("restart.write_as_float", P::writeRestartAsFloat);
    RP::get("restart.filename", P::restartFileName);
+   RP::get("restart.read_writer_partition", P::restartReadWriterPartition);
    P::isRestart = (P::restartFileName != string(""));
 
    // manual FsGrid decomposition should be complete with three values. If at least one is set but all are not set, abort
@@ -887,6 +939,7 @@ void Parameters::getParameters() {
    RP::get("AMR.refine_cadence",P::refineCadence);
    RP::get("AMR.refine_after",P::refineAfter);
    RP::get("AMR.refine_radius",P::refineRadius);
+   RP::get("AMR.refine_memory_budget",P::refineMemoryBudget);
    RP::get("AMR.number_of_refine_boxes", P::refineBoxNumber);
    RP::get("AMR.refinement_min_x", P::refinementMinX);
    RP::get("AMR.refinement_min_y", P::refinementMinY);
@@ -1038,7 +1091,18 @@ void Parameters::getParameters() {
    RP::get("vlasovsolver.minCFL", P::vlasovSolverMinCFL);
    RP::get("vlasovsolver.GhostTranslate",P::vlasovSolverGhostTranslate);
    RP::get("vlasovsolver.GhostTranslateExtent",P::vlasovSolverGhostTranslateExtent);
+   RP::get("vlasovsolver.incrementalPencils",P::vlasovIncrementalPencils);
    RP::get("vlasovsolver.accelerateMaxwellianBoundaries",  P::vlasovAccelerateMaxwellianBoundaries);
+   RP::get("vlasovsolver.fusedAccelerationMoments", P::vlasovFusedAccelerationMoments);
+   RP::get("vlasovsolver.blockPool", P::velocityBlockPool);
+#ifndef USE_BLOCK_POOL
+   if (P::velocityBlockPool) {
+      if (myRank == MASTER_RANK) {
+         cerr << "ERROR vlasovsolver.blockPool requires a CPU build with -DUSE_BLOCK_POOL" << endl;
+      }
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+#endif
    if (P::vlasovSolverGhostTranslate==true) {
       if (myRank == MASTER_RANK) {
          logFile<<"Performing spatial translation using ghost cell information with coalesced MPI updates."<<endl;
@@ -1067,6 +1131,19 @@ void Parameters::getParameters() {
    loadBalanceOptions["IMBALANCE_TOL"] = "";
    RP::get("loadBalance.tolerance", loadBalanceOptions["IMBALANCE_TOL"]);
    RP::get("loadBalance.rebalanceInterval", P::rebalanceInterval);
+   RP::get("loadBalance.mortonOrder", P::mortonOrderCells);
+   RP::get("loadBalance.multiConstraint", P::loadBalanceMultiConstraint);
+   RP::get("loadBalance.computeScale", P::loadBalanceComputeScale);
+   RP::get("loadBalance.memoryScale", P::loadBalanceMemoryScale);
+   RP::get("loadBalance.couplingScale", P::loadBalanceCouplingScale);
+   // Zero would divide by zero and negative factors give negative cell weights
+   if (!(P::loadBalanceComputeScale > 0) || !(P::loadBalanceMemoryScale > 0) || !(P::loadBalanceCouplingScale > 0)) {
+      if (myRank == MASTER_RANK) {
+         cerr << "ERROR loadBalance.computeScale, memoryScale and couplingScale must be positive, got "
+              << P::loadBalanceComputeScale << ", " << P::loadBalanceMemoryScale << " and " << P::loadBalanceCouplingScale << endl;
+      }
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
 
    std::vector<std::string> loadBalanceKeys;
    std::vector<std::string> loadBalanceValues;
@@ -1131,6 +1208,7 @@ void Parameters::getParameters() {
    RP::get("fieldtracing.fluxrope_max_incomplete_cells", FieldTracing::fieldTracingParameters.fluxrope_max_incomplete_cells);
    RP::get("fieldtracing.fullbox_and_fluxrope_max_absolute_distance_to_trace", FieldTracing::fieldTracingParameters.fullbox_and_fluxrope_max_distance);
    RP::get("fieldtracing.use_reconstruction_cache", FieldTracing::fieldTracingParameters.useCache);
+   RP::get("fieldtracing.use_batched_tracing", FieldTracing::fieldTracingParameters.useBatchedTracing);
    RP::get("fieldtracing.fluxrope_max_curvature_radii_to_trace", FieldTracing::fieldTracingParameters.fluxrope_max_curvature_radii_to_trace);
    RP::get("fieldtracing.fluxrope_max_curvature_radii_extent", FieldTracing::fieldTracingParameters.fluxrope_max_curvature_radii_extent);
    RP::get("fieldtracing.min_allowed_x", FieldTracing::fieldTracingParameters.x_min);
@@ -62,6 +62,7 @@ struct Parameters {
                                         timestep if useCFLlimit is true. */
    static bool vlasovSolverGhostTranslate;   /*!< Flag for activating all-local ghost translation. */
    static uint vlasovSolverGhostTranslateExtent;   /*!< Define extent of ghost-translated region in all-local ghost translation. */
+   static bool vlasovIncrementalPencils;   /*!< If true, only rebuild translation pencils touching changed cells after refinement or load balance. */
    static Real fieldSolverMinCFL;    /*!< The minimum CFL limit for propagation of fields. Used to set timestep if
                                         useCFLlimit is true.*/
    static Real fieldSolverMaxCFL;    /*!< The maximum CFL limit for propagation of fields. Used to set timestep if
@@ -153,6 +154,8 @@ struct Parameters {
    static Real maxSlAccelerationRotation; /*!< Maximum rotation in acceleration for semilagrangian solver*/
    static int maxSlAccelerationSubcycles; /*!< Maximum number of subcycles in acceleration*/
    static bool vlasovAccelerateMaxwellianBoundaries; /*!< Accelerate also Maxwellian boundary cells*/
+   static bool vlasovFusedAccelerationMoments; /*!< Accumulate the _V moments in the last acceleration mapping instead of a separate sweep*/
+   static bool velocityBlockPool; /*!< If true, velocity block data and parameters are allocated from a rank-wide buffer pool */
 
    static Real hallMinimumRhom; /*!< Minimum mass density value used in the field solver.*/
    static Real hallMinimumRhoq; /*!< Minimum charge density value used for the Hall and electron pressure gradient terms
@@ -161,6 +164,11 @@ struct Parameters {
    static std::string loadBalanceAlgorithm; /*!< Algorithm to be used for load balance.*/
    static std::map<std::string, std::string> loadBalanceOptions;  // Other Load balancing options
    static uint rebalanceInterval;           /*!< Load rebalance interval (steps). */
+   static bool mortonOrderCells;            /*!< If true, order local cells along a Morton curve and reallocate their block data in that order after load balance. */
+   static bool loadBalanceMultiConstraint;  /*!< If true, balance on measured compute time, memory and fsgrid coupling instead of the LB weight counter. */
+   static Real loadBalanceComputeScale; /*!< Scale factor dividing the normalized compute constraint in multi-constraint load balancing. */
+   static Real loadBalanceMemoryScale;  /*!< Scale factor dividing the normalized memory constraint in multi-constraint load balancing. */
+   static Real loadBalanceCouplingScale; /*!< Scale factor dividing the normalized fsgrid coupling constraint in multi-constraint load balancing. */
    static bool prepareForRebalance; /**< If true, propagators should measure their time consumption in preparation
                                      * for mesh repartitioning.*/
 
@@ -171,9 +179,13 @@ struct Parameters {
 
    static std::string restartFileName; /*!< If defined, restart from this file*/
    static bool isRestart;              /*!< true if this is a restart, false otherwise */
+   static bool restartReadWriterPartition; /*!< If true, read restart cells directly onto the partition of the writing run when the rank counts are compatible */
    static int writeAsFloat;            /*!< true if writing into VLSV in floats instead of doubles, false otherwise */
    static int
        writeRestartAsFloat;     /*!< true if writing into restart files in floats instead of doubles, false otherwise */
+   static Real vdfCompressionTolerance; /*!< Relative error bound of lossy VDF compression in bulk files, 0 writes VDFs losslessly */
+   static uint telemetryInterval;     /*!< Write a performance telemetry record every this many time steps, 0 disables telemetry */
+   static std::string telemetryFileName; /*!< JSON Lines file the telemetry records are appended to */
    static bool dynamicTimestep; /*!< If true, timestep is set based on  CFL limit */
 
    static std::string projectName; /*!< Project to be used in this run. */
@@ -207,6 +219,7 @@ struct Parameters {
    static uint refineCadence;
    static Real refineAfter;
    static Real refineRadius;
+   static Real refineMemoryBudget; /*!< Global velocity block memory budget (GiB) for adaptive refinement, 0 disables budgeted refinement. */
    static Real alphaDRhoWeight;
    static Real alphaDUWeight;
    static Real alphaDPSqWeight;
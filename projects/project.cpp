@@ -22,11 +22,14 @@
 
 #include "project.h"
 #include <cstdlib>
+#include <limits>
+#include <algorithm>
 #include "../common.h"
 #include "../parameters.h"
 #include "../readparameters.h"
 #include "../vlasovsolver/vlasovmover.h"
 #include "../logger.h"
+#include "../mpiconversion.h"
 #include "../object_wrapper.h"
 #include "../velocity_mesh_parameters.h"
 
@@ -517,6 +520,112 @@ namespace projects {
       return shouldUnrefine;
    }
 
+   /*! Refinement candidate in budgeted refinement mode */
+   struct RefineCandidate {
+      CellID id;
+      int refLevel;
+      Real cost;  /*!< Predicted additional memory in bytes */
+      Real ratio; /*!< Benefit per byte */
+   };
+
+   /*! Predicted memory footprint in bytes of the velocity blocks of a cell */
+   static Real predictedBlockBytes(const SpatialCell* cell) {
+      const Real bytesPerBlock = WID3 * sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS * sizeof(Real) + 2 * sizeof(vmesh::GlobalID);
+      return bytesPerBlock * cell->get_number_of_all_velocity_blocks();
+   }
+
+   /*! Benefit of refining a cell: the largest factor by which an active refinement index exceeds its threshold, at least 1 */
+   static Real refinementBenefit(const SpatialCell* cell) {
+      Real benefit = 1.0;
+      if (P::useAlpha1 && P::alpha1RefineThreshold > 0) {
+         benefit = std::max(benefit, cell->parameters[CellParams::AMR_ALPHA1] / P::alpha1RefineThreshold);
+      }
+      if (P::useAlpha2 && P::alpha2RefineThreshold > 0) {
+         benefit = std::max(benefit, cell->parameters[CellParams::AMR_ALPHA2] / P::alpha2RefineThreshold);
+      }
+      if (P::useVorticity && P::vorticityRefineThreshold > 0) {
+         benefit = std::max(benefit, cell->parameters[CellParams::AMR_VORTICITY] / P::vorticityRefineThreshold);
+      }
+      if (P::useAnisotropy && cell->parameters[CellParams::P_ANISOTROPY] > 0) {
+         benefit = std::max(benefit, P::anisotropyRefineThreshold / cell->parameters[CellParams::P_ANISOTROPY]);
+      }
+      return benefit;
+   }
+
+   /*! Accept refinement candidates in order of benefit per byte so that the predicted global velocity block
+    * memory stays within AMR.refine_memory_budget. The ratio threshold is found by bisection on globally
+    * reduced predicted costs. Rejected candidates keep their current refinement level.
+    * \param mpiGrid Spatial grid
+    * \param candidates Local refinement candidates
+    * \param currentBytes Predicted local block memory before adaptation
+    * \param unrefineSavings Predicted local memory released by unrefined cells
+    * @return The amount of cells set to refine
+    */
+   static uint64_t applyRefinementBudget(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                         const std::vector<RefineCandidate>& candidates, Real currentBytes, Real unrefineSavings) {
+      Real localSums[3] = {currentBytes, unrefineSavings, 0};
+      Real localRange[2] = {std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max()}; // min ratio, -max ratio
+      for (const auto& c : candidates) {
+         localSums[2] += c.cost;
+         localRange[0] = std::min(localRange[0], c.ratio);
+         localRange[1] = std::min(localRange[1], -c.ratio);
+      }
+      Real globalSums[3];
+      Real globalRange[2];
+      MPI_Allreduce(localSums, globalSums, 3, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+      MPI_Allreduce(localRange, globalRange, 2, MPI_Type<Real>(), MPI_MIN, MPI_COMM_WORLD);
+
+      const Real budget = P::refineMemoryBudget * 1024.0 * 1024.0 * 1024.0;
+      const Real available = budget - (globalSums[0] - globalSums[1]);
+
+      // Accept candidates with ratio >= threshold
+      Real threshold;
+      if (globalSums[2] <= available) {
+         threshold = -std::numeric_limits<Real>::max();
+      } else if (available <= 0) {
+         threshold = std::numeric_limits<Real>::max();
+      } else {
+         Real lo = globalRange[0];                // accepting all candidates exceeds the budget
+         Real hi = -globalRange[1] * (1 + 1e-6);  // accepting none fits
+         for (int iter = 0; iter < 64 && hi > lo * (1 + 1e-6); ++iter) {
+            const Real mid = 0.5 * (lo + hi);
+            Real localCost = 0;
+            for (const auto& c : candidates) {
+               if (c.ratio >= mid) {
+                  localCost += c.cost;
+               }
+            }
+            Real globalCost;
+            MPI_Allreduce(&localCost, &globalCost, 1, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+            if (globalCost <= available) {
+               hi = mid;
+            } else {
+               lo = mid;
+            }
+         }
+         threshold = hi;
+      }
+
+      uint64_t refines {0};
+      Real localCounts[3] = {0, 0, 0}; // accepted, rejected, accepted cost
+      for (const auto& c : candidates) {
+         if (c.ratio >= threshold) {
+            refines += mpiGrid.refine_completely(c.id) && c.refLevel < P::amrMaxSpatialRefLevel;
+            localCounts[0] += 1;
+            localCounts[2] += c.cost;
+         } else {
+            mpiGrid.dont_unrefine(c.id);
+            localCounts[1] += 1;
+         }
+      }
+      Real globalCounts[3];
+      MPI_Allreduce(localCounts, globalCounts, 3, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+      logFile << "(AMR): Refinement budget " << P::refineMemoryBudget << " GiB, predicted block memory "
+              << (globalSums[0] - globalSums[1] + globalCounts[2]) / (1024.0 * 1024.0 * 1024.0) << " GiB, accepted "
+              << globalCounts[0] << " and rejected " << globalCounts[1] << " refinement candidates" << endl << writeVerbose;
+      return refines;
+   }
+
    uint64_t Project::adaptRefinement( dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid ) const {
       phiprof::Timer refinesTimer {"Set refines"};
       int myRank;
@@ -533,10 +642,18 @@ namespace projects {
       const std::vector<CellID> cells {getLocalCells()};
       Real r_max2 {pow(P::refineRadius, 2)};
 
-      #pragma omp parallel for
+      // Budgeted mode: collect refinement candidates and predicted memory changes, decide after the loop
+      const bool budgeted {P::refineMemoryBudget > 0};
+      std::vector<RefineCandidate> candidates;
+      Real currentBytes {0};
+      Real unrefineSavings {0};
+
+      #pragma omp parallel for reduction(+:currentBytes)
       for (uint cid = 0; cid < cells.size(); ++cid) {
          CellID id = cells[cid];
          int refLevel {mpiGrid.get_refinement_level(id)};
+         const Real cellBytes {budgeted ? predictedBlockBytes(mpiGrid[id]) : 0};
+         currentBytes += cellBytes;
 
          if (!canRefine(mpiGrid[id])) {
             // Skip refining, touching boundaries during runtime breaks everything
@@ -576,11 +693,19 @@ namespace projects {
                if ((shouldRefine || refined_neighbors > 12) && refLevel < P::amrMaxAllowedSpatialRefLevel) {
                   // Refine a cell if a majority of its neighbors are refined or about to be
                   // Increment count of refined cells only if we're actually refining
-                  refines += mpiGrid.refine_completely(id) && refLevel < P::amrMaxSpatialRefLevel;
+                  if (budgeted) {
+                     // Each of the eight children gets a copy of the parent's blocks
+                     const Real cost {7 * cellBytes};
+                     candidates.push_back({id, refLevel, cost, refinementBenefit(mpiGrid[id]) / std::max(cost, (Real)1)});
+                  } else {
+                     refines += mpiGrid.refine_completely(id) && refLevel < P::amrMaxSpatialRefLevel;
+                  }
                } else if (refLevel > 0 && shouldUnrefine && coarser_neighbors > 0) {
                   // Unrefine a cell only if any of its neighbors is unrefined or about to be
                   // refLevel check prevents dont_refine() being set
                   mpiGrid.unrefine_completely(id);
+                  // Eight siblings are merged into one parent cell
+                  unrefineSavings += 0.875 * cellBytes;
                } else {
                   // Ensure no cells above both unrefine thresholds are unrefined
                   mpiGrid.dont_unrefine(id);
@@ -589,6 +714,10 @@ namespace projects {
          }
       }
 
+      if (budgeted) {
+         refines += applyRefinementBudget(mpiGrid, candidates, currentBytes, unrefineSavings);
+      }
+
       return refines;
    }
 
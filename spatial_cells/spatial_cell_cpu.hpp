@@ -91,6 +91,14 @@ namespace spatial_cell {
       Real intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk;
       Real subcycleDt;
 
+      /**< Temporary storage of velocity moments accumulated during the last acceleration mapping,
+         in the layout of blockVelocityMoments(). Consumed by calculateMoments_V().*/
+      Real mappingMoments[10];
+      Real mappingMomentsReference[3];
+      Real mappingMomentsLossCheck; /*!< RHOLOSSADJUST after mapping, block adjustment must not remove content since*/
+      bool mappingMomentsRequested = false;
+      bool mappingMomentsValid = false;
+
       // Constructor, destructor
       Population() {
          vmesh = new vmesh::VelocityMesh();
@@ -164,6 +172,13 @@ namespace spatial_cell {
          }
          return *this;
       }
+      /** Replace the velocity mesh and block data with copies of those of other. All other
+       * members, including the moments and RHOLOSSADJUST, are kept.*/
+      void copyVelocitySpace(const Population& other) {
+         *vmesh = *(other.vmesh);
+         *blockContainer = *(other.blockContainer);
+         N_blocks = vmesh->size();
+      }
       void ResizeClear(const uint newSize) {
          // Resizes the vmesh localToGlobalMap, clears the vmesh GlobalToLocalMap,
          // and resizes the velocity block container.
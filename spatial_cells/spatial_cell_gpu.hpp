@@ -281,6 +281,14 @@ __global__ static void resize_and_empty_kernel (
       Real intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk;
       Real subcycleDt;
 
+      /**< Temporary storage of velocity moments accumulated during the last acceleration mapping,
+         in the layout of blockVelocityMoments(). Consumed by calculateMoments_V().*/
+      Real mappingMoments[10];
+      Real mappingMomentsReference[3];
+      Real mappingMomentsLossCheck; /*!< RHOLOSSADJUST after mapping, block adjustment must not remove content since*/
+      bool mappingMomentsRequested = false;
+      bool mappingMomentsValid = false;
+
       // Constructor, destructor
       Population() {
          vmesh = new vmesh::VelocityMesh();
@@ -363,7 +371,9 @@ __global__ static void resize_and_empty_kernel (
          vmesh->updateCachedCapacity();
          blockContainer->updateCachedCapacity();
       }
-      const Population& operator=(const Population& other) {
+      /** Replace the velocity mesh and block data with copies of those of other. All other
+       * members, including the moments and RHOLOSSADJUST, are kept.*/
+      void copyVelocitySpace(const Population& other) {
          gpuStream_t stream = gpu_getStream();
          const vmesh::LocalID newSize = other.vmesh->size();
          ResizeClear(newSize); // Updates cached values too
@@ -382,6 +392,10 @@ __global__ static void resize_and_empty_kernel (
          #ifdef DEBUG_SPATIAL_CELL
          vmesh->check();
          #endif
+         N_blocks = newSize;
+      }
+      const Population& operator=(const Population& other) {
+         copyVelocitySpace(other);
 
          RHO = other.RHO;
          RHO_R = other.RHO_R;
@@ -389,7 +403,6 @@ __global__ static void resize_and_empty_kernel (
          RHOLOSSADJUST = other.RHOLOSSADJUST;
          velocityBlockMinValue = other.velocityBlockMinValue;
          ACCSUBCYCLES = other.ACCSUBCYCLES;
-         N_blocks = newSize;
          reservation = other.reservation;
          for (uint i=0; i<2; ++i) {
             max_dt[i] = other.max_dt[i];
@@ -45,6 +45,7 @@
    // Place block data and parameters inside splitvectors utilizing unified memory
    #include "include/splitvector/splitvec.h"
 #else
+   #include "../memoryallocation.h"
    // GPU allocation factors are stored in arch/gpu_base.hpp
    static const double BLOCK_ALLOCATION_FACTOR = 1.1;
    static const double BLOCK_ALLOCATION_PADDING = 1.3;
@@ -56,6 +57,15 @@ using namespace std;
 
 namespace vmesh {
 
+#ifndef USE_GPU
+   #ifdef USE_BLOCK_POOL
+   // Block data and parameters are drawn from the rank-wide block_pool (vlasovsolver.blockPool)
+   template <typename T, std::size_t Alignment> using block_allocator = pool_allocator<T, Alignment>;
+   #else
+   template <typename T, std::size_t Alignment> using block_allocator = aligned_allocator<T, Alignment>;
+   #endif
+#endif
+
    class VelocityBlockContainer {
    public:
 
@@ -118,8 +128,8 @@ namespace vmesh {
       size_t cachedCapacity;
       size_t cachedSize;
 #else
-      std::vector<Realf,aligned_allocator<Realf,WID3> > block_data;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters;
+      std::vector<Realf,block_allocator<Realf,WID3> > block_data;
+      std::vector<Real,block_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters;
 #endif
    };
 
@@ -130,8 +140,8 @@ namespace vmesh {
       cachedCapacity = INIT_VMESH_SIZE;
       cachedSize = 0;
 #else
-      block_data = std::vector<Realf,aligned_allocator<Realf,WID3>>(WID3);
-      parameters = std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(BlockParams::N_VELOCITY_BLOCK_PARAMS);
+      block_data = std::vector<Realf,block_allocator<Realf,WID3>>(WID3);
+      parameters = std::vector<Real,block_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(BlockParams::N_VELOCITY_BLOCK_PARAMS);
       //cachedCapacity = 1;
 #endif
       block_data.clear();
@@ -152,8 +162,8 @@ namespace vmesh {
       cachedSize = other.cachedSize;
       cachedCapacity = other.cachedCapacity;
 #else
-      block_data = std::vector<Realf,aligned_allocator<Realf,WID3>>(other.block_data);
-      parameters = std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(other.parameters);
+      block_data = std::vector<Realf,block_allocator<Realf,WID3>>(other.block_data);
+      parameters = std::vector<Real,block_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(other.parameters);
       // block_data.reserve(other.capacity()*WID3);
       // parameters.reserve(other.capacity()*BlockParams::N_VELOCITY_BLOCK_PARAMS);
 #endif
@@ -226,8 +236,8 @@ namespace vmesh {
       }
 #else
       if (shrink) {
-         block_data = std::vector<Realf,aligned_allocator<Realf,WID3>>(WID3);
-         parameters = std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(BlockParams::N_VELOCITY_BLOCK_PARAMS);
+         block_data = std::vector<Realf,block_allocator<Realf,WID3>>(WID3);
+         parameters = std::vector<Real,block_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>>(BlockParams::N_VELOCITY_BLOCK_PARAMS);
       }
 #endif
       block_data.clear();
@@ -714,8 +724,8 @@ namespace vmesh {
       cachedCapacity = newCapacity;
 #else
       // Create with larger size (capacity), then resize down to actual size
-      std::vector<Realf,aligned_allocator<Realf,WID3>> block_data_new(newCapacity*WID3);
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>> parameters_new(newCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+      std::vector<Realf,block_allocator<Realf,WID3>> block_data_new(newCapacity*WID3);
+      std::vector<Real,block_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS>> parameters_new(newCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
       block_data_new.resize(numberOfBlocks*WID3);
       parameters_new.resize(numberOfBlocks*BlockParams::N_VELOCITY_BLOCK_PARAMS);
       for (size_t i=0; i<numberOfBlocks*WID3; ++i) {
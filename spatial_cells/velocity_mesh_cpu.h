@@ -59,6 +59,7 @@ namespace vmesh {
       size_t count(const vmesh::GlobalID& globalID) const;
       vmesh::GlobalID findBlock(vmesh::GlobalID cellIndices[3]) const;
       bool getBlockCoordinates(const vmesh::GlobalID& globalID,Real coords[3]) const;
+      bool getBlockIndexExtents(vmesh::LocalID minIndices[3],vmesh::LocalID maxIndices[3]);
       void getBlockInfo(const vmesh::GlobalID& globalID,Real* array) const;
       const Real* getBlockSize() const;
       bool getBlockSize(const vmesh::GlobalID& globalID,Real size[3]) const;
@@ -75,6 +76,7 @@ namespace vmesh {
       void getIndices(const vmesh::GlobalID& globalID,vmesh::LocalID& i,vmesh::LocalID& j,vmesh::LocalID& k) const;
       size_t getMesh() const;
       vmesh::LocalID getLocalID(const vmesh::GlobalID& globalID) const;
+      void getLocalIDs(const vmesh::GlobalID* globalIDs,vmesh::LocalID* localIDs,const size_t n) const;
       vmesh::GlobalID getMaxVelocityBlocks() const;
       const Real* getMeshMaxLimits() const;
       const Real* getMeshMinLimits() const;
@@ -101,6 +103,21 @@ namespace vmesh {
       std::vector<vmesh::GlobalID> localToGlobalMap;
       OpenBucketHashtable<vmesh::GlobalID,vmesh::LocalID> globalToLocalMap;
       //std::unordered_map<vmesh::GlobalID,vmesh::LocalID> globalToLocalMap;
+
+      // Per-axis histograms of existing block indices, kept up to date by push_back,
+      // move and pop so that the bounding box of the mesh is available in O(1).
+      // Raw writes through getGrid() must be preceded by setNewSize() (or followed by
+      // setGrid()), which invalidates the histograms; they are then rebuilt on the
+      // next call to getBlockIndexExtents().
+      std::vector<vmesh::LocalID> extentCounts[3];
+      vmesh::LocalID extentMin[3];
+      vmesh::LocalID extentMax[3];
+      bool extentsValid;
+
+      void extentsAdd(const vmesh::GlobalID& globalID);
+      void extentsRebuild();
+      void extentsRemove(const vmesh::GlobalID& globalID);
+      void extentsReset();
    };
 
    // ***** DEFINITIONS OF TEMPLATE MEMBER FUNCTIONS ***** //
@@ -110,6 +127,8 @@ namespace vmesh {
       globalToLocalMap = OpenBucketHashtable<vmesh::GlobalID,vmesh::LocalID>();
       localToGlobalMap = std::vector<vmesh::GlobalID>(1);
       localToGlobalMap.clear();
+      extentsValid = false;
+      extentsReset();
    }
 
    inline VelocityMesh::~VelocityMesh() { }
@@ -123,6 +142,12 @@ namespace vmesh {
          localToGlobalMap = std::vector<vmesh::GlobalID>(1);
          localToGlobalMap.clear();
       }
+      for (int d=0; d<3; ++d) {
+         extentCounts[d] = other.extentCounts[d];
+         extentMin[d] = other.extentMin[d];
+         extentMax[d] = other.extentMax[d];
+      }
+      extentsValid = other.extentsValid;
    }
 
    inline const VelocityMesh& VelocityMesh::operator=(const VelocityMesh& other) {
@@ -134,12 +159,19 @@ namespace vmesh {
          localToGlobalMap = std::vector<vmesh::GlobalID>(1);
          localToGlobalMap.clear();
       }
+      for (int d=0; d<3; ++d) {
+         extentCounts[d] = other.extentCounts[d];
+         extentMin[d] = other.extentMin[d];
+         extentMax[d] = other.extentMax[d];
+      }
+      extentsValid = other.extentsValid;
       return *this;
    }
 
    inline size_t VelocityMesh::capacityInBytes() const {
       return localToGlobalMap.capacity()*sizeof(vmesh::GlobalID)
-           + globalToLocalMap.bucket_count()*(sizeof(vmesh::GlobalID)+sizeof(vmesh::LocalID));
+           + globalToLocalMap.bucket_count()*(sizeof(vmesh::GlobalID)+sizeof(vmesh::LocalID))
+           + (extentCounts[0].capacity()+extentCounts[1].capacity()+extentCounts[2].capacity())*sizeof(vmesh::LocalID);
    }
 
    inline bool VelocityMesh::check() const {
@@ -175,6 +207,7 @@ namespace vmesh {
          globalToLocalMap.clear();
          localToGlobalMap.clear();
       }
+      extentsReset();
    }
    inline void VelocityMesh::clearMap(const vmesh::LocalID& newSize) {
       globalToLocalMap.clear();
@@ -194,6 +227,7 @@ namespace vmesh {
       globalToLocalMap.erase(removeGID);
       localToGlobalMap.at(targetLID) = moveGID;
       localToGlobalMap.pop_back();
+      extentsRemove(removeGID);
       return true;
    }
 
@@ -250,6 +284,24 @@ namespace vmesh {
       return true;
    }
 
+   /** Get the index-space bounding box of all existing blocks.
+    * @param minIndices Smallest block index along each axis.
+    * @param maxIndices Largest block index along each axis.
+    * @return If false, the mesh is empty and the indices are not set.*/
+   inline bool VelocityMesh::getBlockIndexExtents(vmesh::LocalID minIndices[3],vmesh::LocalID maxIndices[3]) {
+      if (localToGlobalMap.size() == 0) {
+         return false;
+      }
+      if (!extentsValid) {
+         extentsRebuild();
+      }
+      for (int d=0; d<3; ++d) {
+         minIndices[d] = extentMin[d];
+         maxIndices[d] = extentMax[d];
+      }
+      return true;
+   }
+
    inline void VelocityMesh::getBlockInfo(const vmesh::GlobalID& globalID,Real* array) const {
       #ifdef DEBUG_VMESH
       if (globalID == invalidGlobalID()) {
@@ -376,6 +428,13 @@ namespace vmesh {
       return invalidLocalID();
    }
 
+   /** Batched version of getLocalID, localIDs[i] is set to the local ID of globalIDs[i] or to
+    * invalidLocalID() if the block does not exist. Faster than repeated getLocalID calls for
+    * more than a handful of blocks, as the hash table buckets are prefetched in groups.*/
+   inline void VelocityMesh::getLocalIDs(const vmesh::GlobalID* globalIDs,vmesh::LocalID* localIDs,const size_t n) const {
+      globalToLocalMap.findBatch(globalIDs,localIDs,n,invalidLocalID());
+   }
+
    inline vmesh::GlobalID VelocityMesh::getMaxVelocityBlocks() const {
       return (*vmesh::getMeshWrapper()->velocityMeshes)[meshID].max_velocity_blocks;
    }
@@ -394,6 +453,7 @@ namespace vmesh {
 
    inline bool VelocityMesh::initialize(const size_t& meshID) {
       this->meshID = meshID;
+      extentsValid = false;
       return true;
    }
 
@@ -424,6 +484,7 @@ namespace vmesh {
 
       globalToLocalMap.erase(last);
       localToGlobalMap.pop_back();
+      extentsRemove(lastGID);
    }
 
    inline bool VelocityMesh::push_back(const vmesh::GlobalID& globalID) {
@@ -439,6 +500,7 @@ namespace vmesh {
 
       if (position.second == true) {
          localToGlobalMap.push_back(globalID);
+         extentsAdd(globalID);
       }
 
       return position.second;
@@ -454,6 +516,7 @@ namespace vmesh {
 
       for (size_t b=0; b<blocks.size(); ++b) {
          globalToLocalMap.insert(std::make_pair(blocks[b],localToGlobalMap.size()+b));
+         extentsAdd(blocks[b]);
       }
       localToGlobalMap.insert(localToGlobalMap.end(),blocks.begin(),blocks.end());
 
@@ -465,6 +528,7 @@ namespace vmesh {
       for (size_t i=0; i<localToGlobalMap.size(); ++i) {
          globalToLocalMap.insert(std::make_pair(localToGlobalMap.at(i),i));
       }
+      extentsValid = false;
    }
 
    inline bool VelocityMesh::setGrid(const std::vector<vmesh::GlobalID>& globalIDs) {
@@ -474,6 +538,7 @@ namespace vmesh {
       }
       localToGlobalMap.clear();
       localToGlobalMap.insert(localToGlobalMap.end(),globalIDs.begin(),globalIDs.end());
+      extentsValid = false;
       return true;
    }
 
@@ -482,11 +547,14 @@ namespace vmesh {
          return false;
       }
       this->meshID = meshID;
+      extentsValid = false;
       return true;
    }
 
    inline void VelocityMesh::setNewSize(const vmesh::LocalID& newSize) {
       localToGlobalMap.resize(newSize);
+      // Contents of localToGlobalMap are about to be written directly by the caller
+      extentsValid = false;
    }
 
    // Used in initialization
@@ -504,6 +572,69 @@ namespace vmesh {
            + localToGlobalMap.size()*(sizeof(vmesh::GlobalID)+sizeof(vmesh::LocalID));
    }
 
+   inline void VelocityMesh::extentsAdd(const vmesh::GlobalID& globalID) {
+      if (!extentsValid) {
+         return;
+      }
+      vmesh::LocalID indices[3];
+      getIndices(globalID,indices[0],indices[1],indices[2]);
+      for (int d=0; d<3; ++d) {
+         ++extentCounts[d][indices[d]];
+         extentMin[d] = std::min(extentMin[d],indices[d]);
+         extentMax[d] = std::max(extentMax[d],indices[d]);
+      }
+   }
+
+   inline void VelocityMesh::extentsRebuild() {
+      const vmesh::LocalID* gridLength = getGridLength();
+      for (int d=0; d<3; ++d) {
+         extentCounts[d].assign(gridLength[d],0);
+      }
+      extentsValid = true;
+      extentsReset();
+      for (size_t b=0; b<localToGlobalMap.size(); ++b) {
+         extentsAdd(localToGlobalMap[b]);
+      }
+   }
+
+   inline void VelocityMesh::extentsRemove(const vmesh::GlobalID& globalID) {
+      if (!extentsValid) {
+         return;
+      }
+      if (localToGlobalMap.size() == 0) {
+         extentsReset();
+         return;
+      }
+      vmesh::LocalID indices[3];
+      getIndices(globalID,indices[0],indices[1],indices[2]);
+      for (int d=0; d<3; ++d) {
+         if (--extentCounts[d][indices[d]] > 0) {
+            continue;
+         }
+         // Last block in this plane was removed, shrink the bounds until a populated plane is found.
+         // The mesh is not empty here so both loops terminate within [extentMin,extentMax].
+         while (extentCounts[d][extentMin[d]] == 0) {
+            ++extentMin[d];
+         }
+         while (extentCounts[d][extentMax[d]] == 0) {
+            --extentMax[d];
+         }
+      }
+   }
+
+   /** Set the cached bounds to those of an empty mesh. If the histograms have been
+    * allocated they are zeroed and remain valid, otherwise they are rebuilt lazily.*/
+   inline void VelocityMesh::extentsReset() {
+      for (int d=0; d<3; ++d) {
+         std::fill(extentCounts[d].begin(),extentCounts[d].end(),0);
+         extentMin[d] = invalidBlockIndex();
+         extentMax[d] = 0;
+      }
+      if (extentCounts[0].size() == 0) {
+         extentsValid = false;
+      }
+   }
+
    // inline void VelocityMesh::swap(VelocityMesh& vm) {
    //    globalToLocalMap.swap(vm.globalToLocalMap);
    //    localToGlobalMap.swap(vm.localToGlobalMap);
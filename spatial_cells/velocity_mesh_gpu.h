@@ -67,6 +67,7 @@ namespace vmesh {
       ARCH_HOSTDEV vmesh::GlobalID findBlock(vmesh::GlobalID cellIndices[3]) const;
       ARCH_DEV vmesh::GlobalID warpFindBlock(vmesh::GlobalID cellIndices[3], const size_t b_tid) const;
       ARCH_HOSTDEV bool getBlockCoordinates(const vmesh::GlobalID globalID,Real coords[3]) const;
+      bool getBlockIndexExtents(vmesh::LocalID minIndices[3],vmesh::LocalID maxIndices[3]);
       ARCH_HOSTDEV void getBlockInfo(const vmesh::GlobalID globalID,Real* array) const;
       ARCH_HOSTDEV const Real* getBlockSize() const;
       ARCH_HOSTDEV bool getBlockSize(const vmesh::GlobalID globalID,Real size[3]) const;
@@ -84,6 +85,7 @@ namespace vmesh {
       ARCH_HOSTDEV void getIndicesZ(const vmesh::GlobalID globalID,vmesh::LocalID& k) const;
       ARCH_HOSTDEV size_t getMesh() const;
       ARCH_HOSTDEV vmesh::LocalID getLocalID(const vmesh::GlobalID globalID) const;
+      ARCH_HOSTDEV void getLocalIDs(const vmesh::GlobalID* globalIDs,vmesh::LocalID* localIDs,const size_t n) const;
       ARCH_DEV vmesh::LocalID warpGetLocalID(const vmesh::GlobalID globalID, const size_t b_tid) const;
       ARCH_HOSTDEV const Real* getMeshMaxLimits() const;
       ARCH_HOSTDEV const Real* getMeshMinLimits() const;
@@ -410,6 +412,35 @@ namespace vmesh {
       coords[2] = (*(vmesh::getMeshWrapper()->velocityMeshes))[meshID].meshMinLimits[2] + indices[2]*(*(vmesh::getMeshWrapper()->velocityMeshes))[meshID].blockSize[2];
       return true;
    }
+   /** Get the index-space bounding box of all existing blocks. Unlike the CPU mesh,
+    * the GPU mesh does not track this incrementally (blocks are added and removed
+    * from device kernels), so this is a host-side scan of the block list.
+    * @param minIndices Smallest block index along each axis.
+    * @param maxIndices Largest block index along each axis.
+    * @return If false, the mesh is empty and the indices are not set.*/
+   inline bool VelocityMesh::getBlockIndexExtents(vmesh::LocalID minIndices[3],vmesh::LocalID maxIndices[3]) {
+      const size_t nBlocks = size();
+      if (nBlocks == 0) {
+         return false;
+      }
+      gpuStream_t stream = gpu_getStream();
+      localToGlobalMap.optimizeCPU(stream);
+      CHK_ERR( gpuStreamSynchronize(stream) );
+      for (int d=0; d<3; ++d) {
+         minIndices[d] = invalidBlockIndex();
+         maxIndices[d] = 0;
+      }
+      for (size_t b=0; b<nBlocks; ++b) {
+         vmesh::LocalID indices[3];
+         getIndices(localToGlobalMap[b],indices[0],indices[1],indices[2]);
+         for (int d=0; d<3; ++d) {
+            minIndices[d] = std::min(minIndices[d],indices[d]);
+            maxIndices[d] = std::max(maxIndices[d],indices[d]);
+         }
+      }
+      return true;
+   }
+
    ARCH_HOSTDEV inline void VelocityMesh::getBlockInfo(const vmesh::GlobalID globalID, Real* array) const {
       #ifdef DEBUG_VMESH
       if (globalID == invalidGlobalID()) {
@@ -568,6 +599,13 @@ namespace vmesh {
       #endif
       return invalidLocalID();
    }
+   /** Batched getLocalID, provided for API compatibility with the CPU mesh. Lookups in the
+    * Hashinator map are already parallel, so this simply loops over getLocalID.*/
+   ARCH_HOSTDEV inline void VelocityMesh::getLocalIDs(const vmesh::GlobalID* globalIDs,vmesh::LocalID* localIDs,const size_t n) const {
+      for (size_t i=0; i<n; ++i) {
+         localIDs[i] = getLocalID(globalIDs[i]);
+      }
+   }
    ARCH_HOSTDEV inline size_t VelocityMesh::getMesh() const {
       return meshID;
    }
@@ -29,6 +29,9 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <list>
+#include <map>
+#include <memory>
 
 #include "ionosphere.h"
 #include "../projects/project.h"
@@ -39,6 +42,7 @@
 #include "../fieldtracing/fieldtracing.h"
 #include "../common.h"
 #include "../object_wrapper.h"
+#include "../mpiconversion.h"
 
 #include <Eigen/Dense>
 #include "../fieldtracing/fieldtracing.h"
@@ -81,12 +85,17 @@ namespace SBC {
    Real Ionosphere::couplingTimescale; /*!< Magnetosphere->Ionosphere coupling timescale (seconds) */
    Real Ionosphere::couplingInterval; /*!< Ionosphere update interval */
    int Ionosphere::solveCount; /*!< Counter of the number of solvings */
+   Real Ionosphere::boundaryVDFCacheTolerance = 0; /*!< Relative quantization of the boundary VDF cache key, 0 = disabled */
+   uint Ionosphere::boundaryVDFCacheSize = 0; /*!< Maximum number of cached boundary VDFs per rank */
    Real Ionosphere::backgroundIonisation; /*!< Background ionisation due to stellar UV and cosmic rays */
    int  Ionosphere::solverMaxIterations;
    Real Ionosphere::solverRelativeL2ConvergenceThreshold;
    int Ionosphere::solverMaxFailureCount;
    Real Ionosphere::solverMaxErrorGrowthFactor;
    bool Ionosphere::solverPreconditioning;
+   bool Ionosphere::solverMultigrid = false;
+   int Ionosphere::solverMultigridSmoothingSteps = 2;
+   int Ionosphere::solverMultigridCoarseSweeps = 20;
    bool Ionosphere::solverUseMinimumResidualVariant;
    bool Ionosphere::solverToggleMinimumResidualVariant;
    Real Ionosphere::shieldingLatitude;
@@ -510,6 +519,10 @@ namespace SBC {
             // Renormalize to sit on the circle
             normalizeRadius(newNode, Ionosphere::innerRadius);
 
+            // Remember where it came from, for the multigrid hierarchy
+            newNode.refLevel = parentElement.refLevel + 1;
+            newNode.parentNodes = {(int32_t)parentElement.corners[i], (int32_t)parentElement.corners[(i+1)%3]};
+
             // This node has four touching elements: the old neighbour and 3 of the new ones
             newNode.numTouchingElements = 4;
             newNode.touchingElements[0] = ne;
@@ -885,8 +898,9 @@ namespace SBC {
 
       // At restart we have SIGMAP, SIGMAH and SIGMAPARALLEL read in from the restart file already, no need to update here.
       if(!refillTensorAtRestart) {
-         // Ranks that don't participate in ionosphere solving skip this function outright
-         if(!isCouplingInwards && !isCouplingOutwards) {
+         // Ranks that don't participate in ionosphere solving skip this function outright,
+         // and only the solving rank needs the conductivities.
+         if((!isCouplingInwards && !isCouplingOutwards) || !isSolvingRank()) {
             return;
          }
 
@@ -1044,6 +1058,30 @@ namespace SBC {
 
 
 
+   // Points at which the potential of an ionosphere boundary cell is upmapped
+   // (the cell's face centres)
+   static std::array< std::array<Real, 3>, 6> cellUpmappingPoints(
+      const std::array<Real, CellParams::N_SPATIAL_CELL_PARAMS>& cellParams
+   ) {
+      const Real xmin = cellParams[CellParams::XCRD];
+      const Real ymin = cellParams[CellParams::YCRD];
+      const Real zmin = cellParams[CellParams::ZCRD];
+      const Real xmax = xmin + cellParams[CellParams::DX];
+      const Real ymax = ymin + cellParams[CellParams::DY];
+      const Real zmax = zmin + cellParams[CellParams::DZ];
+      const Real xcen = 0.5*(xmin+xmax);
+      const Real ycen = 0.5*(ymin+ymax);
+      const Real zcen = 0.5*(zmin+zmax);
+      std::array< std::array<Real, 3>, 6> tracepoints;
+      tracepoints[0] = {xmin, ycen, zcen};
+      tracepoints[1] = {xmax, ycen, zcen};
+      tracepoints[2] = {xcen, ymin, zcen};
+      tracepoints[3] = {xcen, ymax, zcen};
+      tracepoints[4] = {xcen, ycen, zmin};
+      tracepoints[5] = {xcen, ycen, zmax};
+      return tracepoints;
+   }
+
    // (Re-)create the subcommunicator for ionosphere-internal communication
    // This needs to be rerun after Vlasov grid load balancing to ensure that
    // ionosphere info is still communicated to the right ranks.
@@ -1083,6 +1121,19 @@ namespace SBC {
 
       // Make sure all tasks know which task on MPI_COMM_WORLD does the writing
       MPI_Allreduce(&writingRankInput, &writingRank, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+      // Remember where this rank upmaps the potential to, so that the solving rank
+      // only needs to send those nodes' values after each solve.
+      upmappingPoints.clear();
+      if(isCouplingOutwards) {
+         for(const auto& cell: mpiGrid.get_cells()) {
+            if(mpiGrid[cell]->sysBoundaryFlag == sysboundarytype::IONOSPHERE) {
+               const std::array< std::array<Real, 3>, 6> points = cellUpmappingPoints(mpiGrid[cell]->parameters);
+               upmappingPoints.insert(upmappingPoints.end(), points.begin(), points.end());
+            }
+         }
+      }
+      upmappingNodesRegistered = false;
    }
 
    // Calculate upmapped potential at the given coordinates,
@@ -1115,6 +1166,107 @@ namespace SBC {
       return potential;
    }
 
+   // Find the nodes this rank's upmapping points couple to, and let the solving rank know.
+   // Collective on the ionosphere communicator.
+   void SphericalTriGrid::registerUpmappingNodes() {
+      phiprof::Timer timer {"ionosphere-registerUpmappingNodes"};
+
+      // Establish the couplings now, instead of lazily in interpolateUpmappedPotential()
+      std::vector< std::array<std::pair<int, Real>, 3> > couplings(upmappingPoints.size());
+      #pragma omp parallel for schedule(dynamic)
+      for(uint i=0; i<upmappingPoints.size(); i++) {
+         bool known;
+         #pragma omp critical(coupling)
+         {
+            auto it = vlasovGridCoupling.find(upmappingPoints[i]);
+            known = (it != vlasovGridCoupling.end());
+            if(known) {
+               couplings[i] = it->second;
+            }
+         }
+         if(!known) {
+            couplings[i] = FieldTracing::calculateIonosphereVlasovGridCoupling(upmappingPoints[i], nodes, Ionosphere::radius);
+            #pragma omp critical(coupling)
+            {
+               vlasovGridCoupling[upmappingPoints[i]] = couplings[i];
+            }
+         }
+      }
+
+      // The solving rank has all node values anyway.
+      std::set<uint32_t> neededNodes;
+      if(!isSolvingRank()) {
+         for(const auto& coupling : couplings) {
+            for(int c=0; c<3; c++) {
+               if(coupling[c].first >= 0 && coupling[c].first < (int)nodes.size()) {
+                  neededNodes.insert(coupling[c].first);
+               }
+            }
+         }
+      }
+      std::vector<uint32_t> ownNodes(neededNodes.begin(), neededNodes.end());
+      int ownCount = ownNodes.size();
+
+      int size;
+      MPI_Comm_size(communicator, &size);
+      upmappingNodeCounts.assign(size, 0);
+      upmappingNodeOffsets.assign(size, 0);
+      MPI_Gather(&ownCount, 1, MPI_INT, upmappingNodeCounts.data(), 1, MPI_INT, solvingRank, communicator);
+      int totalCount = 0;
+      if(isSolvingRank()) {
+         for(int r=0; r<size; r++) {
+            upmappingNodeOffsets[r] = totalCount;
+            totalCount += upmappingNodeCounts[r];
+         }
+      }
+      std::vector<uint32_t> allNodes(totalCount);
+      MPI_Gatherv(ownNodes.data(), ownCount, MPI_UINT32_T, allNodes.data(), upmappingNodeCounts.data(), upmappingNodeOffsets.data(), MPI_UINT32_T, solvingRank, communicator);
+
+      if(isSolvingRank()) {
+         upmappingNodes.swap(allNodes);
+      } else {
+         upmappingNodes.swap(ownNodes);
+      }
+      upmappingNodesRegistered = true;
+   }
+
+   // Send the solved potential from the solving rank to the nodes that other ranks upmap,
+   // along with the solver status (iterations, restarts, residual and potential extrema).
+   // Collective on the ionosphere communicator.
+   void SphericalTriGrid::scatterPotential(std::array<Real, 7>& solverStatus) {
+      if(communicator == MPI_COMM_NULL) {
+         return;
+      }
+      phiprof::Timer timer {"ionosphere-scatterPotential"};
+
+      MPI_Bcast(solverStatus.data(), solverStatus.size(), MPI_Type<Real>(), solvingRank, communicator);
+
+      // Without a dipole field, nothing can be upmapped yet (see interpolateUpmappedPotential())
+      if(!this->dipoleField) {
+         return;
+      }
+      if(!upmappingNodesRegistered) {
+         registerUpmappingNodes();
+      }
+
+      std::vector<double> sendBuffer;
+      if(isSolvingRank()) {
+         sendBuffer.resize(upmappingNodes.size());
+         for(uint i=0; i<upmappingNodes.size(); i++) {
+            sendBuffer[i] = nodes[upmappingNodes[i]].parameters[ionosphereParameters::SOLUTION];
+         }
+      }
+      std::vector<double> receiveBuffer(isSolvingRank() ? 0 : upmappingNodes.size());
+      MPI_Scatterv(sendBuffer.data(), upmappingNodeCounts.data(), upmappingNodeOffsets.data(), MPI_DOUBLE,
+                   receiveBuffer.data(), receiveBuffer.size(), MPI_DOUBLE, solvingRank, communicator);
+
+      if(!isSolvingRank()) {
+         for(uint i=0; i<upmappingNodes.size(); i++) {
+            nodes[upmappingNodes[i]].parameters[ionosphereParameters::SOLUTION] = receiveBuffer[i];
+         }
+      }
+   }
+
    // Transport field-aligned currents down from the simulation cells to the ionosphere
    void SphericalTriGrid::mapDownBoundaryData(
        FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, FS_STENCIL_WIDTH> & perBGrid,
@@ -1246,13 +1398,54 @@ namespace SBC {
          }
       }
 
-      // Allreduce on the ionosphere communicator
+      // Gather the coupled values on the solving rank. Every rank only couples a
+      // small part of the nodes, so only send the nodes that were touched.
+      phiprof::Timer gatherTimer {"ionosphere-gatherCoupling"};
+      std::vector<uint32_t> sendNodes;
+      std::vector<double> sendValues;
+      for(uint n=0; n<nodes.size(); n++) {
+         if(FACinput[n] != 0 || rhoInput[n] != 0 || temperatureInput[n] != 0) {
+            sendNodes.push_back(n);
+            sendValues.push_back(FACinput[n]);
+            sendValues.push_back(rhoInput[n]);
+            sendValues.push_back(temperatureInput[n]);
+         }
+      }
+      int sendCount = sendNodes.size();
+
+      int size;
+      MPI_Comm_size(communicator, &size);
+      std::vector<int> nodeCounts(size), nodeOffsets(size), valueCounts(size), valueOffsets(size);
+      MPI_Gather(&sendCount, 1, MPI_INT, nodeCounts.data(), 1, MPI_INT, solvingRank, communicator);
+      int totalCount = 0;
+      if(isSolvingRank()) {
+         for(int r=0; r<size; r++) {
+            nodeOffsets[r] = totalCount;
+            valueCounts[r] = 3 * nodeCounts[r];
+            valueOffsets[r] = 3 * totalCount;
+            totalCount += nodeCounts[r];
+         }
+      }
+      std::vector<uint32_t> receiveNodes(totalCount);
+      std::vector<double> receiveValues(3 * totalCount);
+      MPI_Gatherv(sendNodes.data(), sendCount, MPI_UINT32_T, receiveNodes.data(), nodeCounts.data(), nodeOffsets.data(), MPI_UINT32_T, solvingRank, communicator);
+      MPI_Gatherv(sendValues.data(), 3 * sendCount, MPI_DOUBLE, receiveValues.data(), valueCounts.data(), valueOffsets.data(), MPI_DOUBLE, solvingRank, communicator);
+      gatherTimer.stop();
+
+      // Only the solving rank keeps the ionosphere state up to date.
+      if(!isSolvingRank()) {
+         return;
+      }
+
       std::vector<double> FACsum(nodes.size());
       std::vector<double> rhoSum(nodes.size());
       std::vector<double> temperatureSum(nodes.size());
-      MPI_Allreduce(&FACinput[0], &FACsum[0], nodes.size(), MPI_DOUBLE, MPI_SUM, communicator);
-      MPI_Allreduce(&rhoInput[0], &rhoSum[0], nodes.size(), MPI_DOUBLE, MPI_SUM, communicator);
-      MPI_Allreduce(&temperatureInput[0], &temperatureSum[0], nodes.size(), MPI_DOUBLE, MPI_SUM, communicator); // TODO: Does it make sense to SUM the temperatures?
+      for(int i=0; i<totalCount; i++) {
+         const uint32_t n = receiveNodes[i];
+         FACsum[n] += receiveValues[3*i];
+         rhoSum[n] += receiveValues[3*i+1];
+         temperatureSum[n] += receiveValues[3*i+2]; // TODO: Does it make sense to SUM the temperatures?
+      }
 
       for(uint n=0; n<nodes.size(); n++) {
 
@@ -1673,6 +1866,15 @@ namespace SBC {
        addAllMatrixDependencies(n);
      }
 
+     assembleSolverMatrix();
+     if(Ionosphere::solverMultigrid) {
+        // The mesh topology only changes at initialization, the coarse operators change with the conductivity.
+        if(multigridLevels.size() == 0 || multigridLevels.back().nodeIndices.size() != nodes.size()) {
+           buildMultigridHierarchy();
+        }
+        assembleMultigridOperators();
+     }
+
      //cerr << "(ionosphere) Solver dependency matrix: " << endl;
      //for(uint n=0; n<nodes.size(); n++) {
      //   for(uint m=0; m<nodes.size(); m++) {
@@ -1697,8 +1899,16 @@ namespace SBC {
    // -> "A times parameter"
    iSolverReal SphericalTriGrid::Atimes(uint nodeIndex, int parameter, bool transpose) {
      iSolverReal retval=0;
-     Node& n = nodes[nodeIndex];
 
+     if(solverMatrix.size() == nodes.size()) {
+        const std::vector<iSolverReal>& values = transpose ? solverMatrix.transposedValues : solverMatrix.values;
+        for(uint k=solverMatrix.rowStart[nodeIndex]; k<solverMatrix.rowStart[nodeIndex+1]; k++) {
+           retval += nodes[solverMatrix.columns[k]].parameters[parameter] * values[k];
+        }
+        return retval;
+     }
+
+     Node& n = nodes[nodeIndex];
      if(transpose) {
         for(uint i=0; i<n.numDepNodes; i++) {
            retval += nodes[n.dependingNodes[i]].parameters[parameter] * n.transposedCoeffs[i];
@@ -1720,6 +1930,9 @@ namespace SBC {
 
      if(Ionosphere::solverPreconditioning) {
         // Find this nodes' selfcoupling coefficient
+        if(solverMatrix.size() == nodes.size()) {
+           return n.parameters[parameter] / (transpose ? solverMatrix.transposedDiagonal[nodeIndex] : solverMatrix.diagonal[nodeIndex]);
+        }
         if(transpose) {
            return n.parameters[parameter] / n.transposedCoeffs[0];
         } else {
@@ -1730,6 +1943,325 @@ namespace SBC {
      }
    }
 
+   // Gather the node dependency lists into compressed sparse row form.
+   // Entries keep the order of the dependency lists, so that matrix-vector
+   // products sum up in the same order as before.
+   void SphericalTriGrid::assembleSolverMatrix() {
+
+      phiprof::Timer timer {"ionosphere-assembleSolverMatrix"};
+      SolverMatrix& M = solverMatrix;
+      M.rowStart.resize(nodes.size()+1);
+      M.rowStart[0] = 0;
+      for(uint n=0; n<nodes.size(); n++) {
+         M.rowStart[n+1] = M.rowStart[n] + nodes[n].numDepNodes;
+      }
+      M.columns.resize(M.rowStart.back());
+      M.values.resize(M.rowStart.back());
+      M.transposedValues.resize(M.rowStart.back());
+      M.diagonal.resize(nodes.size());
+      M.transposedDiagonal.resize(nodes.size());
+
+      #pragma omp parallel for
+      for(uint n=0; n<nodes.size(); n++) {
+         const Node& N = nodes[n];
+         M.diagonal[n] = M.transposedDiagonal[n] = 0;
+         for(uint d=0; d<N.numDepNodes; d++) {
+            const uint k = M.rowStart[n] + d;
+            M.columns[k] = N.dependingNodes[d];
+            M.values[k] = N.dependingCoeffs[d];
+            M.transposedValues[k] = N.transposedCoeffs[d];
+            if(N.dependingNodes[d] == n) {
+               M.diagonal[n] = N.dependingCoeffs[d];
+               M.transposedDiagonal[n] = N.transposedCoeffs[d];
+            }
+         }
+      }
+   }
+
+   // Set up the levels of the multigrid preconditioner from the mesh refinement
+   // hierarchy. Level l consists of all nodes with refLevel <= l. Nodes that
+   // exist on the coarser level are injected, nodes inserted on an edge are
+   // linearly interpolated from the two edge end nodes. Restriction is the
+   // transpose of the prolongation.
+   // A spherical fibonacci base mesh without refinement only yields a single
+   // level, in which case the V-cycle reduces to damped Jacobi sweeps.
+   void SphericalTriGrid::buildMultigridHierarchy() {
+
+      phiprof::Timer timer {"ionosphere-buildMultigridHierarchy"};
+      int maxLevel = 0;
+      for(uint n=0; n<nodes.size(); n++) {
+         maxLevel = max(maxLevel, nodes[n].refLevel);
+      }
+
+      multigridLevels.clear();
+      multigridLevels.resize(maxLevel+1);
+
+      std::vector<int32_t> localIndex(nodes.size(), -1);
+      std::vector<int32_t> coarseIndex(nodes.size(), -1);
+      for(int l=0; l<=maxLevel; l++) {
+         MultigridLevel& L = multigridLevels[l];
+         for(uint n=0; n<nodes.size(); n++) {
+            if(nodes[n].refLevel <= l) {
+               localIndex[n] = L.nodeIndices.size();
+               L.nodeIndices.push_back(n);
+            }
+         }
+         const uint size = L.nodeIndices.size();
+         L.b.resize(size);
+         L.x.resize(size);
+         L.r.resize(size);
+         L.tmp.resize(size);
+
+         if(l > 0) {
+            const MultigridLevel& C = multigridLevels[l-1];
+            L.prolongationNodes.resize(size);
+            L.prolongationWeights.resize(size);
+            std::vector<uint32_t> restrictionCount(C.nodeIndices.size(), 0);
+            for(uint i=0; i<size; i++) {
+               const Node& N = nodes[L.nodeIndices[i]];
+               if(N.refLevel < l) {
+                  L.prolongationNodes[i] = {coarseIndex[L.nodeIndices[i]], -1};
+                  L.prolongationWeights[i] = {1., 0.};
+               } else {
+                  L.prolongationNodes[i] = {coarseIndex[N.parentNodes[0]], coarseIndex[N.parentNodes[1]]};
+                  L.prolongationWeights[i] = {0.5, 0.5};
+               }
+               for(int p=0; p<2; p++) {
+                  if(L.prolongationNodes[i][p] >= 0) {
+                     restrictionCount[L.prolongationNodes[i][p]]++;
+                  }
+               }
+            }
+
+            L.restrictionStart.resize(C.nodeIndices.size()+1);
+            L.restrictionStart[0] = 0;
+            for(uint j=0; j<C.nodeIndices.size(); j++) {
+               L.restrictionStart[j+1] = L.restrictionStart[j] + restrictionCount[j];
+               restrictionCount[j] = L.restrictionStart[j];
+            }
+            L.restrictionNodes.resize(L.restrictionStart.back());
+            L.restrictionWeights.resize(L.restrictionStart.back());
+            for(uint i=0; i<size; i++) {
+               for(int p=0; p<2; p++) {
+                  const int32_t j = L.prolongationNodes[i][p];
+                  if(j >= 0) {
+                     L.restrictionNodes[restrictionCount[j]] = i;
+                     L.restrictionWeights[restrictionCount[j]] = L.prolongationWeights[i][p];
+                     restrictionCount[j]++;
+                  }
+               }
+            }
+         }
+         coarseIndex.swap(localIndex);
+         std::fill(localIndex.begin(), localIndex.end(), -1);
+      }
+
+      logFile << "(IONOSPHERE) Multigrid preconditioner with " << multigridLevels.size() << " levels, coarsest level has "
+         << multigridLevels[0].nodeIndices.size() << " nodes." << endl << write;
+   }
+
+   // Coarsest multigrid levels up to this size are solved directly
+   static const uint multigridDirectSolveMaxNodes = 512;
+
+   // Compute the coarse level operators A_c = R A P (and the same for the transposed
+   // matrix), starting from the finest level solver matrix.
+   void SphericalTriGrid::assembleMultigridOperators() {
+
+      phiprof::Timer timer {"ionosphere-assembleMultigridOperators"};
+      for(int l=multigridLevels.size()-1; l>0; l--) {
+         MultigridLevel& F = multigridLevels[l];
+         const SolverMatrix& A = (l == (int)multigridLevels.size()-1) ? solverMatrix : F.A;
+         SolverMatrix& Ac = multigridLevels[l-1].A;
+         const uint coarseSize = multigridLevels[l-1].nodeIndices.size();
+
+         std::vector< std::map<uint32_t, std::array<iSolverReal,2>> > rows(coarseSize);
+         #pragma omp parallel for schedule(dynamic,64)
+         for(uint j=0; j<coarseSize; j++) {
+            std::map<uint32_t, std::array<iSolverReal,2>>& row = rows[j];
+            for(uint q=F.restrictionStart[j]; q<F.restrictionStart[j+1]; q++) {
+               const uint i = F.restrictionNodes[q];
+               const iSolverReal wr = F.restrictionWeights[q];
+               for(uint k=A.rowStart[i]; k<A.rowStart[i+1]; k++) {
+                  const uint c = A.columns[k];
+                  for(int p=0; p<2; p++) {
+                     const int32_t J = F.prolongationNodes[c][p];
+                     if(J >= 0) {
+                        std::array<iSolverReal,2>& entry = row[J];
+                        entry[0] += wr * A.values[k] * F.prolongationWeights[c][p];
+                        entry[1] += wr * A.transposedValues[k] * F.prolongationWeights[c][p];
+                     }
+                  }
+               }
+            }
+         }
+
+         Ac.rowStart.resize(coarseSize+1);
+         Ac.rowStart[0] = 0;
+         for(uint j=0; j<coarseSize; j++) {
+            Ac.rowStart[j+1] = Ac.rowStart[j] + rows[j].size();
+         }
+         Ac.columns.resize(Ac.rowStart.back());
+         Ac.values.resize(Ac.rowStart.back());
+         Ac.transposedValues.resize(Ac.rowStart.back());
+         Ac.diagonal.resize(coarseSize);
+         Ac.transposedDiagonal.resize(coarseSize);
+         #pragma omp parallel for
+         for(uint j=0; j<coarseSize; j++) {
+            uint k = Ac.rowStart[j];
+            Ac.diagonal[j] = Ac.transposedDiagonal[j] = 1;
+            for(const auto& entry : rows[j]) {
+               Ac.columns[k] = entry.first;
+               Ac.values[k] = entry.second[0];
+               Ac.transposedValues[k] = entry.second[1];
+               if(entry.first == j) {
+                  Ac.diagonal[j] = entry.second[0];
+                  Ac.transposedDiagonal[j] = entry.second[1];
+               }
+               k++;
+            }
+         }
+      }
+
+      // Small coarsest levels (e.g. an icosahedron base) are inverted outright, using
+      // the pseudoinverse to stay finite for gauge fixing modes that leave the matrix singular.
+      MultigridLevel& C = multigridLevels[0];
+      const uint coarseSize = C.nodeIndices.size();
+      if(multigridLevels.size() > 1 && coarseSize <= multigridDirectSolveMaxNodes) {
+         Eigen::MatrixXd dense = Eigen::MatrixXd::Zero(coarseSize, coarseSize);
+         Eigen::MatrixXd denseTransposed = Eigen::MatrixXd::Zero(coarseSize, coarseSize);
+         for(uint j=0; j<coarseSize; j++) {
+            for(uint k=C.A.rowStart[j]; k<C.A.rowStart[j+1]; k++) {
+               dense(j, C.A.columns[k]) = C.A.values[k];
+               denseTransposed(j, C.A.columns[k]) = C.A.transposedValues[k];
+            }
+         }
+         const Eigen::MatrixXd inverse = dense.completeOrthogonalDecomposition().pseudoInverse();
+         const Eigen::MatrixXd inverseTransposed = denseTransposed.completeOrthogonalDecomposition().pseudoInverse();
+         C.coarseInverse.resize(coarseSize*coarseSize);
+         C.coarseInverseTransposed.resize(coarseSize*coarseSize);
+         for(uint j=0; j<coarseSize; j++) {
+            for(uint i=0; i<coarseSize; i++) {
+               C.coarseInverse[j*coarseSize + i] = inverse(j,i);
+               C.coarseInverseTransposed[j*coarseSize + i] = inverseTransposed(j,i);
+            }
+         }
+      } else {
+         C.coarseInverse.clear();
+         C.coarseInverseTransposed.clear();
+      }
+   }
+
+   // Damped Jacobi sweeps on one multigrid level, x <- x + omega D^-1 (b - A x)
+   // Called from within a parallel region.
+   void SphericalTriGrid::multigridSmooth(uint level, bool transpose, int sweeps) {
+      const iSolverReal omega = 2./3.;
+      MultigridLevel& L = multigridLevels[level];
+      const SolverMatrix& A = (level == multigridLevels.size()-1) ? solverMatrix : L.A;
+      const std::vector<iSolverReal>& values = transpose ? A.transposedValues : A.values;
+      const std::vector<iSolverReal>& diagonal = transpose ? A.transposedDiagonal : A.diagonal;
+
+      for(int s=0; s<sweeps; s++) {
+         #pragma omp for
+         for(uint i=0; i<L.x.size(); i++) {
+            iSolverReal Ax = 0;
+            for(uint k=A.rowStart[i]; k<A.rowStart[i+1]; k++) {
+               Ax += values[k] * L.x[A.columns[k]];
+            }
+            L.tmp[i] = L.x[i] + omega * (L.b[i] - Ax) / diagonal[i];
+         }
+         #pragma omp single
+         {
+            L.x.swap(L.tmp);
+         }
+      }
+   }
+
+   // Approximately solve A x = b on the given level, starting from x = 0.
+   // The same number of pre- and post-smoothing sweeps together with R = P^T keep the
+   // V-cycle for the transposed matrix the transpose of the V-cycle for A, as the
+   // biconjugate gradient solver requires.
+   void SphericalTriGrid::multigridVCycle(uint level, bool transpose) {
+      MultigridLevel& L = multigridLevels[level];
+
+      if(level == 0 && L.coarseInverse.size() > 0) {
+         const std::vector<iSolverReal>& inverse = transpose ? L.coarseInverseTransposed : L.coarseInverse;
+         const uint size = L.x.size();
+         #pragma omp for
+         for(uint j=0; j<size; j++) {
+            iSolverReal sum = 0;
+            for(uint i=0; i<size; i++) {
+               sum += inverse[j*size + i] * L.b[i];
+            }
+            L.x[j] = sum;
+         }
+         return;
+      }
+
+      #pragma omp for
+      for(uint i=0; i<L.x.size(); i++) {
+         L.x[i] = 0;
+      }
+
+      if(level == 0) {
+         multigridSmooth(level, transpose, Ionosphere::solverMultigridCoarseSweeps);
+         return;
+      }
+
+      multigridSmooth(level, transpose, Ionosphere::solverMultigridSmoothingSteps);
+
+      // Residual, restricted onto the coarser level
+      const SolverMatrix& A = (level == multigridLevels.size()-1) ? solverMatrix : L.A;
+      const std::vector<iSolverReal>& values = transpose ? A.transposedValues : A.values;
+      #pragma omp for
+      for(uint i=0; i<L.x.size(); i++) {
+         iSolverReal Ax = 0;
+         for(uint k=A.rowStart[i]; k<A.rowStart[i+1]; k++) {
+            Ax += values[k] * L.x[A.columns[k]];
+         }
+         L.r[i] = L.b[i] - Ax;
+      }
+      MultigridLevel& C = multigridLevels[level-1];
+      #pragma omp for
+      for(uint j=0; j<C.b.size(); j++) {
+         iSolverReal sum = 0;
+         for(uint q=L.restrictionStart[j]; q<L.restrictionStart[j+1]; q++) {
+            sum += L.restrictionWeights[q] * L.r[L.restrictionNodes[q]];
+         }
+         C.b[j] = sum;
+      }
+
+      multigridVCycle(level-1, transpose);
+
+      // Prolongate the coarse correction
+      #pragma omp for
+      for(uint i=0; i<L.x.size(); i++) {
+         for(int p=0; p<2; p++) {
+            if(L.prolongationNodes[i][p] >= 0) {
+               L.x[i] += L.prolongationWeights[i][p] * C.x[L.prolongationNodes[i][p]];
+            }
+         }
+      }
+
+      multigridSmooth(level, transpose, Ionosphere::solverMultigridSmoothingSteps);
+   }
+
+   // Multigrid preconditioner: toParameter = M^-1 fromParameter
+   // Has to be called by all threads of a parallel region (or outside of one).
+   void SphericalTriGrid::multigridPrecondition(int fromParameter, int toParameter, bool transpose) {
+      MultigridLevel& L = multigridLevels.back();
+      #pragma omp for
+      for(uint n=0; n<nodes.size(); n++) {
+         L.b[n] = nodes[n].parameters[fromParameter];
+      }
+
+      multigridVCycle(multigridLevels.size()-1, transpose);
+
+      #pragma omp for
+      for(uint n=0; n<nodes.size(); n++) {
+         nodes[n].parameters[toParameter] = L.x[n];
+      }
+   }
+
    // Solve the ionosphere potential using a conjugate gradient solver
    void SphericalTriGrid::solve(
       int &nIterations,
@@ -1757,17 +2289,30 @@ namespace SBC {
 
       phiprof::Timer timer {"ionosphere-solve"};
 
-      initSolver(false);
-
       nIterations = 0;
       nRestarts = 0;
 
-      do {
-         solveInternal(nIterations, nRestarts, residual, minPotentialN, maxPotentialN, minPotentialS, maxPotentialS);
-         if(Ionosphere::solverToggleMinimumResidualVariant) {
-            Ionosphere::solverUseMinimumResidualVariant = !Ionosphere::solverUseMinimumResidualVariant;
-         }
-      } while (residual > Ionosphere::solverRelativeL2ConvergenceThreshold && nIterations < Ionosphere::solverMaxIterations);
+      // Only the solving rank has the downmapped data, the others just receive the potential they upmap.
+      if(isSolvingRank()) {
+         initSolver(false);
+
+         do {
+            solveInternal(nIterations, nRestarts, residual, minPotentialN, maxPotentialN, minPotentialS, maxPotentialS);
+            if(Ionosphere::solverToggleMinimumResidualVariant) {
+               Ionosphere::solverUseMinimumResidualVariant = !Ionosphere::solverUseMinimumResidualVariant;
+            }
+         } while (residual > Ionosphere::solverRelativeL2ConvergenceThreshold && nIterations < Ionosphere::solverMaxIterations);
+      }
+
+      std::array<Real, 7> solverStatus {(Real)nIterations, (Real)nRestarts, residual, minPotentialN, maxPotentialN, minPotentialS, maxPotentialS};
+      scatterPotential(solverStatus);
+      nIterations = solverStatus[0];
+      nRestarts = solverStatus[1];
+      residual = solverStatus[2];
+      minPotentialN = solverStatus[3];
+      maxPotentialN = solverStatus[4];
+      minPotentialS = solverStatus[5];
+      maxPotentialS = solverStatus[6];
    }
 
    void SphericalTriGrid::solveInternal(
@@ -1871,20 +2416,28 @@ namespace SBC {
          skipSolve = true;
       }
 
-      #pragma omp for
-      for(uint n=0; n<nodes.size(); n++) {
-         Node& N=nodes[n];
-         N.parameters.at(ionosphereParameters::ZPARAM) = Asolve(n,ionosphereParameters::RESIDUAL, false);
+      if(Ionosphere::solverMultigrid) {
+         multigridPrecondition(ionosphereParameters::RESIDUAL, ionosphereParameters::ZPARAM, false);
+      } else {
+         #pragma omp for
+         for(uint n=0; n<nodes.size(); n++) {
+            Node& N=nodes[n];
+            N.parameters.at(ionosphereParameters::ZPARAM) = Asolve(n,ionosphereParameters::RESIDUAL, false);
+         }
       }
 
       while(!skipSolve && thread_iteration < Ionosphere::solverMaxIterations) {
          thread_iteration++;
          counter++;
 
-         #pragma omp for
-         for(uint n=0; n<nodes.size(); n++) {
-            Node& N=nodes[n];
-            N.parameters[ionosphereParameters::ZZPARAM] = Asolve(n,ionosphereParameters::RRESIDUAL, true);
+         if(Ionosphere::solverMultigrid) {
+            multigridPrecondition(ionosphereParameters::RRESIDUAL, ionosphereParameters::ZZPARAM, true);
+         } else {
+            #pragma omp for
+            for(uint n=0; n<nodes.size(); n++) {
+               Node& N=nodes[n];
+               N.parameters[ionosphereParameters::ZZPARAM] = Asolve(n,ionosphereParameters::RRESIDUAL, true);
+            }
          }
 
          // Calculate bk and gradient vector p
@@ -2115,10 +2668,14 @@ namespace SBC {
          }
 #endif
 
-         #pragma omp for
-         for(uint n=0; n<nodes.size(); n++) {
-            Node& N=nodes[n];
-            N.parameters[ionosphereParameters::ZPARAM] = Asolve(n, ionosphereParameters::RESIDUAL, false);
+         if(Ionosphere::solverMultigrid) {
+            multigridPrecondition(ionosphereParameters::RESIDUAL, ionosphereParameters::ZPARAM, false);
+         } else {
+            #pragma omp for
+            for(uint n=0; n<nodes.size(); n++) {
+               Node& N=nodes[n];
+               N.parameters[ionosphereParameters::ZPARAM] = Asolve(n, ionosphereParameters::RESIDUAL, false);
+            }
          }
 
          // See if this solved the potential better than before
@@ -2223,6 +2780,9 @@ namespace SBC {
       Readparameters::add("ionosphere.solverGaugeFixing", "Gauge fixing method of the ionosphere solver. Options are: pole, integral, equator", std::string("equator"));
       Readparameters::add("ionosphere.shieldingLatitude", "Latitude below which the potential is set to zero in the equator gauge fixing scheme (degree)", 70);
       Readparameters::add("ionosphere.solverPreconditioning", "Use preconditioning for the solver? (0/1)", 1);
+      Readparameters::add("ionosphere.solverMultigrid", "Precondition the solver with a geometric multigrid V-cycle over the mesh refinement levels instead of the matrix diagonal? (0/1)", 0);
+      Readparameters::add("ionosphere.solverMultigridSmoothingSteps", "Number of damped Jacobi sweeps before and after each multigrid coarse grid correction", 2);
+      Readparameters::add("ionosphere.solverMultigridCoarseSweeps", "Number of damped Jacobi sweeps on the coarsest multigrid level, if it is too large to be inverted directly", 20);
       Readparameters::add("ionosphere.solverUseMinimumResidualVariant", "Use minimum residual variant", 0);
       Readparameters::add("ionosphere.solverToggleMinimumResidualVariant", "Toggle use of minimum residual variant at every solver restart", 0);
       Readparameters::add("ionosphere.earthAngularVelocity", "Angular velocity of inner boundary convection, in rad/s", 7.2921159e-5);
@@ -2232,6 +2792,8 @@ namespace SBC {
       Readparameters::add("ionosphere.unmappedNodeTe", "Electron temperature of ionosphere nodes that do not connect to the magnetosphere domain.", 1e6);
       Readparameters::add("ionosphere.couplingTimescale", "Magnetosphere->Ionosphere coupling timescale (seconds, 0=immediate coupling", 1.);
       Readparameters::add("ionosphere.couplingInterval", "Time interval at which the ionosphere is solved (seconds)", 0);
+      Readparameters::add("ionosphere.boundaryVDFCacheTolerance", "Relative tolerance to which density, temperature, drift velocity (in thermal speeds) and sparsity threshold must match for a Maxwellian inner boundary VDF to be copied from a previously generated one instead of being regenerated. 0 (default) disables the cache.", 0.0);
+      Readparameters::add("ionosphere.boundaryVDFCacheSize", "Maximum number of Maxwellian inner boundary VDFs cached per MPI rank, least recently used ones are evicted.", 64);
 
       // Per-population parameters
       for(uint i=0; i< getObjectWrapper().particleSpecies.size(); i++) {
@@ -2304,12 +2866,17 @@ namespace SBC {
       }
       Readparameters::get("ionosphere.shieldingLatitude", shieldingLatitude);
       Readparameters::get("ionosphere.solverPreconditioning", solverPreconditioning);
+      Readparameters::get("ionosphere.solverMultigrid", solverMultigrid);
+      Readparameters::get("ionosphere.solverMultigridSmoothingSteps", solverMultigridSmoothingSteps);
+      Readparameters::get("ionosphere.solverMultigridCoarseSweeps", solverMultigridCoarseSweeps);
       Readparameters::get("ionosphere.solverUseMinimumResidualVariant", solverUseMinimumResidualVariant);
       Readparameters::get("ionosphere.solverToggleMinimumResidualVariant", solverToggleMinimumResidualVariant);
       Readparameters::get("ionosphere.earthAngularVelocity", earthAngularVelocity);
       Readparameters::get("ionosphere.plasmapauseL", plasmapauseL);
       Readparameters::get("ionosphere.couplingTimescale",couplingTimescale);
       Readparameters::get("ionosphere.couplingInterval", couplingInterval);
+      Readparameters::get("ionosphere.boundaryVDFCacheTolerance", boundaryVDFCacheTolerance);
+      Readparameters::get("ionosphere.boundaryVDFCacheSize", boundaryVDFCacheSize);
       Readparameters::get("ionosphere.downmapRadius",downmapRadius);
       if(downmapRadius < 1000.) {
          downmapRadius *= physicalconstants::R_E;
@@ -3056,6 +3623,7 @@ namespace SBC {
       // Get potential upmapped from six points
       // (Cell's face centres)
       // inside the cell to calculate E
+      const std::array< std::array<Real, 3>, 6> tracepoints = cellUpmappingPoints(cellParams);
       const Real xmin = cellParams[CellParams::XCRD];
       const Real ymin = cellParams[CellParams::YCRD];
       const Real zmin = cellParams[CellParams::ZCRD];
@@ -3065,13 +3633,6 @@ namespace SBC {
       const Real xcen = 0.5*(xmin+xmax);
       const Real ycen = 0.5*(ymin+ymax);
       const Real zcen = 0.5*(zmin+zmax);
-      std::array< std::array<Real, 3>, 6> tracepoints;
-      tracepoints[0] = {xmin, ycen, zcen};
-      tracepoints[1] = {xmax, ycen, zcen};
-      tracepoints[2] = {xcen, ymin, zcen};
-      tracepoints[3] = {xcen, ymax, zcen};
-      tracepoints[4] = {xcen, ycen, zmin};
-      tracepoints[5] = {xcen, ycen, zmax};
       std::array<Real, 6> potentials;
        for(int i=0; i<6; i++) {
          // Get potential at each of these 6 points
@@ -3106,6 +3667,208 @@ namespace SBC {
       cellParams[CellParams::BULKV_FORCING_Z] = (E[0] * B[1] - E[1] * B[0])/Bsqr;
    }
 
+   /*! A VDF in the boundary VDF cache: the population after block adjustment, and the
+    * particle number the adjustment removed when it was generated.
+    */
+   struct CachedVDF {
+      CachedVDF(const spatial_cell::Population& population, creal pruningLoss): population(population), pruningLoss(pruningLoss) { }
+
+      const spatial_cell::Population population;
+      const Real pruningLoss;
+   };
+
+   /*! Per-rank LRU cache of the Maxwellian VDFs generated by Ionosphere::fillMaxwellianVDF.
+    * Many boundary cells end up with nearly identical moments, so a VDF whose key matches a
+    * cached one is copied instead of regenerated. Accessed from within OpenMP loops.
+    */
+   class BoundaryVDFCache {
+   public:
+      /*! Population, quantized log density, log temperature, drift velocity (in units of the
+       * thermal speed) and log sparsity threshold. */
+      typedef std::array<int64_t, 7> Key;
+
+      BoundaryVDFCache(): hits(0), misses(0), evictions(0) { }
+
+      /*! Build the cache key of a Maxwellian VDF, returns false if the moments cannot be keyed. */
+      static bool makeKey(const uint popID, creal rho, creal T, const std::array<Real, 3>& V, creal minValue, Key& key) {
+         creal tolerance = Ionosphere::boundaryVDFCacheTolerance;
+         if (!(rho > 0) || !(T > 0) || !(minValue > 0) || !std::isfinite(rho) || !std::isfinite(T)) {
+            return false;
+         }
+         key[0] = popID;
+         key[1] = std::llround(log(rho) / tolerance);
+         key[2] = std::llround(log(T) / tolerance);
+         // Drift is quantized relative to the thermal speed of the temperature bin
+         creal vThermal = sqrt(physicalconstants::K_B * exp(key[2] * tolerance) / getObjectWrapper().particleSpecies[popID].mass);
+         for (int i = 0; i < 3; ++i) {
+            if (!std::isfinite(V[i])) {
+               return false;
+            }
+            key[3 + i] = std::llround(V[i] / (tolerance * vThermal));
+         }
+         key[6] = std::llround(log(minValue) / tolerance);
+         return true;
+      }
+
+      std::shared_ptr<const CachedVDF> find(const Key& key) {
+         std::shared_ptr<const CachedVDF> result;
+         #pragma omp critical(ionosphereBoundaryVDFCache)
+         {
+            auto it = entries.find(key);
+            if (it == entries.end()) {
+               ++misses;
+            } else {
+               ++hits;
+               order.splice(order.begin(), order, it->second.second);
+               result = it->second.first;
+            }
+         }
+         return result;
+      }
+
+      void insert(const Key& key, const spatial_cell::Population& population, creal pruningLoss) {
+         if (Ionosphere::boundaryVDFCacheSize == 0) {
+            return;
+         }
+         // Deep copy outside of the critical section
+         std::shared_ptr<const CachedVDF> copy = std::make_shared<const CachedVDF>(population, pruningLoss);
+         #pragma omp critical(ionosphereBoundaryVDFCache)
+         {
+            if (entries.find(key) == entries.end()) {
+               while (entries.size() >= Ionosphere::boundaryVDFCacheSize) {
+                  entries.erase(order.back());
+                  order.pop_back();
+                  ++evictions;
+               }
+               order.push_front(key);
+               entries[key] = std::make_pair(copy, order.begin());
+            }
+         }
+      }
+
+      uint64_t size() const { return entries.size(); }
+
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+
+   private:
+      std::list<Key> order; /*!< Keys from most to least recently used */
+      std::map<Key, std::pair<std::shared_ptr<const CachedVDF>, std::list<Key>::iterator> > entries;
+   };
+
+   static BoundaryVDFCache boundaryVDFCache;
+
+   /*! Write the boundary VDF cache hit rate since the previous call into the logfile. Collective. */
+   void Ionosphere::reportBoundaryVDFCacheStatistics() {
+      if (boundaryVDFCacheTolerance <= 0) {
+         return;
+      }
+      uint64_t local[4] = {boundaryVDFCache.hits, boundaryVDFCache.misses, boundaryVDFCache.evictions, boundaryVDFCache.size()};
+      uint64_t global[4];
+      MPI_Reduce(local, global, 4, MPI_UINT64_T, MPI_SUM, MASTER_RANK, MPI_COMM_WORLD);
+      boundaryVDFCache.hits = boundaryVDFCache.misses = boundaryVDFCache.evictions = 0;
+      const uint64_t lookups = global[0] + global[1];
+      logFile << "(IONOSPHERE) boundary VDF cache: " << global[0] << " hits / " << lookups << " lookups"
+              << " (hit rate " << (lookups > 0 ? 100.0 * global[0] / lookups : 0.0) << " %), "
+              << global[2] << " evictions, " << global[3] << " entries" << endl << writeVerbose;
+   }
+
+   /*! Fill the VDF of popID in cell with a Maxwellian of the given density, temperature and drift
+    * and remove the blocks below the sparsity threshold, adding the removed particle number to
+    * RHOLOSSADJUST. With ionosphere.boundaryVDFCacheTolerance > 0, a previously generated VDF with
+    * matching moments is copied instead, and the loss recorded when it was generated is added.
+    * Moments are not calculated.
+    */
+   void Ionosphere::fillMaxwellianVDF(SpatialCell& cell, const uint popID, creal density, creal temperature, const std::array<Real, 3>& vDrift) {
+      // Maxwellian VDFs are fully determined by the moments, drift and sparsity threshold,
+      // so a previously generated one is reused if its key matches.
+      BoundaryVDFCache::Key cacheKey;
+      const bool cacheable = boundaryVDFCacheTolerance > 0
+         && BoundaryVDFCache::makeKey(popID, density, temperature, vDrift, cell.getVelocityBlockMinValue(popID), cacheKey);
+      if (cacheable) {
+         std::shared_ptr<const CachedVDF> cached = boundaryVDFCache.find(cacheKey);
+         if (cached) {
+            // Only the blocks are copied, the cell keeps its loss counter, time step limits and sparsity threshold
+            spatial_cell::Population& population = cell.get_population(popID);
+            population.copyVelocitySpace(cached->population);
+            population.RHOLOSSADJUST += cached->pruningLoss;
+            #ifdef USE_GPU
+            cell.setReservation(popID, cell.get_number_of_velocity_blocks(popID));
+            #endif
+            return;
+         }
+      }
+
+      cell.clear(popID,false); // Clear previous velocity space completely, do not de-allocate memory
+      creal initRho = density;
+      creal initT = temperature;
+      creal initV0X = vDrift[0];
+      creal initV0Y = vDrift[1];
+      creal initV0Z = vDrift[2];
+      creal mass = getObjectWrapper().particleSpecies[popID].mass;
+
+      // Find list of blocks to initialize.
+      const uint nRequested = SBC::findMaxwellianBlocksToInitialize(popID,cell, initRho, initT, initV0X, initV0Y, initV0Z);
+      // stores in vmesh->getGrid() (localToGlobalMap)
+      // with count in cell.get_population(popID).N_blocks
+
+      // Resize and populate mesh
+      cell.prepare_to_receive_blocks(popID);
+
+      // Set the reservation value (capacity is increased in add_velocity_blocks
+      const Realf minValue = cell.getVelocityBlockMinValue(popID);
+
+      // fills v-space into target
+
+      #ifdef USE_GPU
+      vmesh::VelocityMesh *vmesh = cell.dev_get_velocity_mesh(popID);
+      vmesh::VelocityBlockContainer* VBC = cell.dev_get_velocity_blocks(popID);
+      #else
+      vmesh::VelocityMesh *vmesh = cell.get_velocity_mesh(popID);
+      vmesh::VelocityBlockContainer* VBC = cell.get_velocity_blocks(popID);
+      #endif
+      // Loop over blocks
+      Realf rhosum = 0;
+      arch::parallel_reduce<arch::null>(
+         {WID, WID, WID, nRequested},
+         ARCH_LOOP_LAMBDA (const uint i, const uint j, const uint k, const uint initIndex, Realf *lsum ) {
+            vmesh::GlobalID *GIDlist = vmesh->getGrid()->data();
+            Realf* bufferData = VBC->getData();
+            const vmesh::GlobalID blockGID = GIDlist[initIndex];
+            // Calculate parameters for new block
+            Real blockCoords[6];
+            vmesh->getBlockInfo(blockGID,&blockCoords[0]);
+            creal vxBlock = blockCoords[0];
+            creal vyBlock = blockCoords[1];
+            creal vzBlock = blockCoords[2];
+            creal dvxCell = blockCoords[3];
+            creal dvyCell = blockCoords[4];
+            creal dvzCell = blockCoords[5];
+            ARCH_INNER_BODY(i, j, k, initIndex, lsum) {
+               creal vx = vxBlock + (i+0.5)*dvxCell - initV0X;
+               creal vy = vyBlock + (j+0.5)*dvyCell - initV0Y;
+               creal vz = vzBlock + (k+0.5)*dvzCell - initV0Z;
+               const Realf value = projects::MaxwellianPhaseSpaceDensity(vx,vy,vz,initT,initRho,mass);
+               bufferData[initIndex*WID3 + k*WID2 + j*WID + i] = value;
+               //lsum[0] += value;
+            };
+         }, rhosum);
+
+      #ifdef USE_GPU
+      // Set and apply the reservation value
+      cell.setReservation(popID,nRequested,true); // Force to this value
+      cell.applyReservation(popID);
+      #endif
+
+      // let's get rid of blocks not fulfilling the criteria here to save memory.
+      creal lossBefore = cell.get_population(popID).RHOLOSSADJUST;
+      cell.adjustSingleCellVelocityBlocks(popID,true);
+      if (cacheable) {
+         boundaryVDFCache.insert(cacheKey, cell.get_population(popID), cell.get_population(popID).RHOLOSSADJUST - lossBefore);
+      }
+   }
+
    void Ionosphere::vlasovBoundaryCondition(
       dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
       const CellID& cellID,
@@ -3176,70 +3939,8 @@ namespace SBC {
             case FixedMoments:
             case AverageAllMoments:
             case AverageMoments:
-               {
-                  // Fill velocity space with new maxwellian data
-                  SpatialCell& cell = *mpiGrid[cellID];
-                  cell.clear(popID,false); // Clear previous velocity space completely, do not de-allocate memory
-                  creal initRho = density;
-                  creal initT = temperature;
-                  creal initV0X = vDrift[0];
-                  creal initV0Y = vDrift[1];
-                  creal initV0Z = vDrift[2];
-                  creal mass = getObjectWrapper().particleSpecies[popID].mass;
-
-                  // Find list of blocks to initialize.
-                  const uint nRequested = SBC::findMaxwellianBlocksToInitialize(popID,cell, initRho, initT, initV0X, initV0Y, initV0Z);
-                  // stores in vmesh->getGrid() (localToGlobalMap)
-                  // with count in cell.get_population(popID).N_blocks
-
-                  // Resize and populate mesh
-                  cell.prepare_to_receive_blocks(popID);
-
-                  // Set the reservation value (capacity is increased in add_velocity_blocks
-                  const Realf minValue = cell.getVelocityBlockMinValue(popID);
-
-                  // fills v-space into target
-
-                  #ifdef USE_GPU
-                  vmesh::VelocityMesh *vmesh = cell.dev_get_velocity_mesh(popID);
-                  vmesh::VelocityBlockContainer* VBC = cell.dev_get_velocity_blocks(popID);
-                  #else
-                  vmesh::VelocityMesh *vmesh = cell.get_velocity_mesh(popID);
-                  vmesh::VelocityBlockContainer* VBC = cell.get_velocity_blocks(popID);
-                  #endif
-                  // Loop over blocks
-                  Realf rhosum = 0;
-                  arch::parallel_reduce<arch::null>(
-                     {WID, WID, WID, nRequested},
-                     ARCH_LOOP_LAMBDA (const uint i, const uint j, const uint k, const uint initIndex, Realf *lsum ) {
-                        vmesh::GlobalID *GIDlist = vmesh->getGrid()->data();
-                        Realf* bufferData = VBC->getData();
-                        const vmesh::GlobalID blockGID = GIDlist[initIndex];
-                        // Calculate parameters for new block
-                        Real blockCoords[6];
-                        vmesh->getBlockInfo(blockGID,&blockCoords[0]);
-                        creal vxBlock = blockCoords[0];
-                        creal vyBlock = blockCoords[1];
-                        creal vzBlock = blockCoords[2];
-                        creal dvxCell = blockCoords[3];
-                        creal dvyCell = blockCoords[4];
-                        creal dvzCell = blockCoords[5];
-                        ARCH_INNER_BODY(i, j, k, initIndex, lsum) {
-                           creal vx = vxBlock + (i+0.5)*dvxCell - initV0X;
-                           creal vy = vyBlock + (j+0.5)*dvyCell - initV0Y;
-                           creal vz = vzBlock + (k+0.5)*dvzCell - initV0Z;
-                           const Realf value = projects::MaxwellianPhaseSpaceDensity(vx,vy,vz,initT,initRho,mass);
-                           bufferData[initIndex*WID3 + k*WID2 + j*WID + i] = value;
-                           //lsum[0] += value;
-                        };
-                     }, rhosum);
-
-                  #ifdef USE_GPU
-                  // Set and apply the reservation value
-                  cell.setReservation(popID,nRequested,true); // Force to this value
-                  cell.applyReservation(popID);
-                  #endif
-               } // end case several
+               // Fill velocity space with new maxwellian data
+               fillMaxwellianVDF(*mpiGrid[cellID], popID, density, temperature, vDrift);
                break;
             case CopyAndLosscone:
                {
@@ -3376,10 +4077,10 @@ namespace SBC {
                   cell.applyReservation(popID);
                   #endif
                } // end case CopyAndLosscone
+               // let's get rid of blocks not fulfilling the criteria here to save memory.
+               mpiGrid[cellID]->adjustSingleCellVelocityBlocks(popID,true);
                break;
          } // end switch VDF method
-         // let's get rid of blocks not fulfilling the criteria here to save memory.
-         mpiGrid[cellID]->adjustSingleCellVelocityBlocks(popID,true);
 
          // In principle this could call _R or _V instead according to calculate_V_moments (unused at the moment)
          // But the relevant moments will get recomputed in other spots when needed.
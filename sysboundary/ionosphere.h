@@ -98,6 +98,9 @@ namespace SBC {
          std::array<iSolverReal, N_IONOSPHERE_PARAMETERS> parameters = {0}; // Parameters carried by the node, see common.h
 
          int openFieldLine; /*!< See TracingLineEndType for the types assigned. */
+
+         int refLevel = 0; // Refinement level at which this node was inserted (0 for base mesh nodes)
+         std::array<int32_t, 2> parentNodes = {-1, -1}; // Edge end nodes this node was inserted between
          
          // Some calculation helpers
          Real electronDensity() { // Electron Density
@@ -131,7 +134,45 @@ namespace SBC {
       };
       
       std::vector<Node> nodes;
-      
+
+      // Solver matrix in compressed sparse row form, assembled from the node dependency lists.
+      // The transposed matrix is kept explicitly and shares the sparsity pattern.
+      struct SolverMatrix {
+         std::vector<uint32_t> rowStart;             // Index of the first entry of each row (nRows+1 entries)
+         std::vector<uint32_t> columns;              // Column index of each entry
+         std::vector<iSolverReal> values;            // Matrix coefficients
+         std::vector<iSolverReal> transposedValues;  // Transposed matrix coefficients
+         std::vector<iSolverReal> diagonal;          // Selfcoupling coefficient of each row
+         std::vector<iSolverReal> transposedDiagonal;
+
+         uint size() const {
+            return rowStart.size() > 0 ? rowStart.size() - 1 : 0;
+         }
+      };
+      SolverMatrix solverMatrix;
+
+      // One level of the geometric multigrid preconditioner. Level l contains
+      // all nodes with refLevel <= l, the finest level uses solverMatrix directly.
+      struct MultigridLevel {
+         std::vector<uint32_t> nodeIndices;  // Grid node index of each level-local node
+         SolverMatrix A;                     // Galerkin coarse operator (unused on the finest level)
+
+         // Prolongation from the next coarser level: up to two coarse nodes per node (-1 if unused)
+         std::vector<std::array<int32_t, 2>> prolongationNodes;
+         std::vector<std::array<iSolverReal, 2>> prolongationWeights;
+
+         // Restriction onto the next coarser level (transpose of the prolongation) in CSR form
+         std::vector<uint32_t> restrictionStart;
+         std::vector<uint32_t> restrictionNodes;
+         std::vector<iSolverReal> restrictionWeights;
+
+         // Dense (pseudo)inverses of the coarsest level operators, if it is small enough
+         std::vector<iSolverReal> coarseInverse, coarseInverseTransposed;
+
+         std::vector<iSolverReal> b, x, r, tmp; // Work vectors
+      };
+      std::vector<MultigridLevel> multigridLevels;
+
       // Atmospheric height layers that are being integrated over
       constexpr static int numAtmosphereLevels = 20;
       struct AtmosphericLayer {
@@ -174,6 +215,16 @@ namespace SBC {
       std::map< std::array<Real, 3>, std::array<
          std::pair<int, Real>, 3> > vlasovGridCoupling; /*!< Grid coupling information, caching how vlasovGrid coordinate couple to ionosphere data */
 
+      static const int solvingRank = 0;      /*!< Rank in the ionosphere communicator that solves the potential (also the writing rank) */
+      std::vector< std::array<Real, 3> > upmappingPoints; /*!< Coordinates at which this rank upmaps the ionosphere potential */
+      bool upmappingNodesRegistered = false; /*!< Does the solving rank know which nodes' potential this rank needs? */
+      std::vector<uint32_t> upmappingNodes;  /*!< Nodes whose potential this rank needs (on the solving rank: those of all ranks, in rank order) */
+      std::vector<int> upmappingNodeCounts;  /*!< (solving rank only) Number of upmappingNodes per rank */
+      std::vector<int> upmappingNodeOffsets; /*!< (solving rank only) Offset of each rank's upmappingNodes */
+      bool isSolvingRank() {
+         return communicator == MPI_COMM_NULL || rank == solvingRank;
+      }
+
       void setDipoleField(const FieldFunction& dipole) {
          dipoleField = dipole;
       };
@@ -186,6 +237,8 @@ namespace SBC {
       void normalizeRadius(Node& n, Real R); /*!< Scale all coordinates onto sphere with radius R */
       void updateConnectivity();          /*!< Re-link elements and nodes */
       void updateIonosphereCommunicator(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> & technicalGrid); /*!< (Re-)create the subcommunicator for ionosphere-internal communication */
+      void registerUpmappingNodes();      /*!< Tell the solving rank which nodes' potential this rank upmaps */
+      void scatterPotential(std::array<Real, 7>& solverStatus); /*!< Send the solved potential to the ranks that upmap it */
       void initializeTetrahedron();       /*!< Initialize grid as a base tetrahedron */
       void initializeIcosahedron();       /*!< Initialize grid as a base icosahedron */
       void initializeSphericalFibonacci(int n); /*!< Initialize grid as a spherical fibonacci lattice */
@@ -203,6 +256,12 @@ namespace SBC {
       void initSolver(bool zeroOut=true);  /*!< Initialize the CG solver */
       iSolverReal Atimes(uint nodeIndex, int parameter, bool transpose=false); /*!< Evaluate neighbour nodes' coupled parameter */
       Real Asolve(uint nodeIndex, int parameter, bool transpose=false); /*!< Evaluate own parameter value */
+      void assembleSolverMatrix();         /*!< Gather the node dependencies into solverMatrix */
+      void buildMultigridHierarchy();      /*!< Set up multigrid levels and transfer operators from the refinement hierarchy */
+      void assembleMultigridOperators();   /*!< Compute Galerkin coarse level operators */
+      void multigridPrecondition(int fromParameter, int toParameter, bool transpose=false); /*!< Apply one multigrid V-cycle (call from all threads) */
+      void multigridVCycle(uint level, bool transpose);
+      void multigridSmooth(uint level, bool transpose, int sweeps);
       void solve(
          int & iteration,
          int & nRestarts,
@@ -415,6 +474,9 @@ namespace SBC {
       static int solverMaxFailureCount;
       static Real solverMaxErrorGrowthFactor;
       static bool solverPreconditioning; /*!< Preconditioning for the CG solver */
+      static bool solverMultigrid; /*!< Use a geometric multigrid V-cycle instead of diagonal preconditioning */
+      static int solverMultigridSmoothingSteps; /*!< Damped Jacobi sweeps before and after each coarse grid correction */
+      static int solverMultigridCoarseSweeps; /*!< Damped Jacobi sweeps on the coarsest multigrid level */
       static bool solverUseMinimumResidualVariant; /*!< Use the minimum residual variant */
       static bool solverToggleMinimumResidualVariant; /*!< Toggle use of the minimum residual variant between solver restarts */
       static Real shieldingLatitude; /*!< Latitude (degree) below which the potential is zeroed in the equator gauge fixing scheme */
@@ -430,6 +492,8 @@ namespace SBC {
       static Real couplingTimescale; /*!< Magnetosphere->Ionosphere coupling timescale (seconds) */
       static Real couplingInterval; /*!< Ionosphere update interval */
       static int solveCount; /*!< Counter for the number of ionosphere solvings */
+      static Real boundaryVDFCacheTolerance; /*!< Relative quantization of the moments keying the boundary VDF cache, 0 disables the cache */
+      static uint boundaryVDFCacheSize; /*!< Maximum number of boundary VDFs cached per rank */
       static enum IonosphereConductivityModel { // How should the conductivity tensor be assembled?
          GUMICS,   // Like GUMICS-5 does it? (Only SigmaH and SigmaP, B perp to surface)
          Ridley,   // Or like the Ridley 2004 paper (with 1000 mho longitudinal conductivity)
@@ -438,6 +502,8 @@ namespace SBC {
 
       void generateTemplateCell(Project &project);
       void setCellFromTemplate(SpatialCell* cell,const uint popID);
+      static void reportBoundaryVDFCacheStatistics();
+      static void fillMaxwellianVDF(SpatialCell& cell, const uint popID, creal density, creal temperature, const std::array<Real, 3>& vDrift);
       
       std::array<Real, 3> fieldSolverGetNormalDirection(
          FsGrid< fsgrids::technical, FS_STENCIL_WIDTH> & technicalGrid,
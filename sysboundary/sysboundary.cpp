@@ -39,6 +39,10 @@
 #include "sysboundary.h"
 #include "../fieldsolver/gridGlue.hpp"
 
+#ifdef _OPENMP
+   #include <omp.h>
+#endif
+
 using namespace std;
 using namespace spatial_cell;
 
@@ -684,6 +688,16 @@ void SysBoundary::applySysBoundaryVlasovConditions(
    SpatialCell::set_mpi_transfer_type(Transfer::CELL_PARAMETERS | Transfer::POP_METADATA | Transfer::CELL_SYSBOUNDARYFLAG, true);
    mpiGrid.update_copies_of_remote_neighbors(Neighborhoods::SYSBOUNDARIES_EXTENDED);
 
+   // Per-cell cost measurement for multi-constraint load balancing
+   const bool measureCost = Parameters::prepareForRebalance && Parameters::loadBalanceMultiConstraint;
+   // Cell times are measured per thread, scale them to the rank's wall-clock time like the
+   // region-level timings of translation.
+   int nThreads = 1;
+   #ifdef _OPENMP
+   nThreads = omp_get_max_threads();
+   #endif
+   const double threadShare = 1.0 / nThreads;
+
    // Loop over existing particle species
    for (uint popID = 0; popID < getObjectWrapper().particleSpecies.size(); ++popID) {
       SpatialCell::setCommunicatedSpecies(popID);
@@ -704,7 +718,11 @@ void SysBoundary::applySysBoundaryVlasovConditions(
 #pragma omp parallel for
       for (uint i = 0; i < localCells.size(); i++) {
          cuint sysBoundaryType = mpiGrid[localCells[i]]->sysBoundaryFlag;
+         const double t0 = measureCost ? MPI_Wtime() : 0.0;
          this->getSysBoundary(sysBoundaryType)->vlasovBoundaryCondition(mpiGrid, localCells[i], popID, calculate_V_moments);
+         if (measureCost) {
+            mpiGrid[localCells[i]]->parameters[CellParams::LBCOMPUTETIME] += (MPI_Wtime() - t0) * threadShare;
+         }
       }
       if (popID==getObjectWrapper().particleSpecies.size()-1) {
          // Only calculate moments when handling last population
@@ -728,7 +746,11 @@ void SysBoundary::applySysBoundaryVlasovConditions(
 #pragma omp parallel for
       for (uint i = 0; i < boundaryCells.size(); i++) {
          cuint sysBoundaryType = mpiGrid[boundaryCells[i]]->sysBoundaryFlag;
+         const double t0 = measureCost ? MPI_Wtime() : 0.0;
          this->getSysBoundary(sysBoundaryType)->vlasovBoundaryCondition(mpiGrid, boundaryCells[i], popID, calculate_V_moments);
+         if (measureCost) {
+            mpiGrid[boundaryCells[i]]->parameters[CellParams::LBCOMPUTETIME] += (MPI_Wtime() - t0) * threadShare;
+         }
       }
       if (popID==getObjectWrapper().particleSpecies.size()-1) {
          // Only calculate moments when handling last population
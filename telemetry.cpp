@@ -0,0 +1,178 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "logger.h"
+#include "object_wrapper.h"
+#include "parameters.h"
+#include "telemetry.h"
+
+extern Logger logFile;
+
+namespace telemetry {
+
+   static const char* metricNames[N_METRICS] = {
+      "step_time", "io", "load_balance", "spatial_space", "field_solver", "velocity_space", "sysboundaries", "mpi_wait",
+      "cells", "blocks", "memory_hwm"
+   };
+
+   static double sectionTimes[N_SECTIONS] = {0};
+   static uint stepsSinceRecord = 0;
+   static std::ofstream telemetryFile;
+   static bool openFailed = false;
+   static MPI_Datatype recordType = MPI_DATATYPE_NULL;
+   static MPI_Op recordOp = MPI_OP_NULL;
+
+   void addTime(const Section section, const double seconds) {
+      sectionTimes[section] += seconds;
+   }
+
+   /*! MPI reduction operator for records of [min, sum, max, argmax rank] per metric.
+    * Ties in the maximum go to the lower rank so the result does not depend on the reduction order.
+    */
+   static void recordReductionOp(void* in, void* inout, int* len, MPI_Datatype* datatype) {
+      const double* a = reinterpret_cast<const double*>(in);
+      double* b = reinterpret_cast<double*>(inout);
+      for (int e=0; e<*len; ++e) {
+         for (int m=0; m<N_METRICS; ++m) {
+            const double* am = a + 4*m;
+            double* bm = b + 4*m;
+            bm[0] = std::min(am[0], bm[0]);
+            bm[1] += am[1];
+            if (am[2] > bm[2] || (am[2] == bm[2] && am[3] < bm[3])) {
+               bm[2] = am[2];
+               bm[3] = am[3];
+            }
+         }
+         a += 4*N_METRICS;
+         b += 4*N_METRICS;
+      }
+   }
+
+   /*! Resident set high water mark of this process in bytes.*/
+   static double getMemoryHighWaterMark() {
+      struct rusage usage;
+      if (getrusage(RUSAGE_SELF, &usage) != 0) {
+         return 0;
+      }
+      // ru_maxrss is in kilobytes on Linux
+      return 1024.0 * usage.ru_maxrss;
+   }
+
+   void endStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+      if (P::telemetryInterval == 0) {
+         return;
+      }
+      ++stepsSinceRecord;
+      if (P::tstep % P::telemetryInterval != 0) {
+         return;
+      }
+
+      int myRank, nProcs;
+      MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+      MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+
+      if (recordType == MPI_DATATYPE_NULL) {
+         MPI_Type_contiguous(4*N_METRICS, MPI_DOUBLE, &recordType);
+         MPI_Type_commit(&recordType);
+         MPI_Op_create(&recordReductionOp, 1, &recordOp);
+      }
+
+      double values[N_METRICS];
+      for (int s=0; s<N_SECTIONS; ++s) {
+         values[s] = sectionTimes[s] / stepsSinceRecord;
+         sectionTimes[s] = 0;
+      }
+      const std::vector<CellID>& cells = getLocalCells();
+      uint64_t blocks = 0;
+      for (size_t c=0; c<cells.size(); ++c) {
+         for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+            blocks += mpiGrid[cells[c]]->get_number_of_velocity_blocks(popID);
+         }
+      }
+      values[CELLS] = cells.size();
+      values[BLOCKS] = blocks;
+      values[MEMORY_HWM] = getMemoryHighWaterMark();
+
+      double local[4*N_METRICS];
+      double global[4*N_METRICS];
+      for (int m=0; m<N_METRICS; ++m) {
+         local[4*m+0] = values[m];
+         local[4*m+1] = values[m];
+         local[4*m+2] = values[m];
+         local[4*m+3] = myRank;
+      }
+      MPI_Reduce(local, global, 1, recordType, recordOp, MASTER_RANK, MPI_COMM_WORLD);
+
+      const uint steps = stepsSinceRecord;
+      stepsSinceRecord = 0;
+      if (myRank != MASTER_RANK) {
+         return;
+      }
+
+      if (openFailed) {
+         return;
+      }
+      if (!telemetryFile.is_open()) {
+         // Only the master rank knows about a failure, the other ranks keep reducing so as not to deadlock.
+         telemetryFile.open(P::telemetryFileName, std::ios::out | std::ios::app);
+         if (!telemetryFile.good()) {
+            logFile << "(TELEMETRY) ERROR: could not open " << P::telemetryFileName << ", no telemetry will be written." << std::endl << writeVerbose;
+            openFailed = true;
+            return;
+         }
+      }
+
+      std::ostringstream line;
+      line << std::setprecision(9);
+      line << "{\"tstep\":" << P::tstep << ",\"t\":" << P::t << ",\"dt\":" << P::dt
+           << ",\"walltime\":" << MPI_Wtime() << ",\"ranks\":" << nProcs << ",\"steps\":" << steps
+           << ",\"metrics\":{";
+      for (int m=0; m<N_METRICS; ++m) {
+         if (m > 0) {
+            line << ",";
+         }
+         line << "\"" << metricNames[m] << "\":{\"min\":" << global[4*m+0] << ",\"avg\":" << global[4*m+1] / nProcs
+              << ",\"max\":" << global[4*m+2] << ",\"max_rank\":" << static_cast<int>(global[4*m+3]) << "}";
+      }
+      line << "}}\n";
+      telemetryFile << line.str() << std::flush;
+   }
+
+   void finalize() {
+      if (telemetryFile.is_open()) {
+         telemetryFile.close();
+      }
+      if (recordOp != MPI_OP_NULL) {
+         MPI_Op_free(&recordOp);
+         MPI_Type_free(&recordType);
+      }
+   }
+}
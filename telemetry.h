@@ -0,0 +1,100 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <mpi.h>
+#include "definitions.h"
+#include "spatial_cells/spatial_cell_wrapper.hpp"
+#include <dccrg.hpp>
+#include <dccrg_cartesian_geometry.hpp>
+
+/*! Runtime performance telemetry.
+ *
+ * Every io.telemetry_interval steps the per-rank values below are combined with a single
+ * MPI_Reduce, and the master rank appends one JSON object per line to io.telemetry_file:
+ *
+ *   {"tstep":..,"t":..,"dt":..,"walltime":..,"ranks":..,"steps":..,
+ *    "metrics":{"<name>":{"min":..,"avg":..,"max":..,"max_rank":..},..}}
+ *
+ * Times are wall-clock seconds per step, averaged over the steps since the previous record.
+ * The sections may overlap (e.g. mpi_wait is also part of spatial_space), step_time covers
+ * the whole main loop iteration. cells and blocks are the local counts at the time of the
+ * record, memory_hwm is the resident set high water mark of the process in bytes.
+ *
+ * Overhead: two MPI_Wtime() calls per instrumented section per step, and on record steps
+ * one loop over the local cells plus one reduction of 4*telemetry::N_METRICS doubles.
+ * The file is written and flushed by the master rank only.
+ */
+namespace telemetry {
+
+   /*! Instrumented sections of the main loop.*/
+   enum Section {
+      STEP,
+      IO,
+      LOAD_BALANCE,
+      SPATIAL_SPACE,
+      FIELD_SOLVER,
+      VELOCITY_SPACE,
+      SYSBOUNDARIES,
+      MPI_WAIT,
+      N_SECTIONS
+   };
+
+   /*! Metrics of a record, the sections followed by the counters.*/
+   enum Metric {
+      CELLS = N_SECTIONS,
+      BLOCKS,
+      MEMORY_HWM,
+      N_METRICS
+   };
+
+   /*! Accumulate time to a section. Not thread-safe, call outside of OpenMP parallel regions.*/
+   void addTime(const Section section, const double seconds);
+
+   /*! Scoped wall-clock timer feeding a telemetry section, used next to the phiprof timers.*/
+   class Timer {
+   public:
+      Timer(const Section section): section(section), startTime(MPI_Wtime()), running(true) { }
+      ~Timer() { stop(); }
+      void stop() {
+         if (running) {
+            addTime(section, MPI_Wtime() - startTime);
+            running = false;
+         }
+      }
+   private:
+      const Section section;
+      const double startTime;
+      bool running;
+   };
+
+   /*! Count the completed step and, every P::telemetryInterval steps, reduce and write a record.
+    * Collective operation on MPI_COMM_WORLD.
+    */
+   void endStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+
+   /*! Close the telemetry file.*/
+   void finalize();
+}
+
+#endif
@@ -1239,9 +1239,25 @@ bool readAvgs( T & vlsvReader,
    datatype::type dataType;
    uint64_t arraySize, dataSize;
    if (vlsvReader.getArrayInfo("BLOCKVARIABLE", attribs, arraySize, vectorSize, dataType, dataSize) == false) {
-      //no 
-//      cerr << "ERROR READING BLOCKVARIABLE AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
+      //Bulk files written with io.vdf_compression_tolerance only have the compressed distribution:
+      uint32_t valuesPerBlock;
+      if (vlsvReader.getCompressedBlockVariableInfo(attribs, valuesPerBlock) == false) {
+//         cerr << "ERROR READING BLOCKVARIABLE AT " << __FILE__ << " " << __LINE__ << endl;
+         return false;
+      }
+      uint64_t offset, nBlocks, row;
+      vector<float> values;
+      if( vlsvReader.getBlockRange(cellId, offset, nBlocks, row) == false
+          || nBlocks != blockIds.size()
+          || vlsvReader.readCompressedBlockVariable(attribs, row, nBlocks, values, valuesPerBlock) == false ) {
+         cerr << "ERROR could not read compressed block variable at " << __FILE__ << " " << __LINE__ << endl;
+         return false;
+      }
+      vectorSize = valuesPerBlock;
+      for( uint b = 0; b < blockIds.size(); ++b ) {
+         avgs[blockIds[b]] = vector<double>(values.begin() + vectorSize * b, values.begin() + vectorSize * (b+1));
+      }
+      return true;
    }
 
    // Make a routine error checks:
@@ -1304,77 +1320,23 @@ bool getCellsWithBlocksLocations( T & vlsvReader,
       cellsWithBlocksLocations.clear();
    }
    const string meshName = attributes["--meshname"];
-   vlsv::datatype::type cwb_dataType;
-   uint64_t cwb_arraySize, cwb_vectorSize, cwb_dataSize;
-   list<pair<string, string> > attribs;
-
-   //Get the mesh name for reading in data from the correct place
-   attribs.push_back( make_pair("mesh", meshName) );
-
-   //Get array info
-   if (vlsvReader.getArrayInfo("CELLSWITHBLOCKS", attribs, cwb_arraySize, cwb_vectorSize, cwb_dataType, cwb_dataSize) == false) {
-      cerr << "ERROR, COULD NOT FIND ARRAY CELLSWITHBLOCKS AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
-   }
-
-   //Make sure the data format is correct:
-   if( cwb_vectorSize != 1 ) {
-      cerr << "ERROR, BAD VECTORSIZE AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
-   }
-   if( cwb_dataType != vlsv::datatype::type::UINT ) {
-      cerr << "ERROR, BAD DATATYPE AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
-   }
-   if( cwb_dataSize != sizeof(uint64_t) ) {
-      cerr << "ERROR, BAD DATASIZE AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
-   }
-
-   // Create buffer and read data:
-   const uint64_t cwb_amountToReadIn = cwb_arraySize * cwb_vectorSize * cwb_dataSize;
-   const uint16_t cwb_startingPoint = 0;
-   char * cwb_buffer = new char[cwb_amountToReadIn];
-   if (vlsvReader.readArray("CELLSWITHBLOCKS", attribs, cwb_startingPoint, cwb_arraySize, cwb_buffer) == false) {
-      cerr << "Failed to read block metadata for mesh '" << meshName << "'" << endl;
-      delete[] cwb_buffer;
-      return false;
-   }
 
-   vlsv::datatype::type nb_dataType;
-   uint64_t nb_arraySize, nb_vectorSize, nb_dataSize;  
-
-   //Get the mesh name for reading in data from the correct place
-   //Read array info -- stores output in nb_arraySize, nb_vectorSize, nb_dataType, nb_dataSize
-   if (vlsvReader.getArrayInfo("BLOCKSPERCELL", attribs, nb_arraySize, nb_vectorSize, nb_dataType, nb_dataSize) == false) {
-      cerr << "ERROR, COULD NOT FIND ARRAY BLOCKSPERCELL AT " << __FILE__ << " " << __LINE__ << endl;
-      return false;
-   }
-
-   // Create buffers for  number of blocks (nb) and read data:
-   const short int startingPoint = 0; //Read the array from 0 (the beginning)
-   char* nb_buffer = new char[nb_arraySize * nb_vectorSize * nb_dataSize];
-   if (vlsvReader.readArray("BLOCKSPERCELL", attribs, startingPoint, nb_arraySize, nb_buffer) == false) {
-      cerr << "Failed to read number of blocks for mesh '" << meshName << "'" << endl;
-      delete[] nb_buffer;
-      delete[] cwb_buffer;
+   //The reader builds (or loads from its sidecar index) the sorted block offset table:
+   if (vlsvReader.setCellsWithBlocks(meshName, "") == false) {
+      cerr << "ERROR, COULD NOT READ CELLSWITHBLOCKS FOR MESH '" << meshName << "' AT " << __FILE__ << " " << __LINE__ << endl;
       return false;
    }
+   vector<uint64_t> cellsWithBlocks;
+   vlsvReader.getCellsWithBlocks(cellsWithBlocks);
 
    // Input cellswithblock locations:
-   uint64_t blockOffset = 0;
-   uint64_t N_blocks;
-   for (uint64_t cell = 0; cell < cwb_arraySize; ++cell) {
-      const uint64_t readCellID = convUInt(cwb_buffer + cell*cwb_dataSize, cwb_dataType, cwb_dataSize);
-      N_blocks = convUInt(nb_buffer + cell*nb_dataSize, nb_dataType, nb_dataSize);
-      const pair<uint64_t, uint32_t> input = make_pair( blockOffset, N_blocks );
+   cellsWithBlocksLocations.reserve(cellsWithBlocks.size());
+   for (uint64_t cell = 0; cell < cellsWithBlocks.size(); ++cell) {
+      const uint64_t cellID = cellsWithBlocks[cell];
+      const pair<uint64_t, uint32_t> input = make_pair( vlsvReader.getBlockOffset(cellID), vlsvReader.getNumberOfBlocks(cellID) );
       //Insert the location and number of blocks into the map
-      cellsWithBlocksLocations.insert( make_pair(readCellID, input) );
-      blockOffset += N_blocks;
+      cellsWithBlocksLocations.insert( make_pair(cellID, input) );
    }
-
-   delete[] cwb_buffer;
-   delete[] nb_buffer;
    return true;
 }
 
@@ -22,6 +22,7 @@
 
 #include <iostream>
 
+#include <algorithm>
 #include <limits>
 #include <stdint.h>
 #include <cmath>
@@ -42,6 +43,7 @@
 #include "vlsv_util.h"
 #include "vlsvreaderinterface.h"
 #include "vlsvextract.h"
+#include "vdf_compression.h"
 
 using namespace std;
 using namespace Eigen;
@@ -447,7 +449,8 @@ void applyRotation(const Real* B,Real* transform) {
    }
 }
 
-void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string& meshName,const string& popName,const uint64_t& cellID) {
+/** Returns the row of cellID in the variable arrays of meshName, exits if the cell is not found.*/
+static uint64_t getCellIndex(vlsvinterface::Reader& vlsvReader,const string& meshName,const uint64_t& cellID) {
    //Declarations
    vlsv::datatype::type cellIdDataType;
    uint64_t cellIdArraySize, cellIdVectorSize, cellIdDataSize;
@@ -491,7 +494,11 @@ void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string
       cerr << "Spatial cell #" << cellID << " not found in " << __FILE__ << ":" << __LINE__ << endl;
       exit(1);
    }
-   
+   return cellIndex;
+}
+
+void getBulkVelocityAtIndex(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string& meshName,const string& popName,const uint64_t& cellIndex) {
+   list<pair<string,string> > xmlAttributes;
    do {
       // Read combined vg_v
       double velocity[3];
@@ -502,8 +509,8 @@ void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string
       if (vlsvReader.read("VARIABLE",xmlAttributes,cellIndex,1,ptr,false) == true) {
          cerr << "NOTE: Using combined vg_v (all populations!) for plasma frame shifting." << endl;
          V_bulk[0] = velocity[0];
-         V_bulk[0] = velocity[0];
-         V_bulk[0] = velocity[0];
+         V_bulk[1] = velocity[1];
+         V_bulk[2] = velocity[2];
          break;
       }
       // Read <pop>/vg_v
@@ -513,8 +520,8 @@ void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string
       if (vlsvReader.read("VARIABLE",xmlAttributes,cellIndex,1,ptr,false) == true) {
          cerr << "NOTE: Using <pop>/vg_v for plasma frame shifting." << endl;
          V_bulk[0] = velocity[0];
-         V_bulk[0] = velocity[0];
-         V_bulk[0] = velocity[0];
+         V_bulk[1] = velocity[1];
+         V_bulk[2] = velocity[2];
          break;
       }
       // Try old style
@@ -548,8 +555,8 @@ void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string
       if (vlsvReader.read("VARIABLE",xmlAttributes,cellIndex,1,ptr,false) == true) {
          cerr << "NOTE: Using combined vg_v (all populations!) from restart for plasma frame shifting." << endl;
          V_bulk[0] = moments[1];
-         V_bulk[0] = moments[2];
-         V_bulk[0] = moments[3];
+         V_bulk[1] = moments[2];
+         V_bulk[2] = moments[3];
          break;
       }
       // We should have broken out before or we're doomed
@@ -560,50 +567,12 @@ void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string
 
 }
 
-void getB(Real* B,vlsvinterface::Reader& vlsvReader,const string& meshName,const uint64_t& cellID) {
-   //Declarations
-   vlsv::datatype::type cellIdDataType;
-   uint64_t cellIdArraySize, cellIdVectorSize, cellIdDataSize;
+void getBulkVelocity(Real* V_bulk,vlsvinterface::Reader& vlsvReader,const string& meshName,const string& popName,const uint64_t& cellID) {
+   getBulkVelocityAtIndex(V_bulk,vlsvReader,meshName,popName,getCellIndex(vlsvReader,meshName,cellID));
+}
 
+void getBAtIndex(Real* B,vlsvinterface::Reader& vlsvReader,const string& meshName,const uint64_t& cellIndex) {
    list<pair<string,string> > xmlAttributes;
-   xmlAttributes.push_back(make_pair("mesh",meshName));
-   xmlAttributes.push_back(make_pair("name","CellID"));
-   if (vlsvReader.getArrayInfo("VARIABLE", xmlAttributes, cellIdArraySize, cellIdVectorSize, cellIdDataType, cellIdDataSize) == false) {
-      cerr << "Error " << __FILE__ << " " << __LINE__ << endl;
-      exit(1);
-   }
-
-   // Declare buffers and allocate memory, this is done to read in the cell id location:
-   uint64_t* cellIdBuffer = NULL;
-
-   // Read the array into cellIdBuffer starting from 0 up until cellIdArraySize 
-   // which was received from getArrayInfo
-   if (vlsvReader.read("VARIABLE",xmlAttributes,0,cellIdArraySize,cellIdBuffer,true) == false) {
-      cerr << "Error: failed to read cell IDs in " << __FILE__ << ":" << __LINE__ << endl;
-      delete [] cellIdBuffer;
-      exit(1);
-   }
-
-   // Search for the given cellID location, the array in the vlsv file is not ordered depending 
-   // on the cell id so the array might look like this, 
-   // for instance: [CellId1, CellId7, CellId5, ...] and the variables are saved in the same
-   // order: [CellId1_B_FIELD, CellId7_B_FIELD, CellId5_B_FIELD, ...]
-   uint64_t cellIndex = numeric_limits<uint64_t>::max();
-   for (uint64_t cell=0; cell<cellIdArraySize; ++cell) {
-      // the CellID are not sorted in the array, so we'll have to search 
-      // the array -- the CellID is stored in cellId
-      if (cellID == cellIdBuffer[cell]) {
-         //Found the right cell ID, break
-         cellIndex = cell; break;
-      }
-   }
-   delete [] cellIdBuffer; cellIdBuffer = NULL;
-
-   // Check if the cell id was found:
-   if (cellIndex == numeric_limits<uint64_t>::max()) {
-      cerr << "Spatial cell #" << cellID << " not found in " << __FILE__ << ":" << __LINE__ << endl;
-      exit(1);
-   }
 
    // These are needed to determine the buffer size:
    vlsv::datatype::type variableDataType;
@@ -724,6 +693,25 @@ void getB(Real* B,vlsvinterface::Reader& vlsvReader,const string& meshName,const
    }
 }
 
+void getB(Real* B,vlsvinterface::Reader& vlsvReader,const string& meshName,const uint64_t& cellID) {
+   getBAtIndex(B,vlsvReader,meshName,getCellIndex(vlsvReader,meshName,cellID));
+}
+
+/** Velocity distribution of one particle population in one spatial cell,
+ * read in advance by the batched extraction (see readVelocityBlocksBatched).*/
+struct PrefetchedVdf {
+   bool found;                       /**< If false, the cell has no blocks of this population.*/
+   uint64_t row;                     /**< Row of the cell in CELLSWITHBLOCKS.*/
+   std::vector<uint64_t> blockIds;   /**< Velocity block global IDs.*/
+   std::vector<char> blockData;      /**< BLOCKVARIABLE data, valid if hasBlockData is true.*/
+   bool hasBlockData;
+   datatype::type dataType;
+   uint64_t vectorSize;
+   uint64_t dataSize;
+   Real V_bulk[3];                   /**< Bulk velocity, valid if plasma frame shifting was requested.*/
+   Real B[3];                        /**< Magnetic field, valid if rotation was requested.*/
+};
+
 bool convertVelocityBlocks2(
                             vlsvinterface::Reader& vlsvReader,
                             const string& fname,
@@ -733,7 +721,8 @@ bool convertVelocityBlocks2(
                             const bool rotate,
                             const bool plasmaFrame,
                             vlsv::Writer& out,
-                            const std::string& popName
+                            const std::string& popName,
+                            const PrefetchedVdf* prefetched = NULL
                            ) {
    bool success = true;
    
@@ -764,15 +753,23 @@ bool convertVelocityBlocks2(
 
    if (plasmaFrame == true) {
       Real V_bulk[3];
-      getBulkVelocity(V_bulk,vlsvReader,meshName,popName,cellID);
+      if (prefetched != NULL) {
+         for (int i=0; i<3; ++i) V_bulk[i] = prefetched->V_bulk[i];
+      } else {
+         getBulkVelocity(V_bulk,vlsvReader,meshName,popName,cellID);
+      }
       applyTranslation(V_bulk,transform);
    }
 
    // Write transform matrix (if needed)
    if (rotate == true) {
       Real B[3];
-      //Note: allocates memory and stores the vector value into B_ptr
-      getB(B,vlsvReader,meshName,cellID);
+      if (prefetched != NULL) {
+         for (int i=0; i<3; ++i) B[i] = prefetched->B[i];
+      } else {
+         //Note: allocates memory and stores the vector value into B_ptr
+         getB(B,vlsvReader,meshName,cellID);
+      }
       applyRotation(B,transform);
    }
 
@@ -784,7 +781,9 @@ bool convertVelocityBlocks2(
 
    // Read velocity block global IDs and write them out
    std::vector<uint64_t> blockIds;
-   if (vlsvReader.getBlockIds(cellID,blockIds,popName) == false ) {
+   if (prefetched != NULL) {
+      blockIds = prefetched->blockIds;
+   } else if (vlsvReader.getBlockIds(cellID,blockIds,popName) == false ) {
       cerr << "Trying older Vlasiator file format..." << endl;
       if (vlsvReader.getBlockIds(cellID,blockIds,"") == false) {
          cerr << "ERROR, failed to read IDs at " << __FILE__ << ":" << __LINE__ << endl;
@@ -940,6 +939,10 @@ bool convertVelocityBlocks2(
    if (vlsvReader.getUniqueAttributeValues( "BLOCKVARIABLE", attributeName, blockVarNames) == false) {
       cerr << "ERROR, FAILED TO GET UNIQUE ATTRIBUTE VALUES AT " << __FILE__ << " " << __LINE__ << endl;
    }
+   // Lossy compressed distributions are stored in a separate array:
+   set<string> compressedVarNames;
+   vlsvReader.getUniqueAttributeValues( "BLOCKVARIABLECOMPRESSED", attributeName, compressedVarNames);
+   blockVarNames.insert(compressedVarNames.begin(), compressedVarNames.end());
 
    //Writing VLSV file
    if (success == true) {
@@ -947,9 +950,39 @@ bool convertVelocityBlocks2(
          // Only accept the population that belongs to this mesh
          if (*it != popName) continue;
 
+         if (prefetched != NULL) {
+            if (prefetched->hasBlockData == false) return false;
+            attributes["name"] = *it;
+            attributes["mesh"] = outputMeshName;
+            if (out.writeArray("VARIABLE",
+                               attributes,
+                               vlsv::getStringDatatype(prefetched->dataType),
+                               N_blocks * blockSize,
+                               prefetched->vectorSize/blockSize,
+                               prefetched->dataSize,
+                               prefetched->blockData.data()) == false) success = false;
+            continue;
+         }
+
          list<pair<string, string> > attribs;
          attribs.push_back(make_pair("name", *it));
          attribs.push_back(make_pair("mesh", meshName));
+
+         if (compressedVarNames.find(*it) != compressedVarNames.end()) {
+            uint64_t offset, nBlocks, row;
+            std::vector<float> values;
+            uint32_t valuesPerBlock;
+            if (vlsvReader.getBlockRange(cellID, offset, nBlocks, row) == false
+                || vlsvReader.readCompressedBlockVariable(attribs, row, N_blocks, values, valuesPerBlock) == false) {
+               cerr << "ERROR could not read compressed block variable in " << __FILE__ << ":" << __LINE__ << endl;
+               return false;
+            }
+            attributes["name"] = *it;
+            attributes["mesh"] = outputMeshName;
+            if (out.writeArray("VARIABLE", attributes, N_blocks * blockSize, valuesPerBlock/blockSize, values.data()) == false) success = false;
+            continue;
+         }
+
          datatype::type dataType;
          uint64_t arraySize, vectorSize, dataSize;
          if (vlsvReader.getArrayInfo("BLOCKVARIABLE", attribs, arraySize, vectorSize, dataType, dataSize) == false) {
@@ -1099,6 +1132,345 @@ bool convertVelocityBlocks2(
    return success;
 }
 
+/** Reads ranges of an array in a VLSV file with a few large sequential reads. The ranges
+ * are sorted by offset and neighbouring ranges closer than maxGapBytes are coalesced
+ * into one read of at most maxReadBytes (a single larger range is read on its own).
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param tagName Name of the array tag.
+ * @param attribs XML attributes of the array.
+ * @param ranges (first element offset, number of elements, index into output) of each range, sorted on exit.
+ * @param output Data of each range is copied into output[index].
+ * @param dataType Data type of the array.
+ * @param vectorSize Vector size of the array.
+ * @param dataSize Byte size of one vector component.
+ * @return If true, all ranges were read successfully.*/
+static bool readArrayRangesCoalesced(vlsvinterface::Reader& vlsvReader,
+                                     const string& tagName,
+                                     const list<pair<string,string> >& attribs,
+                                     std::vector<std::array<uint64_t,3> >& ranges,
+                                     std::vector<std::vector<char> >& output,
+                                     datatype::type& dataType,
+                                     uint64_t& vectorSize,
+                                     uint64_t& dataSize) {
+   const uint64_t maxGapBytes = 1 << 20;
+   const uint64_t maxReadBytes = 256 << 20;
+
+   uint64_t arraySize;
+   if (vlsvReader.getArrayInfo(tagName, attribs, arraySize, vectorSize, dataType, dataSize) == false) return false;
+   const uint64_t entryBytes = vectorSize*dataSize;
+   std::sort(ranges.begin(), ranges.end());
+
+   std::vector<char> buffer;
+   size_t first = 0;
+   while (first < ranges.size()) {
+      const uint64_t begin = ranges[first][0];
+      uint64_t end = begin + ranges[first][1];
+      size_t last = first+1;
+      while (last < ranges.size()
+             && (ranges[last][0] - std::min(ranges[last][0], end))*entryBytes <= maxGapBytes
+             && (std::max(end, ranges[last][0]+ranges[last][1]) - begin)*entryBytes <= maxReadBytes) {
+         end = std::max(end, ranges[last][0]+ranges[last][1]);
+         ++last;
+      }
+      buffer.resize((end-begin)*entryBytes);
+      if (end > begin && vlsvReader.readArray(tagName, attribs, begin, end-begin, buffer.data()) == false) return false;
+
+      #pragma omp parallel for schedule(dynamic)
+      for (size_t r=first; r<last; ++r) {
+         const char* src = buffer.data() + (ranges[r][0]-begin)*entryBytes;
+         output[ranges[r][2]].assign(src, src + ranges[r][1]*entryBytes);
+      }
+      first = last;
+   }
+   return true;
+}
+
+/** Reads and decodes the lossy compressed velocity distributions of a set of spatial cells
+ * with coalesced reads. The block IDs (and thus the block counts) must have been read already.
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param attribs Attributes (population name and spatial mesh) of the arrays.
+ * @param vdfs Distributions of the cells, the decoded data is stored as floats.
+ * @return If true, all distributions were read and decoded successfully.*/
+static bool readCompressedBlockVariablesBatched(vlsvinterface::Reader& vlsvReader,
+                                                const list<pair<string,string> >& attribs,
+                                                std::vector<PrefetchedVdf>& vdfs) {
+   uint32_t valuesPerBlock;
+   if (vlsvReader.getCompressedBlockVariableInfo(attribs,valuesPerBlock) == false) return false;
+
+   datatype::type dataType;
+   uint64_t vectorSize, dataSize;
+   std::vector<std::array<uint64_t,3> > ranges;
+   for (size_t c=0; c<vdfs.size(); ++c) {
+      if (vdfs[c].found == true) ranges.push_back({vdfs[c].row,1,c});
+   }
+   std::vector<std::vector<char> > buffers(vdfs.size());
+   if (readArrayRangesCoalesced(vlsvReader,"BLOCKVARIABLECOMPRESSEDOFFSETS",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) return false;
+
+   ranges.clear();
+   for (size_t c=0; c<vdfs.size(); ++c) {
+      if (vdfs[c].found == false) continue;
+      const uint64_t* streamLocation = reinterpret_cast<const uint64_t*>(buffers[c].data());
+      ranges.push_back({streamLocation[0],streamLocation[1],c});
+   }
+   if (readArrayRangesCoalesced(vlsvReader,"BLOCKVARIABLECOMPRESSED",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) return false;
+
+   bool success = true;
+   #pragma omp parallel for schedule(dynamic)
+   for (size_t c=0; c<vdfs.size(); ++c) {
+      PrefetchedVdf& vdf = vdfs[c];
+      if (vdf.found == false) continue;
+      std::vector<float> values;
+      if (vdfcompression::decodeCell(reinterpret_cast<const unsigned char*>(buffers[c].data()),buffers[c].size(),
+                                     vdf.blockIds.size(),valuesPerBlock,values) == false) {
+         #pragma omp critical
+         success = false;
+         continue;
+      }
+      std::vector<char>().swap(buffers[c]);
+      vdf.blockData.resize(values.size()*sizeof(float));
+      std::memcpy(vdf.blockData.data(),values.data(),vdf.blockData.size());
+      vdf.hasBlockData = true;
+      vdf.dataType = datatype::type::FLOAT;
+      vdf.vectorSize = valuesPerBlock;
+      vdf.dataSize = sizeof(float);
+   }
+   return success;
+}
+
+/** Reads a spatial mesh variable in a set of spatial cells with coalesced reads.
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param meshName Name of the spatial mesh.
+ * @param varName Name of the variable.
+ * @param cellIndices Rows of the cells in the spatial mesh arrays.
+ * @param minVectorSize Minimum number of components the variable must have.
+ * @param values Output, values[c] is the vector of the variable in cell c.
+ * @return If false, the variable does not exist in the file or could not be read.*/
+static bool readVariableBatched(vlsvinterface::Reader& vlsvReader,
+                                const string& meshName,
+                                const string& varName,
+                                const std::vector<uint64_t>& cellIndices,
+                                const uint64_t minVectorSize,
+                                std::vector<std::vector<double> >& values) {
+   list<pair<string,string> > attribs;
+   attribs.push_back(make_pair("mesh",meshName));
+   attribs.push_back(make_pair("name",varName));
+   std::vector<std::array<uint64_t,3> > ranges(cellIndices.size());
+   for (size_t c=0; c<cellIndices.size(); ++c) ranges[c] = {cellIndices[c],1,c};
+   std::vector<std::vector<char> > buffers(cellIndices.size());
+   datatype::type dataType;
+   uint64_t vectorSize, dataSize;
+   if (readArrayRangesCoalesced(vlsvReader,"VARIABLE",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) return false;
+   if (dataType != datatype::type::FLOAT || (dataSize != sizeof(float) && dataSize != sizeof(double)) || vectorSize < minVectorSize) {
+      cerr << "Variable " << varName << " is not a floating point array of " << minVectorSize << " components in " << __FILE__ << ":" << __LINE__ << endl;
+      return false;
+   }
+
+   values.resize(cellIndices.size());
+   for (size_t c=0; c<cellIndices.size(); ++c) {
+      values[c].resize(vectorSize);
+      for (uint64_t i=0; i<vectorSize; ++i) {
+         if (dataSize == sizeof(double)) values[c][i] = reinterpret_cast<const double*>(buffers[c].data())[i];
+         else values[c][i] = reinterpret_cast<const float*>(buffers[c].data())[i];
+      }
+   }
+   return true;
+}
+
+/** Batched counterpart of getBulkVelocityAtIndex, the velocity variable is read in all cells with one coalesced read.
+ * @param V_bulk Output, bulk velocity of each cell.
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param meshName Name of the spatial mesh.
+ * @param popName Name of the population.
+ * @param cellIndices Rows of the cells in the spatial mesh arrays.*/
+static void getBulkVelocityBatched(std::vector<std::array<Real,3> >& V_bulk,vlsvinterface::Reader& vlsvReader,const string& meshName,
+                                   const string& popName,const std::vector<uint64_t>& cellIndices) {
+   V_bulk.resize(cellIndices.size());
+   std::vector<std::vector<double> > values, numberDensity;
+   if (readVariableBatched(vlsvReader,meshName,"vg_v",cellIndices,3,values) == true) {
+      cerr << "NOTE: Using combined vg_v (all populations!) for plasma frame shifting." << endl;
+      for (size_t c=0; c<cellIndices.size(); ++c) V_bulk[c] = {values[c][0], values[c][1], values[c][2]};
+      return;
+   }
+   if (readVariableBatched(vlsvReader,meshName,popName+"/vg_v",cellIndices,3,values) == true) {
+      cerr << "NOTE: Using <pop>/vg_v for plasma frame shifting." << endl;
+      for (size_t c=0; c<cellIndices.size(); ++c) V_bulk[c] = {values[c][0], values[c][1], values[c][2]};
+      return;
+   }
+   // Try old style
+   if (readVariableBatched(vlsvReader,meshName,"rho",cellIndices,1,numberDensity) == true
+       && readVariableBatched(vlsvReader,meshName,"rho_v",cellIndices,3,values) == true) {
+      cerr << "NOTE: Using rho_v / rho for plasma frame shifting." << endl;
+      for (size_t c=0; c<cellIndices.size(); ++c) {
+         for (int i=0; i<3; ++i) V_bulk[c][i] = values[c][i] / (numberDensity[c][0] + numeric_limits<double>::min());
+      }
+      return;
+   }
+   // Read combined vg_v in restart file style
+   if (readVariableBatched(vlsvReader,meshName,"moments",cellIndices,4,values) == true) {
+      cerr << "NOTE: Using combined vg_v (all populations!) from restart for plasma frame shifting." << endl;
+      for (size_t c=0; c<cellIndices.size(); ++c) V_bulk[c] = {values[c][1], values[c][2], values[c][3]};
+      return;
+   }
+   cerr << "ERROR: Could not find a usable velocity for plasma frame shift!" << endl;
+   exit(1);
+}
+
+/** Batched counterpart of getBAtIndex, each magnetic field variable is read in all cells with one coalesced read.
+ * @param B Output, magnetic field of each cell.
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param meshName Name of the spatial mesh.
+ * @param cellIndices Rows of the cells in the spatial mesh arrays.*/
+static void getBBatched(std::vector<std::array<Real,3> >& B,vlsvinterface::Reader& vlsvReader,const string& meshName,
+                        const std::vector<uint64_t>& cellIndices) {
+   // Same priority as in getBAtIndex, the field is the sum of both variables if the second one is given
+   const char* variables[6][2] = {{"vg_b_vol",""},{"vg_b_background_vol","vg_b_perturbed_vol"},{"B_vol",""},
+                                  {"BGB_vol","PERB_vol"},{"B",""},{"background_B","perturbed_B"}};
+   B.resize(cellIndices.size());
+   std::vector<std::vector<double> > B1, B2;
+   for (int v=0; v<6; ++v) {
+      if (readVariableBatched(vlsvReader,meshName,variables[v][0],cellIndices,3,B1) == false) continue;
+      const bool sum = (variables[v][1][0] != '\0');
+      if (sum == true && readVariableBatched(vlsvReader,meshName,variables[v][1],cellIndices,3,B2) == false) continue;
+      if (runDebug == true) cerr << "Using " << variables[v][0] << (sum ? string(" + ") + variables[v][1] : string("")) << endl;
+      for (size_t c=0; c<cellIndices.size(); ++c) {
+         for (int i=0; i<3; ++i) B[c][i] = B1[c][i] + (sum ? B2[c][i] : 0);
+      }
+      return;
+   }
+   cerr << "Failed to read magnetic field in " << __FILE__ << " " << __LINE__ << endl;
+   exit(1);
+}
+
+/** Reads the velocity distributions of all populations in a set of spatial cells. Block
+ * IDs and block data are read with coalesced reads ordered by file offset instead of one
+ * read per cell. The frame transformation inputs are looked up through the reader's
+ * cell index instead of scanning the CellID array once per cell, and read with one coalesced
+ * read per variable.
+ * @param vlsvReader VLSV file reader that has input file open.
+ * @param meshName Name of the spatial mesh.
+ * @param cellIDs IDs of the spatial cells.
+ * @param popNames Names of the populations, "" for old files without populations.
+ * @param rotate If true, magnetic field is read for each cell.
+ * @param plasmaFrame If true, bulk velocity is read for each cell.
+ * @param vdfs Output, vdfs[p][c] is the distribution of population p in cell c.
+ * @return If false, reading failed for at least one population.*/
+static bool readVelocityBlocksBatched(vlsvinterface::Reader& vlsvReader,
+                                      const string& meshName,
+                                      const std::vector<uint64_t>& cellIDs,
+                                      const std::vector<string>& popNames,
+                                      const bool rotate,
+                                      const bool plasmaFrame,
+                                      std::vector<std::vector<PrefetchedVdf> >& vdfs) {
+   bool success = true;
+   set<string> blockVarNames;
+   if (vlsvReader.getUniqueAttributeValues("BLOCKVARIABLE", "name", blockVarNames) == false) {
+      cerr << "ERROR, FAILED TO GET UNIQUE ATTRIBUTE VALUES AT " << __FILE__ << " " << __LINE__ << endl;
+   }
+   set<string> compressedVarNames;
+   vlsvReader.getUniqueAttributeValues("BLOCKVARIABLECOMPRESSED", "name", compressedVarNames);
+   std::vector<uint64_t> cellIndices(cellIDs.size());
+   if (rotate == true || plasmaFrame == true) {
+      if (vlsvReader.setCellIds() == false) {
+         cerr << "ERROR, failed to read cell IDs in " << __FILE__ << ":" << __LINE__ << endl;
+         exit(1);
+      }
+      for (size_t c=0; c<cellIDs.size(); ++c) {
+         if (vlsvReader.getCellRow(cellIDs[c],cellIndices[c]) == false) {
+            cerr << "Spatial cell #" << cellIDs[c] << " not found in " << __FILE__ << ":" << __LINE__ << endl;
+            exit(1);
+         }
+      }
+   }
+   std::vector<std::array<Real,3> > B;
+   if (rotate == true) getBBatched(B,vlsvReader,meshName,cellIndices);
+   std::vector<std::vector<std::array<Real,3> > > V_bulk(popNames.size());
+   if (plasmaFrame == true) {
+      for (size_t p=0; p<popNames.size(); ++p) {
+         getBulkVelocityBatched(V_bulk[p],vlsvReader,meshName,(popNames[p].size() > 0) ? popNames[p] : "avgs",cellIndices);
+      }
+   }
+
+   vdfs.assign(popNames.size(), std::vector<PrefetchedVdf>(cellIDs.size()));
+   for (size_t p=0; p<popNames.size(); ++p) {
+      const string popName = (popNames[p].size() > 0) ? popNames[p] : "avgs";
+      std::vector<PrefetchedVdf>& popVdfs = vdfs[p];
+      if (vlsvReader.setCellsWithBlocks(meshName,popNames[p]) == false) {
+         success = false;
+         for (size_t c=0; c<cellIDs.size(); ++c) popVdfs[c].found = false;
+         continue;
+      }
+
+      std::vector<std::array<uint64_t,3> > ranges;
+      for (size_t c=0; c<cellIDs.size(); ++c) {
+         PrefetchedVdf& vdf = popVdfs[c];
+         uint64_t offset, nBlocks;
+         vdf.found = vlsvReader.getBlockRange(cellIDs[c],offset,nBlocks,vdf.row);
+         vdf.hasBlockData = false;
+         if (vdf.found == false) continue;
+         ranges.push_back({offset,nBlocks,c});
+         for (int i=0; i<3; ++i) {
+            if (plasmaFrame == true) vdf.V_bulk[i] = V_bulk[p][c][i];
+            if (rotate == true) vdf.B[i] = B[c][i];
+         }
+      }
+      vlsvReader.clearCellsWithBlocks();
+
+      // Block IDs, older files did not add the population name to the array:
+      std::vector<std::vector<char> > buffers(cellIDs.size());
+      datatype::type dataType;
+      uint64_t vectorSize, dataSize;
+      list<pair<string,string> > attribs;
+      attribs.push_back(make_pair("name",popName));
+      if (readArrayRangesCoalesced(vlsvReader,"BLOCKIDS",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) {
+         attribs.clear();
+         if (readArrayRangesCoalesced(vlsvReader,"BLOCKIDS",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) {
+            cerr << "ERROR, failed to read IDs at " << __FILE__ << ":" << __LINE__ << endl;
+            success = false;
+            for (size_t c=0; c<cellIDs.size(); ++c) popVdfs[c].found = false;
+            continue;
+         }
+      }
+      #pragma omp parallel for schedule(dynamic)
+      for (size_t c=0; c<cellIDs.size(); ++c) {
+         if (popVdfs[c].found == false) continue;
+         const uint64_t N_blocks = buffers[c].size() / dataSize;
+         popVdfs[c].blockIds.resize(N_blocks);
+         for (uint64_t b=0; b<N_blocks; ++b) {
+            popVdfs[c].blockIds[b] = convUInt(buffers[c].data() + b*dataSize, dataType, dataSize);
+         }
+         std::vector<char>().swap(buffers[c]);
+      }
+
+      // Block data:
+      attribs.clear();
+      attribs.push_back(make_pair("name",popName));
+      attribs.push_back(make_pair("mesh",meshName));
+      if (compressedVarNames.find(popName) != compressedVarNames.end()) {
+         if (readCompressedBlockVariablesBatched(vlsvReader,attribs,popVdfs) == false) {
+            cerr << "ERROR could not read compressed block variable in " << __FILE__ << ":" << __LINE__ << endl;
+            success = false;
+         }
+         continue;
+      }
+      if (blockVarNames.find(popName) == blockVarNames.end()) continue;
+      if (readArrayRangesCoalesced(vlsvReader,"BLOCKVARIABLE",attribs,ranges,buffers,dataType,vectorSize,dataSize) == false) {
+         cerr << "ERROR could not read block variable in " << __FILE__ << ":" << __LINE__ << endl;
+         success = false;
+         continue;
+      }
+      for (size_t c=0; c<cellIDs.size(); ++c) {
+         PrefetchedVdf& vdf = popVdfs[c];
+         if (vdf.found == false) continue;
+         vdf.blockData.swap(buffers[c]);
+         vdf.hasBlockData = true;
+         vdf.dataType = dataType;
+         vdf.vectorSize = vectorSize;
+         vdf.dataSize = dataSize;
+      }
+   }
+   return success;
+}
+
 //Calculates the cell coordinates and outputs into *coordinates 
 //NOTE: ASSUMING COORDINATES IS NOT NULL AND IS OF SIZE 3
 //Input:
@@ -1546,6 +1918,7 @@ bool retrieveOptions( const int argn, char *args[], UserOptions & mainOptions )
          ("point1", po::value< std::vector<Real> >()->multitoken(), "Set the starting point x y z of a line")
          ("point2", po::value< std::vector<Real> >()->multitoken(), "Set the ending point x y z of a line")
          ("pointamount", po::value<unsigned int>(), "Number of points along a line (OPTIONAL)")
+         ("batch", po::value<uint32_t>(), "Read the distributions of this many cells at a time with coalesced reads (OPTIONAL, default 0 = one cell at a time)")
          ("outputdirectory", po::value< std::vector<string> >(), "The directory where the file is saved (default current folder) (OPTIONAL)");
          
       //For mapping input
@@ -1599,6 +1972,10 @@ bool retrieveOptions( const int argn, char *args[], UserOptions & mainOptions )
 	 // Turn on debugging mode
 	 runDebug = true;
       }
+      //Check for batched extraction
+      if( vm.count("batch") ) {
+         mainOptions.batchSize = vm["batch"].as<uint32_t>();
+      }
       //Check for plasma frame shifting
       if( vm.count("plasmaFrame") ) {
          // Shift the velocity distribution to plasma frame
@@ -1801,6 +2178,122 @@ void setCoordinatesAlongALine(
 }
 
 
+//Returns the path of the output file of a cell, velgrid[.rotated][.shifted].<cellid>.<rest of the input file name>
+//Input:
+//[0] string fileName -- Name of the input file
+//[1] uint64_t cellID -- Cell id of the extracted distribution
+//[2] UserOptions mainOptions -- User options (output directory, rotation and shifting)
+string getOutputFilePath( const string & fileName, const uint64_t cellID, const UserOptions & mainOptions ) {
+   // Create a new file suffix for the output file:
+   stringstream ss1;
+   ss1 << ".vlsv";
+   string newSuffix;
+   ss1 >> newSuffix;
+
+   // Create a new file prefix for the output file:
+   stringstream ss2;
+   ss2 << "velgrid" << '.';
+   if( mainOptions.rotateVectors ) {
+      ss2 << "rotated" << '.';
+   }
+   if( mainOptions.plasmaFrame ) {
+      ss2 << "shifted" << '.';
+   }
+   ss2 << cellID;
+   string newPrefix;
+   ss2 >> newPrefix;
+   
+   // Replace .vlsv with the new suffix:
+   string outputFileName = fileName;
+   size_t pos = outputFileName.rfind(".vlsv");
+   if (pos != string::npos) outputFileName.replace(pos, 5, newSuffix);
+
+   pos = outputFileName.find(".");
+   if (pos != string::npos) outputFileName.replace(0, pos, newPrefix);
+
+   //Get the path (outputDirectoryPath was retrieved from user input and it's a vector<string>):
+   string outputFilePath;
+   outputFilePath.append( mainOptions.outputDirectoryPath.front() );
+   //The complete file path is still missing the file name, so add it to the end:
+   outputFilePath.append( outputFileName );
+   return outputFilePath;
+}
+
+//Extracts the distributions of cellIdList in batches of mainOptions.batchSize cells. Each batch is read
+//with readVelocityBlocksBatched and then written into one file per cell exactly as the cell-by-cell path does.
+//Input:
+//[0] vlsvReader -- VLSV file reader that has input file open
+//[1] string fileName -- Name of the input file
+//[2] string meshName -- Name of the spatial mesh
+//[3] CellStructure cellStruct -- Mesh metadata
+//[4] vector<uint64_t> cellIdList -- Cell ids to extract
+//[5] UserOptions mainOptions -- User options
+void extractDistributionsBatched( vlsvinterface::Reader & vlsvReader, const string & fileName, const string & meshName,
+                                  CellStructure & cellStruct, const std::vector<uint64_t> & cellIdList,
+                                  const UserOptions & mainOptions ) {
+   // Read names of all existing particle species
+   set<string> popNameSet;
+   if (vlsvReader.getUniqueAttributeValues("BLOCKIDS","name",popNameSet) == false) {
+      cerr << "ERROR could not read population names in " << __FILE__ << ":" << __LINE__ << endl;
+      return;
+   }
+   std::vector<string> popNames(popNameSet.begin(), popNameSet.end());
+   if (popNames.empty() == true) {
+      if (runDebug == true) cerr << "Extracting old-style population 'avgs'" << endl;
+      popNames.push_back("");
+   }
+
+   int extractNum = 1;
+   for( size_t batchStart = 0; batchStart < cellIdList.size(); batchStart += mainOptions.batchSize ) {
+      const size_t batchEnd = std::min( cellIdList.size(), batchStart + mainOptions.batchSize );
+      const std::vector<uint64_t> batchCellIds( cellIdList.begin() + batchStart, cellIdList.begin() + batchEnd );
+      std::vector<std::vector<PrefetchedVdf> > vdfs;
+      readVelocityBlocksBatched( vlsvReader, meshName, batchCellIds, popNames, mainOptions.rotateVectors, mainOptions.plasmaFrame, vdfs );
+
+      for( size_t c = 0; c < batchCellIds.size(); ++c ) {
+         const uint64_t cellID = batchCellIds[c];
+         cout << "Cell id: " << cellID << endl;
+         const string outputFilePath = getOutputFilePath( fileName, cellID, mainOptions );
+
+         bool velGridExtracted = true;
+         vlsv::Writer out;
+         if (out.open(outputFilePath,MPI_COMM_SELF,0) == false) {
+            cerr << "ERROR, failed to open output file with vlsv::Writer at " << __FILE__ << " " << __LINE__ << endl;
+            velGridExtracted = false;
+         } else {
+            for( size_t p = 0; p < popNames.size(); ++p ) {
+               const string popName = (popNames[p].size() > 0) ? popNames[p] : "avgs";
+               if (runDebug == true) cerr << "Population '" << popName << "' meshName '" << meshName << "'" << endl;
+               if (vdfs[p][c].found == false) {
+                  cerr << "COULDNT FIND CELL ID " << cellID << " AT " << __FILE__ << " " << __LINE__ << endl;
+                  velGridExtracted = false;
+                  continue;
+               }
+               if (convertVelocityBlocks2(vlsvReader,outputFilePath,meshName,cellStruct,cellID,mainOptions.rotateVectors,
+                                          mainOptions.plasmaFrame,out,popName,&(vdfs[p][c])) == false) velGridExtracted = false;
+               //Release the distribution as soon as it has been written:
+               std::vector<uint64_t>().swap(vdfs[p][c].blockIds);
+               std::vector<char>().swap(vdfs[p][c].blockData);
+            }
+            out.close();
+         }
+
+         if (velGridExtracted == false) {
+            cerr << "ERROR, FAILED TO EXTRACT VELOCITY GRID AT: " << __FILE__ << " " << __LINE__ << endl;
+            if (remove(outputFilePath.c_str()) != 0) {
+               cerr << "\t ERROR: failed to remote dummy output file!" << endl;
+            }
+         } else if( mainOptions.getCellIdFromLine ) {
+            int moreToGo = cellIdList.size() - extractNum;
+            cout << "Extracted num. " << extractNum << ", " << moreToGo << " more to go" << endl;
+            ++extractNum;
+         } else {
+            cout << "\t extracted from '" << fileName << "'" << endl;
+         }
+      }
+   }
+}
+
 template <class T>
 void extractDistribution( const string & fileName, const UserOptions & mainOptions ) {
    T vlsvReader;
@@ -1906,50 +2399,25 @@ void extractDistribution( const string & fileName, const UserOptions & mainOptio
    //Give some info on how many extractions there are and what the save path is:
    cout << "Save path: " << mainOptions.outputDirectoryPath.front() << endl;
    cout << "Total number of extractions: " << cellIdList.size() << endl;
+   if( mainOptions.batchSize > 0 ) {
+      extractDistributionsBatched( vlsvReader, fileName, meshName, cellStruct, cellIdList, mainOptions );
+      vlsvReader.close();
+      return;
+   }
    //Iterate:
    for( it = cellIdList.begin(); it != cellIdList.end(); ++it ) {
       //get the cell id from the iterator:
       const uint64_t cellID = *it;
       //Print out the cell id:
       cout << "Cell id: " << cellID << endl;
-      // Create a new file suffix for the output file:
-      stringstream ss1;
-      ss1 << ".vlsv";
-      string newSuffix;
-      ss1 >> newSuffix;
-
-      // Create a new file prefix for the output file:
-      stringstream ss2;
-      ss2 << "velgrid" << '.';
-      if( mainOptions.rotateVectors ) {
-         ss2 << "rotated" << '.';
-      }
-      if( mainOptions.plasmaFrame ) {
-         ss2 << "shifted" << '.';
-      }
-      ss2 << cellID;
-      string newPrefix;
-      ss2 >> newPrefix;
-      
-      // Replace .vlsv with the new suffix:
-      string outputFileName = fileName;
-      size_t pos = outputFileName.rfind(".vlsv");
-      if (pos != string::npos) outputFileName.replace(pos, 5, newSuffix);
-   
-      pos = outputFileName.find(".");
-      if (pos != string::npos) outputFileName.replace(0, pos, newPrefix);
       
       string slicePrefix = "VelSlice";
       string outputSliceName = fileName;
-      pos = outputSliceName.find(".");
+      size_t pos = outputSliceName.find(".");
       if (pos != string::npos) outputSliceName.replace(0,pos,slicePrefix);
 
       //Declare the file path (used in DBCreate to save the file in the correct location)
-      string outputFilePath;
-      //Get the path (outputDirectoryPath was retrieved from user input and it's a vector<string>):
-      outputFilePath.append( mainOptions.outputDirectoryPath.front() );
-      //The complete file path is still missing the file name, so add it to the end:
-      outputFilePath.append( outputFileName );      
+      const string outputFilePath = getOutputFilePath( fileName, cellID, mainOptions );
 
       // Extract velocity grid from VLSV file, if possible, and write as vlsv file:
       bool velGridExtracted = true;
@@ -78,6 +78,7 @@ public:
    uint64_t cellId;
    std::vector<uint64_t> cellIdList;
    uint32_t numberOfCoordinatesInALine;
+   uint32_t batchSize;
    std::vector<std::string> outputDirectoryPath;
    std::array<Real, 3> coordinates;
    std::array<Real, 3> point1;
@@ -91,6 +92,7 @@ public:
       plasmaFrame =false;
       cellId = std::numeric_limits<uint64_t>::max();
       numberOfCoordinatesInALine = 0;
+      batchSize = 0;
    }
 
    ~UserOptions() {}
@@ -20,7 +20,16 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "vlsvreaderinterface.h"
+#include "vdf_compression.h"
 
 using namespace std;
 
@@ -68,14 +77,219 @@ namespace vlsvinterface {
       }
    }
 
+   static const char sidecarMagic[8] = {'V','L','S','V','I','D','X','1'};
+   static const uint64_t sidecarVersion = 2;
+   //Header: magic, version, VLSV file size, mtime (s), mtime (ns), number of sections
+   static const uint64_t sidecarHeaderWords = 6;
+
+   static uint64_t paddedKeyWords(const uint64_t& keyLength) {
+      return (keyLength + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+   }
+
+   SidecarIndex::SidecarIndex() : vlsvFileSize(0), vlsvMtimeSec(0), vlsvMtimeNsec(0), mapping(NULL), mappingSize(0) { }
+
+   SidecarIndex::~SidecarIndex() {
+      close();
+   }
+
+   bool SidecarIndex::open(const string& fname) {
+      close();
+      struct stat st;
+      if (stat(fname.c_str(),&st) != 0) return false;
+      vlsvFileName = fname;
+      indexFileName = fname + ".vlsvidx";
+      vlsvFileSize = st.st_size;
+      vlsvMtimeSec = st.st_mtim.tv_sec;
+      vlsvMtimeNsec = st.st_mtim.tv_nsec;
+      //A missing or stale index is not an error, sections are (re)built on demand:
+      mapFile();
+      return true;
+   }
+
+   void SidecarIndex::close() {
+      unmapFile();
+      vlsvFileName.clear();
+      indexFileName.clear();
+   }
+
+   void SidecarIndex::unmapFile() {
+      if (mapping != NULL) munmap(mapping,mappingSize);
+      mapping = NULL;
+      mappingSize = 0;
+      sections.clear();
+   }
+
+   bool SidecarIndex::mapFile() {
+      //The current mapping stays in place until the new one has been mapped and validated,
+      //so lookup tables pointing into it remain valid if remapping fails.
+      const int fd = ::open(indexFileName.c_str(),O_RDONLY);
+      if (fd < 0) return false;
+      struct stat st;
+      if (fstat(fd,&st) != 0 || st.st_size < (off_t)(sidecarHeaderWords*sizeof(uint64_t)) || st.st_size % sizeof(uint64_t) != 0) {
+         ::close(fd);
+         return false;
+      }
+      void* newMapping = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+      ::close(fd);
+      if (newMapping == MAP_FAILED) return false;
+      const size_t newMappingSize = st.st_size;
+
+      //Validate the header against the VLSV file, an index of an overwritten file is discarded:
+      const uint64_t* words = reinterpret_cast<const uint64_t*>(newMapping);
+      const uint64_t nWords = newMappingSize / sizeof(uint64_t);
+      map<string,array<uint64_t,3> > newSections;
+      bool valid = memcmp(words,sidecarMagic,sizeof(sidecarMagic)) == 0
+         && words[1] == sidecarVersion
+         && words[2] == vlsvFileSize
+         && (int64_t)words[3] == vlsvMtimeSec
+         && (int64_t)words[4] == vlsvMtimeNsec;
+      const uint64_t nSections = valid ? words[5] : 0;
+      uint64_t pos = sidecarHeaderWords;
+      for (uint64_t s = 0; valid && s < nSections; ++s) {
+         if (pos + 1 > nWords) { valid = false; break; }
+         const uint64_t keyLength = words[pos];
+         const uint64_t keyWords = paddedKeyWords(keyLength);
+         if (pos + 1 + keyWords + 2 > nWords) { valid = false; break; }
+         const string key(reinterpret_cast<const char*>(words + pos + 1),keyLength);
+         const uint64_t entrySize = words[pos + 1 + keyWords];
+         const uint64_t nEntries  = words[pos + 2 + keyWords];
+         const uint64_t begin = pos + 3 + keyWords;
+         if (entrySize == 0 || nEntries > (nWords - begin) / entrySize) { valid = false; break; }
+         newSections[key] = {begin,nEntries,entrySize};
+         pos = begin + nEntries*entrySize;
+      }
+      if (valid == false) {
+         munmap(newMapping,newMappingSize);
+         return false;
+      }
+      unmapFile();
+      mapping = newMapping;
+      mappingSize = newMappingSize;
+      sections.swap(newSections);
+      return true;
+   }
+
+   const uint64_t* SidecarIndex::find(const string& key,const uint64_t& entrySize,uint64_t& nEntries) const {
+      map<string,array<uint64_t,3> >::const_iterator it = sections.find(key);
+      if (it == sections.end() || it->second[2] != entrySize) return NULL;
+      nEntries = it->second[1];
+      return reinterpret_cast<const uint64_t*>(mapping) + it->second[0];
+   }
+
+   bool SidecarIndex::add(const string& key,const uint64_t& entrySize,const vector<uint64_t>& table) {
+      if (indexFileName.empty() == true || entrySize == 0) return false;
+
+      //Write the old sections followed by the new one into a temporary file and
+      //rename it over the index, so that concurrent readers never see a partial file.
+      const string tmpFileName = indexFileName + ".tmp." + to_string(getpid());
+      ofstream out(tmpFileName.c_str(),ios::binary | ios::trunc);
+      if (out.good() == false) return false;
+
+      uint64_t header[sidecarHeaderWords];
+      memcpy(header,sidecarMagic,sizeof(sidecarMagic));
+      header[1] = sidecarVersion;
+      header[2] = vlsvFileSize;
+      header[3] = vlsvMtimeSec;
+      header[4] = vlsvMtimeNsec;
+      header[5] = sections.size() + 1;
+      out.write(reinterpret_cast<const char*>(header),sizeof(header));
+      if (mapping != NULL) {
+         out.write(reinterpret_cast<const char*>(mapping) + sizeof(header),mappingSize - sizeof(header));
+      }
+      const uint64_t keyLength = key.size();
+      vector<char> paddedKey(paddedKeyWords(keyLength)*sizeof(uint64_t),'\0');
+      memcpy(paddedKey.data(),key.data(),keyLength);
+      const uint64_t nEntries = table.size() / entrySize;
+      out.write(reinterpret_cast<const char*>(&keyLength),sizeof(uint64_t));
+      out.write(paddedKey.data(),paddedKey.size());
+      out.write(reinterpret_cast<const char*>(&entrySize),sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(&nEntries),sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(table.data()),nEntries*entrySize*sizeof(uint64_t));
+      out.close();
+      if (out.fail() == true || rename(tmpFileName.c_str(),indexFileName.c_str()) != 0) {
+         unlink(tmpFileName.c_str());
+         return false;
+      }
+      return mapFile();
+   }
+
    Reader::Reader() : vlsv::Reader() {
+      cellIdTable = NULL;
+      cellIdTableSize = 0;
+      cellsWithBlocksTable = NULL;
+      cellsWithBlocksTableSize = 0;
       cellIdsSet = false;
       cellsWithBlocksSet = false;
+      const char* env = getenv("VLSV_SIDECAR_INDEX");
+      useSidecarIndex = (env != NULL && strcmp(env,"") != 0 && strcmp(env,"0") != 0);
+      sidecarIndexOpen = false;
    }
    
    Reader::~Reader() {
    
    }
+
+   bool Reader::open(const string& fname) {
+      clearCellIds();
+      clearCellsWithBlocks();
+      sidecarIndex.close();
+      sidecarIndexOpen = false;
+      if (vlsv::Reader::open(fname) == false) return false;
+      if (useSidecarIndex == true) sidecarIndexOpen = sidecarIndex.open(fname);
+      return true;
+   }
+
+   bool Reader::close() {
+      clearCellIds();
+      clearCellsWithBlocks();
+      sidecarIndex.close();
+      sidecarIndexOpen = false;
+      return vlsv::Reader::close();
+   }
+
+   const uint64_t* Reader::findEntry(const uint64_t* table,const uint64_t& tableSize,const uint64_t& entrySize,const uint64_t& cellId) const {
+      //Binary search over entries sorted by their first word (the cell id):
+      uint64_t low = 0;
+      uint64_t high = tableSize;
+      while (low < high) {
+         const uint64_t mid = low + (high-low)/2;
+         if (table[mid*entrySize] < cellId) low = mid+1;
+         else high = mid;
+      }
+      if (low < tableSize && table[low*entrySize] == cellId) return table + low*entrySize;
+      return NULL;
+   }
+
+   void Reader::resolveTables() {
+      //Point the lookup tables into the (re)mapped index and drop the heap copies:
+      uint64_t nEntries;
+      if (cellIdKey.empty() == false) {
+         const uint64_t* table = sidecarIndex.find(cellIdKey,kCellIdEntryWords,nEntries);
+         if (table != NULL) {
+            cellIdTable = table;
+            cellIdTableSize = nEntries;
+            vector<uint64_t>().swap(cellIdStorage);
+         } else if (cellIdStorage.empty() == false) {
+            cellIdTable = cellIdStorage.data();
+            cellIdTableSize = cellIdStorage.size() / kCellIdEntryWords;
+         } else {
+            clearCellIds();
+         }
+      }
+      if (cellsWithBlocksKey.empty() == false) {
+         const uint64_t* table = sidecarIndex.find(cellsWithBlocksKey,kCellsWithBlocksEntryWords,nEntries);
+         if (table != NULL) {
+            cellsWithBlocksTable = table;
+            cellsWithBlocksTableSize = nEntries;
+            vector<uint64_t>().swap(cellsWithBlocksStorage);
+         } else if (cellsWithBlocksStorage.empty() == false) {
+            cellsWithBlocksTable = cellsWithBlocksStorage.data();
+            cellsWithBlocksTableSize = cellsWithBlocksStorage.size() / kCellsWithBlocksEntryWords;
+         } else {
+            clearCellsWithBlocks();
+         }
+      }
+   }
    
    bool Reader::getMeshNames( list<string> & meshNames ) {
       set<string> meshNames_set;
@@ -163,9 +377,19 @@ namespace vlsvinterface {
    }
    
    bool Reader::setCellIds() {
-      if( cellIdLocations.empty() == false ) {
-         //Clear the cell ids
-         cellIdLocations.clear();
+      clearCellIds();
+      const string meshName = "SpatialGrid";
+      const string key = "CellID:" + meshName;
+      if( sidecarIndexOpen == true ) {
+         uint64_t nEntries;
+         const uint64_t* table = sidecarIndex.find(key,kCellIdEntryWords,nEntries);
+         if( table != NULL ) {
+            cellIdKey = key;
+            cellIdTable = table;
+            cellIdTableSize = nEntries;
+            cellIdsSet = true;
+            return true;
+         }
       }
       uint64_t vectorSize, byteSize;
       uint64_t amountToReadIn;
@@ -173,7 +397,7 @@ namespace vlsvinterface {
       const string variableName = "CellID";
       std::list< pair<std::string, std::string> > xmlAttributes;
       xmlAttributes.push_back( make_pair( "name", variableName ) );
-      xmlAttributes.push_back( make_pair( "mesh", "SpatialGrid" ) );
+      xmlAttributes.push_back( make_pair( "mesh", meshName ) );
       if( getArrayInfo( "VARIABLE", xmlAttributes, amountToReadIn, vectorSize, dataType, byteSize ) == false ) return false;
       if( dataType != vlsv::datatype::type::UINT ) {
          cerr << "ERROR, BAD DATATYPE AT " << __FILE__ << " " << __LINE__ << endl;
@@ -191,21 +415,45 @@ namespace vlsvinterface {
       //Read in cell ids to the buffer:
       const uint16_t begin = 0;
       const bool allocateMemory = false;
-      if( read( "VARIABLE", xmlAttributes, begin, amountToReadIn, cellIds_buffer, allocateMemory ) == false ) return false;
-      //Input cell ids:
-      cellIdLocations.rehash( (uint64_t)(amountToReadIn * vectorSize * 1.25) );
+      if( read( "VARIABLE", xmlAttributes, begin, amountToReadIn, cellIds_buffer, allocateMemory ) == false ) {
+         delete[] cellIds_buffer;
+         return false;
+      }
+      //Input cell ids as (cellid,row) pairs sorted by cell id:
+      vector<pair<uint64_t,uint64_t> > locations(amountToReadIn * vectorSize);
       for( uint64_t i = 0; i < amountToReadIn * vectorSize; ++i ) {
-         const uint64_t cellid = cellIds_buffer[i];
-         cellIdLocations[cellid] = i;
+         locations[i] = make_pair(cellIds_buffer[i], i);
       }
       delete[] cellIds_buffer;
+      sort(locations.begin(), locations.end());
+      cellIdStorage.resize(kCellIdEntryWords*locations.size());
+      for( uint64_t i = 0; i < locations.size(); ++i ) {
+         cellIdStorage[kCellIdEntryWords*i]   = locations[i].first;
+         cellIdStorage[kCellIdEntryWords*i+1] = locations[i].second;
+      }
+      cellIdKey = key;
+      cellIdTable = cellIdStorage.data();
+      cellIdTableSize = locations.size();
       cellIdsSet = true;
-      return true;
+      if( sidecarIndexOpen == true && sidecarIndex.add(key, kCellIdEntryWords, cellIdStorage) == true ) {
+         resolveTables();
+      }
+      return cellIdsSet;
    }
 
    bool Reader::setCellsWithBlocks(const std::string& meshName,const std::string& popName) {
-      if(cellsWithBlocksLocations.empty() == false) {
-         cellsWithBlocksLocations.clear();
+      clearCellsWithBlocks();
+      const string key = "CellsWithBlocks:" + meshName + ":" + popName;
+      if (sidecarIndexOpen == true) {
+         uint64_t nEntries;
+         const uint64_t* table = sidecarIndex.find(key,kCellsWithBlocksEntryWords,nEntries);
+         if (table != NULL) {
+            cellsWithBlocksKey = key;
+            cellsWithBlocksTable = table;
+            cellsWithBlocksTableSize = nEntries;
+            cellsWithBlocksSet = true;
+            return true;
+         }
       }
       vlsv::datatype::type cwb_dataType;
       uint64_t cwb_arraySize, cwb_vectorSize, cwb_dataSize;
@@ -254,6 +502,7 @@ namespace vlsvinterface {
       //Read array info -- stores output in nb_arraySize, nb_vectorSize, nb_dataType, nb_dataSize
       if (getArrayInfo("BLOCKSPERCELL", attribs, nb_arraySize, nb_vectorSize, nb_dataType, nb_dataSize) == false) {
          cerr << "ERROR, COULD NOT FIND ARRAY BLOCKSPERCELL AT " << __FILE__ << " " << __LINE__ << endl;
+         delete[] cwb_buffer;
          return false;
       }
    
@@ -267,22 +516,39 @@ namespace vlsvinterface {
          return false;
       }
    
-      // Input cellswithblock locations:
+      // Input cellswithblock locations as (cellid,offset,blocks,row in CELLSWITHBLOCKS) sorted by cell id:
+      vector<array<uint64_t,kCellsWithBlocksEntryWords> > locations(cwb_arraySize);
       uint64_t blockOffset = 0;
       uint64_t N_blocks;
       for (uint64_t cell = 0; cell < cwb_arraySize; ++cell) {
          const uint64_t readCellID = convUInt(cwb_buffer + cell*cwb_dataSize, cwb_dataType, cwb_dataSize);
          N_blocks = convUInt(nb_buffer + cell*nb_dataSize, nb_dataType, nb_dataSize);
-         const pair<uint64_t, uint32_t> input = make_pair( blockOffset, N_blocks );
-         //Insert the location and number of blocks into the map
-         cellsWithBlocksLocations.insert( make_pair(readCellID, input) );
+         locations[cell] = {readCellID, blockOffset, N_blocks, cell};
          blockOffset += N_blocks;
       }
-   
       delete[] cwb_buffer;
       delete[] nb_buffer;
+
+      sort(locations.begin(), locations.end());
+      cellsWithBlocksStorage.resize(kCellsWithBlocksEntryWords*locations.size());
+      for (uint64_t i = 0; i < locations.size(); ++i) {
+         for (uint64_t j = 0; j < kCellsWithBlocksEntryWords; ++j) cellsWithBlocksStorage[kCellsWithBlocksEntryWords*i+j] = locations[i][j];
+      }
+      cellsWithBlocksKey = key;
+      cellsWithBlocksTable = cellsWithBlocksStorage.data();
+      cellsWithBlocksTableSize = locations.size();
       cellsWithBlocksSet = true;
-      return true;
+      if (sidecarIndexOpen == true && sidecarIndex.add(key, kCellsWithBlocksEntryWords, cellsWithBlocksStorage) == true) {
+         resolveTables();
+      }
+      return cellsWithBlocksSet;
+   }
+
+   void Reader::getCellsWithBlocks(vector<uint64_t>& cellIds) const {
+      cellIds.resize(cellsWithBlocksTableSize);
+      for (uint64_t i = 0; i < cellsWithBlocksTableSize; ++i) {
+         cellIds[i] = cellsWithBlocksTable[kCellsWithBlocksEntryWords*i];
+      }
    }
 
    bool Reader::getBlockIds(const uint64_t& cellId,std::vector<uint64_t>& blockIds,const std::string& popName) {
@@ -291,15 +557,14 @@ namespace vlsvinterface {
          return false;
       }
       //Check if the cell id can be found:
-      unordered_map<uint64_t, pair<uint64_t, uint32_t>>::const_iterator it = cellsWithBlocksLocations.find( cellId );
-      if( it == cellsWithBlocksLocations.end() ) {
+      const uint64_t* entry = findEntry(cellsWithBlocksTable, cellsWithBlocksTableSize, kCellsWithBlocksEntryWords, cellId);
+      if( entry == NULL ) {
          cerr << "COULDNT FIND CELL ID " << cellId << " AT " << __FILE__ << " " << __LINE__ << endl;
          return false;
       }
       //Get offset and number of blocks:
-      pair<uint64_t, uint32_t> offsetAndBlocks = it->second;
-      const uint64_t blockOffset = get<0>(offsetAndBlocks);
-      const uint32_t N_blocks = get<1>(offsetAndBlocks);
+      const uint64_t blockOffset = entry[1];
+      const uint32_t N_blocks = entry[2];
    
       // Get some required info from VLSV file:
       list<pair<string, string> > attribs;
@@ -343,8 +608,8 @@ namespace vlsvinterface {
       }
    
       //Check if the cell id can be found:
-      unordered_map<uint64_t, pair<uint64_t, uint32_t>>::const_iterator it = cellsWithBlocksLocations.find( cellId );
-      if( it == cellsWithBlocksLocations.end() ) {
+      const uint64_t* entry = findEntry(cellsWithBlocksTable, cellsWithBlocksTableSize, kCellsWithBlocksEntryWords, cellId);
+      if( entry == NULL ) {
          cerr << "COULDNT FIND CELL ID " << cellId << " AT " << __FILE__ << " " << __LINE__ << endl;
          return false;
       }
@@ -354,17 +619,31 @@ namespace vlsvinterface {
       attribs.push_back(make_pair("name", variableName));
       attribs.push_back(make_pair("mesh", "SpatialGrid"));
 
+      //Get offset and number of blocks
+      const uint64_t offset = entry[1];
+      const uint32_t amountToReadIn = entry[2];
+
       vlsv::datatype::type dataType;
       uint64_t arraySize, vectorSize, dataSize;
       if (getArrayInfo("BLOCKVARIABLE", attribs, arraySize, vectorSize, dataType, dataSize) == false) {
-         cerr << "Could not read BLOCKVARIABLE array info" << endl;
-         return false;
+         //Bulk files written with io.vdf_compression_tolerance only have the compressed distribution:
+         uint32_t valuesPerBlock;
+         if (getCompressedBlockVariableInfo(attribs, valuesPerBlock) == false) {
+            cerr << "Could not read BLOCKVARIABLE array info" << endl;
+            return false;
+         }
+         vector<float> values;
+         if (readCompressedBlockVariable(attribs, entry[3], amountToReadIn, values, valuesPerBlock) == false) {
+            cerr << "ERROR could not read compressed block variable" << endl;
+            return false;
+         }
+         if( allocateMemory == true ) {
+            buffer = new char[values.size() * sizeof(float)];
+         }
+         memcpy(buffer, values.data(), values.size() * sizeof(float));
+         return true;
       }
    
-      //Get offset and number of blocks
-      const uint64_t offset = get<0>(it->second);
-      const uint32_t amountToReadIn = get<1>(it->second);
-   
       if( allocateMemory == true ) {
          buffer = new char[amountToReadIn * vectorSize * dataSize];
       }
@@ -380,4 +659,29 @@ namespace vlsvinterface {
       return true;
    }
 
+   bool Reader::getCompressedBlockVariableInfo(const list<pair<string,string> >& attribs,uint32_t& valuesPerBlock) {
+      map<string,string> attribsOut;
+      if (getArrayAttributes("BLOCKVARIABLECOMPRESSED", attribs, attribsOut) == false) return false;
+      if (attribsOut["encoding"] != vdfcompression::ENCODING_NAME) {
+         cerr << "ERROR, unsupported velocity distribution encoding '" << attribsOut["encoding"] << "' AT " << __FILE__ << " " << __LINE__ << endl;
+         return false;
+      }
+      valuesPerBlock = atoi(attribsOut["values_per_block"].c_str());
+      return valuesPerBlock > 0;
+   }
+
+   bool Reader::readCompressedBlockVariable(const list<pair<string,string> >& attribs,const uint64_t& row,
+                                            const uint64_t& nBlocks,vector<float>& values,uint32_t& valuesPerBlock) {
+      if (getCompressedBlockVariableInfo(attribs, valuesPerBlock) == false) return false;
+      //(byte offset,size) of the stream of each cell, in the order of CELLSWITHBLOCKS:
+      uint64_t streamLocation[2];
+      if (readArray("BLOCKVARIABLECOMPRESSEDOFFSETS", attribs, row, 1, reinterpret_cast<char*>(streamLocation)) == false) return false;
+      vector<unsigned char> stream(streamLocation[1]);
+      if (stream.size() > 0
+          && readArray("BLOCKVARIABLECOMPRESSED", attribs, streamLocation[0], stream.size(), reinterpret_cast<char*>(stream.data())) == false) {
+         return false;
+      }
+      return vdfcompression::decodeCell(stream.data(), stream.size(), nBlocks, valuesPerBlock, values);
+   }
+
 } // namespace vlsvinterface
@@ -26,6 +26,7 @@
 #include <map>
 #include <vector>
 #include <unordered_map>
+#include <string>
 #include <array>
 #include <vlsv_reader.h>
 
@@ -34,15 +35,71 @@
 extern float checkVersion( const std::string & fname );
 
 namespace vlsvinterface {
+   //Words per entry of the Reader lookup tables: (cellid,row) and (cellid,offset,blocks,row)
+   const uint64_t kCellIdEntryWords = 2;
+   const uint64_t kCellsWithBlocksEntryWords = 4;
+
+   /* Optional sidecar index for a VLSV file. The index is stored next to the file as
+    * <file>.vlsvidx and holds the sorted lookup tables the Reader otherwise rebuilds on
+    * every open (cell id -> row of the SpatialGrid arrays, cell id -> block offset and
+    * block count per mesh/population). It is validated against the size and modification
+    * time of the VLSV file, memory-mapped read-only, and sections missing from it are
+    * appended the first time they are built. Enabled with Reader::setUseSidecarIndex()
+    * or by setting the environment variable VLSV_SIDECAR_INDEX to a non-zero value.
+    */
+   class SidecarIndex {
+   public:
+      SidecarIndex();
+      ~SidecarIndex();
+      bool open(const std::string& vlsvFileName);
+      void close();
+      //Returns the table stored under key (entries of entrySize uint64_t each), or NULL:
+      const uint64_t* find(const std::string& key,const uint64_t& entrySize,uint64_t& nEntries) const;
+      //Appends a table to the index file and remaps it. Returns false if the file could not be written.
+      bool add(const std::string& key,const uint64_t& entrySize,const std::vector<uint64_t>& table);
+   private:
+      SidecarIndex(const SidecarIndex&);
+      SidecarIndex& operator=(const SidecarIndex&);
+      bool mapFile();
+      void unmapFile();
+
+      std::string vlsvFileName;
+      std::string indexFileName;
+      uint64_t vlsvFileSize;
+      int64_t vlsvMtimeSec;
+      int64_t vlsvMtimeNsec;
+      void* mapping;
+      size_t mappingSize;
+      //Key -> (word offset into mapping, number of entries, entry size in words):
+      std::map<std::string,std::array<uint64_t,3> > sections;
+   };
+
    class Reader : public vlsv::Reader {
    private:
-      std::unordered_map<uint64_t, uint64_t> cellIdLocations;
-      std::unordered_map<uint64_t, std::pair<uint64_t, uint32_t> > cellsWithBlocksLocations;
+      //Sorted lookup tables, either pointing into the memory-mapped sidecar index or
+      //into the storage vectors below. Entries are (cellid,row) and (cellid,offset,blocks,row).
+      const uint64_t* cellIdTable;
+      uint64_t cellIdTableSize;
+      std::vector<uint64_t> cellIdStorage;
+      std::string cellIdKey;
+      const uint64_t* cellsWithBlocksTable;
+      uint64_t cellsWithBlocksTableSize;
+      std::vector<uint64_t> cellsWithBlocksStorage;
+      std::string cellsWithBlocksKey;
       bool cellIdsSet;
       bool cellsWithBlocksSet;
+      bool useSidecarIndex;
+      SidecarIndex sidecarIndex;
+      bool sidecarIndexOpen;
+
+      const uint64_t* findEntry(const uint64_t* table,const uint64_t& tableSize,const uint64_t& entrySize,const uint64_t& cellId) const;
+      void resolveTables();
    public:
       Reader();
       virtual ~Reader();
+      bool open(const std::string& fname);
+      bool close();
+      inline void setUseSidecarIndex(bool use) { useSidecarIndex = use; }
       bool getMeshNames( std::list<std::string> & meshNames ); //Function for getting mesh names
       bool getMeshNames( std::set<std::string> & meshNames );
       bool getVariableNames( const std::string&, std::list<std::string> & meshNames );
@@ -54,35 +111,74 @@ namespace vlsvinterface {
       bool getBlockIds( const uint64_t& cellId,std::vector<uint64_t>& blockIds,const std::string& popName );
       bool setCellIds();
       inline void clearCellIds() {
-         cellIdLocations.clear();
+         cellIdStorage.clear();
+         cellIdKey.clear();
+         cellIdTable = NULL;
+         cellIdTableSize = 0;
          cellIdsSet = false;
       }
       bool setCellsWithBlocks(const std::string& meshName,const std::string& popName);
       inline void clearCellsWithBlocks() {
-         cellsWithBlocksLocations.clear();
+         cellsWithBlocksStorage.clear();
+         cellsWithBlocksKey.clear();
+         cellsWithBlocksTable = NULL;
+         cellsWithBlocksTableSize = 0;
          cellsWithBlocksSet = false;
       }
+      //Row of cellId in the SpatialGrid arrays, requires setCellIds():
+      inline bool getCellRow( const uint64_t& cellId, uint64_t& row ) const {
+         const uint64_t* entry = findEntry(cellIdTable,cellIdTableSize,kCellIdEntryWords,cellId);
+         if( entry == NULL ) return false;
+         row = entry[1];
+         return true;
+      }
+      //Block offset and number of blocks of cellId, requires setCellsWithBlocks():
+      inline bool getBlockRange( const uint64_t& cellId, uint64_t& offset, uint64_t& nBlocks ) const {
+         const uint64_t* entry = findEntry(cellsWithBlocksTable,cellsWithBlocksTableSize,kCellsWithBlocksEntryWords,cellId);
+         if( entry == NULL ) return false;
+         offset = entry[1];
+         nBlocks = entry[2];
+         return true;
+      }
+      //As above, also returns the row of cellId in CELLSWITHBLOCKS:
+      inline bool getBlockRange( const uint64_t& cellId, uint64_t& offset, uint64_t& nBlocks, uint64_t& row ) const {
+         const uint64_t* entry = findEntry(cellsWithBlocksTable,cellsWithBlocksTableSize,kCellsWithBlocksEntryWords,cellId);
+         if( entry == NULL ) return false;
+         offset = entry[1];
+         nBlocks = entry[2];
+         row = entry[3];
+         return true;
+      }
+      //Cell ids with blocks set by setCellsWithBlocks(), in ascending order:
+      void getCellsWithBlocks( std::vector<uint64_t>& cellIds ) const;
+      //Block data of cellId, requires setCellsWithBlocks(). Lossy compressed distributions are returned decoded as floats:
       bool getVelocityBlockVariables( const std::string & variableName, const uint64_t & cellId, char*& buffer, bool allocateMemory = true );
+      //Lossy compressed velocity distributions (see vdf_compression.h), attribs are the population name and spatial mesh.
+      //Returns false if the array does not exist or its encoding is not supported:
+      bool getCompressedBlockVariableInfo( const std::list< std::pair<std::string, std::string> >& attribs, uint32_t& valuesPerBlock );
+      //Reads and decodes the distribution of the cell on the given row of CELLSWITHBLOCKS:
+      bool readCompressedBlockVariable( const std::list< std::pair<std::string, std::string> >& attribs, const uint64_t& row,
+                                        const uint64_t& nBlocks, std::vector<float>& values, uint32_t& valuesPerBlock );
 
       inline uint64_t getBlockOffset( const uint64_t & cellId ) {
          //Check if the cell id can be found:
-         std::unordered_map<uint64_t, std::pair<uint64_t,uint32_t> >::const_iterator it = cellsWithBlocksLocations.find( cellId );
-         if( it == cellsWithBlocksLocations.end() ) {
+         const uint64_t* entry = findEntry(cellsWithBlocksTable,cellsWithBlocksTableSize,kCellsWithBlocksEntryWords,cellId);
+         if( entry == NULL ) {
             std::cerr << "COULDNT FIND CELL ID " << cellId << " AT " << __FILE__ << " " << __LINE__ << std::endl;
             exit(1);
          }
          //Get offset:
-         return std::get<0>(it->second);
+         return entry[1];
       }
       inline uint32_t getNumberOfBlocks( const uint64_t & cellId ) {
          //Check if the cell id can be found:
-         std::unordered_map<uint64_t, std::pair<uint64_t,uint32_t> >::const_iterator it = cellsWithBlocksLocations.find( cellId );
-         if( it == cellsWithBlocksLocations.end() ) {
+         const uint64_t* entry = findEntry(cellsWithBlocksTable,cellsWithBlocksTableSize,kCellsWithBlocksEntryWords,cellId);
+         if( entry == NULL ) {
             std::cerr << "COULDNT FIND CELL ID " << cellId << " AT " << __FILE__ << " " << __LINE__ << std::endl;
             exit(1);
          }
          //Get number of blocks:
-         return std::get<1>(it->second);
+         return entry[2];
       }
    };
 
@@ -93,8 +189,8 @@ namespace vlsvinterface {
          return false;
       }
       //Check if the cell id is in the list:
-      std::unordered_map<uint64_t, uint64_t>::const_iterator findCell = cellIdLocations.find(cellId);
-      if( findCell == cellIdLocations.end() ) {
+      const uint64_t* findCell = findEntry(cellIdTable,cellIdTableSize,kCellIdEntryWords,cellId);
+      if( findCell == NULL ) {
          std::cerr << "ERROR, CELL ID NOT FOUND AT " << __FILE__ << " " << __LINE__ << std::endl;
          return false;
       }
@@ -112,7 +208,7 @@ namespace vlsvinterface {
       const uint64_t amountToReadIn = 1;
       char * buffer = new char[vectorSize * amountToReadIn * byteSize];
       //Read in variable to the buffer:
-      const uint64_t begin = findCell->second;
+      const uint64_t begin = findCell[1];
       if( readArray( "VARIABLE", xmlAttributes, begin, amountToReadIn, buffer ) == false ) return false;
       float * buffer_float = reinterpret_cast<float*>(buffer);
       double * buffer_double = reinterpret_cast<double*>(buffer);
@@ -0,0 +1,339 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+/* Lossy, error-bounded codec for velocity distributions written to bulk files.
+ * Header-only so that both Vlasiator and the VLSV tools can use it.
+ *
+ * The data of one spatial cell is encoded into a single byte stream. The first byte is
+ * the encoding mode:
+ *   MODE_QUANTIZED: each block stores its quantization step as a 32-bit float and a 5-bit
+ *                   Rice parameter, followed by the Rice coded zigzag deltas of the
+ *                   quantized values in block-internal order. Blocks are bit-packed
+ *                   back to back, the stream is padded to a full byte at the end.
+ *   MODE_RAW:       the values are stored as 32-bit floats.
+ * The quantization step of a block is at most 2*tolerance*(block maximum), so the
+ * reconstruction error of each value is at most tolerance times the block maximum. A
+ * corrupt or truncated stream is detected and rejected by the decoder. Blocks whose maximum
+ * is below the sparsity threshold of the cell are dropped by the encoder.
+ *
+ * The encoder checks that the density, the bulk flux and the trace of the second moment
+ * of the decoded distribution match the original ones (dropped blocks included) within
+ * the tolerance. If not, it retries with a tighter step, then without dropping, and
+ * finally falls back to the raw mode.*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace vdfcompression {
+
+   const char ENCODING_NAME[] = "rice_quantized_v1"; /**< Value of the "encoding" attribute in VLSV files.*/
+
+   enum Mode {
+      MODE_QUANTIZED = 0,
+      MODE_RAW       = 1
+   };
+
+   /** Geometry of a (non-refined) velocity mesh, needed to evaluate the velocity moments.*/
+   struct MeshGeometry {
+      uint64_t gridLength[3];    /**< Number of blocks in each direction.*/
+      uint32_t blockLength;      /**< Number of velocity cells per block per direction (WID).*/
+      double meshMinLimits[3];   /**< Minimum velocity coordinates of the mesh.*/
+      double cellSize[3];        /**< Size of a velocity cell in each direction.*/
+   };
+
+   class BitWriter {
+    public:
+      BitWriter(std::vector<unsigned char>& out): out(out),buffer(0),nBits(0) { }
+
+      inline void write(uint64_t value,int bits) {
+         for (int b=bits-1; b>=0; --b) put((value >> b) & 1);
+      }
+
+      inline void writeUnary(uint64_t value) {
+         for (uint64_t i=0; i<value; ++i) put(1);
+         put(0);
+      }
+
+      inline void flush() {
+         if (nBits == 0) return;
+         out.push_back(static_cast<unsigned char>(buffer << (8-nBits)));
+         buffer = 0;
+         nBits = 0;
+      }
+
+    private:
+      inline void put(const unsigned int bit) {
+         buffer = (buffer << 1) | bit;
+         if (++nBits == 8) {
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer = 0;
+            nBits = 0;
+         }
+      }
+
+      std::vector<unsigned char>& out;
+      unsigned int buffer;
+      int nBits;
+   };
+
+   class BitReader {
+    public:
+      BitReader(const unsigned char* data,const size_t size): data(data),size(size),position(0) { }
+
+      inline bool read(uint64_t& value,int bits) {
+         value = 0;
+         for (int b=0; b<bits; ++b) {
+            unsigned int bit;
+            if (get(bit) == false) return false;
+            value = (value << 1) | bit;
+         }
+         return true;
+      }
+
+      inline bool readUnary(uint64_t& value) {
+         value = 0;
+         unsigned int bit;
+         while (true) {
+            if (get(bit) == false) return false;
+            if (bit == 0) return true;
+            ++value;
+         }
+      }
+
+    private:
+      inline bool get(unsigned int& bit) {
+         if (position >= 8*size) return false;
+         bit = (data[position/8] >> (7 - position%8)) & 1;
+         ++position;
+         return true;
+      }
+
+      const unsigned char* data;
+      size_t size;
+      size_t position;
+   };
+
+   inline uint64_t zigzag(const int64_t value) {
+      return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+   }
+
+   inline int64_t unzigzag(const uint64_t value) {
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+   }
+
+   inline uint32_t floatBits(const float value) {
+      uint32_t bits;
+      std::memcpy(&bits,&value,sizeof(bits));
+      return bits;
+   }
+
+   inline float bitsFloat(const uint32_t bits) {
+      float value;
+      std::memcpy(&value,&bits,sizeof(value));
+      return value;
+   }
+
+   /** Quantization step of a block with the given maximum: the largest float not above
+    * 2*tolerance*blockMax, so that the error bound also holds where the step is subnormal.
+    * Steps that would underflow to zero use the smallest subnormal float instead, all floats
+    * are integer multiples of it and are thus reconstructed exactly.*/
+   inline float quantizationStep(const double tolerance,const double blockMax) {
+      const double target = 2*tolerance*blockMax;
+      if (!(target > 0)) return 0;
+      float step = static_cast<float>(target);
+      if (step > target) step = std::nextafter(step,0.0f);
+      if (step == 0) step = std::numeric_limits<float>::denorm_min();
+      return step;
+   }
+
+   /** Quantize one block and append it to the bit stream.
+    * @param data Block data, blockSize values.
+    * @param blockSize Number of values in the block.
+    * @param step Quantization step, values are reconstructed as q*step.
+    * @param writer Output bit stream.
+    * @param decoded Reconstructed values, used for the moment check.*/
+   template<typename T>
+   inline void encodeBlock(const T* data,const uint32_t blockSize,const float step,BitWriter& writer,float* decoded) {
+      std::vector<uint64_t> symbols(blockSize);
+      int64_t previous = 0;
+      uint64_t sum = 0;
+      for (uint32_t i=0; i<blockSize; ++i) {
+         const int64_t q = (step > 0) ? static_cast<int64_t>(std::llround(data[i]/step)) : 0;
+         decoded[i] = q*step;
+         symbols[i] = zigzag(q - previous);
+         sum += symbols[i];
+         previous = q;
+      }
+
+      // Rice parameter that minimises the coded length of this block:
+      int k = 0;
+      uint64_t bestLength = UINT64_MAX;
+      for (int candidate=0; candidate<32; ++candidate) {
+         uint64_t length = 0;
+         for (uint32_t i=0; i<blockSize; ++i) length += (symbols[i] >> candidate) + 1 + candidate;
+         if (length < bestLength) {
+            bestLength = length;
+            k = candidate;
+         }
+         if ((sum >> candidate) == 0) break;
+      }
+
+      writer.write(floatBits(step),32);
+      writer.write(k,5);
+      for (uint32_t i=0; i<blockSize; ++i) {
+         writer.writeUnary(symbols[i] >> k);
+         if (k > 0) writer.write(symbols[i] & ((1ull << k) - 1),k);
+      }
+   }
+
+   /** Accumulate density, flux and the trace of the second moment of a block.*/
+   template<typename T>
+   inline void accumulateMoments(const T* data,const uint64_t blockGID,const MeshGeometry& mesh,double* moments,double* scales) {
+      const uint32_t WIDB = mesh.blockLength;
+      const uint64_t bx = blockGID % mesh.gridLength[0];
+      const uint64_t by = (blockGID / mesh.gridLength[0]) % mesh.gridLength[1];
+      const uint64_t bz = blockGID / (mesh.gridLength[0]*mesh.gridLength[1]);
+      const double dV = mesh.cellSize[0]*mesh.cellSize[1]*mesh.cellSize[2];
+      for (uint32_t k=0; k<WIDB; ++k) for (uint32_t j=0; j<WIDB; ++j) for (uint32_t i=0; i<WIDB; ++i) {
+         const double f = data[i + j*WIDB + k*WIDB*WIDB]*dV;
+         const double v[3] = {mesh.meshMinLimits[0] + (bx*WIDB + i + 0.5)*mesh.cellSize[0],
+                              mesh.meshMinLimits[1] + (by*WIDB + j + 0.5)*mesh.cellSize[1],
+                              mesh.meshMinLimits[2] + (bz*WIDB + k + 0.5)*mesh.cellSize[2]};
+         moments[0] += f;
+         scales[0]  += std::fabs(f);
+         for (int c=0; c<3; ++c) {
+            moments[1+c] += f*v[c];
+            scales[1+c]  += std::fabs(f*v[c]);
+         }
+         moments[4] += f*(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+         scales[4]  += std::fabs(f)*(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+      }
+   }
+
+   /** Encode the velocity distribution of one spatial cell.
+    * @param data Block data of the cell, nBlocks*WID3 values.
+    * @param blockGIDs Global IDs of the blocks.
+    * @param nBlocks Number of blocks in the cell.
+    * @param mesh Velocity mesh geometry.
+    * @param tolerance Relative error bound of values and moments.
+    * @param sparsityThreshold Blocks whose maximum is below this value are dropped.
+    * @param output The encoded stream is appended here.
+    * @param keep keep[b] is set to true if block b was written, the decoder only sees the kept blocks.
+    * @return The mode that was used.*/
+   template<typename T>
+   inline Mode encodeCell(const T* data,const uint64_t* blockGIDs,const uint64_t nBlocks,const MeshGeometry& mesh,
+                          const double tolerance,const double sparsityThreshold,
+                          std::vector<unsigned char>& output,std::vector<bool>& keep) {
+      const uint32_t blockSize = mesh.blockLength*mesh.blockLength*mesh.blockLength;
+      keep.assign(nBlocks,true);
+
+      double original[5] = {0,0,0,0,0};
+      double scales[5] = {0,0,0,0,0};
+      std::vector<double> blockMax(nBlocks,0);
+      for (uint64_t b=0; b<nBlocks; ++b) {
+         accumulateMoments(data+b*blockSize,blockGIDs[b],mesh,original,scales);
+         for (uint32_t i=0; i<blockSize; ++i) blockMax[b] = std::max(blockMax[b],std::fabs(static_cast<double>(data[b*blockSize+i])));
+      }
+
+      const size_t start = output.size();
+      std::vector<float> decoded(blockSize);
+      if (tolerance > 0) {
+         const double attempts[3][2] = {{tolerance,sparsityThreshold},{0.25*tolerance,sparsityThreshold},{0.0625*tolerance,0.0}};
+         for (int attempt=0; attempt<3; ++attempt) {
+            const double tol = attempts[attempt][0];
+            output.resize(start);
+            output.push_back(MODE_QUANTIZED);
+            BitWriter writer(output);
+            double moments[5] = {0,0,0,0,0};
+            double dummy[5] = {0,0,0,0,0};
+            for (uint64_t b=0; b<nBlocks; ++b) {
+               keep[b] = blockMax[b] >= attempts[attempt][1];
+               if (keep[b] == false) continue;
+               encodeBlock(data+b*blockSize,blockSize,quantizationStep(tol,blockMax[b]),writer,decoded.data());
+               accumulateMoments(decoded.data(),blockGIDs[b],mesh,moments,dummy);
+            }
+            writer.flush();
+
+            bool ok = true;
+            for (int m=0; m<5; ++m) {
+               if (!(std::fabs(moments[m]-original[m]) <= tolerance*scales[m])) ok = false;
+            }
+            if (ok == true) return MODE_QUANTIZED;
+         }
+      }
+
+      keep.assign(nBlocks,true);
+      output.resize(start);
+      output.push_back(MODE_RAW);
+      const size_t rawStart = output.size();
+      output.resize(rawStart + nBlocks*blockSize*sizeof(float));
+      for (uint64_t i=0; i<nBlocks*blockSize; ++i) {
+         const float value = data[i];
+         std::memcpy(&output[rawStart + i*sizeof(float)],&value,sizeof(float));
+      }
+      return MODE_RAW;
+   }
+
+   /** Decode the velocity distribution of one spatial cell.
+    * @param stream Encoded stream of the cell.
+    * @param size Size of the stream in bytes.
+    * @param nBlocks Number of (kept) blocks in the cell.
+    * @param blockSize Number of values per block.
+    * @param output Decoded values, nBlocks*blockSize.
+    * @return If false, the stream was corrupt or truncated.*/
+   inline bool decodeCell(const unsigned char* stream,const size_t size,const uint64_t nBlocks,const uint32_t blockSize,
+                          std::vector<float>& output) {
+      output.assign(nBlocks*blockSize,0);
+      if (nBlocks == 0) return true;
+      if (size < 1) return false;
+
+      if (stream[0] == MODE_RAW) {
+         if (size < 1 + nBlocks*blockSize*sizeof(float)) return false;
+         std::memcpy(output.data(),stream+1,nBlocks*blockSize*sizeof(float));
+         return true;
+      }
+      if (stream[0] != MODE_QUANTIZED) return false;
+
+      BitReader reader(stream+1,size-1);
+      for (uint64_t b=0; b<nBlocks; ++b) {
+         uint64_t stepBits, k;
+         if (reader.read(stepBits,32) == false) return false;
+         if (reader.read(k,5) == false) return false;
+         const float step = bitsFloat(static_cast<uint32_t>(stepBits));
+         if (!(step >= 0) || std::isinf(step)) return false;
+         int64_t previous = 0;
+         for (uint32_t i=0; i<blockSize; ++i) {
+            uint64_t high, low = 0;
+            if (reader.readUnary(high) == false) return false;
+            if (k > 0 && reader.read(low,k) == false) return false;
+            previous += unzigzag((high << k) | low);
+            output[b*blockSize+i] = previous*step;
+         }
+      }
+      return true;
+   }
+
+} // namespace vdfcompression
@@ -59,6 +59,7 @@
 #include "iowrite.h"
 #include "ioread.h"
 #include "memory_report.h"
+#include "telemetry.h"
 
 #include "object_wrapper.h"
 #include "velocity_mesh_parameters.h"
@@ -123,6 +124,7 @@ void addTimedBarrier(string name){
    return;
 #endif
    phiprof::Timer btimer {name, {"Barriers", "MPI"}};
+   telemetry::Timer waitTelemetry {telemetry::MPI_WAIT};
    MPI_Barrier(MPI_COMM_WORLD);
 }
 
@@ -164,7 +166,9 @@ void computeNewTimeStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
       }
    }
 
+   telemetry::Timer waitTelemetry {telemetry::MPI_WAIT};
    MPI_Allreduce(&(dtMaxLocal[0]), &(dtMaxGlobal[0]), 3, MPI_Type<Real>(), MPI_MIN, MPI_COMM_WORLD);
+   waitTelemetry.stop();
 
    // If any of the solvers are disabled there should be no limits in timespace from it
    if (!P::propagateVlasovTranslation)
@@ -276,6 +280,7 @@ int simulate(int argn,char* args[]) {
    getObjectWrapper().addParameters();
    readparameters.parse();
    P::getParameters();
+   block_pool::setEnabled(P::velocityBlockPool);
 
    getObjectWrapper().addPopulationParameters();
    sysBoundaryContainer.addParameters();
@@ -583,7 +588,10 @@ int simulate(int argn,char* args[]) {
       
       if (myRank == MASTER_RANK) logFile << "(MAIN): Exiting." << endl << writeVerbose;
       logFile.close();
-      if (P::diagnosticInterval != 0) diagnostic.close();
+      if (P::diagnosticInterval != 0) {
+         flushDiagnostic();
+         diagnostic.close();
+      }
       
       perBGrid.finalize();
       perBDt2Grid.finalize();
@@ -844,9 +852,11 @@ int simulate(int argn,char* args[]) {
          P::t-P::dt <= P::t_max+DT_EPSILON &&
          wallTimeRestartCounter <= P::exitAfterRestarts) {
 
+      telemetry::Timer stepTelemetry {telemetry::STEP};
       addTimedBarrier("barrier-loop-start");
       
       phiprof::Timer ioTimer {"IO"};
+      telemetry::Timer ioTelemetry {telemetry::IO};
 
       phiprof::Timer externalsTimer {"checkExternalCommands"};
       if(myRank ==  MASTER_RANK) {
@@ -957,7 +967,9 @@ int simulate(int argn,char* args[]) {
 
       // Reduce globalflags::bailingOut from all processes
       phiprof::Timer bailoutReduceTimer {"Bailout-allreduce"};
+      telemetry::Timer bailoutTelemetry {telemetry::MPI_WAIT};
       MPI_Allreduce(&(globalflags::bailingOut), &(doBailout), 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+      bailoutTelemetry.stop();
       bailoutReduceTimer.stop();
 
       // Write restart data if needed
@@ -1084,6 +1096,7 @@ int simulate(int argn,char* args[]) {
       }
 
       ioTimer.stop();
+      ioTelemetry.stop();
       addTimedBarrier("barrier-end-io");
 
       // reset these for next time around
@@ -1101,6 +1114,7 @@ int simulate(int argn,char* args[]) {
       //TODO - add LB measure and do LB if it exceeds threshold
       if(((P::tstep % P::rebalanceInterval == 0 && P::tstep > P::tstep_min) || overrideRebalanceNow)) {
          logFile << "(LB): Start load balance, tstep = " << P::tstep << " t = " << P::t << endl << writeVerbose;
+         telemetry::Timer loadBalanceTelemetry {telemetry::LOAD_BALANCE};
 
          phiprof::Timer shrinkTimer {"Shrink_to_fit"};
          // * shrink to fit before LB * //
@@ -1116,10 +1130,12 @@ int simulate(int argn,char* args[]) {
                globalflags::bailingOut = false; // Reset this
                for (auto id : mpiGrid.get_local_cells_to_refine()) {
                   mpiGrid[id]->parameters[CellParams::LBWEIGHTCOUNTER] *= 8.0;
+                  mpiGrid[id]->parameters[CellParams::LBCOMPUTETIME] *= 8.0;
                }
                balanceLoad(mpiGrid, sysBoundaryContainer, technicalGrid);
                // We can /= 8.0 now as cells have potentially migrated. Go back to block-based count for now.
                for (auto id : mpiGrid.get_local_cells_to_refine()) {
+                  mpiGrid[id]->parameters[CellParams::LBCOMPUTETIME] /= 8.0;
                   mpiGrid[id]->parameters[CellParams::LBWEIGHTCOUNTER] = 0;
                   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
                      mpiGrid[id]->parameters[CellParams::LBWEIGHTCOUNTER] += mpiGrid[id]->get_number_of_velocity_blocks(popID);
@@ -1202,6 +1218,7 @@ int simulate(int argn,char* args[]) {
          #pragma omp parallel for
          for (size_t c=0; c<cells.size(); ++c) {
             mpiGrid[cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] = 0;
+            mpiGrid[cells[c]]->get_cell_parameters()[CellParams::LBCOMPUTETIME] = 0;
          }
       }
       
@@ -1211,6 +1228,7 @@ int simulate(int argn,char* args[]) {
       // Update boundary condition states (time-varying)
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration) {
          phiprof::Timer timer {"Update system boundaries (Vlasov pre-translation)"};
+         telemetry::Timer sysBoundaryTelemetry {telemetry::SYSBOUNDARIES};
          sysBoundaryContainer.updateState(mpiGrid, technicalGrid, perBGrid, BgBGrid, P::t + 0.5 * P::dt);
 
          // updateState leaves mpiGrid and fsgrid in mismatching states, interpolated moments need to be recalculated
@@ -1234,17 +1252,21 @@ int simulate(int argn,char* args[]) {
       }
 
       phiprof::Timer spatialSpaceTimer {"Spatial-space"};
+      telemetry::Timer spatialSpaceTelemetry {telemetry::SPATIAL_SPACE};
       if( P::propagateVlasovTranslation) {
          calculateSpatialTranslation(mpiGrid,P::dt);
       } else {
          calculateSpatialTranslation(mpiGrid,0.0);
       }
       spatialSpaceTimer.stop(computedCells, "Cells");
+      spatialSpaceTelemetry.stop();
       
       // Apply boundary conditions
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration ) {
          phiprof::Timer timer {"Update system boundaries (Vlasov post-translation)"};
+         telemetry::Timer sysBoundaryTelemetry {telemetry::SYSBOUNDARIES};
          sysBoundaryContainer.applySysBoundaryVlasovConditions(mpiGrid, P::t+0.5*P::dt, false);
+         sysBoundaryTelemetry.stop();
          timer.stop();
          addTimedBarrier("barrier-boundary-conditions");
       }
@@ -1270,6 +1292,7 @@ int simulate(int argn,char* args[]) {
       // moments for t + dt are computed (field uses t and t+0.5dt)
       if (P::propagateField) {
          phiprof::Timer propagateTimer {"Propagate Fields"};
+         telemetry::Timer fieldSolverTelemetry {telemetry::FIELD_SOLVER};
 
          phiprof::Timer couplingInTimer {"fsgrid-coupling-in"};
          // Copy moments over into the fsgrid.
@@ -1306,6 +1329,7 @@ int simulate(int argn,char* args[]) {
          getFieldsFromFsGrid(volGrid, BgBGrid, EGradPeGrid, dMomentsGrid, technicalGrid, mpiGrid, cells);
          getFieldsTimer.stop();
          propagateTimer.stop(cells.size(),"SpatialCells");
+         fieldSolverTelemetry.stop();
          addTimedBarrier("barrier-after-field-solver");
       }
 
@@ -1343,6 +1367,7 @@ int simulate(int argn,char* args[]) {
       }
       
       phiprof::Timer vspaceTimer {"Velocity-space"};
+      telemetry::Timer vspaceTelemetry {telemetry::VELOCITY_SPACE};
       if ( P::propagateVlasovAcceleration ) {
          calculateAcceleration(mpiGrid,P::dt);
          addTimedBarrier("barrier-after-ad just-blocks");
@@ -1351,6 +1376,7 @@ int simulate(int argn,char* args[]) {
          calculateAcceleration(mpiGrid, 0.0);
       }
       vspaceTimer.stop(computedCells, "Cells");
+      vspaceTelemetry.stop();
       addTimedBarrier("barrier-after-acceleration");
 
       if (P::artificialPADiff){
@@ -1363,7 +1389,9 @@ int simulate(int argn,char* args[]) {
 
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration ) {
          phiprof::Timer timer {"Update system boundaries (Vlasov post-acceleration)"};
+         telemetry::Timer sysBoundaryTelemetry {telemetry::SYSBOUNDARIES};
          sysBoundaryContainer.applySysBoundaryVlasovConditions(mpiGrid, P::t + 0.5 * P::dt, true);
+         sysBoundaryTelemetry.stop();
          timer.stop();
          addTimedBarrier("barrier-boundary-conditions");
       }
@@ -1399,12 +1427,17 @@ int simulate(int argn,char* args[]) {
          s << "The timestep dt=" << P::dt << " went below bailout.bailout_min_dt (" << to_string(P::bailout_min_dt) << ")." << endl;
          bailout(true, s.str(), __FILE__, __LINE__);
       }
+      if (globalflags::ionosphereJustSolved) {
+         SBC::Ionosphere::reportBoundaryVDFCacheStatistics();
+      }
       //Move forward in time
       P::meshRepartitioned = false;
       globalflags::ionosphereJustSolved = false;
       ++P::tstep;
       P::t += P::dt;
 
+      stepTelemetry.stop();
+      telemetry::endStep(mpiGrid);
    }
 
    double after = MPI_Wtime();
@@ -1438,6 +1471,7 @@ int simulate(int argn,char* args[]) {
       logFile << writeVerbose;
    }
    
+   telemetry::finalize();
    finalizationTimer.stop();
    mainTimer.stop();
 
@@ -1456,6 +1490,7 @@ int simulate(int argn,char* args[]) {
    }
    logFile.close();
    if (P::diagnosticInterval != 0) {
+      flushDiagnostic();
       diagnostic.close();
    }
 
@@ -55,9 +55,6 @@ void reduce_vlasov_dt(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
          }
          #ifdef USE_GPU
          const vmesh::VelocityBlockContainer *blockContainer = cell->dev_get_velocity_blocks(popID);
-         #else
-         const vmesh::VelocityBlockContainer *blockContainer = cell->get_velocity_blocks(popID);
-         #endif
 
          Real threadMin = std::numeric_limits<Real>::max();
          arch::parallel_reduce<arch::min>({2, nBlocks},
@@ -77,6 +74,29 @@ void reduce_vlasov_dt(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
                const Real dt_max_cell = min({dx / fabs(Vx), dy / fabs(Vy), dz / fabs(Vz)});
                lthreadMin[0] = min(dt_max_cell,lthreadMin[0]);
          }, threadMin);
+         #else
+         // The limiting velocity along each axis is found at the outer face cells of the
+         // outermost blocks, so the per-axis block index extents maintained by the velocity
+         // mesh give the same minimum as a loop over the faces of every block.
+         vmesh::VelocityMesh* vmesh = cell->get_velocity_mesh(popID);
+         vmesh::LocalID minIndices[3], maxIndices[3];
+         vmesh->getBlockIndexExtents(minIndices, maxIndices);
+         const Real* meshMinLimits = vmesh->getMeshMinLimits();
+         const Real* blockSize = vmesh->getBlockSize();
+         const Real* cellSize = vmesh->getCellSize();
+         const Real spatialSize[3] = {dx, dy, dz};
+
+         Real threadMin = std::numeric_limits<Real>::max();
+         for (uint d = 0; d < 3; ++d) {
+            for (const vmesh::LocalID blockIndex : {minIndices[d], maxIndices[d]}) {
+               const Real VCRD = meshMinLimits[d] + blockIndex * blockSize[d];
+               for (const uint i : {0u, WID - 1u}) {
+                  const Real V = VCRD + (i + HALF) * cellSize[d] + EPS;
+                  threadMin = min(spatialSize[d] / fabs(V), threadMin);
+               }
+            }
+         }
+         #endif
          cell->set_max_r_dt(popID, threadMin);
          cell->parameters[CellParams::MAXRDT] = min(cell->get_max_r_dt(popID), cell->parameters[CellParams::MAXRDT]);
       } // end loop over popID
@@ -20,6 +20,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cmath>
+#include <algorithm>
 #include <phiprof.hpp>
 #include "arch_moments.h"
 #include "vlasovmover.h"
@@ -32,55 +34,83 @@
 
 using namespace std;
 
-/** Calculate zeroth, first, and (possibly) second bulk velocity moments for the
- * given spatial cell. The calculated moments include contributions from
- * all existing particle populations.
+// CellParams targets of the bulk moments, in the order RHOM, VX, VY, VZ, RHOQ and P_11, P_22, P_33, P_23, P_13, P_12
+static const uint bulkMoments[5] = {CellParams::RHOM, CellParams::VX, CellParams::VY, CellParams::VZ, CellParams::RHOQ};
+static const uint bulkMoments_R[5] = {CellParams::RHOM_R, CellParams::VX_R, CellParams::VY_R, CellParams::VZ_R, CellParams::RHOQ_R};
+static const uint bulkMoments_V[5] = {CellParams::RHOM_V, CellParams::VX_V, CellParams::VY_V, CellParams::VZ_V, CellParams::RHOQ_V};
+static const uint pressureMoments[nMom2] = {CellParams::P_11, CellParams::P_22, CellParams::P_33, CellParams::P_23, CellParams::P_13, CellParams::P_12};
+static const uint pressureMoments_R[nMom2] = {CellParams::P_11_R, CellParams::P_22_R, CellParams::P_33_R, CellParams::P_23_R, CellParams::P_13_R, CellParams::P_12_R};
+static const uint pressureMoments_V[nMom2] = {CellParams::P_11_V, CellParams::P_22_V, CellParams::P_33_V, CellParams::P_23_V, CellParams::P_13_V, CellParams::P_12_V};
+
+/** Calculate zeroth, first, and (possibly) second bulk velocity moments of one
+ * spatial cell, sweeping the distribution of each population only once. The bulk
+ * moments are stored in the CellParams listed in cp_bulk (RHOM, VX, VY, VZ, RHOQ)
+ * and cp_pressure (P_11, P_22, P_33, P_23, P_13, P_12), the population moments in
+ * the given Population members. The second moments are accumulated relative to the
+ * previous bulk velocity of the cell, and shifted to the new one afterwards.
  * @param cell Spatial cell.
  * @param computeSecond If true, second velocity moments are calculated.
- * @param doNotSkip If false, DO_NOT_COMPUTE cells are skipped.*/
-void calculateCellMoments(spatial_cell::SpatialCell* cell,
-                          const bool& computeSecond,
-                          const bool& computePopulationMomentsOnly,
-                          const bool& doNotSkip) {
-
-   // Called once per cell. If doNotSkip == true, then DO_NOT_COMPUTE cells aren't skipped.
-   if (!doNotSkip && cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-       return;
+ * @param computePopulationMomentsOnly If true, the bulk moments are not touched
+ * and the population pressures are evaluated around the existing bulk velocity.
+ * @param cp_bulk CellParams indices of the bulk density, velocity and charge density.
+ * @param cp_pressure CellParams indices of the bulk pressure tensor.
+ * @param popRHO Population member for the number density.
+ * @param popV Population member for the bulk velocity.
+ * @param popP Population member for the pressure tensor.
+ * @param useMappingMoments If true, populations whose moments were accumulated during
+ * the last acceleration mapping (and not altered since) skip the sweep.*/
+static void calculateCellMomentsSingleSweep(
+   spatial_cell::SpatialCell* cell,
+   const bool computeSecond,
+   const bool computePopulationMomentsOnly,
+   const uint (&cp_bulk)[5],
+   const uint (&cp_pressure)[nMom2],
+   Real Population::*popRHO,
+   Real (Population::*popV)[3],
+   Real (Population::*popP)[nMom2],
+   const bool useMappingMoments=false) {
+
+   const uint nPops = getObjectWrapper().particleSpecies.size();
+
+   // Previous bulk velocity as reference velocity for the second moments
+   Real referenceV[3] = {0.0, 0.0, 0.0};
+   for (uint i=0; i<3; ++i) {
+      if (std::isfinite(cell->parameters[cp_bulk[1+i]])) {
+         referenceV[i] = cell->parameters[cp_bulk[1+i]];
+      }
    }
 
    // Clear old moments to zero value
    if (computePopulationMomentsOnly == false) {
-      cell->parameters[CellParams::RHOM  ] = 0.0;
-      cell->parameters[CellParams::VX] = 0.0;
-      cell->parameters[CellParams::VY] = 0.0;
-      cell->parameters[CellParams::VZ] = 0.0;
-      cell->parameters[CellParams::RHOQ  ] = 0.0;
-      cell->parameters[CellParams::P_11] = 0.0;
-      cell->parameters[CellParams::P_22] = 0.0;
-      cell->parameters[CellParams::P_33] = 0.0;
-      cell->parameters[CellParams::P_23] = 0.0;
-      cell->parameters[CellParams::P_13] = 0.0;
-      cell->parameters[CellParams::P_12] = 0.0;
+      for (uint i=0; i<5; ++i) {
+         cell->parameters[cp_bulk[i]] = 0.0;
+      }
+      for (uint i=0; i<nMom2; ++i) {
+         cell->parameters[cp_pressure[i]] = 0.0;
+      }
    }
 
    // Loop over all particle species
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+   std::vector<Real> popMoments(nPops*nMomAll, 0.0);
+   std::vector<Real> popReferenceV(nPops*3, 0.0);
+   for (uint popID=0; popID<nPops; ++popID) {
+      for (uint i=0; i<3; ++i) {
+         popReferenceV[popID*3+i] = referenceV[i];
+      }
       #ifdef USE_GPU
-      vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
       vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
       #else
-      vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
       vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
       #endif
       const uint nBlocks = cell->get_velocity_mesh(popID)->size();
       Population &pop = cell->get_population(popID);
       if (nBlocks == 0) {
-         pop.RHO = 0;
+         pop.*popRHO = 0;
          for (int i=0; i<3; ++i) {
-            pop.V[i]=0;
+            (pop.*popV)[i]=0;
          }
          for (int i=0; i<nMom2; ++i) {
-            pop.P[i]=0;
+            (pop.*popP)[i]=0;
          }
          continue;
       }
@@ -89,31 +119,50 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
       const Real charge = getObjectWrapper().particleSpecies[popID].charge;
 
       // Temporary array for storing moments
-      Real array[nMom1] = {0};
-
-      // Calculate species' contribution to first velocity moments
-      blockVelocityFirstMoments(blockContainer,
-                                array,
-                                nBlocks);
-      pop.RHO = array[0];
-      pop.V[0] = divideIfNonZero(array[1], array[0]);
-      pop.V[1] = divideIfNonZero(array[2], array[0]);
-      pop.V[2] = divideIfNonZero(array[3], array[0]);
+      Real* array = &popMoments[popID*nMomAll];
+
+      // Calculate species' contribution to velocity moments, all in one sweep if second moments are needed.
+      // Moments accumulated by the acceleration mapping are still valid if block adjustment removed no content.
+      if (useMappingMoments && computeSecond && pop.mappingMomentsValid && pop.mappingMomentsLossCheck == pop.RHOLOSSADJUST) {
+         std::copy(pop.mappingMoments, pop.mappingMoments+nMomAll, array);
+         for (uint i=0; i<3; ++i) {
+            popReferenceV[popID*3+i] = pop.mappingMomentsReference[i];
+         }
+      } else if (computeSecond) {
+         Real moments[nMomAll] = {0};
+         blockVelocityMoments(blockContainer,
+                              referenceV[0],
+                              referenceV[1],
+                              referenceV[2],
+                              moments,
+                              nBlocks);
+         std::copy(moments, moments+nMomAll, array);
+      } else {
+         Real moments[nMom1] = {0};
+         blockVelocityFirstMoments(blockContainer,
+                                   moments,
+                                   nBlocks);
+         std::copy(moments, moments+nMom1, array);
+      }
+      pop.*popRHO = array[0];
+      (pop.*popV)[0] = divideIfNonZero(array[1], array[0]);
+      (pop.*popV)[1] = divideIfNonZero(array[2], array[0]);
+      (pop.*popV)[2] = divideIfNonZero(array[3], array[0]);
 
       if (!computePopulationMomentsOnly) {
          // Store species' contribution to bulk velocity moments
-         cell->parameters[CellParams::RHOM  ] += array[0]*mass;
-         cell->parameters[CellParams::VX] += array[1]*mass;
-         cell->parameters[CellParams::VY] += array[2]*mass;
-         cell->parameters[CellParams::VZ] += array[3]*mass;
-         cell->parameters[CellParams::RHOQ  ] += array[0]*charge;
+         cell->parameters[cp_bulk[0]] += array[0]*mass;
+         cell->parameters[cp_bulk[1]] += array[1]*mass;
+         cell->parameters[cp_bulk[2]] += array[2]*mass;
+         cell->parameters[cp_bulk[3]] += array[3]*mass;
+         cell->parameters[cp_bulk[4]] += array[0]*charge;
       }
    } // for-loop over particle species
 
    if(!computePopulationMomentsOnly) {
-      cell->parameters[CellParams::VX] = divideIfNonZero(cell->parameters[CellParams::VX], cell->parameters[CellParams::RHOM]);
-      cell->parameters[CellParams::VY] = divideIfNonZero(cell->parameters[CellParams::VY], cell->parameters[CellParams::RHOM]);
-      cell->parameters[CellParams::VZ] = divideIfNonZero(cell->parameters[CellParams::VZ], cell->parameters[CellParams::RHOM]);
+      cell->parameters[cp_bulk[1]] = divideIfNonZero(cell->parameters[cp_bulk[1]], cell->parameters[cp_bulk[0]]);
+      cell->parameters[cp_bulk[2]] = divideIfNonZero(cell->parameters[cp_bulk[2]], cell->parameters[cp_bulk[0]]);
+      cell->parameters[cp_bulk[3]] = divideIfNonZero(cell->parameters[cp_bulk[3]], cell->parameters[cp_bulk[0]]);
    }
 
    // Compute second moments only if requested
@@ -121,15 +170,8 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
       return;
    }
 
-   // Loop over all particle species
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-      #ifdef USE_GPU
-      vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
-      vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
-      #else
-      vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
-      vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
-      #endif
+   // Shift species' second moments to the bulk velocity of all species
+   for (uint popID=0; popID<nPops; ++popID) {
       const uint nBlocks = cell->get_velocity_mesh(popID)->size();
       if (nBlocks == 0) {
          continue;
@@ -137,32 +179,48 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
 
       const Real mass = getObjectWrapper().particleSpecies[popID].mass;
 
-      // Temporary array for storing moments
-      Real array[nMom2] = {0};
-
-      // Calculate species' contribution to second velocity moments
-      blockVelocitySecondMoments(blockContainer,
-                                 cell->parameters[CellParams::VX],
-                                 cell->parameters[CellParams::VY],
-                                 cell->parameters[CellParams::VZ],
-                                 array,
-                                 nBlocks);
+      Real central[nMom2];
+      centralSecondMoments(&popMoments[popID*nMomAll],
+                           popReferenceV[popID*3],
+                           popReferenceV[popID*3+1],
+                           popReferenceV[popID*3+2],
+                           cell->parameters[cp_bulk[1]],
+                           cell->parameters[cp_bulk[2]],
+                           cell->parameters[cp_bulk[3]],
+                           central);
       // Store species' contribution to bulk velocity moments
       Population &pop = cell->get_population(popID);
       for (size_t i=0; i<nMom2; ++i) {
-         pop.P[i] = mass * array[i];
+         (pop.*popP)[i] = mass * central[i];
       }
 
       if (!computePopulationMomentsOnly) {
-         cell->parameters[CellParams::P_11] += pop.P[0];
-         cell->parameters[CellParams::P_22] += pop.P[1];
-         cell->parameters[CellParams::P_33] += pop.P[2];
-         cell->parameters[CellParams::P_23] += pop.P[3];
-         cell->parameters[CellParams::P_13] += pop.P[4];
-         cell->parameters[CellParams::P_12] += pop.P[5];
+         for (size_t i=0; i<nMom2; ++i) {
+            cell->parameters[cp_pressure[i]] += (pop.*popP)[i];
+         }
       }
    } // for-loop over particle species
+}
+
+/** Calculate zeroth, first, and (possibly) second bulk velocity moments for the
+ * given spatial cell. The calculated moments include contributions from
+ * all existing particle populations.
+ * @param cell Spatial cell.
+ * @param computeSecond If true, second velocity moments are calculated.
+ * @param doNotSkip If false, DO_NOT_COMPUTE cells are skipped.*/
+void calculateCellMoments(spatial_cell::SpatialCell* cell,
+                          const bool& computeSecond,
+                          const bool& computePopulationMomentsOnly,
+                          const bool& doNotSkip) {
 
+   // Called once per cell. If doNotSkip == true, then DO_NOT_COMPUTE cells aren't skipped.
+   if (!doNotSkip && cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
+       return;
+   }
+
+   calculateCellMomentsSingleSweep(cell, computeSecond, computePopulationMomentsOnly,
+                                   bulkMoments, pressureMoments,
+                                   &Population::RHO, &Population::V, &Population::P);
 }
 
 /** Calculate zeroth, first, and (possibly) second bulk velocity moments for the
@@ -189,143 +247,21 @@ void calculateMoments_R(
    #endif
 
    phiprof::Timer computeMomentsTimer {"Compute _R moments"};
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
 #pragma omp parallel for schedule(dynamic,1)
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
-            continue;
-         }
-         // Clear old moments to zero value
-         if (popID == 0) {
-            cell->parameters[CellParams::RHOM_R  ] = 0.0;
-            cell->parameters[CellParams::VX_R] = 0.0;
-            cell->parameters[CellParams::VY_R] = 0.0;
-            cell->parameters[CellParams::VZ_R] = 0.0;
-            cell->parameters[CellParams::RHOQ_R  ] = 0.0;
-            cell->parameters[CellParams::P_11_R] = 0.0;
-            cell->parameters[CellParams::P_22_R] = 0.0;
-            cell->parameters[CellParams::P_33_R] = 0.0;
-            cell->parameters[CellParams::P_23_R] = 0.0;
-            cell->parameters[CellParams::P_13_R] = 0.0;
-            cell->parameters[CellParams::P_12_R] = 0.0;
-         }
-
-         #ifdef USE_GPU
-         vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
-         #else
-         vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
-         #endif
-         const uint nBlocks = cell->get_velocity_mesh(popID)->size();
-         Population &pop = cell->get_population(popID);
-         if (nBlocks == 0) {
-            pop.RHO_R = 0;
-            for (int i=0; i<3; ++i) {
-               pop.V_R[i]=0;
-            }
-            for (int i=0; i<nMom2; ++i) {
-               pop.P_R[i]=0;
-            }
-            continue;
-         }
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-         const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-
-         // Temporary array where the moments for this species are accumulated
-         Real array[nMom1] = {0};
-
-         // Calculate species' contribution to first velocity moments
-         blockVelocityFirstMoments(blockContainer,
-                                   array,
-                                   nBlocks);
-         // Store species' contribution to bulk velocity moments
-         pop.RHO_R = array[0];
-         pop.V_R[0] = divideIfNonZero(array[1], array[0]);
-         pop.V_R[1] = divideIfNonZero(array[2], array[0]);
-         pop.V_R[2] = divideIfNonZero(array[3], array[0]);
-
-         cell->parameters[CellParams::RHOM_R  ] += array[0]*mass;
-         cell->parameters[CellParams::VX_R] += array[1]*mass;
-         cell->parameters[CellParams::VY_R] += array[2]*mass;
-         cell->parameters[CellParams::VZ_R] += array[3]*mass;
-         cell->parameters[CellParams::RHOQ_R  ] += array[0]*charge;
-      } // for-loop over spatial cells
-   } // for-loop over particle species
-
-#pragma omp parallel for schedule(static)
    for (size_t c=0; c<cells.size(); ++c) {
       SpatialCell* cell = mpiGrid[cells[c]];
+
       if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
          continue;
       }
       if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
          continue;
       }
-      cell->parameters[CellParams::VX_R] = divideIfNonZero(cell->parameters[CellParams::VX_R], cell->parameters[CellParams::RHOM_R]);
-      cell->parameters[CellParams::VY_R] = divideIfNonZero(cell->parameters[CellParams::VY_R], cell->parameters[CellParams::RHOM_R]);
-      cell->parameters[CellParams::VZ_R] = divideIfNonZero(cell->parameters[CellParams::VZ_R], cell->parameters[CellParams::RHOM_R]);
-   }
 
-   // Compute second moments only if requested.
-   if (computeSecond == false) {
-      return;
-   }
-
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-#pragma omp parallel for schedule(dynamic,1)
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
-            continue;
-         }
-
-         #ifdef USE_GPU
-         vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
-         #else
-         vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
-         #endif
-         const uint nBlocks = cell->get_velocity_mesh(popID)->size();
-         if (nBlocks == 0) {
-            continue;
-         }
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-
-         // Temporary array where species' contribution to 2nd moments is accumulated
-         Real array[nMom2] = {0};
-
-         // Calculate species' contribution to second velocity moments
-         blockVelocitySecondMoments(blockContainer,
-                                    cell->parameters[CellParams::VX_R],
-                                    cell->parameters[CellParams::VY_R],
-                                    cell->parameters[CellParams::VZ_R],
-                                    array,
-                                    nBlocks);
-         // Store species' contribution to 2nd bulk velocity moments
-         Population &pop = cell->get_population(popID);
-         for (size_t i = 0; i < nMom2; ++i) {
-            pop.P_R[i] = mass * array[i];
-         }
-
-         cell->parameters[CellParams::P_11_R] += pop.P_R[0];
-         cell->parameters[CellParams::P_22_R] += pop.P_R[1];
-         cell->parameters[CellParams::P_33_R] += pop.P_R[2];
-         cell->parameters[CellParams::P_23_R] += pop.P_R[3];
-         cell->parameters[CellParams::P_13_R] += pop.P_R[4];
-         cell->parameters[CellParams::P_12_R] += pop.P_R[5];
-      } // for-loop over spatial cells
-   } // for-loop over particle species
+      calculateCellMomentsSingleSweep(cell, computeSecond, false,
+                                      bulkMoments_R, pressureMoments_R,
+                                      &Population::RHO_R, &Population::V_R, &Population::P_R);
+   } // for-loop over spatial cells
 }
 
 /** Calculate zeroth, first, and (possibly) second bulk velocity moments for the
@@ -353,147 +289,26 @@ void calculateMoments_V(
    #endif
 
    phiprof::Timer computeMomentsTimer {"Compute _V moments"};
-   // Loop over all particle species
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
 #pragma omp parallel for schedule(dynamic,1)
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
-            continue;
-         }
-
-         // Clear old moments to zero value
-         if (popID == 0) {
-            cell->parameters[CellParams::RHOM_V  ] = 0.0;
-            cell->parameters[CellParams::VX_V] = 0.0;
-            cell->parameters[CellParams::VY_V] = 0.0;
-            cell->parameters[CellParams::VZ_V] = 0.0;
-            cell->parameters[CellParams::RHOQ_V  ] = 0.0;
-            cell->parameters[CellParams::P_11_V] = 0.0;
-            cell->parameters[CellParams::P_22_V] = 0.0;
-            cell->parameters[CellParams::P_33_V] = 0.0;
-            cell->parameters[CellParams::P_23_V] = 0.0;
-            cell->parameters[CellParams::P_13_V] = 0.0;
-            cell->parameters[CellParams::P_12_V] = 0.0;
-         }
-
-         #ifdef USE_GPU
-         vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
-         #else
-         vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
-         #endif
-         const uint nBlocks = cell->get_velocity_mesh(popID)->size();
-         Population &pop = cell->get_population(popID);
-         if (nBlocks == 0) {
-            pop.RHO_V = 0;
-            for (int i=0; i<3; ++i) {
-               pop.V_V[i]=0;
-            }
-            for (int i=0; i<nMom2; ++i) {
-               pop.P_V[i]=0;
-            }
-            continue;
-         }
-
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-         const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-
-         // Temporary array for storing moments
-         Real array[nMom1] = {0};
-
-         // Calculate species' contribution to first velocity moments
-         blockVelocityFirstMoments(blockContainer,
-                                   array,
-                                   nBlocks);
-         // Store species' contribution to bulk velocity moments
-         pop.RHO_V = array[0];
-         pop.V_V[0] = divideIfNonZero(array[1], array[0]);
-         pop.V_V[1] = divideIfNonZero(array[2], array[0]);
-         pop.V_V[2] = divideIfNonZero(array[3], array[0]);
-
-         cell->parameters[CellParams::RHOM_V  ] += array[0]*mass;
-         cell->parameters[CellParams::VX_V] += array[1]*mass;
-         cell->parameters[CellParams::VY_V] += array[2]*mass;
-         cell->parameters[CellParams::VZ_V] += array[3]*mass;
-         cell->parameters[CellParams::RHOQ_V  ] += array[0]*charge;
-
-      } // for-loop over spatial cells
-   } // for-loop over particle species
-
-#pragma omp parallel for schedule(static)
    for (size_t c=0; c<cells.size(); ++c) {
       SpatialCell* cell = mpiGrid[cells[c]];
+
       if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
          continue;
       }
       if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
          continue;
       }
-      cell->parameters[CellParams::VX_V] = divideIfNonZero(cell->parameters[CellParams::VX_V], cell->parameters[CellParams::RHOM_V]);
-      cell->parameters[CellParams::VY_V] = divideIfNonZero(cell->parameters[CellParams::VY_V], cell->parameters[CellParams::RHOM_V]);
-      cell->parameters[CellParams::VZ_V] = divideIfNonZero(cell->parameters[CellParams::VZ_V], cell->parameters[CellParams::RHOM_V]);
-   }
-
-   // Compute second moments only if requested
-   if (computeSecond == false) {
-      return;
-   }
 
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-#pragma omp parallel for schedule(dynamic,1)
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         if (cell->sysBoundaryFlag == sysboundarytype::OUTFLOW && cell->sysBoundaryLayer != 1 && !initialCompute) { // these should have been handled by the boundary code
-            continue;
+      calculateCellMomentsSingleSweep(cell, computeSecond, false,
+                                      bulkMoments_V, pressureMoments_V,
+                                      &Population::RHO_V, &Population::V_V, &Population::P_V,
+                                      P::vlasovFusedAccelerationMoments);
+      if (computeSecond) {
+         // Mapping moments are only ever used once
+         for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+            cell->get_population(popID).mappingMomentsValid = false;
          }
-
-         #ifdef USE_GPU
-         vmesh::VelocityMesh* vmesh    = cell->dev_get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->dev_get_velocity_blocks(popID);
-         #else
-         vmesh::VelocityMesh* vmesh    = cell->get_velocity_mesh(popID);
-         vmesh::VelocityBlockContainer* blockContainer = cell->get_velocity_blocks(popID);
-         #endif
-         const uint nBlocks = cell->get_velocity_mesh(popID)->size();
-         if (nBlocks == 0) {
-            continue;
-         }
-
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-         const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-
-         // Temporary array where moments are stored
-         Real array[nMom2] = {0};
-
-         // Calculate species' contribution to second velocity moments
-         blockVelocitySecondMoments(blockContainer,
-                                    cell->parameters[CellParams::VX_V],
-                                    cell->parameters[CellParams::VY_V],
-                                    cell->parameters[CellParams::VZ_V],
-                                    array,
-                                    nBlocks);
-         // Store species' contribution to 2nd bulk velocity moments
-         Population &pop = cell->get_population(popID);
-         for (size_t i = 0; i < nMom2; ++i) {
-            pop.P_V[i] = mass * array[i];
-         }
-
-         cell->parameters[CellParams::P_11_V] += pop.P_V[0];
-         cell->parameters[CellParams::P_22_V] += pop.P_V[1];
-         cell->parameters[CellParams::P_33_V] += pop.P_V[2];
-         cell->parameters[CellParams::P_23_V] += pop.P_V[3];
-         cell->parameters[CellParams::P_13_V] += pop.P_V[4];
-         cell->parameters[CellParams::P_12_V] += pop.P_V[5];
-      } // for-loop over spatial cells
-   } // for-loop over particle species
+      }
+   } // for-loop over spatial cells
 }
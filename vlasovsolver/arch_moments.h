@@ -36,6 +36,7 @@ using namespace spatial_cell;
 
 #define nMom1 4
 #define nMom2 6
+#define nMomAll (nMom1+nMom2)
 
 // ***** FUNCTION DECLARATIONS ***** //
 
@@ -52,6 +53,24 @@ void blockVelocitySecondMoments(vmesh::VelocityBlockContainer *blockContainer,
                                 REAL (&array)[SIZE],
                                 uint nBlocks);
 
+template<typename REAL, uint SIZE>
+void blockVelocityMoments(vmesh::VelocityBlockContainer *blockContainer,
+                          const REAL referenceVX,
+                          const REAL referenceVY,
+                          const REAL referenceVZ,
+                          REAL (&array)[SIZE],
+                          uint nBlocks);
+
+template<typename REAL>
+void centralSecondMoments(const REAL* array,
+                          const REAL referenceVX,
+                          const REAL referenceVY,
+                          const REAL referenceVZ,
+                          const REAL averageVX,
+                          const REAL averageVY,
+                          const REAL averageVZ,
+                          REAL (&central)[nMom2]);
+
 void calculateMoments_R(
    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    const std::vector<CellID>& cells,
@@ -152,4 +171,99 @@ void blockVelocitySecondMoments(
      }, array);
 }
 
+/** Calculate the zeroth, first and second velocity moments for the velocity
+ * blocks in a single sweep over the distribution, and add results to 'array',
+ * which must have at least size ten. After this function returns, the contents of
+ * 'array' are as follows: array[0]=n; array[1]=nVx; array[2]=nVy; array[3]=nVz;
+ * array[4..9]=n(Vi-Vi0)(Vj-Vj0) with ij = xx, yy, zz, yz, xz, xy. Here Vx0,Vy0,Vz0
+ * is a reference velocity which should be close to the bulk velocity, so that
+ * the pressure tensor derived by centralSecondMoments() does not suffer from
+ * cancellation. This function is AMR safe.
+ * @param blockContainer Velocity block container of the population
+ * @param referenceVX Reference velocity x
+ * @param referenceVY Reference velocity y
+ * @param referenceVZ Reference velocity z
+ * @param array Array where the calculated moments are added
+ * @param nBlocks The number of blocks */
+template<typename REAL, uint SIZE> inline
+void blockVelocityMoments(
+   vmesh::VelocityBlockContainer *blockContainer,
+   const REAL referenceVX,
+   const REAL referenceVY,
+   const REAL referenceVZ,
+   REAL (&array)[SIZE],
+   uint nBlocks) {
+
+   arch::parallel_reduce<arch::sum>({WID, WID, WID, nBlocks},
+     ARCH_LOOP_LAMBDA (const uint i, const uint j, const uint k, const uint blockLID, Real *lsum ) {
+
+       Realf *data = blockContainer->getData();
+       Real *blockParameters = blockContainer->getParameters();
+       const Realf* avgs = &data[blockLID*WID3];
+       const Real* blockParams = &blockParameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS];
+       const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
+       const Real HALF = 0.5;
+
+       ARCH_INNER_BODY(i, j, k, blockLID, lsum) {
+         const Real VX = blockParams[BlockParams::VXCRD] + (i+HALF)*blockParams[BlockParams::DVX];
+         const Real VY = blockParams[BlockParams::VYCRD] + (j+HALF)*blockParams[BlockParams::DVY];
+         const Real VZ = blockParams[BlockParams::VZCRD] + (k+HALF)*blockParams[BlockParams::DVZ];
+         const Real f = avgs[cellIndex(i,j,k)];
+         lsum[0] += f * DV3;
+         lsum[1] += f*VX * DV3;
+         lsum[2] += f*VY * DV3;
+         lsum[3] += f*VZ * DV3;
+         const Real fDV3 = f * DV3;
+         const Real dVX = VX - referenceVX;
+         const Real dVY = VY - referenceVY;
+         const Real dVZ = VZ - referenceVZ;
+         lsum[4] += fDV3 * dVX * dVX;
+         lsum[5] += fDV3 * dVY * dVY;
+         lsum[6] += fDV3 * dVZ * dVZ;
+         lsum[7] += fDV3 * dVY * dVZ;
+         lsum[8] += fDV3 * dVX * dVZ;
+         lsum[9] += fDV3 * dVX * dVY;
+       };
+     }, array);
+}
+
+/** Shift the second moments accumulated by blockVelocityMoments() from the
+ * reference velocity to the given bulk velocity, i.e. compute
+ * central[0]=n(Vx-Vx0)(Vx-Vx0) etc. in the same order as blockVelocitySecondMoments().
+ * @param array Moments from blockVelocityMoments(), nMomAll values
+ * @param referenceVX Reference velocity x used in accumulation
+ * @param referenceVY Reference velocity y used in accumulation
+ * @param referenceVZ Reference velocity z used in accumulation
+ * @param averageVX Bulk velocity x
+ * @param averageVY Bulk velocity y
+ * @param averageVZ Bulk velocity z
+ * @param central Array where the central second moments are written */
+template<typename REAL> inline
+void centralSecondMoments(
+   const REAL* array,
+   const REAL referenceVX,
+   const REAL referenceVY,
+   const REAL referenceVZ,
+   const REAL averageVX,
+   const REAL averageVY,
+   const REAL averageVZ,
+   REAL (&central)[nMom2]) {
+
+   // First moments and bulk velocity relative to the reference velocity
+   const REAL n = array[0];
+   const REAL mX = array[1] - n*referenceVX;
+   const REAL mY = array[2] - n*referenceVY;
+   const REAL mZ = array[3] - n*referenceVZ;
+   const REAL dX = averageVX - referenceVX;
+   const REAL dY = averageVY - referenceVY;
+   const REAL dZ = averageVZ - referenceVZ;
+
+   central[0] = array[4] - 2*dX*mX + n*dX*dX;
+   central[1] = array[5] - 2*dY*mY + n*dY*dY;
+   central[2] = array[6] - 2*dZ*mZ + n*dZ*dZ;
+   central[3] = array[7] - dY*mZ - mY*dZ + n*dY*dZ;
+   central[4] = array[8] - dX*mZ - mX*dZ + n*dX*dZ;
+   central[5] = array[9] - dX*mY - mX*dY + n*dX*dY;
+}
+
 #endif
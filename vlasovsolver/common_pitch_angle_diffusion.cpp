@@ -33,7 +33,9 @@
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <algorithm>
 #include <Eigen/Geometry>
+#include <Eigen/Eigenvalues>
 #include "common_pitch_angle_diffusion.hpp"
 
 /* Storage of Temperature anisotropy to beta parallel array for pitch-angle diffusion parametrization
@@ -49,6 +51,87 @@ std::vector<Real> nu0Array;
 size_t n_betaPara = 0;
 size_t n_Taniso = 0;
 bool nuArrayRead = false;
+NuTableAxis betaParaAxis;
+NuTableAxis TanisoAxis;
+
+void NuTableAxis::setup(const std::vector<Real>& axisValues) {
+   values = axisValues;
+   spacing = Unsorted;
+   if (values.size() < 2) {
+      minValue = values.size() > 0 ? values[0] : 0.0;
+      return;
+   }
+   minValue = *std::min_element(values.begin(), values.end());
+   for (size_t i = 1; i < values.size(); i++) {
+      if (!(values[i] > values[i-1])) {
+         return;
+      }
+   }
+   spacing = Irregular;
+
+   // Values are read from a text file, so only demand uniformity to within a relative tolerance.
+   // Rounding at the nodes is corrected in lowerIndex().
+   const Real tolerance = 1e-3;
+   const size_t n = values.size();
+   const Real step = (values[n-1] - values[0]) / (n-1);
+   bool uniform = true;
+   for (size_t i = 1; i < n; i++) {
+      uniform = uniform && fabs(values[i] - values[i-1] - step) <= tolerance * step;
+   }
+   if (uniform) {
+      spacing = Linear;
+      origin = values[0];
+      inverseStep = 1.0 / step;
+      return;
+   }
+   if (values[0] > 0) {
+      const Real logStep = (log(values[n-1]) - log(values[0])) / (n-1);
+      bool logUniform = true;
+      for (size_t i = 1; i < n; i++) {
+         logUniform = logUniform && fabs(log(values[i]) - log(values[i-1]) - logStep) <= tolerance * logStep;
+      }
+      if (logUniform) {
+         spacing = Logarithmic;
+         origin = log(values[0]);
+         inverseStep = 1.0 / logStep;
+      }
+   }
+}
+
+int NuTableAxis::lowerIndex(const Real x) const {
+   const int n = values.size();
+   if (spacing == Unsorted) {
+      int index = -1;
+      for (int i = 0; i < n; i++) {
+         if (x >= values[i]) {
+            index = i;
+         }
+      }
+      return index;
+   }
+   if (!(x >= values[0])) {
+      return -1;
+   }
+   if (x >= values[n-1]) {
+      return n-1;
+   }
+   int index;
+   if (spacing == Linear) {
+      index = (x - origin) * inverseStep;
+   } else if (spacing == Logarithmic) {
+      index = (log(x) - origin) * inverseStep;
+   } else {
+      return std::upper_bound(values.begin(), values.end(), x) - values.begin() - 1;
+   }
+   index = std::max(0, std::min(index, n-1));
+   while (index+1 < n && x >= values[index+1]) {
+      index++;
+   }
+   while (index > 0 && x < values[index]) {
+      index--;
+   }
+   return index;
+}
 
 void readNuArrayFromFile() {
    if (nuArrayRead) {
@@ -120,6 +203,9 @@ void readNuArrayFromFile() {
       }
    }
 
+   betaParaAxis.setup(betaParaArray);
+   TanisoAxis.setup(TanisoArray);
+
    nuArrayRead = true;
    FILEDmumu.close();
 }
@@ -130,53 +216,138 @@ Realf interpolateNuFromArray(
    const Real Taniso_in,
    const Real betaParallel_in
    ) {
-   Real Taniso = Taniso_in;
-   Real betaParallel = betaParallel_in;
-   int betaIndx = -1;
-   int TanisoIndx = -1;
-   for (size_t i = 0; i < betaParaArray.size(); i++) {
-      if (betaParallel >= betaParaArray[i]) {
-         betaIndx   = i;
-      }
-   }
-   for (size_t i = 0; i < TanisoArray.size()  ; i++) {
-      if (Taniso       >= TanisoArray[i]  ) {
-         TanisoIndx = i;
-      }
-   }
+   Realf nu0;
+   interpolateNuFromArray(&Taniso_in, &betaParallel_in, &nu0, 1);
+   return nu0;
+}
 
-   if ( (betaIndx < 0) || (TanisoIndx < 0) ) {
-      // Values below table lower bounds; no diffusion required.
-      return 0.0;
-   } else {
+/* Linear interpolation of diffusion coefficients for n cells at once. Table indices are
+   found first, after which the bilinear interpolation itself vectorizes.
+ */
+void interpolateNuFromArray(
+   const Real* Taniso_in,
+   const Real* betaParallel_in,
+   Realf* nu0,
+   const size_t n
+   ) {
+   std::vector<int> betaIndx(n);
+   std::vector<int> TanisoIndx(n);
+   std::vector<Real> betaParallel(betaParallel_in, betaParallel_in + n);
+   std::vector<Real> Taniso(Taniso_in, Taniso_in + n);
+   for (size_t c = 0; c < n; c++) {
+      betaIndx[c] = betaParaAxis.lowerIndex(betaParallel[c]);
+      TanisoIndx[c] = TanisoAxis.lowerIndex(Taniso[c]);
+      if ( (betaIndx[c] < 0) || (TanisoIndx[c] < 0) ) {
+         // Values below table lower bounds; no diffusion required.
+         continue;
+      }
       // Interpolate values from table; if values are above bounds, cap to maximum value.
-      if (betaIndx >= (int)betaParaArray.size()-1) {
-         betaIndx = (int)betaParaArray.size()-2; // force last bin
-         betaParallel = betaParaArray[betaIndx+1]; // force interpolation to bin top
+      if (betaIndx[c] >= (int)betaParaArray.size()-1) {
+         betaIndx[c] = (int)betaParaArray.size()-2; // force last bin
+         betaParallel[c] = betaParaArray[betaIndx[c]+1]; // force interpolation to bin top
       }
-      if (TanisoIndx >= (int)TanisoArray.size()-1) {
-         TanisoIndx = (int)TanisoArray.size()-2; // force last bin
-         Taniso = TanisoArray[TanisoIndx+1]; // force interpolation to bin top
+      if (TanisoIndx[c] >= (int)TanisoArray.size()-1) {
+         TanisoIndx[c] = (int)TanisoArray.size()-2; // force last bin
+         Taniso[c] = TanisoArray[TanisoIndx[c]+1]; // force interpolation to bin top
       }
+   }
+
+   const Real* betaValues = betaParaArray.data();
+   const Real* TanisoValues = TanisoArray.data();
+   const Real* nu0Values = nu0Array.data();
+   const Real inverseFudge = 1.0 / Parameters::PADfudge;
+   #pragma omp simd
+   for (size_t c = 0; c < n; c++) {
+      const bool below = (betaIndx[c] < 0) || (TanisoIndx[c] < 0);
+      const int bi = below ? 0 : betaIndx[c];
+      const int ti = below ? 0 : TanisoIndx[c];
       // bi-linear interpolation with weighted mean to find nu0(betaParallel,Taniso)
-      const Real beta1   = betaParaArray[betaIndx];
-      const Real beta2   = betaParaArray[betaIndx+1];
-      const Real Taniso1 = TanisoArray[TanisoIndx];
-      const Real Taniso2 = TanisoArray[TanisoIndx+1];
-      const Real nu011   = nu0Array[betaIndx*n_Taniso+TanisoIndx];
-      const Real nu012   = nu0Array[betaIndx*n_Taniso+TanisoIndx+1];
-      const Real nu021   = nu0Array[(betaIndx+1)*n_Taniso+TanisoIndx];
-      const Real nu022   = nu0Array[(betaIndx+1)*n_Taniso+TanisoIndx+1];
+      const Real beta1   = betaValues[bi];
+      const Real beta2   = betaValues[bi+1];
+      const Real Taniso1 = TanisoValues[ti];
+      const Real Taniso2 = TanisoValues[ti+1];
+      const Real nu011   = nu0Values[bi*n_Taniso+ti];
+      const Real nu012   = nu0Values[bi*n_Taniso+ti+1];
+      const Real nu021   = nu0Values[(bi+1)*n_Taniso+ti];
+      const Real nu022   = nu0Values[(bi+1)*n_Taniso+ti+1];
       // Weights
-      const Real w11 = (beta2 - betaParallel)*(Taniso2 - Taniso)  / ( (beta2 - beta1)*(Taniso2-Taniso1) );
-      const Real w12 = (beta2 - betaParallel)*(Taniso  - Taniso1) / ( (beta2 - beta1)*(Taniso2-Taniso1) );
-      const Real w21 = (betaParallel - beta1)*(Taniso2 - Taniso)  / ( (beta2 - beta1)*(Taniso2-Taniso1) );
-      const Real w22 = (betaParallel - beta1)*(Taniso  - Taniso1) / ( (beta2 - beta1)*(Taniso2-Taniso1) );
+      const Real norm = 1.0 / ( (beta2 - beta1)*(Taniso2-Taniso1) );
+      const Real w11 = (beta2 - betaParallel[c])*(Taniso2 - Taniso[c])  * norm;
+      const Real w12 = (beta2 - betaParallel[c])*(Taniso[c]  - Taniso1) * norm;
+      const Real w21 = (betaParallel[c] - beta1)*(Taniso2 - Taniso[c])  * norm;
+      const Real w22 = (betaParallel[c] - beta1)*(Taniso[c]  - Taniso1) * norm;
       // Linear interpolation (with fudge factor divisor)
-      return (w11*nu011 + w12*nu012 + w21*nu021 + w22*nu022)/Parameters::PADfudge;
+      nu0[c] = below ? 0.0 : (w11*nu011 + w12*nu012 + w21*nu021 + w22*nu022) * inverseFudge;
    }
 }
 
+/* Magnetic field direction, temperature anisotropy and parallel beta of a cell
+ */
+void computePitchAngleDiffusionAnisotropy(
+   const SpatialCell& cell, std::array<Real,3>& b, Real& Taniso, Real& betaParallel
+   ) {
+   const std::array<Real,3> B = {cell.parameters[CellParams::PERBXVOL] +  cell.parameters[CellParams::BGBXVOL],
+      cell.parameters[CellParams::PERBYVOL] +  cell.parameters[CellParams::BGBYVOL],
+      cell.parameters[CellParams::PERBZVOL] +  cell.parameters[CellParams::BGBZVOL]};
+   const Real Bnorm           = sqrt(B[0]*B[0] + B[1]*B[1] + B[2]*B[2]);
+   b[0] = B[0]/Bnorm;
+   b[1] = B[1]/Bnorm;
+   b[2] = B[2]/Bnorm;
+
+   // Perform Eigen rotation to find parallel and perpendicular pressure
+   Eigen::Matrix3d rot = Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d{b[0], b[1], b[2]}, Eigen::Vector3d{0, 0, 1}).normalized().toRotationMatrix();
+   Eigen::Matrix3d Ptensor {
+      {cell.parameters[CellParams::P_11], cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_13]},
+      {cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_22], cell.parameters[CellParams::P_23]},
+      {cell.parameters[CellParams::P_13], cell.parameters[CellParams::P_23], cell.parameters[CellParams::P_33]},
+   };
+   Eigen::Matrix3d transposerot = rot.transpose();
+   Eigen::Matrix3d Pprime = rot * Ptensor * transposerot;
+
+   // Anisotropy
+   Taniso = 0.0;
+   if (Pprime(2, 2) > std::numeric_limits<Real>::min()) {
+      Taniso = (Pprime(0, 0) + Pprime(1, 1)) / (2 * Pprime(2, 2));
+   }
+   // Beta Parallel
+   betaParallel = 0.0;
+   if (Bnorm > 0) {
+      betaParallel = 2.0 * physicalconstants::MU_0 * Pprime(2, 2) / (Bnorm*Bnorm);
+   }
+}
+
+/* Flag cells in which the pressure tensor alone rules out diffusion, whatever the
+   magnetic field direction will be when pitchAngleDiffusion() runs: the largest
+   anisotropy over all directions, (trace - lambda_min)/(2 lambda_min), lies below
+   the nu0 table. With a constant coefficient, either all or no cells are skipped.
+   To be called with the interpolated moments in CellParams::P_ij.
+ */
+void updatePitchAngleDiffusionSkipMask(SpatialCell& cell) {
+   bool skip = false;
+   if (P::PADcoefficient >= 0) {
+      skip = (P::PADcoefficient <= 0.001);
+   } else if (nuArrayRead) {
+      Eigen::Matrix3d Ptensor {
+         {cell.parameters[CellParams::P_11], cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_13]},
+         {cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_22], cell.parameters[CellParams::P_23]},
+         {cell.parameters[CellParams::P_13], cell.parameters[CellParams::P_23], cell.parameters[CellParams::P_33]},
+      };
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigenSolver;
+      eigenSolver.computeDirect(Ptensor, Eigen::EigenvaluesOnly);
+      const Eigen::Vector3d lambda = eigenSolver.eigenvalues(); // In increasing order
+      // Safety margin against rounding differences to the rotated tensor
+      const Real margin = 0.999;
+      if (lambda(2) <= std::numeric_limits<Real>::min()) {
+         // No pressure: anisotropy is zero in any direction
+         skip = (0.0 < margin * TanisoAxis.minValue);
+      } else if (lambda(0) > std::numeric_limits<Real>::min()) {
+         const Real maxTaniso = (lambda(1) + lambda(2)) / (2 * lambda(0));
+         skip = (maxTaniso < margin * TanisoAxis.minValue);
+      }
+   }
+   cell.parameters[CellParams::PAD_SKIP] = skip ? 1.0 : 0.0;
+}
+
 void computePitchAngleDiffusionParameters(
    SpatialCell& cell,
    const uint popID, size_t CellIdx, bool& currentSpatialLoopComplete,
@@ -190,14 +361,16 @@ void computePitchAngleDiffusionParameters(
    // Diffusion coefficient to use in this cell
    nu0 = 0.0;
 
-   // Compute b
-   const std::array<Real,3> B = {cell.parameters[CellParams::PERBXVOL] +  cell.parameters[CellParams::BGBXVOL],
-      cell.parameters[CellParams::PERBYVOL] +  cell.parameters[CellParams::BGBYVOL],
-      cell.parameters[CellParams::PERBZVOL] +  cell.parameters[CellParams::BGBZVOL]};
-   const Real Bnorm           = sqrt(B[0]*B[0] + B[1]*B[1] + B[2]*B[2]);
-   b[0] = B[0]/Bnorm;
-   b[1] = B[1]/Bnorm;
-   b[2] = B[2]/Bnorm;
+   // Cells ruled out by the interpolated moments skip the parameter computation altogether
+   if (cell.parameters[CellParams::PAD_SKIP] > 0) {
+      cell.parameters[CellParams::NU0] = 0.0;
+      currentSpatialLoopComplete = true;
+      return;
+   }
+
+   Real Taniso;
+   Real betaParallel;
+   computePitchAngleDiffusionAnisotropy(cell, b, Taniso, betaParallel);
 
    if (P::PADcoefficient >= 0) {
       // User-provided single diffusion coefficient
@@ -208,27 +381,6 @@ void computePitchAngleDiffusionParameters(
          std::cerr<<" ERROR! Attempting to interpolate nu0 value but file has not been read."<<std::endl;
          abort();
       }
-
-      // Perform Eigen rotation to find parallel and perpendicular pressure
-      Eigen::Matrix3d rot = Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d{b[0], b[1], b[2]}, Eigen::Vector3d{0, 0, 1}).normalized().toRotationMatrix();
-      Eigen::Matrix3d Ptensor {
-         {cell.parameters[CellParams::P_11], cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_13]},
-         {cell.parameters[CellParams::P_12], cell.parameters[CellParams::P_22], cell.parameters[CellParams::P_23]},
-         {cell.parameters[CellParams::P_13], cell.parameters[CellParams::P_23], cell.parameters[CellParams::P_33]},
-      };
-      Eigen::Matrix3d transposerot = rot.transpose();
-      Eigen::Matrix3d Pprime = rot * Ptensor * transposerot;
-
-      // Anisotropy
-      Real Taniso = 0.0;
-      if (Pprime(2, 2) > std::numeric_limits<Real>::min()) {
-         Taniso = (Pprime(0, 0) + Pprime(1, 1)) / (2 * Pprime(2, 2));
-      }
-      // Beta Parallel
-      Real betaParallel = 0.0;
-      if (Bnorm > 0) {
-         betaParallel = 2.0 * physicalconstants::MU_0 * Pprime(2, 2) / (Bnorm*Bnorm);
-      }
       // Find anisotropy and beta parallel indexes from read table
       nu0 = interpolateNuFromArray(Taniso,betaParallel);
    }
@@ -41,11 +41,40 @@ extern size_t n_betaPara;
 extern size_t n_Taniso;
 extern bool nuArrayRead;
 
+/* One axis of the nu0 table. Index lookups are O(1) for linearly or logarithmically
+   spaced axes, and fall back to a binary search (or a scan, if unsorted) otherwise.
+ */
+struct NuTableAxis {
+   enum Spacing {
+      Linear,
+      Logarithmic,
+      Irregular,
+      Unsorted
+   } spacing = Unsorted;
+   std::vector<Real> values;
+   Real origin = 0.0;       // First value (or its logarithm)
+   Real inverseStep = 0.0;  // Inverse of the (logarithmic) spacing
+   Real minValue = 0.0;     // Smallest table value
+
+   void setup(const std::vector<Real>& axisValues);
+   int lowerIndex(const Real x) const; // Index of the last table value <= x, -1 if there is none
+};
+extern NuTableAxis betaParaAxis;
+extern NuTableAxis TanisoAxis;
+
 void readNuArrayFromFile();
 
 Realf interpolateNuFromArray(
    const Real Taniso, const Real betaParallel);
 
+void interpolateNuFromArray(
+   const Real* Taniso, const Real* betaParallel, Realf* nu0, const size_t n);
+
+void computePitchAngleDiffusionAnisotropy(
+   const SpatialCell& cell, std::array<Real,3>& b, Real& Taniso, Real& betaParallel);
+
+void updatePitchAngleDiffusionSkipMask(SpatialCell& cell);
+
 void computePitchAngleDiffusionParameters(
    SpatialCell& cell,
    const uint popID, size_t CellIdx, bool& currentSpatialLoopComplete,
@@ -117,11 +117,17 @@ void inline swapBlockIndices(velocity_block_indices_t &blockIndices, const uint
    then the openmp parallization would scale well (better than over
    spatial cells), and would not need synchronization.
 
+   If moments is given, the velocity moments of the mapped distribution
+   are added to it in the layout of blockVelocityMoments(), with second
+   moments relative to momentsReferenceV. As all target data is written
+   here, this replaces a separate sweep over the distribution after the
+   last dimension has been mapped.
+
 */
 bool map_1d(SpatialCell* spatial_cell,
             const uint popID,
             Real in_intersection, Real in_intersection_di, Real in_intersection_dj, Real in_intersection_dk,
-            const uint dimension) {
+            const uint dimension, Real* moments, const Real* momentsReferenceV) {
    no_subnormals(); // Needed by Agner's vectorclass
 
    // Conversion here:
@@ -200,6 +206,11 @@ bool map_1d(SpatialCell* spatial_cell,
 
    const Real i_dv=1.0/dv;
 
+   // Original velocity dimensions of the swapped i,j,k coordinates, and moments accumulated in that frame
+   // in the order n, nVi, nVj, nVk, ii, jj, kk, jk, ik, ij
+   const uint swappedDims[3] = {dimension == 0 ? 2u : 0u, dimension == 1 ? 2u : 1u, dimension};
+   Real mappedMoments[10] = {0};
+
    // sort blocks according to dimension, and divide them into columns
    vmesh::LocalID* blocks = new vmesh::LocalID[vmesh->size()];
    std::vector<uint> columnBlockOffsets;
@@ -376,15 +387,24 @@ bool map_1d(SpatialCell* spatial_cell,
      /*now store pointer to blocks, cannot do it at the same time as adding
       them since they might move due to re-allocations or migrated when
       removing blocks*/
+      vmesh::GlobalID targetBlocks[MAX_BLOCKS_PER_DIM];
+      vmesh::LocalID targetBlockLIDs[MAX_BLOCKS_PER_DIM];
+      uint nTargetBlocks = 0;
       for (int blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
          if(isTargetBlock[blockK])  {
-            const int targetBlock =
+            targetBlocks[nTargetBlocks++] =
                setFirstBlockIndices[0] * block_indices_to_id[0] +
                setFirstBlockIndices[1] * block_indices_to_id[1] +
                blockK                  * block_indices_to_id[2];
-            const vmesh::LocalID tblockLID = vmesh->getLocalID(targetBlock);
+         }
+      }
+      // Resolve all target blocks of the set in one batch
+      vmesh->getLocalIDs(targetBlocks, targetBlockLIDs, nTargetBlocks);
+      nTargetBlocks = 0;
+      for (int blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
+         if(isTargetBlock[blockK])  {
             // Get pointer to target block data.
-            blockIndexToBlockData[blockK] = blockContainer->getData(tblockLID);
+            blockIndexToBlockData[blockK] = blockContainer->getData(targetBlockLIDs[nTargetBlocks++]);
          }
       }
 
@@ -483,6 +503,18 @@ bool map_1d(SpatialCell* spatial_cell,
             const Veci  target_cell_index_common =
                i_indices * cell_indices_to_id[0] +
                j_indices * cell_indices_to_id[1];
+
+            // Velocities of the vector elements in the two non-mapped dimensions
+            Real laneVi[VECL];
+            Real laneVj[VECL];
+            if (moments != nullptr) {
+               for (int target_i=0; target_i < VECL; ++target_i) {
+                  laneVi[target_i] = vmesh->getMeshMinLimits()[swappedDims[0]]
+                     + (block_indices_begin[0] * WID + i_indices[target_i] + 0.5) * vmesh->getCellSize()[swappedDims[0]];
+                  laneVj[target_i] = vmesh->getMeshMinLimits()[swappedDims[1]]
+                     + (block_indices_begin[1] * WID + j_indices[target_i] + 0.5) * vmesh->getCellSize()[swappedDims[1]];
+               }
+            }
        
             /* 
                intersection_min is the intersection z coordinate (z after
@@ -606,16 +638,38 @@ bool map_1d(SpatialCell* spatial_cell,
                   //TODO replace by vector version & scatter & gather operation
 
 
+                  // total value of integrand
+                  const Vec target_density = target_density_r - target_density_l;
+
+                  if (moments != nullptr) {
+                     // Each target cell is only ever incremented, so its moments are the sum of the increments
+                     const Real vk = v_min + (gk + 0.5) * dv;
+                     const Real dvk = vk - momentsReferenceV[swappedDims[2]];
+                     for (int target_i=0; target_i < VECL; ++target_i) {
+                        const Real f = target_density[target_i];
+                        const Real dvi = laneVi[target_i] - momentsReferenceV[swappedDims[0]];
+                        const Real dvj = laneVj[target_i] - momentsReferenceV[swappedDims[1]];
+                        mappedMoments[0] += f;
+                        mappedMoments[1] += f * laneVi[target_i];
+                        mappedMoments[2] += f * laneVj[target_i];
+                        mappedMoments[3] += f * vk;
+                        mappedMoments[4] += f * dvi * dvi;
+                        mappedMoments[5] += f * dvj * dvj;
+                        mappedMoments[6] += f * dvk * dvk;
+                        mappedMoments[7] += f * dvj * dvk;
+                        mappedMoments[8] += f * dvi * dvk;
+                        mappedMoments[9] += f * dvi * dvj;
+                     }
+                  }
+
                   if(dimension == 2) {
                      Realf* targetDataPointer = blockIndexToBlockData[blockK] + j * cell_indices_to_id[1] + gk_mod_WID * cell_indices_to_id[2];
                      Vec targetData;
                      targetData.load_a(targetDataPointer);
-                     targetData += target_density_r - target_density_l;
+                     targetData += target_density;
                      targetData.store_a(targetDataPointer);
                   }
                   else{
-                     // total value of integrand
-                     const Vec target_density = target_density_r - target_density_l;
                      #pragma omp simd
                      for (int target_i=0; target_i < VECL; ++target_i) {
                         const Realf tval = target_density[target_i];
@@ -632,5 +686,27 @@ bool map_1d(SpatialCell* spatial_cell,
 
    }
    delete [] blocks;
+
+   if (moments != nullptr) {
+      // Back from the swapped frame to vx,vy,vz
+      const Real DV3 = vmesh->getCellSize()[0] * vmesh->getCellSize()[1] * vmesh->getCellSize()[2];
+      Real second[3][3];
+      second[swappedDims[0]][swappedDims[0]] = mappedMoments[4];
+      second[swappedDims[1]][swappedDims[1]] = mappedMoments[5];
+      second[swappedDims[2]][swappedDims[2]] = mappedMoments[6];
+      second[swappedDims[1]][swappedDims[2]] = second[swappedDims[2]][swappedDims[1]] = mappedMoments[7];
+      second[swappedDims[0]][swappedDims[2]] = second[swappedDims[2]][swappedDims[0]] = mappedMoments[8];
+      second[swappedDims[0]][swappedDims[1]] = second[swappedDims[1]][swappedDims[0]] = mappedMoments[9];
+      moments[0] += mappedMoments[0] * DV3;
+      moments[1 + swappedDims[0]] += mappedMoments[1] * DV3;
+      moments[1 + swappedDims[1]] += mappedMoments[2] * DV3;
+      moments[1 + swappedDims[2]] += mappedMoments[3] * DV3;
+      moments[4] += second[0][0] * DV3;
+      moments[5] += second[1][1] * DV3;
+      moments[6] += second[2][2] * DV3;
+      moments[7] += second[1][2] * DV3;
+      moments[8] += second[0][2] * DV3;
+      moments[9] += second[0][1] * DV3;
+   }
    return true;
 }
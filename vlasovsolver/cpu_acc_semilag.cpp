@@ -20,6 +20,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cmath>
 #include <dccrg.hpp>
 #include <dccrg_cartesian_geometry.hpp>
 #include <phiprof.hpp>
@@ -49,6 +50,15 @@ void cpu_accelerate_cells(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& m
    ) {
    int timerId {phiprof::initializeTimer("cell-semilag-acc")};
    int intersections_id {phiprof::initializeTimer("cell-compute-intersections")};
+   // Per-cell cost measurement for multi-constraint load balancing
+   const bool measureCost = Parameters::prepareForRebalance && Parameters::loadBalanceMultiConstraint;
+   // Cell times are measured per thread, scale them to the rank's wall-clock time like the
+   // region-level timings of translation.
+   int nThreads = 1;
+   #ifdef _OPENMP
+   nThreads = omp_get_max_threads();
+   #endif
+   const double threadShare = 1.0 / nThreads;
 
    #pragma omp parallel // Launch workshare region
    {
@@ -69,7 +79,11 @@ void cpu_accelerate_cells(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& m
          SpatialCell* SC = mpiGrid[cellID];
 
          phiprof::Timer semilagAccTimer {timerId};
+         const double t0 = measureCost ? MPI_Wtime() : 0.0;
          cpu_accelerate_cell(SC,popID,map_order);
+         if (measureCost) {
+            SC->parameters[CellParams::LBCOMPUTETIME] += (MPI_Wtime() - t0) * threadShare;
+         }
          semilagAccTimer.stop();
       }
    }
@@ -95,6 +109,24 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
    ) {
 
    Population& pop = spatial_cell->get_population(popID);
+
+   // Velocity moments of the last subcycle are accumulated while mapping the last dimension
+   Real* moments = nullptr;
+   if (pop.mappingMomentsRequested) {
+      for (uint i=0; i<10; ++i) {
+         pop.mappingMoments[i] = 0.0;
+      }
+      pop.mappingMomentsReference[0] = spatial_cell->parameters[CellParams::VX_V];
+      pop.mappingMomentsReference[1] = spatial_cell->parameters[CellParams::VY_V];
+      pop.mappingMomentsReference[2] = spatial_cell->parameters[CellParams::VZ_V];
+      for (uint i=0; i<3; ++i) {
+         if (!std::isfinite(pop.mappingMomentsReference[i])) {
+            pop.mappingMomentsReference[i] = 0.0;
+         }
+      }
+      moments = pop.mappingMoments;
+   }
+
    switch(map_order){
       case 0: {
          //Map order XYZ
@@ -103,7 +135,8 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
          map_1d(spatial_cell, popID, pop.intersection_y,
                 pop.intersection_y_di,pop.intersection_y_dj,pop.intersection_y_dk,1); // map along y
          map_1d(spatial_cell, popID, pop.intersection_z,
-                pop.intersection_z_di,pop.intersection_z_dj,pop.intersection_z_dk,2); // map along z
+                pop.intersection_z_di,pop.intersection_z_dj,pop.intersection_z_dk,2,
+                moments, pop.mappingMomentsReference); // map along z
          break;
       }
       case 1: {
@@ -113,7 +146,8 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
          map_1d(spatial_cell, popID, pop.intersection_z,
                 pop.intersection_z_di,pop.intersection_z_dj,pop.intersection_z_dk,2); // map along z
          map_1d(spatial_cell, popID, pop.intersection_x,
-                pop.intersection_x_di,pop.intersection_x_dj,pop.intersection_x_dk,0); // map along x
+                pop.intersection_x_di,pop.intersection_x_dj,pop.intersection_x_dk,0,
+                moments, pop.mappingMomentsReference); // map along x
          break;
       }
       case 2: {
@@ -123,8 +157,15 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
          map_1d(spatial_cell, popID, pop.intersection_x,
                 pop.intersection_x_di,pop.intersection_x_dj,pop.intersection_x_dk,0); // map along x
          map_1d(spatial_cell, popID, pop.intersection_y,
-                pop.intersection_y_di,pop.intersection_y_dj,pop.intersection_y_dk,1); // map along y
+                pop.intersection_y_di,pop.intersection_y_dj,pop.intersection_y_dk,1,
+                moments, pop.mappingMomentsReference); // map along y
          break;
       }
    }
+
+   if (pop.mappingMomentsRequested) {
+      pop.mappingMomentsValid = true;
+      pop.mappingMomentsLossCheck = pop.RHOLOSSADJUST;
+      pop.mappingMomentsRequested = false;
+   }
 }
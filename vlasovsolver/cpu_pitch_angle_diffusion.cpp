@@ -28,6 +28,8 @@
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <numeric>
+#include <algorithm>
 #include <Eigen/Geometry>
 #include "vec.h"
 #include "common_pitch_angle_diffusion.hpp"
@@ -135,6 +137,50 @@ void pitchAngleDiffusion(
    phiprof::Timer diffusionTimer {"pitch-angle-diffusion"};
 
    const auto LocalCells=getLocalCells();
+
+   // Cheap pass: field direction, anisotropy and beta of all cells not already ruled out by the moments
+   std::vector<std::array<Real,3>> cellB(LocalCells.size());
+   std::vector<Real> cellTaniso(LocalCells.size(), 0.0);
+   std::vector<Real> cellBetaParallel(LocalCells.size(), 0.0);
+   std::vector<Realf> cellNu0(LocalCells.size(), 0.0);
+   std::vector<char> cellSkip(LocalCells.size());
+   #pragma omp parallel for
+   for (size_t CellIdx = 0; CellIdx < LocalCells.size(); CellIdx++) {
+      SpatialCell& cell = *mpiGrid[LocalCells[CellIdx]];
+      cellSkip[CellIdx] = cell.parameters[CellParams::PAD_SKIP] > 0;
+      if (!cellSkip[CellIdx]) {
+         computePitchAngleDiffusionAnisotropy(cell, cellB[CellIdx], cellTaniso[CellIdx], cellBetaParallel[CellIdx]);
+      }
+   }
+
+   // Diffusion coefficients of all cells in one batched table lookup
+   if (P::PADcoefficient >= 0) {
+      // User-provided single diffusion coefficient
+      std::fill(cellNu0.begin(), cellNu0.end(), P::PADcoefficient);
+   } else {
+      interpolateNuFromArray(cellTaniso.data(), cellBetaParallel.data(), cellNu0.data(), LocalCells.size());
+   }
+
+   // Enable nu0 disk output; skip cells where diffusion is not required (or diffusion coefficient is very small).
+   std::vector<size_t> cellOrder;
+   std::vector<vmesh::LocalID> cellBlocks(LocalCells.size());
+   for (size_t CellIdx = 0; CellIdx < LocalCells.size(); CellIdx++) {
+      if (cellSkip[CellIdx]) {
+         cellNu0[CellIdx] = 0.0;
+      }
+      SpatialCell& cell = *mpiGrid[LocalCells[CellIdx]];
+      cell.parameters[CellParams::NU0] = cellNu0[CellIdx];
+      if (cellNu0[CellIdx] > 0.001) {
+         cellOrder.push_back(CellIdx);
+         cellBlocks[CellIdx] = cell.get_number_of_velocity_blocks(popID);
+      }
+   }
+
+   // The work per cell scales with its block count, so hand out the heaviest cells first.
+   std::stable_sort(cellOrder.begin(), cellOrder.end(), [&cellBlocks](size_t a, size_t b) -> bool {
+      return cellBlocks[a] > cellBlocks[b];
+   });
+
    #pragma omp parallel
    {
       std::vector<int>   fcount (nbins_v*nbins_mu,0); // Array to count number of f stored
@@ -142,9 +188,13 @@ void pitchAngleDiffusion(
       std::vector<Realf> dfdmu  (nbins_v*nbins_mu,0); // Array to store dfdmu
       std::vector<Realf> dfdmu2 (nbins_v*nbins_mu,0); // Array to store dfdmumu
       std::vector<Realf> dfdt_mu(nbins_v*nbins_mu,0); // Array to store dfdt_mu
-      #pragma omp for
-      for (size_t CellIdx = 0; CellIdx < LocalCells.size(); CellIdx++) { // Iterate over all spatial cells
+      std::vector<Realf> fmuLanes(nbins_v*nbins_mu*VECL,0); // Per-lane copies of fmu, so that histogramming has no write conflicts
+      std::vector<uint32_t> binIndex; // (v,mu) bin of each velocity cell, MUSPACE layout
+      std::vector<Realf> binWeight;   // 2 pi v^2 normalization of each velocity cell
+      #pragma omp for schedule(dynamic,1)
+      for (size_t orderIdx = 0; orderIdx < cellOrder.size(); orderIdx++) { // Iterate over spatial cells requiring diffusion
 
+         const size_t CellIdx               = cellOrder[orderIdx];
          const auto CellID                  = LocalCells[CellIdx];
          SpatialCell& cell                  = *mpiGrid[CellID];
          const Real* parameters             = cell.get_block_parameters(popID);
@@ -175,70 +225,75 @@ void pitchAngleDiffusion(
          const Real bulkVY = cell.parameters[CellParams::VY];
          const Real bulkVZ = cell.parameters[CellParams::VZ];
 
-         bool currentSpatialLoopComplete;
-         Realf Sparsity;
-         std::array<Real,3> b;
-         Real nu0;
-
-         // Compute parameters
-         computePitchAngleDiffusionParameters(
-            cell,
-            popID, CellIdx, currentSpatialLoopComplete,
-            Sparsity, b, nu0
-         );
-
-         // Enable nu0 disk output; skip cells where diffusion is not required (or diffusion coefficient is very small).
-         cell.parameters[CellParams::NU0] = nu0;
-         if (nu0 <= 0.001) {
-            continue;
-         }
+         const Realf Sparsity = 0.01 * cell.getVelocityBlockMinValue(popID);
+         const std::array<Real,3>& b = cellB[CellIdx];
+         const Real nu0 = cellNu0[CellIdx];
+
+         // Bulk V and b stay fixed over the substeps, so map each velocity cell to its (v,mu) bin only once.
+         const vmesh::LocalID nBlocksCell = cell.get_number_of_velocity_blocks(popID);
+         const size_t nVelocityCells = nBlocksCell*WID3;
+         binIndex.resize(nVelocityCells);
+         binWeight.resize(nVelocityCells);
+         std::fill(fcount.begin(), fcount.end(), 0);
+         for (vmesh::LocalID n=0; n<nBlocksCell; n++) { // Iterate through velocity blocks
+
+            loop_over_block([&](Veci i_indices, Veci j_indices, int k) -> void { // Lambda function processor
+
+               //Get velocity space coordinates
+               const Vec VX(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD]
+                            + (to_realf(i_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]);
+               const Vec VY(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD]
+                            + (to_realf(j_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]);
+               const Vec VZ(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD]
+                            + (k + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ]);
+
+               const Vec VplasmaX = VX - bulkVX;
+               const Vec VplasmaY = VY - bulkVY;
+               const Vec VplasmaZ = VZ - bulkVZ;
+
+               const Vec normV = sqrt(VplasmaX*VplasmaX + VplasmaY*VplasmaY + VplasmaZ*VplasmaZ);
+               const Vec Vpara = VplasmaX*b[0] + VplasmaY*b[1] + VplasmaZ*b[2];
+               const Vec mu = Vpara/(normV+std::numeric_limits<Real>::min()); // + min value to avoid division by 0.
+
+               const Veci Vindex = roundi(floor((normV) / dVbins));
+               const Vec Vmu = dVbins * (to_realf(Vindex)+0.5); // Take value at the center of the mu cell
+               Veci muindex = roundi(floor((mu+1.0) / dmubins));
+
+               const Vec weight = 2.0 * M_PI * Vmu*Vmu;
+               const size_t offset = n*WID3 + WID2*k + WID*j_indices[0] + i_indices[0];
+               weight.store(&binWeight[offset]);
+               for (uint i = 0; i<VECL; i++) {
+                  // Safety check to handle edge case where mu = exactly 1.0
+                  const int mui = std::max(0,std::min((int)muindex[i],nbins_mu-1));
+                  const int vi = std::max(0,std::min((int)Vindex[i],nbins_v-1));
+                  binIndex[offset + i] = mui*nbins_v + vi;
+                  MUSPACE(fcount,vi,mui) += 1;
+               }
+            }); // End of Lambda
+         } // End blocks
 
          while (dtTotalDiff < Parameters::dt) { // Substep loop
 
             const Real RemainT  = Parameters::dt - dtTotalDiff; //Remaining time before reaching simulation time step
             Real checkCFL = std::numeric_limits<Real>::max();
 
-            // Initialised at each substep
-            std::fill(fmu.begin(), fmu.end(), 0.0);
-            std::fill(fcount.begin(), fcount.end(), 0);
-
-            // Build 2d array of f(v,mu)
-            for (vmesh::LocalID n=0; n<cell.get_number_of_velocity_blocks(popID); n++) { // Iterate through velocity blocks
-
-               loop_over_block([&](Veci i_indices, Veci j_indices, int k) -> void { // Lambda function processor
-
-                  //Get velocity space coordinates
-                  const Vec VX(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD]
-                               + (to_realf(i_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]);
-                  const Vec VY(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD]
-                               + (to_realf(j_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]);
-                  const Vec VZ(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD]
-                               + (k + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ]);
-
-                  const Vec VplasmaX = VX - bulkVX;
-                  const Vec VplasmaY = VY - bulkVY;
-                  const Vec VplasmaZ = VZ - bulkVZ;
-
-                  const Vec normV = sqrt(VplasmaX*VplasmaX + VplasmaY*VplasmaY + VplasmaZ*VplasmaZ);
-                  const Vec Vpara = VplasmaX*b[0] + VplasmaY*b[1] + VplasmaZ*b[2];
-                  const Vec mu = Vpara/(normV+std::numeric_limits<Real>::min()); // + min value to avoid division by 0.
-
-                  const Veci Vindex = roundi(floor((normV) / dVbins));
-                  const Vec Vmu = dVbins * (to_realf(Vindex)+0.5); // Take value at the center of the mu cell
-                  Veci muindex = roundi(floor((mu+1.0) / dmubins));
-
-                  Vec CellValue;
-                  CellValue.load(&cell.get_data(n,popID)[WID2*k + WID*j_indices[0] + i_indices[0]]);
-                  const Vec increment = 2.0 * M_PI * Vmu*Vmu * CellValue;
-                  for (uint i = 0; i<VECL; i++) {
-                     // Safety check to handle edge case where mu = exactly 1.0
-                     const int mui = std::max(0,std::min((int)muindex[i],nbins_mu-1));
-                     const int vi = std::max(0,std::min((int)Vindex[i],nbins_v-1));
-                     MUSPACE(fmu,vi,mui) += increment[i];
-                     MUSPACE(fcount,vi,mui) += 1;
-                  }
-               }); // End of Lambda
-            } // End blocks
+            // Build 2d array of f(v,mu). Every vector lane accumulates into its own copy of the bins.
+            std::fill(fmuLanes.begin(), fmuLanes.end(), 0.0);
+            const Realf* cellData = cell.get_data(popID);
+            for (size_t c0 = 0; c0 < nVelocityCells; c0 += VECL) {
+               #pragma omp simd
+               for (uint lane = 0; lane < VECL; lane++) {
+                  const size_t c = c0 + lane;
+                  fmuLanes[binIndex[c]*VECL + lane] += binWeight[c] * cellData[c];
+               }
+            }
+            for (int bin = 0; bin < nbins_v*nbins_mu; bin++) {
+               Realf sum = 0.0;
+               for (uint lane = 0; lane < VECL; lane++) {
+                  sum += fmuLanes[bin*VECL + lane];
+               }
+               fmu[bin] = sum;
+            }
 
             int cRight;
             int cLeft;
@@ -319,50 +374,14 @@ void pitchAngleDiffusion(
             }
             dtTotalDiff = dtTotalDiff + Ddt;
 
-            for (vmesh::LocalID n=0; n<cell.get_number_of_velocity_blocks(popID); n++) { // Iterate through velocity blocks
-
-               loop_over_block([&](Veci i_indices, Veci j_indices, int k) -> void { // Lambda function processor
-
-                  //Get velocity space coordinates
-                  const Vec VX(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD]
-                               + (to_realf(i_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]);
-                  const Vec VY(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD]
-                               + (to_realf(j_indices) + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]);
-                  const Vec VZ(parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD]
-                               + (k + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ]);
-
-                  const Vec VplasmaX = VX - bulkVX;
-                  const Vec VplasmaY = VY - bulkVY;
-                  const Vec VplasmaZ = VZ - bulkVZ;
-
-                  const Vec normV = sqrt(VplasmaX*VplasmaX + VplasmaY*VplasmaY + VplasmaZ*VplasmaZ);
-                  const Vec Vpara = VplasmaX*b[0] + VplasmaY*b[1] + VplasmaZ*b[2];
-                  const Vec mu = Vpara/(normV+std::numeric_limits<Real>::min()); // + min value to avoid division by 0.
-
-                  const Veci Vindex = roundi(floor((normV) / dVbins));
-                  const Vec Vmu = dVbins * (to_realf(Vindex)+0.5); // Take value at the center of the mu cell
-                  Veci muindex = roundi(floor((mu+1.0) / dmubins));
-
-                  // Compute dfdt
-                  std::array<Realf,VECL> dfdt = {0};
-                  for (uint i = 0; i < VECL; i++) {
-                     // Safety check to handle edge case where mu = exactly 1.0
-                     const int mui = std::max(0,std::min((int)muindex[i],nbins_mu-1));
-                     const int vi = std::max(0,std::min((int)Vindex[i],nbins_v-1));
-                     dfdt[i] = MUSPACE(dfdt_mu,vi,mui); // dfdt_mu was scaled back down by 2pi*v^2 on creation
-                  }
-                  Vec dfdtUpdate;
-                  dfdtUpdate.load(&dfdt[0]);
-
-                  // Update cell value, ensuring result is non-negative
-                  Vec CellValue;
-                  CellValue.load(&cell.get_data(n,popID)[WID2*k + WID*j_indices[0] + i_indices[0]]);
-                  Vec NewCellValue    = CellValue + dfdtUpdate * Ddt;
-                  const Vecb lessZero = NewCellValue < 0.0;
-                  NewCellValue        = select(lessZero,0.0,NewCellValue);
-                  NewCellValue.store(&cell.get_data(n,popID)[WID2*k + WID*j_indices[0] + i_indices[0]]);
-               }); // End of Lambda
-            } // End Blocks
+            // Update cell values, ensuring results are non-negative
+            Realf* updateData = cell.get_data(popID);
+            const Realf Ddtf = Ddt;
+            #pragma omp simd
+            for (size_t c = 0; c < nVelocityCells; c++) {
+               const Realf newCellValue = updateData[c] + dfdt_mu[binIndex[c]] * Ddtf; // dfdt_mu was scaled back down by 2pi*v^2 on creation
+               updateData[c] = newCellValue < 0.0 ? 0.0 : newCellValue;
+            }
 
          } // End Time loop
 
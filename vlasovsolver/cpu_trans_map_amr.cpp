@@ -288,14 +288,11 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
 
    // Only needed if pencil counts are used as weight multiplier in load balance
    if (Parameters::prepareForRebalance == true) {
+      // Counts of central pencil membership are precomputed when building pencils
       for (uint i=0; i<localPropagatedCells.size(); i++) {
-         for (uint ip=0; ip<DimensionPencils[dimension].N; ip++) {
-            // Read only central IDs for each pencil
-            std::vector<CellID> centerIds = DimensionPencils[dimension].getIds(ip);
-            cuint myPencilCount = std::count(centerIds.begin(), centerIds.end(), localPropagatedCells[i]);
-            nPencils[i] += myPencilCount;
-            nPencils[nPencils.size()-1] += myPencilCount;
-         }
+         cuint myPencilCount = DimensionPencils[dimension].getPencilCount(localPropagatedCells[i]);
+         nPencils[i] += myPencilCount;
+         nPencils[nPencils.size()-1] += myPencilCount;
       }
    }
 
@@ -335,7 +332,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
    int propagateTimerId = phiprof::initializeTimer("trans-amr-propagatePencil");
 
    const size_t blocksSize {unionOfBlocks.size()};
-   const size_t binsSize {DimensionPencils[dimension].activeBins.size()};
+   const size_t binsSize {DimensionPencils[dimension].nBins};
 
    #pragma omp parallel
    {
@@ -353,11 +350,13 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
       for(uint blocki = 0; blocki < blocksSize; blocki++) {
          for (uint nBin = 0; nBin < binsSize; ++nBin) {
             // For each block + bin we copy first copy each pencil's data into a buffer, clear the target blocks, and then sum the translated pencils in
-            uint currentBin = DimensionPencils[dimension].activeBins[nBin];
+            const uint binPencilsBegin = DimensionPencils[dimension].pencilsInBinStart[nBin];
+            const uint binPencilsEnd = DimensionPencils[dimension].pencilsInBinStart[nBin+1];
 
             phiprof::Timer loadTimer {loadTimerId};
             vmesh::GlobalID blockGID = unionOfBlocks[blocki];
-            for (uint pencili : DimensionPencils[dimension].pencilsInBin[currentBin]) {
+            for (uint k = binPencilsBegin; k < binPencilsEnd; ++k) {
+               const uint pencili = DimensionPencils[dimension].pencilsInBin[k];
                int nonEmptyBlocks = 0;
                int L = DimensionPencils[dimension].lengthOfPencils[pencili];
                int start = DimensionPencils[dimension].idsStart[pencili];
@@ -388,8 +387,8 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
 
             phiprof::Timer memsetTimer {memsetTimerId};
             // reset blocks in all non-sysboundary neighbor spatial cells for this block id
-            for (CellID target_cell_id: DimensionPencils[dimension].targetCellsInBin[currentBin]) {
-               SpatialCell* target_cell = mpiGrid[target_cell_id];
+            for (uint k = DimensionPencils[dimension].targetCellsInBinStart[nBin]; k < DimensionPencils[dimension].targetCellsInBinStart[nBin+1]; ++k) {
+               SpatialCell* target_cell = mpiGrid[DimensionPencils[dimension].targetCellsInBin[k]];
                if (target_cell) {
                   // Get local velocity block id
                   const vmesh::LocalID blockLID = target_cell->get_velocity_block_local_id(blockGID, popID);
@@ -404,7 +403,8 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
             memsetTimer.stop();
 
             phiprof::Timer propagateTimer {propagateTimerId};
-            for (uint pencili : DimensionPencils[dimension].pencilsInBin[currentBin]) {
+            for (uint k = binPencilsBegin; k < binPencilsEnd; ++k) {
+               const uint pencili = DimensionPencils[dimension].pencilsInBin[k];
                // Skip pencils without blocks
                if (pencilBlocksCount.at(pencili) == 0) {
                   continue;
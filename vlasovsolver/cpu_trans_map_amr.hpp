@@ -35,6 +35,25 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
                   const Realf dt,
                   const uint popID);
 
+/* Kernels of trans_map_1d_amr, exposed for driving them on synthetic pencils (see mini-apps/vlasiator_bench).*/
+bool copy_trans_block_data_amr(Realf** pencilBlockData,
+                               const int lengthOfPencil,
+                               Vec* values,
+                               const unsigned int* const vcell_transpose,
+                               const uint popID);
+
+void propagatePencil(Realf* dz,
+                     Vec* values,
+                     const uint dimension,
+                     const uint blockGID,
+                     const Realf dt,
+                     const vmesh::VelocityMesh* vmesh,
+                     const int lengthOfPencil,
+                     const Realf threshold,
+                     Realf** blockDataPointer,
+                     Realf* targetRatios,
+                     const unsigned int* const vcell_transpose);
+
 void update_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCell,
                                             dccrg::Cartesian_Geometry>& mpiGrid,
                                             const uint dimension,
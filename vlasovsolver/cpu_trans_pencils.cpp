@@ -4,6 +4,7 @@ using namespace spatial_cell;
 
 #include "cpu_trans_pencils.hpp"
 #include "../logger.h"
+#include <tuple>
 
 #ifdef USE_GPU
 // just for uploading pencil information to GPU
@@ -1281,32 +1282,38 @@ void printPencilsFunc(const setOfPencils& pencils, const uint dimension, const i
       ss << "\n";
    }
 
-   for (const auto& [bin, pencilsInBin] : pencils.pencilsInBin) {
-      const auto& cells = pencils.targetCellsInBin.at(bin);
+   std::unordered_map<CellID, uint> binOfCell;
+   for (uint bin = 0; bin < pencils.nBins; ++bin) {
+      for (uint k = pencils.targetCellsInBinStart[bin]; k < pencils.targetCellsInBinStart[bin+1]; ++k) {
+         binOfCell.emplace(pencils.targetCellsInBin[k], bin);
+      }
+   }
+
+   for (uint bin = 0; bin < pencils.nBins; ++bin) {
       std::set<uint64_t> collisions;
 
       ss << "Bin " << bin << " pencils: ";
-      if (pencilsInBin.empty()) {
+      if (pencils.pencilsInBinStart[bin] == pencils.pencilsInBinStart[bin+1]) {
          ss << "EMPTY ";
       }
 
-      for (auto pencil : pencilsInBin) {
-         ss << pencil << " ";
+      for (uint k = pencils.pencilsInBinStart[bin]; k < pencils.pencilsInBinStart[bin+1]; ++k) {
+         ss << pencils.pencilsInBin[k] << " ";
       }
 
       ss << "\n";
 
       ss << "Bin " << bin << " cells: ";
-      if (cells.empty()) {
+      if (pencils.targetCellsInBinStart[bin] == pencils.targetCellsInBinStart[bin+1]) {
          ss << "EMPTY ";
       }
 
-      for (auto id : cells) {
+      for (uint k = pencils.targetCellsInBinStart[bin]; k < pencils.targetCellsInBinStart[bin+1]; ++k) {
+         const CellID id = pencils.targetCellsInBin[k];
          ss << id << " ";
-         for (auto [bin2, cells2] : pencils.targetCellsInBin) {
-            if (bin != bin2 && cells2.contains(id)) {
-               collisions.insert(bin2);
-            }
+         const auto it = binOfCell.find(id);
+         if (it != binOfCell.end() && it->second != bin) {
+            collisions.insert(it->second);
          }
       }
 
@@ -1339,15 +1346,266 @@ void printPencilsFunc(const setOfPencils& pencils, const uint dimension, const i
  */
 void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
       phiprof::Timer timer {"GetSeedIdsAndBuildPencils"};
-      // Remove all old pencils now
-      for (int dimension=0; dimension<3; dimension++) {
-         DimensionPencils[dimension].removeAllPencils();
+      // Remove all old pencils now, unless they are to be updated incrementally
+      if (!P::vlasovIncrementalPencils) {
+         for (int dimension=0; dimension<3; dimension++) {
+            DimensionPencils[dimension].removeAllPencils();
+         }
       }
       for (int dimension=0; dimension<3; dimension++) {
          prepareSeedIdsAndPencils(mpiGrid, dimension);
       }
 }
 
+/* Build pencils starting from the given seed cells, split them where ghost cells are more refined,
+ * and compute their source cells, source widths and target ratios. Pencils are appended to the given set.
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ * @param [out] pencils Set of pencils to append to
+ * @param [in] buildSeedIds Seed cells to build pencils from
+ * @param [in] allSeedIds All seed cells of this dimension, at which pencils end
+ * @param [in] dimension Spatial dimension
+ */
+static void buildPencilSet(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                           setOfPencils& pencils,
+                           const vector<CellID>& buildSeedIds,
+                           const vector<CellID>& allSeedIds,
+                           const uint dimension) {
+#pragma omp parallel
+   {
+      // Empty vectors for internal use of buildPencilsWithNeighbors. Could be default values but
+      // default vectors are complicated. Should overload buildPencilsWithNeighbors like suggested here
+      // https://stackoverflow.com/questions/3147274/c-default-argument-for-vectorint
+      std::vector<CellID> ids;
+      vector<uint> path;
+      // thread-internal pencil set to be accumulated at the end
+      setOfPencils thread_pencils;
+      // iterators used in the accumulation
+      std::vector<CellID>::iterator ibeg, iend;
+
+#pragma omp for schedule(guided,8)
+      for (uint i=0; i<buildSeedIds.size(); i++) {
+         cuint seedId = buildSeedIds[i];
+         // Construct pencils from the seedIds into a set of pencils.
+         buildPencilsWithNeighbors(mpiGrid, thread_pencils, seedId, ids, dimension, path, allSeedIds);
+      }
+
+      // accumulate thread results in global set of pencils
+#pragma omp critical
+      {
+         for (uint i=0; i<thread_pencils.N; i++) {
+            // Use vector range constructor
+            ibeg = thread_pencils.ids.begin() + thread_pencils.idsStart[i];
+            iend = ibeg + thread_pencils.lengthOfPencils[i];
+            std::vector<CellID> pencilIds(ibeg, iend);
+            pencils.addPencil(pencilIds,thread_pencils.x[i],thread_pencils.y[i],thread_pencils.periodic[i],thread_pencils.path[i]);
+         }
+      }
+   }
+
+   phiprof::Timer checkGhostCellsTimer {"check_ghost_cells"};
+   // Check refinement of two ghost cells on each end of each pencil
+   // in case pencil needs to be split.
+   // This function contains threading.
+   check_ghost_cells(mpiGrid,pencils,dimension);
+   checkGhostCellsTimer.stop();
+
+   phiprof::Timer findSourceRatiosTimer {"Find_source_cells_ratios_dz"};
+   // Compute also the stencil around the pencil (source cells), and
+   // Store source cell widths and target cell contribution ratios.
+#pragma omp parallel for schedule(guided)
+   for (uint i=0; i<pencils.N; ++i) {
+      const uint L = pencils.lengthOfPencils[i];
+      CellID *pencilIds = pencils.ids.data() + pencils.idsStart[i];
+      Realf* pencilDZ = pencils.sourceDZ.data() + pencils.idsStart[i];
+      Realf* pencilAreaRatio = pencils.targetRatios.data() + pencils.idsStart[i];
+      computeSpatialSourceCellsForPencil(mpiGrid,pencilIds,L,dimension,pencils.path[i],pencilDZ,pencilAreaRatio);
+   }
+   findSourceRatiosTimer.stop();
+}
+
+// State of the cells pencils were last built from, per dimension, for incremental rebuilds
+static std::array<std::unordered_map<CellID, uint>, 3> pencilCellStates;
+static std::array<bool, 3> pencilCellStatesValid = {false, false, false};
+
+/* Everything about a cell that pencil building, splitting and source computation depend on,
+ * packed into one value. Cell IDs encode the refinement level, so refined and unrefined
+ * cells show up as cells that have appeared or disappeared (state 0).
+ */
+static uint getPencilCellState(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, const CellID cid, const uint dimension) {
+   SpatialCell* SC = mpiGrid[cid];
+   if (!SC) {
+      return 0;
+   }
+   uint state = 1;
+   if (mpiGrid.is_local(cid)) {
+      state |= 1 << 1;
+   }
+   if (check_is_active(mpiGrid, cid, dimension)) {
+      state |= 1 << 2;
+   }
+   if (P::vlasovSolverGhostTranslate && check_is_written_to(mpiGrid, cid, dimension)) {
+      state |= 1 << 3;
+   }
+   if (do_translate_cell(SC)) {
+      state |= 1 << 4;
+   }
+   state |= (SC->sysBoundaryLayer & 0xff) << 5;
+   state |= SC->sysBoundaryFlag << 13;
+   return state;
+}
+
+/* Store the state of the propagated cells and of all cells in the pencils of the given dimension.
+ */
+static void storePencilCellStates(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                  const vector<CellID>& propagatedCells,
+                                  const uint dimension) {
+   auto& states = pencilCellStates[dimension];
+   states.clear();
+   for (const CellID cid : propagatedCells) {
+      states[cid] = getPencilCellState(mpiGrid, cid, dimension);
+   }
+   for (const CellID cid : DimensionPencils[dimension].ids) {
+      if (cid && !states.contains(cid)) {
+         states[cid] = getPencilCellState(mpiGrid, cid, dimension);
+      }
+   }
+   pencilCellStatesValid[dimension] = true;
+}
+
+/* Incrementally update the pencils of one dimension after refinement or load balance.
+ * Cells that were refined, unrefined, migrated or otherwise changed state since the previous build are found
+ * by comparing against the stored cell states. Pencils of seeds that are still seeds and whose cells
+ * (including stencil cells) are all unchanged are kept as they are, all other seeds are rebuilt.
+ * check_ghost_cells only runs on the rebuilt pencils: the cells it inspects at the pencil ends are the
+ * stencil cells, so a refinement change there marks the pencil as changed. Build with -DDEBUG_SOLVERS
+ * to cross-check the result against a full rebuild (see checkIncrementalPencils).
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ * @param [in] propagatedCells Cells translated in this dimension
+ * @param [in] seedIds Current seed cells of this dimension
+ * @param [in] dimension Spatial dimension
+ */
+static void rebuildChangedPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                  const vector<CellID>& propagatedCells,
+                                  const vector<CellID>& seedIds,
+                                  const uint dimension) {
+   setOfPencils& pencils = DimensionPencils[dimension];
+   const auto& states = pencilCellStates[dimension];
+
+   phiprof::Timer changedTimer {"find changed pencil cells"};
+   std::unordered_set<CellID> changedCells;
+   for (const auto& [cid, state] : states) {
+      if (getPencilCellState(mpiGrid, cid, dimension) != state) {
+         changedCells.insert(cid);
+      }
+   }
+   for (const CellID cid : propagatedCells) {
+      if (!states.contains(cid)) {
+         changedCells.insert(cid);
+      }
+   }
+
+   std::unordered_set<CellID> dirtySeeds;
+   std::unordered_set<CellID> oldSeeds;
+   for (uint i=0; i<pencils.N; ++i) {
+      const CellID seed = pencils.getSeedId(i);
+      oldSeeds.insert(seed);
+      for (uint j = pencils.idsStart[i]; j < pencils.idsStart[i] + pencils.lengthOfPencils[i]; ++j) {
+         if (pencils.ids[j] && changedCells.contains(pencils.ids[j])) {
+            dirtySeeds.insert(seed);
+            break;
+         }
+      }
+   }
+   changedTimer.stop();
+
+   // Keep pencils of unchanged seeds, drop pencils of seeds that are gone or dirty
+   const std::unordered_set<CellID> currentSeeds(seedIds.begin(), seedIds.end());
+   setOfPencils kept;
+   for (uint i=0; i<pencils.N; ++i) {
+      const CellID seed = pencils.getSeedId(i);
+      if (currentSeeds.contains(seed) && !dirtySeeds.contains(seed)) {
+         kept.copyPencil(pencils, i);
+      }
+   }
+   vector<CellID> buildSeedIds;
+   for (const CellID seed : seedIds) {
+      if (dirtySeeds.contains(seed) || !oldSeeds.contains(seed)) {
+         buildSeedIds.push_back(seed);
+      }
+   }
+
+   setOfPencils rebuilt;
+   buildPencilSet(mpiGrid, rebuilt, buildSeedIds, seedIds, dimension);
+
+   pencils.removeAllPencils();
+   for (uint i=0; i<kept.N; ++i) {
+      pencils.copyPencil(kept, i);
+   }
+   for (uint i=0; i<rebuilt.N; ++i) {
+      pencils.copyPencil(rebuilt, i);
+   }
+}
+
+#ifdef DEBUG_SOLVERS
+/* Pencil contents independent of the pencil index: cells, position, periodicity, refinement path,
+ * source cell widths and target ratios.
+ */
+typedef std::tuple<std::vector<CellID>, Real, Real, bool, std::vector<uint>, std::vector<Realf>, std::vector<Realf>> PencilContents;
+
+static std::vector<PencilContents> getSortedPencilContents(const setOfPencils& pencils) {
+   std::vector<PencilContents> contents;
+   for (uint i=0; i<pencils.N; ++i) {
+      const uint begin = pencils.idsStart[i];
+      const uint end = begin + pencils.lengthOfPencils[i];
+      contents.emplace_back(std::vector<CellID>(pencils.ids.begin() + begin, pencils.ids.begin() + end),
+                            pencils.x[i], pencils.y[i], pencils.periodic[i], pencils.path[i],
+                            std::vector<Realf>(pencils.sourceDZ.begin() + begin, pencils.sourceDZ.begin() + end),
+                            std::vector<Realf>(pencils.targetRatios.begin() + begin, pencils.targetRatios.begin() + end));
+   }
+   std::sort(contents.begin(), contents.end());
+   return contents;
+}
+
+/* Target cells of each bin, bins sorted by their target cells. */
+static std::vector<std::vector<CellID>> getSortedBinTargetCells(const setOfPencils& pencils) {
+   std::vector<std::vector<CellID>> bins;
+   for (uint bin=0; bin<pencils.nBins; ++bin) {
+      bins.emplace_back(pencils.targetCellsInBin.begin() + pencils.targetCellsInBinStart[bin],
+                        pencils.targetCellsInBin.begin() + pencils.targetCellsInBinStart[bin + 1]);
+   }
+   std::sort(bins.begin(), bins.end());
+   return bins;
+}
+
+/* Cross-check of the incremental pencil update: builds all pencils of the dimension from scratch and
+ * aborts unless the pencils and the bins of the incrementally updated set are the same, up to their order.
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ * @param [in] seedIds Current seed cells of this dimension
+ * @param [in] dimension Spatial dimension
+ */
+static void checkIncrementalPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                    const vector<CellID>& seedIds,
+                                    const uint dimension) {
+   const setOfPencils& pencils = DimensionPencils[dimension];
+   setOfPencils full;
+   buildPencilSet(mpiGrid, full, seedIds, seedIds, dimension);
+   full.binPencils();
+   if (getSortedPencilContents(pencils) != getSortedPencilContents(full)) {
+      std::cerr << __FILE__ << ":" << __LINE__ << " Incrementally updated pencils of dimension " << dimension
+                << " differ from a full rebuild (" << pencils.N << " and " << full.N << " pencils)" << std::endl;
+      abort();
+   }
+   if (getSortedBinTargetCells(pencils) != getSortedBinTargetCells(full)) {
+      std::cerr << __FILE__ << ":" << __LINE__ << " Bins of the incrementally updated pencils of dimension " << dimension
+                << " differ from a full rebuild (" << pencils.nBins << " and " << full.nBins << " bins)" << std::endl;
+      abort();
+   }
+}
+#endif
+
 /* Wrapper function for calling seed ID selection and pencil generation, per dimension.
  * Includes threading and gathering of pencils into thread-containers.
  *
@@ -1444,65 +1702,32 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
    }
 
    phiprof::Timer buildPencilsTimer {"buildPencils"};
-
-#pragma omp parallel
-   {
-      // Empty vectors for internal use of buildPencilsWithNeighbors. Could be default values but
-      // default vectors are complicated. Should overload buildPencilsWithNeighbors like suggested here
-      // https://stackoverflow.com/questions/3147274/c-default-argument-for-vectorint
-      std::vector<CellID> ids;
-      vector<uint> path;
-      // thread-internal pencil set to be accumulated at the end
-      setOfPencils thread_pencils;
-      // iterators used in the accumulation
-      std::vector<CellID>::iterator ibeg, iend;
-
-#pragma omp for schedule(guided,8)
-      for (uint i=0; i<seedIds.size(); i++) {
-         cuint seedId = seedIds[i];
-         // Construct pencils from the seedIds into a set of pencils.
-         buildPencilsWithNeighbors(mpiGrid, thread_pencils, seedId, ids, dimension, path, seedIds);
-      }
-
-      // accumulate thread results in global set of pencils
-#pragma omp critical
-      {
-         for (uint i=0; i<thread_pencils.N; i++) {
-            // Use vector range constructor
-            ibeg = thread_pencils.ids.begin() + thread_pencils.idsStart[i];
-            iend = ibeg + thread_pencils.lengthOfPencils[i];
-            std::vector<CellID> pencilIds(ibeg, iend);
-            DimensionPencils[dimension].addPencil(pencilIds,thread_pencils.x[i],thread_pencils.y[i],thread_pencils.periodic[i],thread_pencils.path[i]);
-         }
-      }
+   if (P::vlasovIncrementalPencils && pencilCellStatesValid[dimension]) {
+      rebuildChangedPencils(mpiGrid, propagatedCells, seedIds, dimension);
+   } else {
+      DimensionPencils[dimension].removeAllPencils();
+      buildPencilSet(mpiGrid, DimensionPencils[dimension], seedIds, seedIds, dimension);
    }
-
-   phiprof::Timer checkGhostCellsTimer {"check_ghost_cells"};
-   // Check refinement of two ghost cells on each end of each pencil
-   // in case pencil needs to be split.
-   // This function contains threading.
-   check_ghost_cells(mpiGrid,DimensionPencils[dimension],dimension);
-   checkGhostCellsTimer.stop();
-
-   phiprof::Timer findSourceRatiosTimer {"Find_source_cells_ratios_dz"};
-   // Compute also the stencil around the pencil (source cells), and
-   // Store source cell widths and target cell contribution ratios.
-#pragma omp parallel for schedule(guided)
-   for (uint i=0; i<DimensionPencils[dimension].N; ++i) {
-      const uint L = DimensionPencils[dimension].lengthOfPencils[i];
-      CellID *pencilIds = DimensionPencils[dimension].ids.data() + DimensionPencils[dimension].idsStart[i];
-      Realf* pencilDZ = DimensionPencils[dimension].sourceDZ.data() + DimensionPencils[dimension].idsStart[i];
-      Realf* pencilAreaRatio = DimensionPencils[dimension].targetRatios.data() + DimensionPencils[dimension].idsStart[i];
-      computeSpatialSourceCellsForPencil(mpiGrid,pencilIds,L,dimension,DimensionPencils[dimension].path[i],pencilDZ,pencilAreaRatio);
+   if (P::vlasovIncrementalPencils) {
+      storePencilCellStates(mpiGrid, propagatedCells, dimension);
    }
-   findSourceRatiosTimer.stop();
 
-   // ****************************************************************************
+   // Pencil membership counts, used as load balance weight multipliers
+   DimensionPencils[dimension].countPencilsOfCells();
 
    phiprof::Timer binPencilsTimer {"bin_pencils"};
    DimensionPencils[dimension].binPencils();
+   #ifdef USE_GPU
+   DimensionPencils[dimension].gpuBins();
+   #endif
    binPencilsTimer.stop();
 
+   #ifdef DEBUG_SOLVERS
+   if (P::vlasovIncrementalPencils) {
+      checkIncrementalPencils(mpiGrid, seedIds, dimension);
+   }
+   #endif
+
    if (printPencils) {
       for (int rank=0; rank<mpi_size; ++rank) {
          MPI_Barrier(MPI_COMM_WORLD);
@@ -25,6 +25,10 @@
 #include <vector>
 #include "vec.h"
 #include <unordered_set>
+#include <unordered_map>
+#include <numeric>
+#include <limits>
+#include <algorithm>
 #include <dccrg.hpp>
 #include <dccrg_cartesian_geometry.hpp>
 #include <string>
@@ -44,10 +48,13 @@ struct setOfPencils {
    std::vector< bool > periodic;
    std::vector< std::vector<uint> > path; // Path taken through refinement levels
 
+   uint nBins; //!< Number of bins
    std::vector<uint> binOfPencil; //!< Bin of each pencil
-   std::map<uint, std::vector<uint>> pencilsInBin; //!< Vector of pencils in each bin
-   std::map<uint, std::set<CellID>> targetCellsInBin; //!< Set of source and target cells in each bin which are a target cell of any pencil
-   std::vector<uint> activeBins; //!< set of keys in the above two maps
+   std::vector<uint> pencilsInBinStart; //!< Offsets of each bin in pencilsInBin, size nBins+1
+   std::vector<uint> pencilsInBin; //!< Pencils of all bins, bin by bin (CSR)
+   std::vector<uint> targetCellsInBinStart; //!< Offsets of each bin in targetCellsInBin, size nBins+1
+   std::vector<CellID> targetCellsInBin; //!< Source and target cells of each bin which are a target cell of any pencil, bin by bin and sorted (CSR)
+   std::unordered_map<CellID, uint> pencilCountOfCell; //!< Number of pencils each cell is a central (non-stencil) member of
 
    //GPUTODO: move gpu buffers and their upload to separate gpu_trans_pencils .hpp and .cpp files
 #ifdef USE_GPU
@@ -67,6 +74,7 @@ struct setOfPencils {
    setOfPencils() {
       N = 0;
       sumOfLengths = 0;
+      nBins = 0;
    }
 
    void removeAllPencils() {
@@ -81,10 +89,13 @@ struct setOfPencils {
       y.clear();
       periodic.clear();
       path.clear();
+      nBins = 0;
       binOfPencil.clear();
-      targetCellsInBin.clear();
+      pencilsInBinStart.clear();
       pencilsInBin.clear();
-      activeBins.clear();
+      targetCellsInBinStart.clear();
+      targetCellsInBin.clear();
+      pencilCountOfCell.clear();
    }
 
    void addPencil(std::vector<CellID> idsIn, Real xIn, Real yIn, bool periodicIn, std::vector<uint> pathIn) {
@@ -111,85 +122,120 @@ struct setOfPencils {
       path.push_back(pathIn);
    }
 
-   void binPencils() {
-      binOfPencil.resize(N);
+   // Append pencil i of another set as is, including its stencil cells, source widths and target ratios
+   void copyPencil(const setOfPencils& other, const uint i) {
+      auto ibeg = other.idsStart[i];
+      auto iend = ibeg + other.lengthOfPencils[i];
+      N++;
+      sumOfLengths += other.lengthOfPencils[i];
+      lengthOfPencils.push_back(other.lengthOfPencils[i]);
+      idsStart.push_back(ids.size());
+      ids.insert(ids.end(), other.ids.begin() + ibeg, other.ids.begin() + iend);
+      sourceDZ.insert(sourceDZ.end(), other.sourceDZ.begin() + ibeg, other.sourceDZ.begin() + iend);
+      targetRatios.insert(targetRatios.end(), other.targetRatios.begin() + ibeg, other.targetRatios.begin() + iend);
+      x.push_back(other.x[i]);
+      y.push_back(other.y[i]);
+      periodic.push_back(other.periodic[i]);
+      path.push_back(other.path[i]);
+   }
 
-      // Consider only cells which _any_ pencil writes into for binning,
-      // since read-only cells aren't affected by race conditions
-      std::unordered_set<CellID> allTargetCells = {};
-      #pragma omp parallel for
-      for (uint i = 0; i < sumOfLengths; ++i) {
-         const CellID targ = ids[i];
-         const Realf ratio = targetRatios[i];
-         if (targ && (ratio > 0.0)) {
-            #pragma omp critical
-            allTargetCells.insert(targ);
-         }
-      }
+   // Seed cell of a pencil, i.e. its first central cell
+   CellID getSeedId(const uint pencilId) const {
+      return ids[idsStart[pencilId] + VLASOV_STENCIL_WIDTH];
+   }
 
-      // Loop over pencils to create initial bins containing all cells in the pencil that are a target cell for any pencil
-      // TODO could be paralellized as well
+   // Count, in a single pass over all pencils, how many pencils each cell is a central member of.
+   // Must be called once the set of pencils is final, i.e. after any splitting.
+   void countPencilsOfCells() {
+      pencilCountOfCell.clear();
       for (uint i = 0; i < N; ++i) {
-         binOfPencil[i] = i;
-         targetCellsInBin[i] = {};
-
-         for (auto id = ids.begin() + idsStart[i]; id < ids.begin() + idsStart[i] + lengthOfPencils[i]; ++id) {
-            // We don't need to consider source and target cells of the pencil separately
-            // as all pencils with source/target cell C must be in the same bin as all pencils with target C
-            if (*id && allTargetCells.contains(*id)) {
-               targetCellsInBin[i].insert(*id);
-            }
+         auto ibeg = ids.begin() + idsStart[i] + VLASOV_STENCIL_WIDTH;
+         auto iend = ids.begin() + idsStart[i] + lengthOfPencils[i] - VLASOV_STENCIL_WIDTH;
+         for (auto id = ibeg; id < iend; ++id) {
+            pencilCountOfCell[*id]++;
          }
       }
+   }
 
-      // Super ugly!
-      // TODO If anyone knows how to do this more efficiently feel free to fix it
-      std::set<uint> binsToDelete;
-      do {
-         binsToDelete.clear();
-         for (auto& [binIndex1, cellsInBin1] : targetCellsInBin) {
-            if (binsToDelete.contains(binIndex1)) {
-               continue;
-            }
-
-            for (auto& [binIndex2, cellsInBin2] : targetCellsInBin) {
-               if (binIndex1 == binIndex2 || binsToDelete.contains(binIndex2)) {
-                  continue;
-               }
-
-               // Check for overlapping cells
-               for (auto cell : cellsInBin2) {
-                  if (cellsInBin1.contains(cell)) {
-                     binsToDelete.insert(binIndex2);
+   // Number of pencils the given cell is a central member of, zero if none
+   uint getPencilCount(const CellID cell) const {
+      const auto it = pencilCountOfCell.find(cell);
+      return it == pencilCountOfCell.end() ? 0 : it->second;
+   }
 
-                     // Insert all cells from bin2 to bin1
-                     cellsInBin1.insert(cellsInBin2.begin(), cellsInBin2.end());
+   void binPencils() {
+      // Consider only cells which _any_ pencil writes into for binning,
+      // since read-only cells aren't affected by race conditions
+      std::unordered_set<CellID> allTargetCells;
+      for (uint i = 0; i < sumOfLengths; ++i) {
+         if (ids[i] && (targetRatios[i] > 0.0)) {
+            allTargetCells.insert(ids[i]);
+         }
+      }
 
-                     // Replace bin2 with bin1 in bins
-                     std::replace(binOfPencil.begin(), binOfPencil.end(), binIndex2, binIndex1);
-                     break;
-                  }
+      // All pencils with source/target cell C must be in the same bin as all pencils with target C,
+      // so join pencils sharing any such cell with a union-find. Each cell remembers the first pencil it was found in.
+      std::vector<uint> root(N);
+      std::iota(root.begin(), root.end(), 0);
+      auto findRoot = [&root](uint i) {
+         while (root[i] != i) {
+            root[i] = root[root[i]];
+            i = root[i];
+         }
+         return i;
+      };
+      std::unordered_map<CellID, uint> pencilOfCell;
+      for (uint i = 0; i < N; ++i) {
+         for (uint j = idsStart[i]; j < idsStart[i] + lengthOfPencils[i]; ++j) {
+            if (ids[j] && allTargetCells.contains(ids[j])) {
+               const auto [it, inserted] = pencilOfCell.try_emplace(ids[j], i);
+               if (!inserted) {
+                  const uint a = findRoot(i);
+                  const uint b = findRoot(it->second);
+                  root[std::max(a, b)] = std::min(a, b);
                }
             }
          }
+      }
 
-         for (auto bin : binsToDelete) {
-            targetCellsInBin.erase(bin);
+      // Number bins in order of their first pencil
+      std::vector<uint> binOfRoot(N, std::numeric_limits<uint>::max());
+      binOfPencil.resize(N);
+      nBins = 0;
+      for (uint i = 0; i < N; ++i) {
+         const uint r = findRoot(i);
+         if (binOfRoot[r] == std::numeric_limits<uint>::max()) {
+            binOfRoot[r] = nBins++;
          }
-      } while (!binsToDelete.empty());
+         binOfPencil[i] = binOfRoot[r];
+      }
 
-      // TODO do this "online" and make variable bins redundant
+      // Pencils of each bin, in pencil order
+      pencilsInBinStart.assign(nBins + 1, 0);
       for (uint i = 0; i < N; ++i) {
-         pencilsInBin[binOfPencil[i]].push_back(i);
+         pencilsInBinStart[binOfPencil[i] + 1]++;
       }
-
-      for (auto [bin, pencils] : pencilsInBin) {
-         activeBins.push_back(bin);
+      std::partial_sum(pencilsInBinStart.begin(), pencilsInBinStart.end(), pencilsInBinStart.begin());
+      pencilsInBin.resize(N);
+      std::vector<uint> fill(pencilsInBinStart.begin(), pencilsInBinStart.end() - 1);
+      for (uint i = 0; i < N; ++i) {
+         pencilsInBin[fill[binOfPencil[i]]++] = i;
       }
 
-      #ifdef USE_GPU
-      gpuBins();
-      #endif
+      // Target cells of each bin, sorted within the bin
+      targetCellsInBinStart.assign(nBins + 1, 0);
+      for (const auto& [cell, pencil] : pencilOfCell) {
+         targetCellsInBinStart[binOfPencil[pencil] + 1]++;
+      }
+      std::partial_sum(targetCellsInBinStart.begin(), targetCellsInBinStart.end(), targetCellsInBinStart.begin());
+      targetCellsInBin.resize(pencilOfCell.size());
+      fill.assign(targetCellsInBinStart.begin(), targetCellsInBinStart.end() - 1);
+      for (const auto& [cell, pencil] : pencilOfCell) {
+         targetCellsInBin[fill[binOfPencil[pencil]]++] = cell;
+      }
+      for (uint bin = 0; bin < nBins; ++bin) {
+         std::sort(targetCellsInBin.begin() + targetCellsInBinStart[bin], targetCellsInBin.begin() + targetCellsInBinStart[bin + 1]);
+      }
    }
 
    #ifdef USE_GPU
@@ -200,11 +246,11 @@ struct setOfPencils {
       gpuMemoryManager.createPointer(dev_binStart);
       gpuMemoryManager.createPointer(dev_binSize);
       
-      gpuMemoryManager.allocate(dev_pencilsInBin, sumOfLengths*sizeof(uint));
-      gpuMemoryManager.hostAllocate(host_binStart, activeBins.size()*sizeof(uint));
-      gpuMemoryManager.hostAllocate(host_binSize, activeBins.size()*sizeof(uint));
-      gpuMemoryManager.allocate(dev_binStart, activeBins.size()*sizeof(uint));
-      gpuMemoryManager.allocate(dev_binSize, activeBins.size()*sizeof(uint));
+      gpuMemoryManager.allocate(dev_pencilsInBin, std::max(N, 1u)*sizeof(uint));
+      gpuMemoryManager.hostAllocate(host_binStart, nBins*sizeof(uint));
+      gpuMemoryManager.hostAllocate(host_binSize, nBins*sizeof(uint));
+      gpuMemoryManager.allocate(dev_binStart, nBins*sizeof(uint));
+      gpuMemoryManager.allocate(dev_binSize, nBins*sizeof(uint));
 
       uint *dev_pencilsInBinPointer = gpuMemoryManager.getPointer<uint>(dev_pencilsInBin);
       uint *host_binStartPointer = gpuMemoryManager.getPointer<uint>(host_binStart);
@@ -212,21 +258,14 @@ struct setOfPencils {
       uint *dev_binStartPointer = gpuMemoryManager.getPointer<uint>(dev_binStart);
       uint *dev_binSizePointer = gpuMemoryManager.getPointer<uint>(dev_binSize);
 
-      int offset = 0;
-      for(size_t bin = 0; bin < activeBins.size(); bin++){
-         uint thisBin = activeBins[bin];
-         host_binStartPointer[bin] = offset;
-
-         uint binSize = pencilsInBin[thisBin].size();
-         host_binSizePointer[bin] = binSize;
-
-         CHK_ERR( gpuMemcpy(dev_pencilsInBinPointer + offset, pencilsInBin[thisBin].data(), binSize * sizeof(uint), gpuMemcpyHostToDevice) );
-
-         offset += binSize;
+      for(size_t bin = 0; bin < nBins; bin++){
+         host_binStartPointer[bin] = pencilsInBinStart[bin];
+         host_binSizePointer[bin] = pencilsInBinStart[bin+1] - pencilsInBinStart[bin];
       }
 
-      CHK_ERR( gpuMemcpy(dev_binStartPointer, host_binStartPointer, activeBins.size() * sizeof(uint), gpuMemcpyHostToDevice) );
-      CHK_ERR( gpuMemcpy(dev_binSizePointer, host_binSizePointer, activeBins.size() * sizeof(uint), gpuMemcpyHostToDevice) );
+      CHK_ERR( gpuMemcpy(dev_pencilsInBinPointer, pencilsInBin.data(), N * sizeof(uint), gpuMemcpyHostToDevice) );
+      CHK_ERR( gpuMemcpy(dev_binStartPointer, host_binStartPointer, nBins * sizeof(uint), gpuMemcpyHostToDevice) );
+      CHK_ERR( gpuMemcpy(dev_binSizePointer, host_binSizePointer, nBins * sizeof(uint), gpuMemcpyHostToDevice) );
    }
    #endif
 
@@ -452,7 +452,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    phiprof::Timer pencilCountTimer {"trans-amr-count-pencils"};
    if (Parameters::prepareForRebalance == true) {
       for (uint i=0; i<localPropagatedCells.size(); i++) {
-         const uint myPencilCount = std::count(DimensionPencils[dimension].ids.begin(), DimensionPencils[dimension].ids.end(), localPropagatedCells[i]);
+         const uint myPencilCount = DimensionPencils[dimension].getPencilCount(localPropagatedCells[i]);
          nPencilsLB[i] += myPencilCount;
          nPencilsLB[nPencilsLB.size()-1] += myPencilCount;
       }
@@ -526,7 +526,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    unionOfBlocks->copyMetadata(&unionInfo, bgStream);
    CHK_ERR( gpuStreamSynchronize(bgStream) );
    const uint nAllBlocks = unionInfo.size;
-   const uint numberOfBins = DimensionPencils[dimension].activeBins.size();
+   const uint numberOfBins = DimensionPencils[dimension].nBins;
    vmesh::GlobalID *allBlocks = unionOfBlocks->data();
    // This threshold value is used by slope limiters.
    Realf threshold = mpiGrid[DimensionPencils[dimension].ids[VLASOV_STENCIL_WIDTH]]->getVelocityBlockMinValue(popID);
@@ -40,6 +40,7 @@
 #include "../mpiconversion.h"
 
 #include "arch_moments.h"
+#include "common_pitch_angle_diffusion.hpp"
 
 #include "cpu_trans_pencils.hpp"
 #include "cpu_acc_transform.hpp" // for updateAccelerationMaxdt
@@ -234,6 +235,7 @@ void calculateSpatialGhostTranslation(
 
    //#warning TODO: Implement also 2D / non-AMR ghost translation?
    // ------------- SLICE - map dist function in Z --------------- //
+   const double t1 = MPI_Wtime();
    phiprof::Timer mappingZTimer {"compute-mapping-z"};
    trans_map_1d_amr(mpiGrid,local_propagated_cells, dummy_cells, nPencils, 2, dt,popID); // map along z//
    mappingZTimer.stop();
@@ -247,6 +249,7 @@ void calculateSpatialGhostTranslation(
    phiprof::Timer mappingYTimer {"compute-mapping-y"};
    trans_map_1d_amr(mpiGrid,local_propagated_cells, dummy_cells, nPencils, 1,dt,popID); // map along y//
    mappingYTimer.stop();
+   time += MPI_Wtime() - t1;
 
    phiprof::Timer postBarrierTimer {"MPI barrier-post-trans"};
    MPI_Barrier(MPI_COMM_WORLD);
@@ -374,6 +377,23 @@ void calculateSpatialTranslation(
             }
          }
       }
+
+      if (P::loadBalanceMultiConstraint) {
+         // Translation is done per pencil, so attribute the measured translation time to cells
+         // in proportion to their pencil count times block count.
+         vector<Real> cost(local_propagated_cells.size(), 0);
+         Real totalCost = 0;
+         for (size_t c=0; c<local_propagated_cells.size(); ++c) {
+            SpatialCell* SC = mpiGrid[local_propagated_cells[c]];
+            cost[c] = (Real)std::max(nPencils[c], 1u) * SC->get_number_of_all_velocity_blocks();
+            totalCost += cost[c];
+         }
+         if (totalCost > 0) {
+            for (size_t c=0; c<local_propagated_cells.size(); ++c) {
+               mpiGrid[local_propagated_cells[c]]->parameters[CellParams::LBCOMPUTETIME] += time * cost[c] / totalCost;
+            }
+         }
+      }
    }
 
    // Mapping complete, update moments and maximum dt limits //
@@ -453,11 +473,31 @@ void calculateAcceleration(const uint popID,const uint globalMaxSubcycles,const
       }
       spatial_cell::Population& pop = mpiGrid[cellID]->get_population(popID);
       pop.subcycleDt = thisSubcycleDt;
+
+      // Let the last subcycle accumulate the _V moments while mapping, see calculateMoments_V()
+      pop.mappingMomentsValid = false;
+      pop.mappingMomentsRequested = P::vlasovFusedAccelerationMoments && (step + 1 == pop.ACCSUBCYCLES);
    }
 
    // Semi-Lagrangian acceleration for all cells
 #ifdef USE_GPU
+   const bool measureCost = P::prepareForRebalance && P::loadBalanceMultiConstraint;
+   const double t0 = measureCost ? MPI_Wtime() : 0.0;
    gpu_accelerate_cells(mpiGrid,acceleratedCells,popID,map_order);
+   if (measureCost) {
+      // Cells are accelerated in batches on the GPU, so attribute the measured time by block count.
+      const double elapsed = MPI_Wtime() - t0;
+      Real totalBlocks = 0;
+      for (size_t c=0; c<acceleratedCells.size(); ++c) {
+         totalBlocks += mpiGrid[acceleratedCells[c]]->get_number_of_velocity_blocks(popID);
+      }
+      if (totalBlocks > 0) {
+         for (size_t c=0; c<acceleratedCells.size(); ++c) {
+            SpatialCell* SC = mpiGrid[acceleratedCells[c]];
+            SC->parameters[CellParams::LBCOMPUTETIME] += elapsed * SC->get_number_of_velocity_blocks(popID) / totalBlocks;
+         }
+      }
+   }
 #else
    cpu_accelerate_cells(mpiGrid,acceleratedCells,popID,map_order);
 #endif
@@ -600,6 +640,12 @@ void calculateInterpolatedVelocityMoments(
 ) {
    const vector<CellID>& cells = getLocalCells();
 
+   // Pitch-angle diffusion reads the full-step pressure tensor, so refresh its skip mask along with it
+   const bool updatePADSkipMask = P::artificialPADiff && cp_p11 == CellParams::P_11;
+   if (updatePADSkipMask && P::PADcoefficient < 0) {
+      readNuArrayFromFile();
+   }
+
    //Iterate through all local cells
     #pragma omp parallel for
    for (size_t c=0; c<cells.size(); ++c) {
@@ -627,6 +673,10 @@ void calculateInterpolatedVelocityMoments(
             pop.P[i] = 0.5 * ( pop.P_R[i] + pop.P_V[i] );
          }
       }
+
+      if (updatePADSkipMask) {
+         updatePitchAngleDiffusionSkipMask(*SC);
+      }
    }
 }
 